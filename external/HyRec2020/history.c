@@ -929,6 +929,18 @@ before calling hyrec_allocate().
 ***********************************************************/
 
 void hyrec_allocate(HYREC_DATA *data, double zmax, double zmin) {
+  hyrec_allocate_with_tables(data, zmax, zmin, NULL, NULL);
+}
+
+/***********************************************************
+Same as hyrec_allocate(), but if atomic and fit are not NULL,
+these tables (already read with allocate_and_read_atomic() and
+allocate_and_read_fit()) are used instead of reading the files.
+They can then be shared by several HYREC_DATA structures, and
+are not freed by hyrec_free().
+***********************************************************/
+
+void hyrec_allocate_with_tables(HYREC_DATA *data, double zmax, double zmin, HYREC_ATOMIC *atomic, FIT_FUNC *fit) {
   double DLNA;
   if (MODEL == SWIFT) DLNA = DLNA_SWIFT;
   else DLNA = DLNA_HYREC;
@@ -940,11 +952,19 @@ void hyrec_allocate(HYREC_DATA *data, double zmax, double zmin) {
   data->zmax = (zmax > 3000.? zmax : 3000.);
   data->zmin = zmin;
 
-  data->atomic = (HYREC_ATOMIC *) malloc(sizeof(HYREC_ATOMIC));
-  allocate_and_read_atomic(data->atomic, &data->error, data->path_to_hyrec, data->error_message);
+  if (atomic != NULL && fit != NULL) {
+    data->atomic = atomic;
+    data->fit = fit;
+    data->shared_tables = 1;
+  }
+  else {
+    data->atomic = (HYREC_ATOMIC *) malloc(sizeof(HYREC_ATOMIC));
+    allocate_and_read_atomic(data->atomic, &data->error, data->path_to_hyrec, data->error_message);
 
-  data->fit = (FIT_FUNC *) malloc(sizeof(FIT_FUNC));
-  allocate_and_read_fit(data->fit, &data->error, data->path_to_hyrec, data->error_message);
+    data->fit = (FIT_FUNC *) malloc(sizeof(FIT_FUNC));
+    allocate_and_read_fit(data->fit, &data->error, data->path_to_hyrec, data->error_message);
+    data->shared_tables = 0;
+  }
 
   data->cosmo  = (REC_COSMOPARAMS *) malloc(sizeof(REC_COSMOPARAMS));
   data->cosmo->inj_params = (INJ_PARAMS *)  malloc(sizeof(INJ_PARAMS));
@@ -963,17 +983,19 @@ void hyrec_allocate(HYREC_DATA *data, double zmax, double zmin) {
 
 
 void hyrec_free(HYREC_DATA *data) {
-  free_atomic(data->atomic);
+  if (data->shared_tables == 0) {
+    free_atomic(data->atomic);
+    free(data->atomic);
+    free_fit(data->fit);
+    free(data->fit);
+  }
   free(data->cosmo->inj_params);
   free(data->cosmo);
-  free(data->atomic);
   free(data->xe_output);
   free(data->Tm_output);
   free(data->error_message);
   if (MODEL == FULL) free_radiation(data->rad);
   free(data->rad);
-  free_fit(data->fit);
-  free(data->fit);
 }
 
 /******************************************************************
@@ -177,6 +177,7 @@ typedef struct{
   char *path_to_hyrec;
   RADIATION *rad;
   FIT_FUNC *fit;
+  int shared_tables;  /* 1 if atomic and fit were passed to hyrec_allocate_with_tables() (then not freed by hyrec_free()), 0 if read by hyrec_allocate() */
 } HYREC_DATA;
 
 /*********** EFFECTIVE 3-LEVEL A LA PEEBLES ***************/
@@ -7,6 +7,16 @@
 #include "thermodynamics.h"
 #include "wrap_hyrec.h"
 
+/**
+ * Tables of effective atomic rates, two-photon rates and SWIFT
+ * correction function, read once and shared by all the HyRec runs of
+ * the process (see thermodynamics_hyrec_tables_get()).
+ */
+static HYREC_ATOMIC * hyrec_shared_atomic = NULL;
+static FIT_FUNC * hyrec_shared_fit = NULL;
+static FileName hyrec_shared_path;
+static int hyrec_shared_refcount = 0;
+
 
 /**
  * Initialize the thermohyrec structure, and in particular HyRec 2020.
@@ -21,6 +31,10 @@ int thermodynamics_hyrec_init(struct precision* ppr, struct background * pba, st
 
   /** Summary: */
 
+  /** - define local variables */
+  HYREC_ATOMIC * atomic;
+  FIT_FUNC * fit;
+
   if(phy->thermohyrec_verbose > 0){
     printf(" -> Using the hyrec wrapper programmed by Nils Sch. (Oct2020)\n");
     printf("    implements HyRec2 version Oct 2020 by Yacine Ali-Haimoud, Chris Hirata, and Nanoom Lee\n");
@@ -38,9 +52,12 @@ int thermodynamics_hyrec_init(struct precision* ppr, struct background * pba, st
     printf("    Starting HyRec at z = %.10e until z = %.10e\n",phy->zstart, phy->zend);
   }
 
-  /** - allocate hyrec internally */
+  /** - allocate hyrec internally, with the tables of atomic rates shared by all runs */
   phy->data->path_to_hyrec = ppr->hyrec_path;
-  hyrec_allocate(phy->data, phy->zstart, phy->zend);
+  class_call(thermodynamics_hyrec_tables_get(ppr->hyrec_path,&atomic,&fit,phy->error_message),
+             phy->error_message,
+             phy->error_message);
+  hyrec_allocate_with_tables(phy->data, phy->zstart, phy->zend, atomic, fit);
   /* Error during allocation */
   if(phy->data->error != 0){
     class_call_message(phy->error_message,"hyrec_allocate",phy->data->error_message);
@@ -76,13 +93,130 @@ int thermodynamics_hyrec_init(struct precision* ppr, struct background * pba, st
  */
 int thermodynamics_hyrec_free(struct thermohyrec* phy){
 
-  /* We just need to free hyrec (without error management) */
+  /* We just need to free hyrec (without error management), and release the shared tables */
   hyrec_free(phy->data);
+  if (phy->data->shared_tables == 1) {
+    class_call(thermodynamics_hyrec_tables_release(phy->error_message),
+               phy->error_message,
+               phy->error_message);
+  }
   free(phy->data);
 
   return _SUCCESS_;
 }
 
+/**
+ * Get the tables of atomic rates and of the SWIFT correction function
+ * read from the files in the directory path, shared read-only by all
+ * the runs of the process: they are only read by the first call, and
+ * kept in memory for the next runs. Each call must be followed by a
+ * call to thermodynamics_hyrec_tables_release().
+ *
+ * If tables read from another directory are still in use, the
+ * returned pointers are NULL, and the caller should read its own
+ * copy (as done by hyrec_allocate_with_tables()).
+ *
+ * @param path          Input: directory containing the HyRec tables
+ * @param atomic        Output: pointer to the table of atomic rates
+ * @param fit           Output: pointer to the table of correction function
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_hyrec_tables_get(char * path,
+                                    HYREC_ATOMIC ** atomic,
+                                    FIT_FUNC ** fit,
+                                    ErrorMsg error_message){
+  int status;
+
+#pragma omp critical (hyrec_shared)
+  {
+    status = thermodynamics_hyrec_tables_get_serial(path,atomic,fit,error_message);
+  }
+
+  return status;
+}
+
+/**
+ * Release the tables obtained with thermodynamics_hyrec_tables_get().
+ * They are kept in memory for the next runs.
+ *
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_hyrec_tables_release(ErrorMsg error_message){
+
+#pragma omp critical (hyrec_shared)
+  {
+    hyrec_shared_refcount--;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Body of thermodynamics_hyrec_tables_get(), to be called by one
+ * thread at a time.
+ *
+ * @param path          Input: directory containing the HyRec tables
+ * @param atomic        Output: pointer to the table of atomic rates
+ * @param fit           Output: pointer to the table of correction function
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_hyrec_tables_get_serial(char * path,
+                                           HYREC_ATOMIC ** atomic,
+                                           FIT_FUNC ** fit,
+                                           ErrorMsg error_message){
+
+  int error = 0;
+  char hyrec_message[SIZE_ErrorM] = "";
+
+  *atomic = NULL;
+  *fit = NULL;
+
+  /** - tables read from another directory: replace them if they are not used anymore */
+  if ((hyrec_shared_atomic != NULL) && (strcmp(hyrec_shared_path,path) != 0)) {
+    if (hyrec_shared_refcount > 0)
+      return _SUCCESS_;
+    free_atomic(hyrec_shared_atomic);
+    free(hyrec_shared_atomic);
+    free_fit(hyrec_shared_fit);
+    free(hyrec_shared_fit);
+    hyrec_shared_atomic = NULL;
+    hyrec_shared_fit = NULL;
+  }
+
+  /** - read the tables the first time */
+  if (hyrec_shared_atomic == NULL) {
+
+    class_alloc(hyrec_shared_atomic,sizeof(HYREC_ATOMIC),error_message);
+    class_alloc(hyrec_shared_fit,sizeof(FIT_FUNC),error_message);
+
+    allocate_and_read_atomic(hyrec_shared_atomic, &error, path, hyrec_message);
+    if (error == 0)
+      allocate_and_read_fit(hyrec_shared_fit, &error, path, hyrec_message);
+
+    if (error != 0) {
+      free(hyrec_shared_atomic);
+      free(hyrec_shared_fit);
+      hyrec_shared_atomic = NULL;
+      hyrec_shared_fit = NULL;
+      class_stop(error_message,"%s",hyrec_message);
+    }
+
+    strcpy(hyrec_shared_path,path);
+  }
+
+  hyrec_shared_refcount++;
+  *atomic = hyrec_shared_atomic;
+  *fit = hyrec_shared_fit;
+
+  return _SUCCESS_;
+}
+
 /**
  * Calculate the derivative of the hydrogen HII ionization fraction
  *
@@ -42,6 +42,12 @@ extern "C" {
 
   int thermodynamics_hyrec_free(struct thermohyrec* phy);
 
+  int thermodynamics_hyrec_tables_get(char * path, HYREC_ATOMIC ** atomic, FIT_FUNC ** fit, ErrorMsg error_message);
+
+  int thermodynamics_hyrec_tables_release(ErrorMsg error_message);
+
+  int thermodynamics_hyrec_tables_get_serial(char * path, HYREC_ATOMIC ** atomic, FIT_FUNC ** fit, ErrorMsg error_message);
+
   int hyrec_dx_H_dz(struct thermodynamics* pth, struct thermohyrec* phy, double x_H, double x_He, double xe, double nH, double z, double Hz, double Tmat, double Trad, double alpha, double me, double *dx_H_dz);
   int hyrec_dx_He_dz(struct thermodynamics* pth, struct thermohyrec* phy, double x_H, double x_He, double xe, double nH, double z, double Hz, double Tmat, double Trad, double alpha, double me, double *dx_He_dz);
 
@@ -253,6 +253,35 @@ int array_integrate_all_trapzd_or_spline(
 			       int result_size, /** from 1 to n_columns */
 			       ErrorMsg errmsg);
 
+  int array_interpolate_spline_guided(
+                                      double * __restrict__ x_array,
+                                      int n_lines,
+                                      double * __restrict__ array,
+                                      double * __restrict__ array_splined,
+                                      int n_columns,
+                                      double x,
+                                      int * __restrict__ last_index,
+                                      double * __restrict__ result,
+                                      int result_size, /** from 1 to n_columns */
+                                      ErrorMsg errmsg);
+
+  int array_index_guide_init(
+                             double * x_array,
+                             int n_lines,
+                             double (*u_of_x)(double),
+                             int n_guide,
+                             int * guide,
+                             double * u_min,
+                             double * du,
+                             ErrorMsg errmsg);
+
+  int array_index_guide_find(
+                             int * guide,
+                             int n_guide,
+                             double u_min,
+                             double du,
+                             double u);
+
   int array_search_bisect(
                        int n_lines,
                        double * __restrict__ array,
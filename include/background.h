@@ -8,6 +8,8 @@
 #include "growTable.h"
 #include "arrays.h"
 #include "dei_rkck.h"
+#include "evolver_ndf15.h"
+#include "evolver_rkck.h"
 #include "parser.h"
 
 /** list of possible types of spatial curvature */
@@ -243,6 +245,20 @@ struct background
   //@}
 
 
+  /** @name - index guide for finding the interpolation interval in constant time */
+
+  //@{
+
+  short has_index_guide;     /**< if _TRUE_, background_at_z(), background_tau_of_z() and background_z_of_tau() locate their interval without bisection in inter_normal mode */
+  double dloga;              /**< step of the (uniform) loga_table */
+  int tau_guide_size;        /**< number of nodes in tau_guide */
+  int * tau_guide;           /**< tau_guide[index_guide] = index of the tau_table interval containing the node number index_guide, uniformly spaced in log(tau) */
+  double tau_guide_logtau_min; /**< value of log(tau) at the first node of tau_guide */
+  double tau_guide_dlogtau;  /**< step in log(tau) between the nodes of tau_guide */
+
+  //@}
+
+
   /** @name - all indices for the vector of background quantities to be integrated (=bi)
    *
    * Most background quantities can be immediately inferred from the
@@ -317,6 +333,22 @@ struct background
 
   //@}
 
+  /**
+   *@name - optional tables of the background ncdm integrals over momenta, as a function of x = a M_ncdm (i.e. a m / T_ncdm)
+   */
+
+  //@{
+
+  short has_ncdm_bg_table;        /**< if _TRUE_, background_functions() reads rho, p, pseudo-p of each ncdm species in these tables instead of summing over q_ncdm_bg */
+  int ncdm_bg_table_size;         /**< number of values of x in the tables */
+  double * ncdm_bg_table_logx;    /**< values of log(x), uniformly spaced, common to all species */
+  double ** ncdm_bg_table;        /**< ncdm_bg_table[n_ncdm][index_x*3+i] = log of the integrals giving rho (i=0), p (i=1), pseudo-p (i=2), without factor_ncdm*(1+z)^4 */
+  double ** d2ncdm_bg_table;      /**< second derivatives of ncdm_bg_table with respect to log(x), for spline interpolation */
+  double * ncdm_bg_q1_moment;     /**< sum of w q over q_ncdm_bg, for the expansion below the smallest tabulated x */
+  double * ncdm_bg_q3_moment;     /**< sum of w q^3 over q_ncdm_bg, for the expansion below the smallest tabulated x */
+
+  //@}
+
   /** @name - technical parameters */
 
   //@{
@@ -482,6 +514,20 @@ extern "C" {
                               double * pseudo_p
                               );
 
+  int background_ncdm_momenta_table_init(
+                                         struct precision *ppr,
+                                         struct background *pba
+                                         );
+
+  int background_ncdm_momenta_tabulated(
+                                        struct background *pba,
+                                        int n_ncdm,
+                                        double z,
+                                        double * rho,
+                                        double * p,
+                                        double * pseudo_p
+                                        );
+
   int background_ncdm_M_from_Omega(
                                    struct precision *ppr,
                                    struct background *pba,
@@ -0,0 +1,132 @@
+/** @file batch.h Documented includes for batch module */
+
+#ifndef __BATCH__
+#define __BATCH__
+
+#include "input.h"
+#include "output.h"
+
+/**
+ * List of the successive stages of a CLASS run, in the order of
+ * main/class.c. For each cosmology of a batch, we keep track of the
+ * last stage successfully performed.
+ */
+
+enum batch_stage {
+  batch_none,           /**< nothing done yet */
+  batch_input,          /**< input_read_from_file() done */
+  batch_background,     /**< background_init() done */
+  batch_thermodynamics, /**< thermodynamics_init() done */
+  batch_perturbations,  /**< perturbations_init() done */
+  batch_primordial,     /**< primordial_init() done */
+  batch_fourier,        /**< fourier_init() done */
+  batch_transfer,       /**< transfer_init() done */
+  batch_harmonic,       /**< harmonic_init() done */
+  batch_lensing,        /**< lensing_init() done */
+  batch_distortions     /**< distortions_init() done */
+};
+
+/**
+ * Structure pointing towards all the structures describing one
+ * cosmology of a batch (they are allocated by the caller, like the
+ * structures declared in main/class.c), and storing the status of
+ * its computation.
+ */
+
+struct batch_cosmology {
+
+  struct file_content * pfc;    /**< input parameters of this cosmology */
+
+  struct precision * ppr;       /**< pointer to precision structure */
+  struct background * pba;      /**< pointer to background structure */
+  struct thermodynamics * pth;  /**< pointer to thermodynamics structure */
+  struct perturbations * ppt;   /**< pointer to perturbation structure */
+  struct primordial * ppm;      /**< pointer to primordial structure */
+  struct fourier * pfo;         /**< pointer to fourier structure */
+  struct transfer * ptr;        /**< pointer to transfer structure */
+  struct harmonic * phr;        /**< pointer to harmonic structure */
+  struct lensing * ple;         /**< pointer to lensing structure */
+  struct distortions * psd;     /**< pointer to distortions structure */
+  struct output * pop;          /**< pointer to output structure */
+
+  enum batch_stage stage_done;  /**< last stage successfully performed; if smaller than batch_distortions after batch_init(), the computation failed */
+
+  ErrorMsg error_message;       /**< error message in case of failure of this cosmology */
+
+};
+
+/*************************************************************************************************************/
+/* @cond INCLUDE_WITH_DOXYGEN */
+/*
+ * Boilerplate for C++
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int batch_init(
+                 int cosmo_size,
+                 struct batch_cosmology * pbc,
+                 ErrorMsg error_message
+                 );
+
+  int batch_init_early_stages(
+                              struct batch_cosmology * pbc
+                              );
+
+  int batch_init_late_stages(
+                             struct batch_cosmology * pbc
+                             );
+
+  int batch_init_stage(
+                       struct batch_cosmology * pbc,
+                       enum batch_stage stage
+                       );
+
+  int batch_free(
+                 int cosmo_size,
+                 struct batch_cosmology * pbc
+                 );
+
+  int batch_free_stage(
+                       struct batch_cosmology * pbc,
+                       enum batch_stage stage
+                       );
+
+  int batch_update(
+                   struct batch_cosmology * pbc,
+                   struct file_content * pfc_new
+                   );
+
+  int batch_mark_stages(
+                        struct file_content * pfc,
+                        int index,
+                        short * dirty
+                        );
+
+  short batch_depends_on(
+                         struct batch_cosmology * pbc,
+                         enum batch_stage stage,
+                         enum batch_stage other
+                         );
+
+  int batch_cosmology_alloc(
+                            struct batch_cosmology * pbc,
+                            struct file_content * pfc,
+                            ErrorMsg error_message
+                            );
+
+  int batch_cosmology_free(
+                           struct batch_cosmology * pbc
+                           );
+
+  int batch_free_temporary(
+                           struct batch_cosmology * pbc
+                           );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* @endcond */
@@ -31,5 +31,6 @@
 #include "distortions.h"
 #include "lensing.h"
 #include "output.h"
+#include "batch.h"
 
 #endif
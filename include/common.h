@@ -67,6 +67,8 @@ typedef char FileName[_FILENAMESIZE_];
 
 #define _DELIMITER_ "\t" /**< character used for delimiting titles in the title strings */
 
+#define _HASH_INIT_ 14695981039346656037ULL /**< initial value (FNV-1a offset basis) for hashes computed with class_hash() */
+
 #ifndef __CLASSDIR__
 #define __CLASSDIR__ "." /**< The directory of CLASS. This is set to the absolute path to the CLASS directory so this is just a failsafe. */
 #endif
@@ -92,6 +94,9 @@ int file_exists(const char *fname);
 int compare_doubles(const void * a,
                     const void * b);
 int string_begins_with(char* thestring, char beginchar);
+unsigned long long class_hash(unsigned long long hash,
+                              const void * data,
+                              size_t size);
 
 /* general CLASS macros */
 
@@ -350,6 +355,57 @@ enum evolver_type {
   ndf15 /* stiff integrator */
 };
 
+struct jacobian_entries;
+struct jacobian_cache;
+
+/**
+ * Common prototype of all evolvers (evolver_rk(), evolver_ndf15()),
+ * so that a module can choose one of them at run time (possibly a
+ * different one for each integration interval) and call it through a
+ * pointer of this type. The arguments that are specific to one
+ * evolver are ignored by the others and can be NULL.
+ */
+typedef int (*evolver_function)(
+                                int (*derivs)(double x,
+                                              double * y,
+                                              double * dy,
+                                              void * parameters_and_workspace,
+                                              ErrorMsg error_message),
+                                double x_ini,
+                                double x_end,
+                                double * y,
+                                int * used_in_output,
+                                int y_size,
+                                void * parameters_and_workspace,
+                                double tolerance,
+                                double minimum_variation,
+                                int (*evaluate_timescale)(double x,
+                                                          void * parameters_and_workspace,
+                                                          double * timescale,
+                                                          ErrorMsg error_message),
+                                double timestep_over_timescale,
+                                double * x_sampling,
+                                int x_size,
+                                int (*output)(double x,
+                                              double y[],
+                                              double dy[],
+                                              int index_x,
+                                              void * parameters_and_workspace,
+                                              ErrorMsg error_message),
+                                int (*print_variables)(double x,
+                                                       double y[],
+                                                       double dy[],
+                                                       void * parameters_and_workspace,
+                                                       ErrorMsg error_message),
+                                int (*jacobian)(double x,
+                                                double * y,
+                                                struct jacobian_entries * jac_entries,
+                                                void * parameters_and_workspace,
+                                                ErrorMsg error_message),
+                                struct jacobian_cache * jacobian_cache,
+                                ErrorMsg error_message
+                                );
+
 /**
  * List of ways in which matter power spectrum P(k) can be defined.
  * The standard definition is the first one (delta_m_squared) but
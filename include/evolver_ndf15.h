@@ -6,6 +6,18 @@
 #define TINY 1e-50
 /**************************************************************/
 
+/* List of non-zero entries of a Jacobian, filled by the optional
+   callback passed to evolver_ndf15 by modules able to compute their
+   Jacobian analytically. Indices go from 0 to neq-1. Entries with the
+   same row and column are summed. */
+struct jacobian_entries{
+	int size;     /* Number of entries written by the callback */
+	int size_max; /* Maximum number of entries */
+	int *row;     /* row[0..size-1]: row index (equation) */
+	int *col;     /* col[0..size-1]: column index (variable) */
+	double *value; /* value[0..size-1]: d(dy[row])/d(y[col]) */
+};
+
 struct jacobian{
 /*Stuff for normal method: */
 	double **dfdy;
@@ -21,7 +33,8 @@ struct jacobian{
 	int trust_sparse; /* Number of times a pattern is repeated (actually included) before we trust it. */
 	int has_grouping;
 	int has_pattern;
-	int new_jacobian; /* True if sp_ludcmp has not been run on the current jacobian. */
+	int new_jacobian; /* True if the current jacobian has not been factorised yet. */
+	int has_symbolic; /* True if Numerical holds the ordering and pivot sequence of the current pattern, so that sp_refactor can be used. */
 	int cnzmax;
 	int *col_group; /* Column grouping. Groups go from 0 to max_group*/
 	int *col_wi; /* Workarray for column grouping*/
@@ -31,6 +44,28 @@ struct jacobian{
 	sp_num *Numerical; /*Stores the LU decomposition.*/
 	int *Cp; /* Stores the column pointers of the spJ+spJ' sparsity pattern. */
 	int *Ci; /* Stores the row indices of the  spJ+spJ' sparsity pattern. */
+/*Analytic jacobian, if provided:*/
+	int analytic_stuff_initialized;
+	struct jacobian_entries entries; /* Entries written by the callback */
+	struct jacobian_entries sorted;  /* Same entries sorted by row within columns */
+	int *entries_count; /* Work array for counting sort */
+};
+
+/* Jacobians kept from one call of evolver_ndf15 to the next, so that
+   the sparsity pattern, column grouping, AMD ordering and pivot
+   sequence found for a system are reused when integrating a system with
+   the same structure (e.g. the same perturbation equations in another
+   interval), until jacobian_cache_reset is called, or copied from
+   another cache with jacobian_cache_copy. Jacobians are
+   identified by neq, by the key set by the caller before each call, and
+   by the use of an analytic jacobian. */
+struct jacobian_cache{
+	int key;       /* Set by the caller: identifies the structure of the next system to integrate */
+	int size;      /* Number of stored jacobians */
+	int *neq;      /* neq[0..size-1] */
+	int *keys;     /* keys[0..size-1] */
+	int *analytic; /* analytic[0..size-1]: true if filled by analytic_jac */
+	struct jacobian **jac; /* jac[0..size-1] */
 };
 
 struct numjac_workspace{
@@ -85,6 +120,19 @@ extern "C" {
                    int *fevals,
                    ErrorMsg error_message);
 
+  int jacobian_cache_init(struct jacobian_cache *pjc);
+  int jacobian_cache_get(struct jacobian_cache *pjc, int neq, int analytic, struct jacobian **pjac,
+                         ErrorMsg error_message);
+  int jacobian_cache_reset(struct jacobian_cache *pjc);
+  int jacobian_cache_copy(struct jacobian_cache *out, struct jacobian_cache *in,
+                          ErrorMsg error_message);
+  int jacobian_cache_free(struct jacobian_cache *pjc);
+  int initialize_jacobian_entries(struct jacobian *jac, int neq, ErrorMsg error_message);
+  int uninitialize_jacobian_entries(struct jacobian *jac);
+  int analytic_jac(int (*jacobian)(double x, double * y, struct jacobian_entries * jac_entries,
+                                   void * parameters_and_workspace, ErrorMsg error_message),
+                   double t, double *y, struct jacobian *jac, int neq,
+                   void * parameters_and_workspace_for_derivs, ErrorMsg error_message);
   int numjac(int (*derivs)(double x,double * y,double * dy,void * parameters_and_workspace,ErrorMsg error_message),
 	     double t, double *y, double *fval, struct jacobian *jac, struct numjac_workspace *nj_ws,
 	     double thresh, int neq, int *nfe,
@@ -113,6 +161,9 @@ int evolver_ndf15(
 		ErrorMsg error_message),
 	int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
 		ErrorMsg error_message),
+	int (*jacobian)(double x, double * y, struct jacobian_entries * jac_entries,
+		void * parameters_and_workspace, ErrorMsg error_message),
+	struct jacobian_cache * jacobian_cache,
 	ErrorMsg error_message);
 
 
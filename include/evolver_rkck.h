@@ -1,10 +1,13 @@
-#ifndef __EVO__
-#define __EVO__
+#ifndef __EVO_RKCK__
+#define __EVO_RKCK__
 
 #include "dei_rkck.h"
 
 /**************************************************************/
 
+struct jacobian_entries; /* defined in evolver_ndf15.h */
+struct jacobian_cache;   /* defined in evolver_ndf15.h */
+
 /**
  * Boilerplate for C++
  */
@@ -43,6 +46,12 @@ extern "C" {
 					     double dy[],
 					     void * parameters_and_workspace,
 					     ErrorMsg error_message),
+		      int (*jacobian)(double x,
+				      double * y,
+				      struct jacobian_entries * jac_entries,
+				      void * parameters_and_workspace,
+				      ErrorMsg error_message),
+		      struct jacobian_cache * jacobian_cache,
 		      ErrorMsg error_message);
 
 #ifdef __cplusplus
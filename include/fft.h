@@ -0,0 +1,46 @@
+/**
+ * definitions for module fft.c
+ */
+
+#ifndef __FFT__
+#define __FFT__
+
+#include "common.h"
+
+/**
+ * Boilerplate for C++
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int fft_size(
+               int n_min
+               );
+
+  int fft_twiddle_init(
+                       double * twiddle,
+                       int n,
+                       ErrorMsg error_message
+                       );
+
+  int fft_complex(
+                  double * data,
+                  double * twiddle,
+                  int n,
+                  int sign
+                  );
+
+  int fft_real_pair(
+                    double * data,
+                    double * twiddle,
+                    int n,
+                    double * spectrum_a,
+                    double * spectrum_b
+                    );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
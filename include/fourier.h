@@ -17,8 +17,6 @@ enum pk_outputs {pk_linear,pk_nonlinear};
 
 enum source_extrapolation {extrap_zero,extrap_only_max,extrap_only_max_units,extrap_max_scaled,extrap_hmcode,extrap_user_defined};
 
-enum halofit_integral_type {halofit_integral_one, halofit_integral_two, halofit_integral_three};
-
 enum hmcode_baryonic_feedback_model {nl_emu_dmonly, nl_owls_dmonly, nl_owls_ref, nl_owls_agn, nl_owls_dblim, nl_user_defined};
 enum out_sigmas {out_sigma,out_sigma_prime,out_sigma_disp};
 
@@ -202,13 +200,29 @@ struct fourier {
 
 struct fourier_workspace {
 
+  /** @name - quantitites used by Halofit */
+
+  //@{
+
+  int halofit_k_size;   /**< number of wavenumbers in the integrals giving sigma(R) and its derivatives */
+  double * halofit_k;   /**< list of these wavenumbers */
+  double * halofit_k2;  /**< their squares */
+  double * halofit_w8;  /**< weights such that sum_i w8[i] f(k_i) is the integral over k of the natural cubic spline of f(k) */
+
+  //@}
+
   /** @name - quantitites used by HMcode */
 
   //@{
 
   double * rtab; /** List of R values */
-  double * stab; /** List of Sigma Values */
-  double * ddstab; /** Splined sigma */
+  double * stab; /** List of Sigma Values (allocated separately for each thread) */
+  double * ddstab; /** Splined sigma (allocated separately for each thread) */
+
+  int sigtab_k_size;      /**< number of wavenumbers in the integrals giving the table of sigma(R) */
+  double * sigtab_k;      /**< list of these wavenumbers, in increasing order */
+  double * sigtab_t;      /**< corresponding values of the integration variable t=1/(1+k), in increasing order */
+  double * sigtab_window; /**< time-independent part of the integrands, sigtab_window[index_t*n_hmcode_tables+index_r] = k^3 W^2(k R)/(t(1-t)) */
 
   double * growtable;
   double * ztable;
@@ -419,23 +433,29 @@ extern "C" {
                       double *lnpk_l,
                       double *ddlnpk_l,
                       double *k_nl,
-                      short * halofit_found_k_max
+                      short * halofit_found_k_max,
+                      struct fourier_workspace * pnw
                       );
 
   int fourier_halofit_integrate(
-                                struct fourier *pfo,
-                                double * integrand_array,
-                                int integrand_size,
-                                int ia_size,
-                                int index_ia_k,
-                                int index_ia_pk,
-                                int index_ia_sum,
-                                int index_ia_ddsum,
+                                struct fourier_workspace * pnw,
+                                double * integrand,
                                 double R,
-                                enum halofit_integral_type type,
-                                double * sum
+                                double * sum1,
+                                double * sum2,
+                                double * sum3
                                 );
 
+  int fourier_halofit_workspace_init(
+                                     struct precision *ppr,
+                                     struct fourier *pfo,
+                                     struct fourier_workspace * pnw
+                                     );
+
+  int fourier_halofit_workspace_free(
+                                     struct fourier_workspace * pnw
+                                     );
+
   int fourier_hmcode(
                      struct precision *ppr,
                      struct background *pba,
@@ -489,6 +509,13 @@ extern "C" {
                                  struct fourier_workspace * pnw
                                  );
 
+  int fourier_hmcode_fill_sigtab_window(
+                                        struct precision * ppr,
+                                        struct background * pba,
+                                        struct fourier * pfo,
+                                        struct fourier_workspace * pnw
+                                        );
+
   int fourier_hmcode_fill_growtab(
                                   struct precision *ppr,
                                   struct background * pba,
@@ -200,7 +200,7 @@ extern "C" {
                           int index_l,
                           int cl_integrand_num_columns,
                           double * cl_integrand,
-                          double * primordial_pk,
+                          double * primordial_pk_table,
                           double * transfer_ic1,
                           double * transfer_ic2
                           );
@@ -14,6 +14,12 @@
 #define _HYPER_CHUNK_ 16
 #define _TWO_OVER_THREE_ 0.666666666666666666666666666667e0
 #define _HIS_BYTE_ALIGNMENT_ 16
+/* Compile the vectorised kernels for several instruction sets, the best one being selected at runtime (only with compilers supporting function multiversioning) */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) && defined(__x86_64__) && defined(__linux__)
+#define _HYPER_TARGET_CLONES_ __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define _HYPER_TARGET_CLONES_
+#endif
 
 typedef struct HypersphericalInterpolationStructure{
   int K;                 //Sign of the curvature, (0,-1,1)
@@ -31,6 +37,33 @@ typedef struct HypersphericalInterpolationStructure{
   double *dphi;       //Same as phivec, but containing derivatives.
 } HyperInterpStruct;
 
+/**
+ * Flat-space interpolation structure shared between runs, with its
+ * reference count (see hyperspherical_HIS_flat_shared_get())
+ */
+typedef struct HypersphericalSharedTable{
+  unsigned long long key;  //Hash of all parameters of the table, including its x-sampling
+  HyperInterpStruct HIS;   //The interpolation structure itself
+  void * map;              //Memory-mapped file containing the arrays of HIS (NULL if they were allocated)
+  size_t map_size;         //Size of the mapped file
+  int refcount;            //Number of runs currently using this table
+  struct HypersphericalSharedTable * next;
+} HyperSharedTable;
+
+/**
+ * Header of a binary file containing an interpolation structure
+ */
+typedef struct HypersphericalSharedFileHeader{
+  char magic[8];           //Always "CLASSHIS"
+  unsigned long long key;  //Same as in HyperSharedTable
+  int K;
+  int l_size;
+  int x_size;
+  int trig_order;
+  double beta;
+  double delta_x;
+} HyperSharedFileHeader;
+
 struct WKB_parameters{
    int K;
    int l;
@@ -56,7 +89,68 @@ extern "C" {
                                 HyperInterpStruct *pHIS,
                                 ErrorMsg error_message);
 
+  int hyperspherical_HIS_create_on_grid(int K,
+                                        double beta,
+                                        int nl,
+                                        int *lvec,
+                                        double xmin,
+                                        double deltax,
+                                        int nx,
+                                        int l_WKB,
+                                        double phiminabs,
+                                        HyperInterpStruct *pHIS,
+                                        ErrorMsg error_message);
+
   int hyperspherical_HIS_free(HyperInterpStruct *pHIS, ErrorMsg error_message);
+
+  int hyperspherical_HIS_flat_shared_get(int nl,
+                                         int *lvec,
+                                         double xmin,
+                                         double xmax,
+                                         double sampling,
+                                         int l_WKB,
+                                         double phiminabs,
+                                         short use_file,
+                                         char *directory,
+                                         int verbose,
+                                         HyperInterpStruct **ppHIS,
+                                         ErrorMsg error_message);
+
+  int hyperspherical_HIS_flat_shared_release(HyperInterpStruct *pHIS,
+                                             ErrorMsg error_message);
+
+  int hyperspherical_HIS_flat_shared_get_serial(int nl,
+                                                int *lvec,
+                                                double xmin,
+                                                double xmax,
+                                                double sampling,
+                                                int l_WKB,
+                                                double phiminabs,
+                                                short use_file,
+                                                char *directory,
+                                                int verbose,
+                                                HyperInterpStruct **ppHIS,
+                                                ErrorMsg error_message);
+
+  int hyperspherical_HIS_flat_shared_release_serial(HyperInterpStruct *pHIS,
+                                                    ErrorMsg error_message);
+
+  int hyperspherical_HIS_flat_shared_free(HyperSharedTable *pHST,
+                                          ErrorMsg error_message);
+
+  int hyperspherical_HIS_write_file(char *filename,
+                                    unsigned long long key,
+                                    HyperInterpStruct *pHIS,
+                                    ErrorMsg error_message);
+
+  int hyperspherical_HIS_map_file(char *filename,
+                                  unsigned long long key,
+                                  int nl,
+                                  int nx,
+                                  double deltax,
+                                  HyperSharedTable *pHST,
+                                  short *found,
+                                  ErrorMsg error_message);
   int hyperspherical_forwards_recurrence(int K,
                                          int lmax,
                                          double beta,
@@ -151,6 +245,7 @@ int hyperspherical_forwards_recurrence_chunk(int K,
                                           int *ignore2);
 
   size_t hyperspherical_HIS_size(int nl, int nx);
+  size_t hyperspherical_HIS_int_size(int nl);
   int hyperspherical_update_pointers(HyperInterpStruct *pHIS_local,
                                      void * HIS_storage_shared);
 
@@ -162,6 +257,18 @@ int hyperspherical_forwards_recurrence_chunk(int K,
                                                   double *dPhi,
                                                   double *d2Phi);
 
+  int hyperspherical_Hermite4_convolution_Phi(HyperInterpStruct *pHIS,
+                                              int nxi,
+                                              int lnum,
+                                              double * __restrict__ xinterp,
+                                              double * __restrict__ integrand,
+                                              double * __restrict__ w_trapz,
+                                              double * __restrict__ cscK,
+                                              int cscK_power,
+                                              double factor,
+                                              double *result,
+                                              double *radial_last);
+
   int hyperspherical_Hermite3_interpolation_vector_Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi, ErrorMsg error_message);
   int hyperspherical_Hermite3_interpolation_vector_dPhi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *dPhi, ErrorMsg error_message);
   int hyperspherical_Hermite3_interpolation_vector_d2Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *d2Phi, ErrorMsg error_message);
@@ -209,6 +209,28 @@ enum target_names {theta_s, theta_s_100, Omega_dcdmdr, omega_dcdmdr, Omega_scf,
 /* Important: add one for each new target_names */
 enum computation_stage {cs_background, cs_thermodynamics, cs_perturbations, cs_primordial, cs_nonlinear, cs_transfer, cs_spectra};
 
+/**
+ * Groups of parameters read successively by input_read_parameters()
+ * (plus the precision parameters read by input_read_precisions()).
+ * When the field read_by of the file_content structure is allocated,
+ * each parameter is flagged with the bitmask of the groups reading it,
+ * which tells which modules depend on it (see batch_update()).
+ */
+
+enum input_group {
+  input_group_precision,
+  input_group_general,
+  input_group_species,
+  input_group_injection,
+  input_group_nonlinear,
+  input_group_primordial,
+  input_group_spectra,
+  input_group_lensing,
+  input_group_distortions,
+  input_group_additional,
+  input_group_output
+};
+
 /**
  * Structure for all temporary parameters for background fzero function
  */
@@ -448,6 +470,13 @@ extern "C" {
                                    struct output *pop,
                                    ErrorMsg errmsg);
 
+  int input_read_group_start(struct file_content * pfc,
+                             short * read_before);
+
+  int input_read_group_end(struct file_content * pfc,
+                           short * read_before,
+                           enum input_group group);
+
   int input_write_info(struct file_content * pfc,
                        struct output * pop,
                        ErrorMsg errmsg);
@@ -4,6 +4,19 @@
 #define __LENSING__
 
 #include "harmonic.h"
+#include "fft.h"
+
+/**
+ * Wigner d-functions and lensed correlation functions used by the
+ * FFT-based transforms of lensing_lensed_cl_fft()
+ */
+
+enum lensing_fft_d {fft_d00, fft_d11, fft_d1m1, fft_d2m2, fft_d20, fft_d3m1, fft_d4m2, fft_d22, fft_d31, fft_d3m3, fft_d40, fft_d4m4, fft_d_size};
+enum lensing_fft_ksi {fft_ksi, fft_ksiX, fft_ksip, fft_ksim, fft_ksi_size};
+
+#define _LENSING_FFT_TERMS_ 20 /**< number of terms in the lensed correlation functions, see lensing_fft_term() */
+#define _LENSING_L_TILE_ 16 /**< number of multipoles per tile in lensing_lensed_cl_all() */
+#define _LENSING_MU_TILE_ 64 /**< number of values of mu per tile in lensing_lensed_cl_all() */
 
 /**
  * Structure containing everything about lensed spectra that other modules need to know.
@@ -125,6 +138,14 @@ extern "C" {
                       struct lensing * ple
                       );
 
+  int lensing_lensed_cl_reset(
+                              struct lensing * ple
+                              );
+
+  int lensing_lensed_cl_normalize(
+                                  struct lensing * ple
+                                  );
+
   int lensing_lensed_cl_tt(
                            double *ksi,
                            double **d00,
@@ -150,6 +171,22 @@ extern "C" {
                               int nmu,
                               struct lensing * ple
                               );
+
+  int lensing_lensed_cl_all(
+                            double *ksi,
+                            double *ksiX,
+                            double *ksip,
+                            double *ksim,
+                            double **d00,
+                            double **d20,
+                            double **d22,
+                            double **d2m2,
+                            double *w8,
+                            int mu_start,
+                            int nmu,
+                            struct lensing * ple
+                            );
+
   int lensing_addback_cl_tt(
                             struct lensing *ple,
                             double *cl_tt
@@ -166,6 +203,96 @@ extern "C" {
                                double *cl_bb
                                );
 
+  int lensing_lensed_cl_quadrature(
+                                   struct precision * ppr,
+                                   struct lensing * ple,
+                                   double * cl_tt,
+                                   double * cl_te,
+                                   double * cl_ee,
+                                   double * cl_bb,
+                                   double * cl_pp
+                                   );
+
+  int lensing_lensed_cl_fft(
+                            struct precision * ppr,
+                            struct lensing * ple,
+                            double * cl_tt,
+                            double * cl_te,
+                            double * cl_ee,
+                            double * cl_bb,
+                            double * cl_pp
+                            );
+
+  int lensing_fft_term(
+                       int index_term,
+                       double l,
+                       double sigma2,
+                       double Cgl2,
+                       int * index_ksi,
+                       int * index_d,
+                       short * leading,
+                       double * q,
+                       double * a
+                       );
+
+  double lensing_fft_blend(
+                           double l,
+                           int l_switch
+                           );
+
+  double lensing_fft_taper(
+                           double theta,
+                           double theta_taper,
+                           double theta_max
+                           );
+
+  double lensing_fft_cl_at_l(
+                             double * cl,
+                             int lmax,
+                             double l
+                             );
+
+  double lensing_fft_damping(
+                             int index_kernel,
+                             double vx2
+                             );
+
+  int lensing_fft_wigner_d(
+                           double * mu,
+                           int num_mu,
+                           int lmax,
+                           short * has_d,
+                           double *** d,
+                           int index_start,
+                           double * buffer,
+                           int block_size,
+                           ErrorMsg error_message
+                           );
+
+  int lensing_fft_spectra(
+                          double * a1,
+                          double * a2,
+                          int n_a,
+                          double * twiddle,
+                          int n_fft,
+                          double * work,
+                          double * spectrum1,
+                          double * spectrum2
+                          );
+
+  int lensing_fft_correlate(
+                            double * spectrum_a1,
+                            double * spectrum_k1,
+                            double * spectrum_a2,
+                            double * spectrum_k2,
+                            double * twiddle,
+                            int n_fft,
+                            double * work,
+                            double * out1,
+                            double * out2,
+                            int n_out
+                            );
+
 
   int lensing_X000(
                    double * mu,
@@ -14,6 +14,10 @@ TYPE NAME;
 #define class_precision_parameter(NAME,TYPE,DEF_VALUE)          \
 class_read_ ## TYPE(#NAME,ppr->NAME);
 #endif
+#ifdef __HASH_PRECISION_PARAMETER__
+#define class_precision_parameter(NAME,TYPE,DEF_VALUE)          \
+hash = class_hash(hash,&(ppr->NAME),sizeof(ppr->NAME));
+#endif
 
 
 #ifdef __ASSIGN_DEFAULT_PRECISION__      
@@ -29,6 +33,10 @@ FileName NAME;
 #define class_string_parameter(NAME,DIR,STRING)     \
 class_read_string(STRING,ppr->NAME);
 #endif
+#ifdef __HASH_PRECISION_PARAMETER__
+#define class_string_parameter(NAME,DIR,STRING)     \
+hash = class_hash(hash,ppr->NAME,strlen(ppr->NAME));
+#endif
 
 
 #ifdef __ASSIGN_DEFAULT_PRECISION__      
@@ -43,3 +51,7 @@ REAL_TP NAME;
 #define class_type_parameter(NAME,READ_TP,REAL_TP,DEF_VAL) \
 class_read_ ## READ_TP(#NAME,ppr->NAME);
 #endif
+#ifdef __HASH_PRECISION_PARAMETER__
+#define class_type_parameter(NAME,READ_TP,REAL_TP,DEF_VAL) \
+hash = class_hash(hash,&(ppr->NAME),sizeof(ppr->NAME));
+#endif
@@ -135,6 +135,11 @@ extern "C" {
                            struct output * pop
                            );
 
+  int output_perturbations_profile(
+                                   struct perturbations * ppt,
+                                   struct output * pop
+                                   );
+
   int output_primordial(
                         struct perturbations * ppt,
                         struct primordial * ppm,
@@ -15,6 +15,7 @@ struct file_content {
   FileArg * name;      /**< list of (size) names */
   FileArg * value;     /**< list of (size) values */
   short * read;        /**< set to _TRUE_ if this parameter is effectively read */
+  int * read_by;       /**< optional (NULL if not used): for each parameter, bitmask of the groups of parameters of input_read_parameters() in which it is read (see enum input_group in input.h) */
 };
 
 /**************************************************************/
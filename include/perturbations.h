@@ -9,7 +9,37 @@
 #define _vectors_ ((ppt->has_vectors == _TRUE_) && (index_md == ppt->index_md_vectors))
 #define _tensors_ ((ppt->has_tensors == _TRUE_) && (index_md == ppt->index_md_tensors))
 
-#define _set_source_(index) ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index][index_tau * ppt->k_size[index_md] + index_k]
+/**
+ * position of the source function at (index_tau, index_k) in
+ * ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index_tp].
+ * Other modules should access this table through this macro rather
+ * than assuming a given ordering.
+ */
+#define _source_index_(index_md,index_tau,index_k) ((index_tau) * ppt->k_size[index_md] + (index_k))
+
+/**
+ * store a source function computed by perturbations_sources(). The
+ * sources of one wavenumber are first written in a buffer owned by
+ * the workspace of each thread, and copied in ppt->sources once the
+ * integration is over (see perturbations_solve()), such that threads
+ * integrating neighbouring wavenumbers do not write concurrently in
+ * the same cache lines.
+ */
+#define _set_source_(index) ppw->sources_buffer[(index) * ppt->tau_size + index_tau]
+
+/**
+ * add one entry d(dy[entry_row])/d(y[entry_col]) = entry_value to the list
+ * of non-zero Jacobian entries filled by perturbations_jacobian()
+ */
+#define _add_jacobian_entry_(entry_row,entry_col,entry_value) {                                    \
+    class_test(pje->size >= pje->size_max,                                                         \
+               error_message,                                                                      \
+               "more than %d non-zero entries in the jacobian",pje->size_max);                     \
+    pje->row[pje->size] = (entry_row);                                                             \
+    pje->col[pje->size] = (entry_col);                                                             \
+    pje->value[pje->size] = (entry_value);                                                         \
+    pje->size++;                                                                                   \
+  }
 
 /**
  * flags for various approximation schemes
@@ -83,6 +113,18 @@ enum selection_type {gaussian,tophat,dirac};
 //@}
 
 
+//@{
+
+/**
+ * number of wavenumbers of each mode integrated one after the other
+ * before all the other ones, to find the jacobians of the ndf15
+ * evolver from which the other ones start (see perturbations_init_batch())
+ */
+#define _REFERENCE_TASKS_ 3
+
+//@}
+
+
 
 /**
  * Structure containing everything about perturbations that other
@@ -164,6 +206,12 @@ struct perturbations
   double eisw_lisw_split_z; /**< at which redshift do we define the cut between eisw and lisw ?*/
 
   int store_perturbations;  /**< Do we want to store perturbations? */
+
+  short has_perturbations_cache;          /**< do we want to read/write the source function tables in a persistent cache on disk? */
+  FileName perturbations_cache_directory; /**< directory containing the cache files */
+
+  short has_perturbations_profile;        /**< do we want to record the cost of the integration of each wavenumber? */
+  FileName perturbations_profile_file;    /**< profile written by a previous run, used to integrate the most expensive wavenumbers first (empty string if none) */
   int k_output_values_num;       /**< Number of perturbation outputs (default=0) */
   double k_output_values[_MAX_NUMBER_OF_K_FILES_];    /**< List of k values where perturbation output is requested. */
 
@@ -359,6 +407,9 @@ struct perturbations
   double * tau_sampling;    /**< array of tau values */
   int tau_size;             /**< number of values in this array */
 
+  double * pvecback_sampling;   /**< background quantities (of size bg_size_normal) at each value of tau_sampling, stored as pvecback_sampling[index_tau*pba->bg_size_normal+index_bg]; only allocated while the perturbations are integrated */
+  double * pvecthermo_sampling; /**< thermodynamics quantities (of size th_size) at each value of tau_sampling, stored as pvecthermo_sampling[index_tau*pth->th_size+index_th]; only allocated while the perturbations are integrated */
+
   double selection_min_of_tau_min; /**< used in presence of selection functions (for matter density, cosmic shear...) */
   double selection_max_of_tau_max; /**< used in presence of selection functions (for matter density, cosmic shear...) */
 
@@ -378,7 +429,20 @@ struct perturbations
   double *** sources; /**< Pointer towards the source interpolation table
                          sources[index_md]
                          [index_ic * ppt->tp_size[index_md] + index_tp]
-                         [index_tau * ppt->k_size + index_k] */
+                         [_source_index_(index_md,index_tau,index_k)] */
+
+  //@}
+
+  /** @name - cost of the integration of each wavenumber */
+
+  //@{
+
+  double ** profile_time; /**< profile_time[index_md][index_ic*ppt->k_size[index_md]+index_k]: wall-clock time spent in perturbations_solve(), in seconds (only if has_perturbations_profile) */
+  int ** profile_derivs;  /**< idem for the number of calls to perturbations_derivs() */
+  int ** profile_jacobians; /**< idem for the number of analytic Jacobians computed by perturbations_jacobian() */
+  int ** profile_intervals; /**< idem for the number of time intervals with a uniform approximation scheme */
+
+  double ** profile_cost; /**< profile_cost[index_md][index_k]: time per initial condition measured for this wavenumber in a previous run and read from perturbations_profile_file (NULL for modes absent from the file; only allocated until the integrations are ordered) */
 
   //@}
 
@@ -557,6 +621,7 @@ struct perturbations_workspace
   double * pvecback;          /**< background quantities */
   double * pvecthermo;        /**< thermodynamics quantities */
   double * pvecmetric;        /**< metric quantities */
+  double * sources_buffer;    /**< source functions of the wavenumber being integrated, sources_buffer[index_tp * ppt->tau_size + index_tau] */
   struct perturbations_vector * pv; /**< pointer to vector of integrated
                                        perturbations and their
                                        time-derivatives */
@@ -642,6 +707,24 @@ struct perturbations_workspace
 
   //@}
 
+  /** @name - jacobians of the ndf15 evolver, reused from one wavenumber to the next */
+
+  //@{
+
+  struct jacobian_cache jacobian_cache; /**< jacobians (with their sparsity pattern and LU ordering) for each approximation scheme met by this workspace */
+  struct jacobian_cache * jacobian_cache_reference; /**< if not NULL, jacobians from which each wavenumber starts, found by integrating the reference wavenumbers (see perturbations_init_batch()) */
+
+  //@}
+
+  /** @name - counters for the profile of the current wavenumber */
+
+  //@{
+
+  int derivs_calls;    /**< number of calls to perturbations_derivs() */
+  int jacobian_calls;  /**< number of calls to perturbations_jacobian() */
+
+  //@}
+
 };
 
 /**
@@ -664,6 +747,25 @@ struct perturbations_parameters_and_workspace {
 
 };
 
+/**
+ * Structure describing one elementary integration task of
+ * perturbations_init_batch(): one cosmology, mode, initial condition
+ * and wavenumber, with an estimate of its cost used to schedule the
+ * most expensive tasks first.
+ */
+
+struct perturbations_task {
+
+  double cost;     /**< estimated cost of the integration (arbitrary units) */
+  int index_cosmo; /**< index of cosmology in the batch */
+  int index_md;    /**< index of mode */
+  int index_ic;    /**< index of initial condition */
+  int index_k;     /**< index of wavenumber */
+  int order;       /**< position of the task before sorting (for a reproducible ordering of tasks with equal cost) */
+  short is_reference; /**< _TRUE_ if integrated among the reference tasks of its cosmology and mode, before all other tasks */
+
+};
+
 /*************************************************************************************************************/
 /* @cond INCLUDE_WITH_DOXYGEN */
 /*
@@ -751,6 +853,56 @@ extern "C" {
                          struct perturbations * ppt
                          );
 
+  int perturbations_init_batch(
+                               int cosmo_size,
+                               struct precision ** pppr,
+                               struct background ** ppba,
+                               struct thermodynamics ** ppth,
+                               struct perturbations ** pppt,
+                               int * status
+                               );
+
+  double perturbations_task_cost(
+                                 struct background * pba,
+                                 struct perturbations * ppt,
+                                 int index_md,
+                                 int index_k
+                                 );
+
+  int perturbations_compare_tasks(
+                                  const void * a,
+                                  const void * b
+                                  );
+
+  int perturbations_profile_read(
+                                 struct background * pba,
+                                 struct perturbations * ppt
+                                 );
+
+  int perturbations_profile_titles(
+                                   struct perturbations * ppt,
+                                   char titles[_MAXTITLESTRINGLENGTH_]
+                                   );
+
+  int perturbations_profile_data(
+                                 struct perturbations * ppt,
+                                 int number_of_titles,
+                                 double * data
+                                 );
+
+  int perturbations_prepare(
+                            struct precision * ppr,
+                            struct background * pba,
+                            struct thermodynamics * pth,
+                            struct perturbations * ppt,
+                            short * needs_integration,
+                            unsigned long long * cache_key
+                            );
+
+  int perturbations_spline_sources(
+                                   struct perturbations * ppt
+                                   );
+
   int perturbations_free_input(
                                struct perturbations * ppt
                                );
@@ -772,6 +924,12 @@ extern "C" {
                                              struct thermodynamics * pth,
                                              struct perturbations * ppt
                                              );
+  int perturbations_timesampling_background(
+                                            struct background * pba,
+                                            struct thermodynamics * pth,
+                                            struct perturbations * ppt
+                                            );
+
   int perturbations_get_k_list(
                                struct precision * ppr,
                                struct background * pba,
@@ -810,6 +968,25 @@ extern "C" {
                                      struct perturbations * ppt
                                      );
 
+  int perturbations_cache_key(
+                              struct precision * ppr,
+                              struct background * pba,
+                              struct thermodynamics * pth,
+                              struct perturbations * ppt,
+                              unsigned long long * key
+                              );
+
+  int perturbations_cache_read(
+                               struct perturbations * ppt,
+                               unsigned long long key,
+                               short * found
+                               );
+
+  int perturbations_cache_write(
+                                struct perturbations * ppt,
+                                unsigned long long key
+                                );
+
   int perturbations_find_approximation_number(
                                               struct precision * ppr,
                                               struct background * pba,
@@ -935,6 +1112,35 @@ extern "C" {
                            ErrorMsg error_message
                            );
 
+  int perturbations_jacobian_available(
+                                       struct background * pba,
+                                       struct thermodynamics * pth,
+                                       struct perturbations * ppt,
+                                       int index_md,
+                                       struct perturbations_workspace * ppw,
+                                       short * available
+                                       );
+
+  int perturbations_jacobian(
+                             double tau,
+                             double * y,
+                             struct jacobian_entries * pje,
+                             void * parameters_and_workspace,
+                             ErrorMsg error_message
+                             );
+
+  int perturbations_jacobian_metric(
+                                    struct background * pba,
+                                    struct perturbations * ppt,
+                                    struct perturbations_workspace * ppw,
+                                    double k,
+                                    int index_row,
+                                    double weight_h_prime,
+                                    double weight_eta_prime,
+                                    struct jacobian_entries * pje,
+                                    ErrorMsg error_message
+                                    );
+
   int perturbations_tca_slip_and_shear(
                                        double * y,
                                        void * parameters_and_workspace,
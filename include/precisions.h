@@ -13,6 +13,14 @@ class_precision_parameter(a_ini_over_a_today_default,double,1.e-14)
  * Number of background integration steps that are stored in the output vector
  */
 class_precision_parameter(background_Nloga,int,40000)
+/**
+ * If true, build at initialisation an index guide for the background and
+ * thermodynamics interpolation tables, such that background_at_z(),
+ * background_at_tau(), background_tau_of_z(), background_z_of_tau() and
+ * thermodynamics_at_z() find the interpolation interval in constant time
+ * instead of bisecting (the interpolated values are unchanged)
+ */
+class_precision_parameter(interpolation_index_guide,int,_TRUE_)
 /**
  * Evolver to be used for thermodynamics (rk, ndf15)
  */
@@ -66,6 +74,21 @@ class_precision_parameter(tol_ncdm_bg,double,1.e-5)
  * Using w = pressure/density, this quantifies the maximum deviation from 1/3. (for relativistic species)
  */
 class_precision_parameter(tol_ncdm_initial_w,double,1.e-3)
+/**
+ * If true, the integrals over momenta giving the background density,
+ * pressure and pseudo-pressure of each ncdm species are tabulated once
+ * as a function of x = a m / T_ncdm, and interpolated in
+ * background_functions() instead of being summed at each call
+ */
+class_precision_parameter(background_ncdm_table,int,_FALSE_)
+/**
+ * Range and step in log(x) of these tables. Below the smallest x, an
+ * expansion to order x^2 is used; above the largest x, the code falls
+ * back to the sum over momenta.
+ */
+class_precision_parameter(background_ncdm_table_x_min,double,1.e-3)
+class_precision_parameter(background_ncdm_table_x_max,double,1.e7)
+class_precision_parameter(background_ncdm_table_dlogx,double,5.e-3)
 /**
  * Tolerance on the deviation of the conformal time of equality from the true value in 1/Mpc.
  */
@@ -234,6 +257,13 @@ class_precision_parameter(reionization_sampling,double,1.5e-2)  /**< Minimum sam
 class_precision_parameter(reionization_optical_depth_tol,double,1.0e-4) /**< Relative tolerance on finding the user-given optical depth of reionization given a certain redshift of reionization */
 class_precision_parameter(reionization_start_factor,double,8.0) /**< Searching optical depth corresponding to the redshift is started from an initial offset beyond z_reionization_start, multiplied by reionization_width */
 
+/*
+ * Recombination emulator parameters
+ */
+
+class_precision_parameter(recombination_emulator_z_stride,int,1) /**< when training the recombination emulator, store one line of the thermodynamics table every recombination_emulator_z_stride lines (plus all lines close to the beginning of reionization), the others being obtained by spline interpolation in z. The default stores all lines; with larger values, the file is smaller but the spline error on dx_e/dz reaches the visibility function and the C_l's */
+class_precision_parameter(recombination_emulator_tolerance,double,1.e-3) /**< maximum error of the recombination emulator, estimated during the training: relative error on x_e and T_b, and error on dx_e/dz relative to its maximum (the latter dominates; 1.e-3 corresponds to C_l differences of about 1.e-5); above this value, the emulator is not used */
+
 /*
  * Heating parameters
  */
@@ -387,6 +417,14 @@ class_precision_parameter(neglect_CMB_sources_below_visibility,double,1.0e-3)
  * The type of evolver to use: options are ndf15 or rk
  */
 class_type_parameter(evolver,int,enum evolver_type,ndf15)
+/**
+ * Only relevant for ndf15 evolver: whether the Jacobian of the scalar
+ * perturbation equations should be computed analytically when
+ * possible (see perturbations_jacobian_available()), instead of
+ * numerically with extra calls to perturbations_derivs(). Off by
+ * default, since it changes the reference C_l's slightly.
+ */
+class_precision_parameter(perturbations_analytic_jacobian,int,_FALSE_)
 
 /*
  * Primordial parameters
@@ -573,7 +611,16 @@ class_precision_parameter(mmax_for_p1h_integral,double,1.e18)
  */
 
 class_precision_parameter(accurate_lensing,int,_FALSE_) /**< switch between Gauss-Legendre quadrature integration and simple quadrature on a subdomain of angles */
-class_precision_parameter(num_mu_minus_lmax,int,70) /**< difference between num_mu and l_max, increase for more precision */
+class_precision_parameter(num_mu_minus_lmax,int,70) /**< difference between num_mu and l_max, increase for more precision (with the default delta_l_max, the default value is not converged in the last thousand lensed multipoles: for l_max_scalars=3000, the lensed BB spectrum changes by 74% at l=3000 with num_mu_minus_lmax=3000; use such values when comparing with lensing_fft_transforms) */
+class_precision_parameter(lensing_mu_block_size,int,256) /**< number of values of mu for which the Wigner d-functions are stored at the same time (memory scales like lensing_mu_block_size*l_max); if zero or larger than num_mu, they are stored for all values at once */
+class_precision_parameter(lensing_fft_transforms,int,_FALSE_) /**< compute the lensed spectra with the FFT-based transforms of lensing_lensed_cl_fft() (Bessel approximation of the Wigner d-functions above lensing_fft_l_switch, correlations on logarithmic grids computed by FFT) instead of the direct sums; accurate_lensing is then ignored */
+class_precision_parameter(lensing_fft_l_switch,int,100) /**< in FFT mode, multipole below which Wigner d-functions are computed exactly (the two treatments are blended over [lensing_fft_l_switch/2,lensing_fft_l_switch]) */
+class_precision_parameter(lensing_fft_theta_max,double,_PI_/16.) /**< in FFT mode, largest angle at which the lensing correction to the correlation functions is integrated */
+class_precision_parameter(lensing_fft_taper,double,0.5) /**< in FFT mode, the lensing correction to the correlation functions is smoothly tapered to zero between lensing_fft_taper*lensing_fft_theta_max and lensing_fft_theta_max in the integrals over theta, and the complement is integrated with exact sums at lensing_fft_l_switch+l_max*(1-lensing_fft_taper)*lensing_fft_theta_max Gauss-Legendre nodes for multipoles below lensing_fft_l_switch */
+class_precision_parameter(lensing_fft_sampling,double,2.) /**< in FFT mode, step of the logarithmic grids in l and theta is pi/(lensing_fft_sampling*l_max*lensing_fft_theta_max) */
+class_precision_parameter(lensing_fft_x_min,double,1.e-2) /**< in FFT mode, smallest angle of the logarithmic grid in units of 1/l_max */
+class_precision_parameter(lensing_fft_v_nodes,int,16) /**< in FFT mode, number of Chebyshev nodes used to interpolate the Gaussian damping factors of the lensed correlation functions */
+class_precision_parameter(lensing_fft_num_mu_large,int,1200) /**< in FFT mode, minimum number of Gauss-Legendre nodes in mu used for angles larger than lensing_fft_theta_max, where only multipoles below lensing_fft_l_switch are affected; at least (l_max+lensing_fft_l_switch)/2 are used, since the lensed correlation functions keep oscillations of frequency l_max from the sharp cut of the unlensed spectra. With these settings, the lensed spectra agree with those of accurate_lensing (with a converged num_mu_minus_lmax) to about 1e-4 up to l_max-delta_l_max, for the default delta_l_max */
 class_precision_parameter(delta_l_max,int,500)/**< difference between l_max in unlensed and lensed spectra */
 class_precision_parameter(tol_gauss_legendre,double,ppr->smallest_allowed_variation) /**< tolerance with which quadrature points are found: must be very small for an accurate integration (if not entered manually, set automatically to match machine precision) */
 
@@ -41,6 +41,59 @@ enum reionization_z_or_tau {
                             reio_tau /**< input = tau */
 };
 
+/**
+ * Should the recombination history be obtained from the emulator
+ * (interpolation in a table of previous solutions), or should this
+ * table be computed?
+ */
+
+enum recombination_emulator_mode {
+                                  rec_emulator_none,  /**< always integrate the recombination network */
+                                  rec_emulator_use,   /**< interpolate the recombination history in the emulator table when possible */
+                                  rec_emulator_train  /**< compute the emulator table around the input cosmology, and write it in the emulator file */
+};
+
+/**
+ * Parameters on which the emulated recombination history depends
+ * (all other parameters must be the same as during the training).
+ */
+
+enum recombination_emulator_parameter {
+                                       rec_emulator_omega_b,   /**< baryon density \f$ \omega_b \f$ */
+                                       rec_emulator_omega_cdm, /**< CDM density \f$ \omega_{cdm} \f$ */
+                                       rec_emulator_YHe,       /**< primordial helium mass fraction */
+                                       rec_emulator_Neff,      /**< effective neutrino number */
+                                       rec_emulator_parameter_size
+};
+
+/**
+ * Content of an emulator file, kept in memory and shared by all the
+ * runs of the process (see thermodynamics_emulator_table_get()).
+ */
+
+struct recombination_emulator_table {
+
+  FileName file;           /**< name of the file */
+  long long file_time;     /**< modification time of the file when it was read */
+  long long file_size;     /**< size of the file when it was read */
+
+  short complete;          /**< _FALSE_ if the file is not a complete emulator table (then the fields below are not set) */
+
+  double validation_error; /**< maximum relative error on \f$ x_e, T_b \f$ estimated during the training (-1 if not validated) */
+  int recombination;       /**< recombination code used in the training */
+  double T_cmb;            /**< CMB temperature used in the training */
+  int points;              /**< number of nodes along each parameter direction */
+  double p_min[rec_emulator_parameter_size]; /**< first node along each parameter direction */
+  double p_max[rec_emulator_parameter_size]; /**< last node along each parameter direction */
+  int tt_size;             /**< number of lines of the thermodynamics table used in the training */
+  int index_tau_min;       /**< line of the beginning of reionization */
+  int z_size;              /**< number of stored lines */
+  double * z;              /**< redshift of the stored lines */
+  int node_size;           /**< number of values per node (3 per stored line, plus the state at the beginning of reionization) */
+  double * node;           /**< values for all nodes, node_size values per node */
+
+};
+
 /**
  * Two useful smooth step functions, for smoothing transitions in recfast.
  */
@@ -175,6 +228,18 @@ struct thermodynamics
 
   short has_varconst; /**< presence of varying fundamental constants? */
 
+  /** parameters for the recombination emulator */
+
+  enum recombination_emulator_mode recombination_emulator; /**< use, or train, the emulator of the recombination history? */
+
+  FileName recombination_emulator_file; /**< file containing the emulator table */
+
+  short recombination_emulator_check; /**< if _TRUE_, also integrate the full network and compare it with the emulated history */
+
+  int recombination_emulator_points; /**< number of training points along each parameter direction */
+
+  double recombination_emulator_delta[rec_emulator_parameter_size]; /**< half-width of the training range along each parameter direction */
+
   //@}
 
   /** @name - all indices for the vector of thermodynamical (=th) quantities stored in table */
@@ -239,6 +304,18 @@ struct thermodynamics
 
   //@}
 
+  /** @name - index guide for finding the interpolation interval in constant time */
+
+  //@{
+
+  short has_index_guide; /**< if _TRUE_, thermodynamics_at_z() locates its interval through z_guide in inter_normal mode instead of bisecting */
+  int z_guide_size;      /**< number of nodes in z_guide */
+  int * z_guide;         /**< z_guide[index_guide] = index of the z_table interval containing the node number index_guide, uniformly spaced in log(1+z) */
+  double z_guide_u_min;  /**< value of log(1+z) at the first node of z_guide */
+  double z_guide_du;     /**< step in log(1+z) between the nodes of z_guide */
+
+  //@}
+
   /** @name - characteristic quantities like redshift, conformal time and sound horizon at recombination */
 
   //@{
@@ -291,6 +368,19 @@ struct thermodynamics
 
   //@}
 
+  /** @name - recombination emulator */
+
+  //@{
+
+  double x_H_reio_start;    /**< hydrogen ionization fraction at the beginning of reionization */
+  double x_He_reio_start;   /**< helium ionization fraction at the beginning of reionization */
+  double D_Tmat_reio_start; /**< difference between baryon and photon temperature at the beginning of reionization */
+
+  short recombination_emulator_used; /**< _TRUE_ if the table contains the emulated recombination history */
+  double recombination_emulator_error; /**< maximum difference between emulated and integrated history, see thermodynamics_emulator_compare() (only if recombination_emulator_check is set, -1 otherwise) */
+
+  //@}
+
   /** @name - parameters needed for idm */
 
   //@{
@@ -675,6 +765,84 @@ extern "C" {
                                              double z_ini,
                                              struct thermo_diffeq_workspace * ptdw);
 
+  int thermodynamics_table_store(struct thermodynamics * pth,
+                                 struct thermo_workspace * ptw,
+                                 int index_tau,
+                                 double z,
+                                 double x,
+                                 double Tmat,
+                                 double dTmat,
+                                 double sigmaTrescale);
+
+  int thermodynamics_emulator_parameters(struct background * pba,
+                                         struct thermodynamics * pth,
+                                         double * parameter);
+
+  int thermodynamics_emulator_sampling(struct precision * ppr,
+                                       struct thermodynamics * pth,
+                                       int * index_tau_min,
+                                       int ** line,
+                                       int * z_size);
+
+  int thermodynamics_emulator_table_get(char * file,
+                                        struct recombination_emulator_table ** ptable,
+                                        ErrorMsg error_message);
+
+  int thermodynamics_emulator_table_get_serial(char * file,
+                                               struct recombination_emulator_table ** ptable,
+                                               ErrorMsg error_message);
+
+  int thermodynamics_emulator_table_release(struct recombination_emulator_table * ptable,
+                                            ErrorMsg error_message);
+
+  int thermodynamics_emulator_table_read(char * file,
+                                         struct recombination_emulator_table * ptable,
+                                         ErrorMsg error_message);
+
+  int thermodynamics_emulator_table_free(struct recombination_emulator_table * ptable);
+
+  int thermodynamics_emulator_evaluate(struct precision * ppr,
+                                       struct background * pba,
+                                       struct thermodynamics * pth,
+                                       int index_tau_min,
+                                       int * line,
+                                       int z_size,
+                                       double * emulated,
+                                       short * found);
+
+  int thermodynamics_emulator_weights(int n,
+                                      double p_min,
+                                      double p_max,
+                                      double p,
+                                      int * first,
+                                      int * size,
+                                      double * weight);
+
+  int thermodynamics_emulator_start(struct thermodynamics * pth,
+                                    struct thermo_workspace * ptw,
+                                    int index_tau_min,
+                                    double * emulated);
+
+  int thermodynamics_emulator_compare(struct thermodynamics * pth,
+                                      int index_tau_min,
+                                      double * emulated,
+                                      double * error);
+
+  int thermodynamics_emulator_write_header(struct precision * ppr,
+                                           struct background * pba,
+                                           struct thermodynamics * pth,
+                                           FILE * emulator_file,
+                                           double * p_min,
+                                           double * p_max);
+
+  int thermodynamics_emulator_write_node(struct precision * ppr,
+                                         struct thermodynamics * pth,
+                                         FILE * emulator_file);
+
+  int thermodynamics_emulator_train(struct precision * ppr,
+                                    struct background * pba,
+                                    struct thermodynamics * pth);
+
 #ifdef __cplusplus
 }
 #endif
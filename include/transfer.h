@@ -50,6 +50,9 @@
     bin = index_tt - ptr->index_tt_nc_g4;                               \
   if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr)) \
     bin = index_tt - ptr->index_tt_nc_g5;
+/* number of arrays of size tau_size_max in the scratch arena of struct transfer_workspace */
+#define _TRANSFER_SCRATCH_SIZE_ 6
+
 /**
  * Structure containing everything about transfer functions in
  * harmonic space \f$ \Delta_l^{X} (q) \f$ that other modules need to
@@ -193,6 +196,9 @@ struct transfer {
 
   //@{
 
+  short has_hyperspherical_cache;           /**< do we want to read/write the table of flat spherical Bessel functions in a memory-mapped file? */
+  FileName hyperspherical_cache_directory;  /**< directory containing this file */
+
   short transfer_verbose; /**< flag regulating the amount of information sent to standard output (none if set to zero) */
 
   ErrorMsg error_message; /**< zone for writing error messages */
@@ -249,6 +255,20 @@ struct transfer_workspace {
 
   //@}
 
+  /** @name - scratch arena: one block of memory allocated once per thread and split into the arrays below, such that the loop over wavenumbers, multipoles and types runs without allocations */
+
+  //@{
+
+  double * scratch;              /**< contiguous block of _TRANSFER_SCRATCH_SIZE_*tau_size_max doubles containing all the arrays below */
+  double * radial_function;      /**< radial_function[index_tau]: radial (Bessel) function to be convolved with the source */
+  double * Phi;                  /**< Phi[index_tau]: hyperspherical Bessel function, in reverse time order */
+  double * dPhi;                 /**< dPhi[index_tau]: its first derivative */
+  double * d2Phi;                /**< d2Phi[index_tau]: its second derivative */
+  double * chireverse;           /**< chireverse[index_tau]: values of chi in reverse time order */
+  double * rescale_function;     /**< rescale_function[index_tau]: amplitude rescaling in flat approximation scheme */
+
+  //@}
+
   /** @name - parameters defining the spatial curvature (copied from background structure) */
 
   //@{
@@ -661,6 +681,16 @@ extern "C" {
                                      struct transfer * ptr
                                      );
 
+  int transfer_radial_function_is_fused(
+                                        struct transfer_workspace * ptw,
+                                        struct transfer * ptr,
+                                        int index_l,
+                                        radial_function_type radial_type,
+                                        short * fused,
+                                        double * factor,
+                                        int * cscK_power
+                                        );
+
   int transfer_workspace_init(
                               struct transfer * ptr,
                               struct precision * ppr,
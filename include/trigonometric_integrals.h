@@ -26,6 +26,13 @@ extern "C" {
          ErrorMsg error_message
 				 );
 
+  int sine_cosine_integral(
+                           double x,
+                           double *Si,
+                           double *Ci,
+                           ErrorMsg error_message
+                           );
+
 #ifdef __cplusplus
 }
 #endif
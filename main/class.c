@@ -24,6 +24,13 @@ int main(int argc, char **argv) {
     return _FAILURE_;
   }
 
+  if (th.recombination_emulator == rec_emulator_train) {
+    if (thermodynamics_emulator_train(&pr,&ba,&th) == _FAILURE_) {
+      printf("\n\nError in thermodynamics_emulator_train \n=>%s\n",th.error_message);
+      return _FAILURE_;
+    }
+  }
+
   if (background_init(&pr,&ba) == _FAILURE_) {
     printf("\n\nError running background_init \n=>%s\n",ba.error_message);
     return _FAILURE_;
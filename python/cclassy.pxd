@@ -153,6 +153,7 @@ cdef extern from "class.h":
         int l_lss_max
 
         int store_perturbations
+        short has_perturbations_profile
         int k_output_values_num
         double k_output_values[30]
         double k_max_for_pk
@@ -425,6 +426,36 @@ cdef extern from "class.h":
         FileArg * name
         FileArg * value
         short * read
+        int * read_by
+
+    cdef enum batch_stage:
+        batch_none
+        batch_input
+        batch_background
+        batch_thermodynamics
+        batch_perturbations
+        batch_primordial
+        batch_fourier
+        batch_transfer
+        batch_harmonic
+        batch_lensing
+        batch_distortions
+
+    cdef struct batch_cosmology:
+        void * pfc
+        void * ppr
+        void * pba
+        void * pth
+        void * ppt
+        void * ppm
+        void * pfo
+        void * ptr
+        void * phr
+        void * ple
+        void * psd
+        void * pop
+        batch_stage stage_done
+        ErrorMsg error_message
 
     void lensing_free(void*)
     void harmonic_free(void*)
@@ -451,6 +482,8 @@ cdef extern from "class.h":
     int harmonic_init(void*,void*,void*,void*,void*,void*,void*)
     int lensing_init(void*,void*,void*,void*,void*)
     int distortions_init(void*,void*,void*,void*,void*,void*)
+    int batch_init(int, batch_cosmology*, char*)
+    int batch_update(batch_cosmology*, file_content*)
 
     int background_tau_of_z(void* pba, double z,double* tau)
     int background_z_of_tau(void* pba, double tau,double* z)
@@ -468,6 +501,8 @@ cdef extern from "class.h":
     int perturbations_output_data(void *pba,void *ppt, file_format output_format, double * tkfull, int number_of_titles, double *data)
     int perturbations_output_firstline_and_ic_suffix(void *ppt, int index_ic, char first_line[1024], FileName ic_suffix)
     int perturbations_output_titles(void *pba, void *ppt,  file_format output_format, char titles[8000])
+    int perturbations_profile_titles(void *ppt, char titles[8000])
+    int perturbations_profile_data(void *ppt, int number_of_titles, double *data)
 
     int primordial_output_titles(void * ppt, void *ppm, char titles[8000])
     int primordial_output_data(void *ppt, void *ppm, int number_of_titles, double *data)
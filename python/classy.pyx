@@ -104,6 +104,7 @@ cdef class Class:
 
     cdef int computed # Flag to see if classy has already computed with the given pars
     cdef int allocated # Flag to see if classy structs are allocated already
+    cdef int _partial_update # Flag to recompute only the modules affected by changed parameters
     cdef object _pars # Dictionary of the parameters
     cdef object ncp   # Keeps track of the structures initialized, in view of cleaning.
 
@@ -123,16 +124,22 @@ cdef class Class:
     property nonlinear_method:
         def __get__(self):
             return self.fo.method
+    property partial_update:
+        def __get__(self):
+            return bool(self._partial_update)
+        def __set__(self, value):
+            self._partial_update = bool(value)
 
     def set_default(self):
         _pars = {
             "output":"tCl mPk",}
         self.set(**_pars)
 
-    def __cinit__(self, default=False):
+    def __cinit__(self, default=False, partial_update=False):
         cdef char* dumc
         self.allocated = False
         self.computed = False
+        self._partial_update = partial_update
         self._pars = {}
         self.fc.size=0
         self.fc.filename = <char*>malloc(sizeof(char)*30)
@@ -152,6 +159,7 @@ cdef class Class:
             free(self.fc.name)
             free(self.fc.value)
             free(self.fc.read)
+            free(self.fc.read_by)
             free(self.fc.filename)
 
     # Set up the dictionary
@@ -180,6 +188,7 @@ cdef class Class:
             free(self.fc.name)
             free(self.fc.value)
             free(self.fc.read)
+            free(self.fc.read_by)
         self.fc.size = len(self._pars)
         self.fc.name = <FileArg*> malloc(sizeof(FileArg)*len(self._pars))
         assert(self.fc.name!=NULL)
@@ -190,6 +199,10 @@ cdef class Class:
         self.fc.read = <short*> malloc(sizeof(short)*len(self._pars))
         assert(self.fc.read!=NULL)
 
+        # groups of input parameters in which each parameter is read, used by _update()
+        self.fc.read_by = <int*> calloc(len(self._pars), sizeof(int))
+        assert(self.fc.read_by!=NULL)
+
         # fill parameter file
         i = 0
         for kk in self._pars:
@@ -320,6 +333,14 @@ cdef class Class:
             level default value should be left as an array (it was creating
             problem when casting as a set later on, in _check_task_dependency)
 
+        .. note::
+
+            if partial_update is True (it can be passed to the constructor
+            or set as an attribute), and if all modules were computed
+            before, only the modules affected by the parameters changed
+            since the previous call are recomputed. By default, all modules
+            are recomputed.
+
         """
         cdef ErrorMsg errmsg
 
@@ -333,6 +354,12 @@ cdef class Class:
         if self.computed and self.ncp.issuperset(level):
             return
 
+        # If requested, and if all modules were computed before, recompute
+        # only those affected by the parameters changed since then
+        if self._partial_update and self.allocated and "distortions" in self.ncp and "distortions" in level:
+            self._update()
+            return
+
         # Check if already allocated to prevent memory leaks
         if self.allocated:
             self.struct_cleanup()
@@ -447,6 +474,72 @@ cdef class Class:
         # following functions are only to output the desired numbers
         return
 
+    def _update(self):
+        """
+        Update the parameters of a cosmology for which all modules were
+        already computed, and recompute only the modules depending on the
+        parameters changed since the previous computation, through the
+        function batch_update() of CLASS.
+        """
+        cdef file_content fc_old = self.fc
+        cdef batch_cosmology bc
+        cdef int status
+
+        # names of the modules computed at each stage, in the format of self.ncp
+        stage_names = ["input", "background", "thermodynamics", "perturb",
+                       "primordial", "fourier", "transfer", "harmonic",
+                       "lensing", "distortions"]
+
+        # Write the new parameter file, keeping the previous one
+        self.computed = False
+        self.fc.size = 0
+        self._fillparfile()
+
+        bc.pfc = &fc_old
+        bc.ppr = &self.pr
+        bc.pba = &self.ba
+        bc.pth = &self.th
+        bc.ppt = &self.pt
+        bc.ppm = &self.pm
+        bc.pfo = &self.fo
+        bc.ptr = &self.tr
+        bc.phr = &self.hr
+        bc.ple = &self.le
+        bc.psd = &self.sd
+        bc.pop = &self.op
+        bc.stage_done = batch_distortions
+
+        status = batch_update(&bc, &self.fc)
+
+        # The file name is shared by the two parameter files
+        if fc_old.size != 0:
+            free(fc_old.name)
+            free(fc_old.value)
+            free(fc_old.read)
+            free(fc_old.read_by)
+
+        self.ncp = set(stage_names[:bc.stage_done])
+
+        # As in compute(), a failure in reading the input, or non-understood
+        # parameters, are problematic situations
+        if status == _FAILURE_ and bc.stage_done == batch_distortions:
+            self.struct_cleanup()
+            raise CosmoSevereError(bc.error_message)
+        problematic_parameters = []
+        for i in range(self.fc.size):
+            if self.fc.read[i] == _FALSE_:
+                problematic_parameters.append(self.fc.name[i].decode())
+        if problematic_parameters:
+            self.struct_cleanup()
+            raise CosmoSevereError(
+                "Class did not read input parameter(s): %s\n" % ', '.join(
+                problematic_parameters))
+        if status == _FAILURE_:
+            self.struct_cleanup()
+            raise CosmoComputationError(bc.error_message)
+
+        self.computed = True
+
     def raw_cl(self, lmax=-1, nofail=False):
         """
         raw_cl(lmax=-1, nofail=False)
@@ -2183,6 +2276,59 @@ cdef class Class:
 
         return perturbations
 
+    def get_perturbations_profile(self):
+        """
+        Return the cost of the integration of perturbations for each mode,
+        initial condition and wavenumber.
+
+        .. note::
+
+            you need to set 'perturbations_profile' to 'yes'. The table can
+            also be written in a file and passed to later runs with
+            'perturbations_profile_file', in order to integrate the most
+            expensive wavenumbers first.
+
+        Returns
+        -------
+        profile : dictionary of arrays, with keys 'mode', 'ic', 'k [1/Mpc]',
+                'time [s]', 'derivs', 'jacobians' and 'intervals'
+        """
+        cdef char *titles
+        cdef double* data
+        cdef int index_md
+
+        if not self.pt.has_perturbations_profile:
+            raise CosmoSevereError("set 'perturbations_profile' to 'yes' to record the profile of the perturbations")
+
+        titles = <char*>calloc(_MAXTITLESTRINGLENGTH_,sizeof(char))
+
+        if perturbations_profile_titles(&self.pt, titles)==_FAILURE_:
+            raise CosmoSevereError(self.pt.error_message)
+
+        tmp = <bytes> titles
+        tmp = str(tmp.decode())
+        names = tmp.split("\t")[:-1]
+        number_of_titles = len(names)
+        rows = 0
+        for index_md in range(self.pt.md_size):
+            rows += self.pt.ic_size[index_md]*self.pt.k_size[index_md]
+
+        data = <double*>malloc(sizeof(double)*rows*number_of_titles)
+
+        if perturbations_profile_data(&self.pt, number_of_titles, data)==_FAILURE_:
+            raise CosmoSevereError(self.pt.error_message)
+
+        profile = {}
+
+        for i in range(number_of_titles):
+            profile[names[i]] = np.zeros(rows, dtype=np.double)
+            for index in range(rows):
+                profile[names[i]][index] = data[index*number_of_titles+i]
+
+        free(titles)
+        free(data)
+        return profile
+
     def get_transfer(self, z=0., output_format='class'):
         """
         Return the density and/or velocity transfer functions for all initial
@@ -2973,3 +3119,108 @@ make        nonlinear_scale_cb(z, z_size)
             sources[name] = np.asarray(tmparray)
 
         return (sources, np.asarray(k_array), np.asarray(tau_array))
+
+
+def compute_batch(cosmos):
+    """
+    compute_batch(cosmos)
+
+    Compute all modules of several Class instances in a single call to
+    the batch module of CLASS. The perturbations of all cosmologies
+    are integrated from a single queue of tasks shared by all
+    threads, which keeps threads busy until the whole batch is done,
+    instead of leaving them idle at the end of each cosmology as with
+    successive calls to compute(). This is useful for samplers
+    proposing several points at once, or for parameter scans.
+
+    Parameters
+    ----------
+    cosmos : list
+            list of Class instances, with their parameters already set
+
+    Returns
+    -------
+    errors : list
+            for each instance, None if the computation succeeded, or
+            the corresponding CosmoError otherwise. A failure in one
+            cosmology does not stop the computation of the others.
+    """
+    cdef Class cosmo
+    cdef int index_cosmo
+    cdef int cosmo_size = len(cosmos)
+    cdef int status
+    cdef char errmsg[2048]
+    cdef batch_cosmology * pbc
+
+    # names of the modules computed at each stage, in the format of Class.ncp
+    stage_names = ["input", "background", "thermodynamics", "perturb",
+                   "primordial", "fourier", "transfer", "harmonic",
+                   "lensing", "distortions"]
+
+    if cosmo_size == 0:
+        return []
+
+    pbc = <batch_cosmology*> calloc(cosmo_size, sizeof(batch_cosmology))
+    if pbc == NULL:
+        raise MemoryError("could not allocate batch of %d cosmologies" % cosmo_size)
+
+    # Equivalent of writing a parameter file for each instance, and
+    # pointing the batch towards the structures of each instance
+    for index_cosmo, cosmo in enumerate(cosmos):
+        if cosmo.allocated:
+            cosmo.struct_cleanup()
+        cosmo.computed = False
+        cosmo._fillparfile()
+        pbc[index_cosmo].pfc = &cosmo.fc
+        pbc[index_cosmo].ppr = &cosmo.pr
+        pbc[index_cosmo].pba = &cosmo.ba
+        pbc[index_cosmo].pth = &cosmo.th
+        pbc[index_cosmo].ppt = &cosmo.pt
+        pbc[index_cosmo].ppm = &cosmo.pm
+        pbc[index_cosmo].pfo = &cosmo.fo
+        pbc[index_cosmo].ptr = &cosmo.tr
+        pbc[index_cosmo].phr = &cosmo.hr
+        pbc[index_cosmo].ple = &cosmo.le
+        pbc[index_cosmo].psd = &cosmo.sd
+        pbc[index_cosmo].pop = &cosmo.op
+
+    status = batch_init(cosmo_size, pbc, errmsg)
+
+    # Keep track of the modules computed for each instance, in view of
+    # cleaning, and collect the errors. If the input could not be read,
+    # nothing was allocated.
+    errors = []
+    for index_cosmo, cosmo in enumerate(cosmos):
+        cosmo.ncp = set(stage_names[:pbc[index_cosmo].stage_done])
+        if pbc[index_cosmo].stage_done == batch_none:
+            errors.append(CosmoSevereError(pbc[index_cosmo].error_message))
+            continue
+        cosmo.allocated = True
+        if status == _FAILURE_:
+            cosmo.struct_cleanup()
+            continue
+        # As in compute(), non-understood parameters are a problematic situation
+        problematic_parameters = []
+        for i in range(cosmo.fc.size):
+            if cosmo.fc.read[i] == _FALSE_:
+                problematic_parameters.append(cosmo.fc.name[i].decode())
+        if problematic_parameters:
+            cosmo.struct_cleanup()
+            errors.append(CosmoSevereError(
+                "Class did not read input parameter(s): %s\n" % ', '.join(
+                problematic_parameters)))
+        elif pbc[index_cosmo].stage_done != batch_distortions:
+            cosmo.struct_cleanup()
+            errors.append(CosmoComputationError(pbc[index_cosmo].error_message))
+        else:
+            cosmo.computed = True
+            errors.append(None)
+
+    free(pbc)
+
+    # A failure of the batch itself, as opposed to a failure of one
+    # cosmology, is a problematic situation
+    if status == _FAILURE_:
+        raise CosmoSevereError(errmsg)
+
+    return errors
@@ -0,0 +1,95 @@
+"""
+.. module:: test_batch
+    :synopsis: python script testing the batched computation of classy
+
+Check that compute_batch() gives the same results as successive calls to
+compute(), and that the failure of one cosmology is reported without
+affecting the others.
+To run the test suite, type
+python -m pytest test_batch.py
+"""
+import unittest
+
+import numpy as np
+
+from classy import Class
+from classy import CosmoSevereError
+from classy import compute_batch
+
+# Parameters common to all computations
+BASE_PARAMETERS = {
+    'output': 'tCl,pCl,lCl,mPk',
+    'lensing': 'yes',
+    'P_k_max_1/Mpc': 1.,
+}
+
+# Cosmologies of the batch
+COSMOLOGIES = [
+    {'omega_b': 0.0223},
+    {'omega_b': 0.0225, 'n_s': 0.95},
+]
+
+# Bound on the relative difference between batched and successive results
+RELATIVE_ERROR = 1e-10
+
+
+class TestBatch(unittest.TestCase):
+    """
+    Testing compute_batch() against compute()
+    """
+
+    def new_cosmo(self, parameters):
+        cosmo = Class()
+        cosmo.set(BASE_PARAMETERS)
+        cosmo.set(parameters)
+        return cosmo
+
+    def assert_same_results(self, batched, single):
+        batched_cl = batched.lensed_cl(2500)
+        single_cl = single.lensed_cl(2500)
+        for key in ['tt', 'te', 'ee', 'bb', 'pp']:
+            np.testing.assert_allclose(
+                batched_cl[key][2:], single_cl[key][2:],
+                rtol=RELATIVE_ERROR,
+                atol=RELATIVE_ERROR*np.max(np.abs(single_cl[key][2:])),
+                err_msg=key)
+        for k in [1e-3, 1e-2, 1e-1]:
+            self.assertAlmostEqual(
+                batched.pk(k, 0.)/single.pk(k, 0.), 1., delta=RELATIVE_ERROR)
+
+    def test_batch(self):
+        """Compute a batch, with one failing input, and compare with compute()"""
+        batch = [self.new_cosmo(parameters) for parameters in COSMOLOGIES]
+        # a value that cannot be read: the input module fails
+        batch.append(self.new_cosmo({'omega_b': 'not_a_number'}))
+        # a parameter that is not understood
+        batch.append(self.new_cosmo({'not_a_parameter': 1.}))
+
+        errors = compute_batch(batch)
+
+        self.assertEqual(len(errors), len(batch))
+        for index in range(len(COSMOLOGIES)):
+            self.assertIsNone(errors[index])
+            single = self.new_cosmo(COSMOLOGIES[index])
+            single.compute()
+            self.assert_same_results(batch[index], single)
+            single.struct_cleanup()
+            single.empty()
+        self.assertIsInstance(errors[-2], CosmoSevereError)
+        self.assertIsInstance(errors[-1], CosmoSevereError)
+
+        # the failed instances can be cleaned and computed again
+        for cosmo in batch[-2:]:
+            cosmo.struct_cleanup()
+            cosmo.empty()
+            cosmo.set(BASE_PARAMETERS)
+            cosmo.compute()
+            self.assertGreater(cosmo.lensed_cl(100)['tt'][100], 0.)
+
+        for cosmo in batch:
+            cosmo.struct_cleanup()
+            cosmo.empty()
+
+
+if __name__ == '__main__':
+    unittest.main()
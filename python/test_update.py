@@ -0,0 +1,86 @@
+"""
+.. module:: test_update
+    :synopsis: python script testing the partial recomputation of classy
+
+Check that the results of a Class instance updated with partial_update=True
+are the same as those of a fresh computation with the new parameters.
+To run the test suite, type
+python -m pytest test_update.py
+"""
+import unittest
+
+import numpy as np
+
+from classy import Class
+
+# Parameters common to all computations
+BASE_PARAMETERS = {
+    'output': 'tCl,pCl,lCl,mPk',
+    'lensing': 'yes',
+    'P_k_max_1/Mpc': 1.,
+}
+
+# Successive changes of parameters, affecting modules from the background
+# to the primordial spectrum
+CHANGES = [
+    {'omega_b': 0.0225},
+    {'tau_reio': 0.06},
+    {'n_s': 0.95},
+    {'A_s': 2.2e-9},
+]
+
+# Bound on the relative difference between updated and fresh results
+RELATIVE_ERROR = 1e-10
+
+
+class TestUpdate(unittest.TestCase):
+    """
+    Testing the recomputation of only the modules affected by changed
+    parameters, through Class(partial_update=True)
+    """
+
+    def assert_same_results(self, updated, fresh):
+        updated_cl = updated.lensed_cl(2500)
+        fresh_cl = fresh.lensed_cl(2500)
+        for key in ['tt', 'te', 'ee', 'bb', 'pp']:
+            np.testing.assert_allclose(
+                updated_cl[key][2:], fresh_cl[key][2:],
+                rtol=RELATIVE_ERROR,
+                atol=RELATIVE_ERROR*np.max(np.abs(fresh_cl[key][2:])),
+                err_msg=key)
+        for k in [1e-3, 1e-2, 1e-1]:
+            self.assertAlmostEqual(
+                updated.pk(k, 0.)/fresh.pk(k, 0.), 1., delta=RELATIVE_ERROR)
+
+    def test_partial_update(self):
+        """Update parameters one at a time and compare with fresh runs"""
+        updated = Class(partial_update=True)
+        updated.set(BASE_PARAMETERS)
+        updated.compute()
+
+        for change in CHANGES:
+            updated.set(change)
+            updated.compute()
+
+            fresh = Class()
+            fresh.set(updated.pars)
+            fresh.compute()
+
+            self.assert_same_results(updated, fresh)
+
+            fresh.struct_cleanup()
+            fresh.empty()
+
+        updated.struct_cleanup()
+        updated.empty()
+
+    def test_default_is_full_recompute(self):
+        """Without partial_update, the flag stays off"""
+        cosmo = Class()
+        self.assertFalse(cosmo.partial_update)
+        cosmo.partial_update = True
+        self.assertTrue(cosmo.partial_update)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -87,6 +87,12 @@
  * integration of perturbations; long_info returns quantities needed
  * only occasionally.
  *
+ * Unless the precision parameter interpolation_index_guide is set to
+ * false, the position of a given time in the interpolation table is
+ * found in constant time rather than by bisection: loga_table is
+ * uniform, and an index guide uniform in log(tau) is built together
+ * with the table.
+ *
  * In summary, the following functions can be called from other modules:
  *
  * -# background_init() at the beginning background_at_tau(),
@@ -178,7 +184,24 @@ int background_at_z(
       or array_interpolate_growing_closeby() (depending on
       interpolation mode) */
 
-  if (inter_mode == inter_normal) {
+  if ((inter_mode == inter_normal) && (pba->has_index_guide == _TRUE_)) {
+    /* loga_table is uniform: the interval follows directly from loga */
+    *last_index = (int)((loga-pba->loga_table[0])/pba->dloga);
+    class_call(array_interpolate_spline_guided(
+                                               pba->loga_table,
+                                               pba->bt_size,
+                                               pba->background_table,
+                                               pba->d2background_dloga2_table,
+                                               pba->bg_size,
+                                               loga,
+                                               last_index,
+                                               pvecback,
+                                               pvecback_size,
+                                               pba->error_message),
+               pba->error_message,
+               pba->error_message);
+  }
+  else if (inter_mode == inter_normal) {
     class_call(array_interpolate_spline(
                                         pba->loga_table,
                                         pba->bt_size,
@@ -287,20 +310,40 @@ int background_tau_of_z(
              pba->error_message,
              "out of range: z=%e > z_max=%e\n",z,pba->z_table[0]);
 
-  /** - interpolate from pre-computed table with array_interpolate() */
-  class_call(array_interpolate_spline(
-                                      pba->z_table,
-                                      pba->bt_size,
-                                      pba->tau_table,
-                                      pba->d2tau_dz2_table,
-                                      1,
-                                      z,
-                                      &last_index,
-                                      tau,
-                                      1,
-                                      pba->error_message),
-             pba->error_message,
-             pba->error_message);
+  /** - interpolate from pre-computed table with array_interpolate(),
+      or array_interpolate_spline_guided() starting from the line
+      inferred from the uniform loga_table */
+  if (pba->has_index_guide == _TRUE_) {
+    last_index = (int)((-log(1.+z)-pba->loga_table[0])/pba->dloga);
+    class_call(array_interpolate_spline_guided(
+                                               pba->z_table,
+                                               pba->bt_size,
+                                               pba->tau_table,
+                                               pba->d2tau_dz2_table,
+                                               1,
+                                               z,
+                                               &last_index,
+                                               tau,
+                                               1,
+                                               pba->error_message),
+               pba->error_message,
+               pba->error_message);
+  }
+  else {
+    class_call(array_interpolate_spline(
+                                        pba->z_table,
+                                        pba->bt_size,
+                                        pba->tau_table,
+                                        pba->d2tau_dz2_table,
+                                        1,
+                                        z,
+                                        &last_index,
+                                        tau,
+                                        1,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+  }
 
   return _SUCCESS_;
 }
@@ -337,20 +380,44 @@ int background_z_of_tau(
              pba->error_message,
              "out of range: tau=%e > tau_max=%e\n",tau,pba->tau_table[pba->bt_size-1]);
 
-  /** - interpolate from pre-computed table with array_interpolate() */
-  class_call(array_interpolate_spline(
-                                      pba->tau_table,
-                                      pba->bt_size,
-                                      pba->z_table,
-                                      pba->d2z_dtau2_table,
-                                      1,
-                                      tau,
-                                      &last_index,
-                                      z,
-                                      1,
-                                      pba->error_message),
-             pba->error_message,
-             pba->error_message);
+  /** - interpolate from pre-computed table with array_interpolate(),
+      or array_interpolate_spline_guided() starting from the line
+      given by the index guide in log(tau) */
+  if (pba->has_index_guide == _TRUE_) {
+    last_index = array_index_guide_find(pba->tau_guide,
+                                        pba->tau_guide_size,
+                                        pba->tau_guide_logtau_min,
+                                        pba->tau_guide_dlogtau,
+                                        log(tau));
+    class_call(array_interpolate_spline_guided(
+                                               pba->tau_table,
+                                               pba->bt_size,
+                                               pba->z_table,
+                                               pba->d2z_dtau2_table,
+                                               1,
+                                               tau,
+                                               &last_index,
+                                               z,
+                                               1,
+                                               pba->error_message),
+               pba->error_message,
+               pba->error_message);
+  }
+  else {
+    class_call(array_interpolate_spline(
+                                        pba->tau_table,
+                                        pba->bt_size,
+                                        pba->z_table,
+                                        pba->d2z_dtau2_table,
+                                        1,
+                                        tau,
+                                        &last_index,
+                                        z,
+                                        1,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+  }
 
   return _SUCCESS_;
 }
@@ -496,21 +563,34 @@ int background_functions(
     for (n_ncdm=0; n_ncdm<pba->N_ncdm; n_ncdm++) {
 
       /* function returning background ncdm[n_ncdm] quantities (only
-         those for which non-NULL pointers are passed) */
-      class_call(background_ncdm_momenta(
-                                         pba->q_ncdm_bg[n_ncdm],
-                                         pba->w_ncdm_bg[n_ncdm],
-                                         pba->q_size_ncdm_bg[n_ncdm],
-                                         pba->M_ncdm[n_ncdm],
-                                         pba->factor_ncdm[n_ncdm],
-                                         1./a-1.,
-                                         NULL,
-                                         &rho_ncdm,
-                                         &p_ncdm,
-                                         NULL,
-                                         &pseudo_p_ncdm),
-                 pba->error_message,
-                 pba->error_message);
+         those for which non-NULL pointers are passed), either from
+         pre-computed tables or by summing over momenta */
+      if (pba->has_ncdm_bg_table == _TRUE_) {
+        class_call(background_ncdm_momenta_tabulated(pba,
+                                                     n_ncdm,
+                                                     1./a-1.,
+                                                     &rho_ncdm,
+                                                     &p_ncdm,
+                                                     &pseudo_p_ncdm),
+                   pba->error_message,
+                   pba->error_message);
+      }
+      else {
+        class_call(background_ncdm_momenta(
+                                           pba->q_ncdm_bg[n_ncdm],
+                                           pba->w_ncdm_bg[n_ncdm],
+                                           pba->q_size_ncdm_bg[n_ncdm],
+                                           pba->M_ncdm[n_ncdm],
+                                           pba->factor_ncdm[n_ncdm],
+                                           1./a-1.,
+                                           NULL,
+                                           &rho_ncdm,
+                                           &p_ncdm,
+                                           NULL,
+                                           &pseudo_p_ncdm),
+                   pba->error_message,
+                   pba->error_message);
+      }
 
       pvecback[pba->index_bg_rho_ncdm1+n_ncdm] = rho_ncdm;
       rho_tot += rho_ncdm;
@@ -892,6 +972,8 @@ int background_free_noinput(
   free(pba->d2z_dtau2_table);
   free(pba->background_table);
   free(pba->d2background_dloga2_table);
+  if (pba->has_index_guide == _TRUE_)
+    free(pba->tau_guide);
 
   return _SUCCESS_;
 }
@@ -925,6 +1007,17 @@ int background_free_input(
     free(pba->q_ncdm_bg);
     free(pba->w_ncdm_bg);
     free(pba->dlnf0_dlnq_ncdm);
+    if (pba->has_ncdm_bg_table == _TRUE_) {
+      for (k=0; k<pba->N_ncdm; k++) {
+        free(pba->ncdm_bg_table[k]);
+        free(pba->d2ncdm_bg_table[k]);
+      }
+      free(pba->ncdm_bg_table);
+      free(pba->d2ncdm_bg_table);
+      free(pba->ncdm_bg_table_logx);
+      free(pba->ncdm_bg_q1_moment);
+      free(pba->ncdm_bg_q3_moment);
+    }
     free(pba->q_size_ncdm);
     free(pba->q_size_ncdm_bg);
     free(pba->M_ncdm);
@@ -1586,6 +1679,14 @@ int background_ncdm_init(
     }
   }
 
+  /** - if requested, tabulate the background integrals over momenta */
+  pba->has_ncdm_bg_table = _FALSE_;
+  if (ppr->background_ncdm_table == _TRUE_) {
+    class_call(background_ncdm_momenta_table_init(ppr,pba),
+               pba->error_message,
+               pba->error_message);
+  }
+
 
   return _SUCCESS_;
 }
@@ -1668,6 +1769,200 @@ int background_ncdm_momenta(
   return _SUCCESS_;
 }
 
+/**
+ * Tabulate, for each ncdm species, the integrals over momenta giving
+ * the background density, pressure and pseudo-pressure, as a function
+ * of x = M/(1+z) = a m / T_ncdm. Once normalised by factor_ncdm (1+z)^4,
+ * these integrals only depend on x, so the table does not need the
+ * mass, which may not be known yet at this stage. The logarithm of
+ * each integral is splined in log(x) on a uniform grid.
+ *
+ * @param ppr Input: precision structure
+ * @param pba Input/Output: background structure
+ * @return the error status
+ */
+
+int background_ncdm_momenta_table_init(
+                                       struct precision *ppr,
+                                       struct background *pba
+                                       ) {
+
+  int n_ncdm,index_x,index_q;
+  double logx_min,logx_max,x;
+  double rho,p,pseudo_p;
+
+  class_test(ppr->background_ncdm_table_x_min <= 0. || ppr->background_ncdm_table_x_max <= ppr->background_ncdm_table_x_min,
+             pba->error_message,
+             "the range of the ncdm background table should be 0 < x_min=%e < x_max=%e",
+             ppr->background_ncdm_table_x_min,ppr->background_ncdm_table_x_max);
+
+  class_test(ppr->background_ncdm_table_dlogx <= 0.,
+             pba->error_message,
+             "the step of the ncdm background table should be positive, not %e",
+             ppr->background_ncdm_table_dlogx);
+
+  /** - define a grid uniform in log(x), common to all species */
+  logx_min = log(ppr->background_ncdm_table_x_min);
+  logx_max = log(ppr->background_ncdm_table_x_max);
+  pba->ncdm_bg_table_size = (int)ceil((logx_max-logx_min)/ppr->background_ncdm_table_dlogx)+1;
+
+  class_alloc(pba->ncdm_bg_table_logx,pba->ncdm_bg_table_size*sizeof(double),pba->error_message);
+  for (index_x=0; index_x<pba->ncdm_bg_table_size; index_x++) {
+    pba->ncdm_bg_table_logx[index_x] = logx_min + index_x*(logx_max-logx_min)/(pba->ncdm_bg_table_size-1);
+  }
+
+  class_alloc(pba->ncdm_bg_table,pba->N_ncdm*sizeof(double*),pba->error_message);
+  class_alloc(pba->d2ncdm_bg_table,pba->N_ncdm*sizeof(double*),pba->error_message);
+  class_alloc(pba->ncdm_bg_q1_moment,pba->N_ncdm*sizeof(double),pba->error_message);
+  class_alloc(pba->ncdm_bg_q3_moment,pba->N_ncdm*sizeof(double),pba->error_message);
+
+  for (n_ncdm=0; n_ncdm<pba->N_ncdm; n_ncdm++) {
+
+    class_alloc(pba->ncdm_bg_table[n_ncdm],3*pba->ncdm_bg_table_size*sizeof(double),pba->error_message);
+    class_alloc(pba->d2ncdm_bg_table[n_ncdm],3*pba->ncdm_bg_table_size*sizeof(double),pba->error_message);
+
+    /** - the integrals are computed with background_ncdm_momenta()
+        for M=x at z=0, where the normalisation factor is one */
+    for (index_x=0; index_x<pba->ncdm_bg_table_size; index_x++) {
+
+      x = exp(pba->ncdm_bg_table_logx[index_x]);
+
+      class_call(background_ncdm_momenta(pba->q_ncdm_bg[n_ncdm],
+                                         pba->w_ncdm_bg[n_ncdm],
+                                         pba->q_size_ncdm_bg[n_ncdm],
+                                         x,
+                                         1.,
+                                         0.,
+                                         NULL,
+                                         &rho,
+                                         &p,
+                                         NULL,
+                                         &pseudo_p),
+                 pba->error_message,
+                 pba->error_message);
+
+      pba->ncdm_bg_table[n_ncdm][3*index_x]   = log(rho);
+      pba->ncdm_bg_table[n_ncdm][3*index_x+1] = log(p);
+      pba->ncdm_bg_table[n_ncdm][3*index_x+2] = log(pseudo_p);
+    }
+
+    class_call(array_spline_table_lines(pba->ncdm_bg_table_logx,
+                                        pba->ncdm_bg_table_size,
+                                        pba->ncdm_bg_table[n_ncdm],
+                                        3,
+                                        pba->d2ncdm_bg_table[n_ncdm],
+                                        _SPLINE_EST_DERIV_,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+
+    /** - moments needed for the small-x expansion */
+    pba->ncdm_bg_q1_moment[n_ncdm] = 0.;
+    pba->ncdm_bg_q3_moment[n_ncdm] = 0.;
+    for (index_q=0; index_q<pba->q_size_ncdm_bg[n_ncdm]; index_q++) {
+      pba->ncdm_bg_q1_moment[n_ncdm] += pba->q_ncdm_bg[n_ncdm][index_q]*pba->w_ncdm_bg[n_ncdm][index_q];
+      pba->ncdm_bg_q3_moment[n_ncdm] += pow(pba->q_ncdm_bg[n_ncdm][index_q],3)*pba->w_ncdm_bg[n_ncdm][index_q];
+    }
+  }
+
+  pba->has_ncdm_bg_table = _TRUE_;
+
+  if (pba->background_verbose > 1) {
+    printf("ncdm background integrals tabulated for %d species at %d values of a*m/T between %e and %e\n",
+           pba->N_ncdm,
+           pba->ncdm_bg_table_size,
+           ppr->background_ncdm_table_x_min,
+           ppr->background_ncdm_table_x_max);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * For a given ncdm species, get the background density, pressure and
+ * pseudo-pressure from the tables built by
+ * background_ncdm_momenta_table_init(), instead of summing over
+ * momenta like background_ncdm_momenta(). The position in the table
+ * follows directly from log(x), x=M/(1+z). Below the tabulated range,
+ * the integrals are expanded to order x^2; above it, this function
+ * calls background_ncdm_momenta().
+ *
+ * @param pba      Input: background structure
+ * @param n_ncdm   Input: index of ncdm species
+ * @param z        Input: redshift
+ * @param rho      Output: energy density
+ * @param p        Output: pressure
+ * @param pseudo_p Output: pseudo-pressure used in perturbation module for fluid approx
+ * @return the error status
+ */
+
+int background_ncdm_momenta_tabulated(
+                                      struct background *pba,
+                                      int n_ncdm,
+                                      double z,
+                                      double * rho,
+                                      double * p,
+                                      double * pseudo_p
+                                      ) {
+
+  int last_index;
+  double x,x2,logx,factor2;
+  double result[3];
+
+  x = pba->M_ncdm[n_ncdm]/(1.+z);
+  logx = log(x);
+  factor2 = pba->factor_ncdm[n_ncdm]*pow(1+z,4);
+
+  /** - relativistic regime: expand epsilon = sqrt(q^2+x^2) to order x^2 */
+  if (logx < pba->ncdm_bg_table_logx[0]) {
+    x2 = x*x;
+    *rho = factor2*(pba->ncdm_bg_q3_moment[n_ncdm] + 0.5*x2*pba->ncdm_bg_q1_moment[n_ncdm]);
+    *p = factor2*(pba->ncdm_bg_q3_moment[n_ncdm] - 0.5*x2*pba->ncdm_bg_q1_moment[n_ncdm])/3.;
+    *pseudo_p = factor2*(pba->ncdm_bg_q3_moment[n_ncdm] - 1.5*x2*pba->ncdm_bg_q1_moment[n_ncdm])/3.;
+    return _SUCCESS_;
+  }
+
+  /** - beyond the table: sum over momenta */
+  if (logx > pba->ncdm_bg_table_logx[pba->ncdm_bg_table_size-1]) {
+    class_call(background_ncdm_momenta(pba->q_ncdm_bg[n_ncdm],
+                                       pba->w_ncdm_bg[n_ncdm],
+                                       pba->q_size_ncdm_bg[n_ncdm],
+                                       pba->M_ncdm[n_ncdm],
+                                       pba->factor_ncdm[n_ncdm],
+                                       z,
+                                       NULL,
+                                       rho,
+                                       p,
+                                       NULL,
+                                       pseudo_p),
+               pba->error_message,
+               pba->error_message);
+    return _SUCCESS_;
+  }
+
+  /** - otherwise, spline interpolation in log(x) */
+  last_index = (int)((logx-pba->ncdm_bg_table_logx[0])/(pba->ncdm_bg_table_logx[1]-pba->ncdm_bg_table_logx[0]));
+
+  class_call(array_interpolate_spline_guided(pba->ncdm_bg_table_logx,
+                                             pba->ncdm_bg_table_size,
+                                             pba->ncdm_bg_table[n_ncdm],
+                                             pba->d2ncdm_bg_table[n_ncdm],
+                                             3,
+                                             logx,
+                                             &last_index,
+                                             result,
+                                             3,
+                                             pba->error_message),
+             pba->error_message,
+             pba->error_message);
+
+  *rho = factor2*exp(result[0]);
+  *p = factor2*exp(result[1]);
+  *pseudo_p = factor2*exp(result[2]);
+
+  return _SUCCESS_;
+}
+
 /**
  * When the user passed the density fraction Omega_ncdm or
  * omega_ncdm in input but not the mass, infer the mass with Newton iteration method.
@@ -1902,9 +2197,7 @@ int background_solve(
   double conformal_distance;
 
   /* evolvers */
-  extern int evolver_rk();
-  extern int evolver_ndf15();
-  int (*generic_evolver)() = evolver_ndf15;
+  evolver_function generic_evolver = evolver_ndf15;
 
   /* initial and final loga values */
   double loga_ini, loga_final;
@@ -1935,7 +2228,8 @@ int background_solve(
   loga_final = 0.; // with our conventions, loga is in fact log(a/a_0); we integrate until today, when log(a/a_0) = 0
   pba->bt_size = ppr->background_Nloga;
 
-  /** - allocate background tables */
+  /** - allocate background tables (the index guide is only switched on once all tables are filled) */
+  pba->has_index_guide = _FALSE_;
   class_alloc(pba->tau_table,pba->bt_size * sizeof(double),pba->error_message);
   class_alloc(pba->z_table,pba->bt_size * sizeof(double),pba->error_message);
   class_alloc(pba->loga_table,pba->bt_size * sizeof(double),pba->error_message);
@@ -1988,6 +2282,8 @@ int background_solve(
                              pba->bt_size,
                              background_sources,
                              NULL, //'print_variables' in evolver_rk could be set, but, not required
+                             NULL, //'jacobian', optional in ndf15 (computed numerically if NULL)
+                             NULL, //'jacobian_cache', optional in ndf15 (jacobian not kept between calls if NULL)
                              pba->error_message),
              pba->error_message,
              pba->error_message);
@@ -2056,6 +2352,27 @@ int background_solve(
              pba->error_message,
              pba->error_message);
 
+  /** - if requested, build the index guide used to find interpolation
+      intervals without bisection: loga_table is uniform by
+      construction, and tau_table is located through a guide uniform
+      in log(tau), with as many nodes as lines in the table */
+  if (ppr->interpolation_index_guide == _TRUE_) {
+    pba->dloga = (pba->loga_table[pba->bt_size-1]-pba->loga_table[0])/(pba->bt_size-1);
+    pba->tau_guide_size = pba->bt_size;
+    class_alloc(pba->tau_guide,pba->tau_guide_size*sizeof(int),pba->error_message);
+    class_call(array_index_guide_init(pba->tau_table,
+                                      pba->bt_size,
+                                      log,
+                                      pba->tau_guide_size,
+                                      pba->tau_guide,
+                                      &(pba->tau_guide_logtau_min),
+                                      &(pba->tau_guide_dlogtau),
+                                      pba->error_message),
+               pba->error_message,
+               pba->error_message);
+    pba->has_index_guide = _TRUE_;
+  }
+
   /** - compute remaining "related parameters" */
 
   /**  - so-called "effective neutrino number", computed at earliest
@@ -0,0 +1,783 @@
+/** @file batch.c Documented batch module
+ *
+ * Computes several cosmologies in a single call, e.g. for the
+ * successive points of a parameter scan or of a sampler proposing
+ * several points at once.
+ *
+ * Running the cosmologies one after the other with main/class.c
+ * leaves threads idle at the end of each parallel region of the
+ * perturbation module (the last wavenumbers of each mode and initial
+ * condition are integrated while other threads wait). Here, all the
+ * (cosmology, mode, initial condition, wavenumber) integrations of
+ * the batch are distributed from a single queue by
+ * perturbations_init_batch(), and the subsequent modules run in
+ * parallel over cosmologies when there are enough of them to keep
+ * all threads busy.
+ *
+ * The following functions can be called from other modules or from
+ * a wrapper:
+ *
+ * -# batch_init() computes all modules for each cosmology of the batch
+ * -# batch_update() changes the input parameters of one cosmology, and
+ *    recomputes only the modules depending on the modified parameters
+ * -# batch_free() frees all the modules allocated by batch_init()
+ *
+ * A failure in one cosmology does not stop the computation of the
+ * others: its status is stored in the stage_done and error_message
+ * fields of the corresponding batch_cosmology structure.
+ *
+ * The modules keep no global state: each batch_cosmology structure
+ * holds all the data of its cosmology, and the only tables shared
+ * between cosmologies (the flat spherical Bessel functions of the
+ * transfer module, and the atomic rates of HyRec) are protected by a
+ * lock. Distinct batch_cosmology
+ * structures, e.g. allocated with batch_cosmology_alloc(), can then
+ * be passed to batch_init() or batch_update() from several threads
+ * of the same process at the same time.
+ */
+
+#include "batch.h"
+
+/**
+ * Compute all modules, from the input to the spectral distortions,
+ * for each cosmology of the batch.
+ *
+ * For each cosmology, the caller should fill the field pfc with the
+ * input parameters, and make the other pointers point towards
+ * (non-initialized) structures. On output, pbc[index_cosmo].stage_done
+ * is equal to batch_distortions if the computation succeeded;
+ * otherwise it indicates the last stage performed, and
+ * pbc[index_cosmo].error_message contains the reason of the failure.
+ *
+ * @param cosmo_size    Input: number of cosmologies
+ * @param pbc           Input/Output: array of cosmo_size batch_cosmology structures
+ * @param error_message Output: error message (only in case of failure of the batch itself)
+ * @return the error status
+ */
+
+int batch_init(
+               int cosmo_size,
+               struct batch_cosmology * pbc,
+               ErrorMsg error_message
+               ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+
+  int index_cosmo;
+  int cosmo_size_pt;
+  int * index_cosmo_pt;
+  struct precision ** pppr;
+  struct background ** ppba;
+  struct thermodynamics ** ppth;
+  struct perturbations ** pppt;
+  int * status;
+  int number_of_threads=1;
+
+  class_test(cosmo_size < 1,
+             error_message,
+             "cosmo_size=%d, should be at least 1",cosmo_size);
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    pbc[index_cosmo].stage_done = batch_none;
+    sprintf(pbc[index_cosmo].error_message,"%s","");
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel
+  {
+    number_of_threads = omp_get_num_threads();
+  }
+#endif
+
+  /** - read input, and compute background and thermodynamics for
+      each cosmology. Like the modules following the perturbations
+      (see below), they run in parallel over cosmologies when there are
+      at least as many cosmologies as threads. */
+
+#pragma omp parallel for schedule (dynamic) if (cosmo_size >= number_of_threads)
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    batch_init_early_stages(&(pbc[index_cosmo]));
+  }
+
+  /** - integrate the perturbations of all cosmologies having reached
+      this stage from a single queue of tasks */
+
+  class_alloc(index_cosmo_pt,cosmo_size*sizeof(int),error_message);
+  class_alloc(pppr,cosmo_size*sizeof(struct precision *),error_message);
+  class_alloc(ppba,cosmo_size*sizeof(struct background *),error_message);
+  class_alloc(ppth,cosmo_size*sizeof(struct thermodynamics *),error_message);
+  class_alloc(pppt,cosmo_size*sizeof(struct perturbations *),error_message);
+  class_alloc(status,cosmo_size*sizeof(int),error_message);
+
+  cosmo_size_pt = 0;
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    if (pbc[index_cosmo].stage_done == batch_thermodynamics) {
+      index_cosmo_pt[cosmo_size_pt] = index_cosmo;
+      pppr[cosmo_size_pt] = pbc[index_cosmo].ppr;
+      ppba[cosmo_size_pt] = pbc[index_cosmo].pba;
+      ppth[cosmo_size_pt] = pbc[index_cosmo].pth;
+      pppt[cosmo_size_pt] = pbc[index_cosmo].ppt;
+      cosmo_size_pt++;
+    }
+  }
+
+  if (cosmo_size_pt > 0) {
+
+    class_call(perturbations_init_batch(cosmo_size_pt,pppr,ppba,ppth,pppt,status),
+               pppt[0]->error_message,
+               error_message);
+
+    for (index_cosmo = 0; index_cosmo < cosmo_size_pt; index_cosmo++) {
+      if (status[index_cosmo] == _SUCCESS_) {
+        pbc[index_cosmo_pt[index_cosmo]].stage_done = batch_perturbations;
+      }
+      else {
+        class_call_message(pbc[index_cosmo_pt[index_cosmo]].error_message,
+                           "perturbations_init_batch",
+                           pppt[index_cosmo]->error_message);
+      }
+    }
+  }
+
+  free(index_cosmo_pt);
+  free(pppr);
+  free(ppba);
+  free(ppth);
+  free(pppt);
+  free(status);
+
+  /** - compute the remaining modules. If there are at least as many
+      cosmologies as threads, distribute cosmologies over threads
+      (the parallel regions inside each module then run on a single
+      thread); otherwise, compute cosmologies one after the other,
+      each module using all threads. */
+
+#pragma omp parallel for schedule (dynamic) if (cosmo_size >= number_of_threads)
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    if (pbc[index_cosmo].stage_done == batch_perturbations) {
+      batch_init_late_stages(&(pbc[index_cosmo]));
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Read the input parameters, and compute the background and
+ * thermodynamics modules of one cosmology.
+ *
+ * @param pbc Input/Output: pointer to batch_cosmology structure
+ * @return the error status
+ */
+
+int batch_init_early_stages(
+                            struct batch_cosmology * pbc
+                            ) {
+
+  int stage;
+
+  /* keep track of the modules reading each parameter, for later calls to batch_update() */
+  if ((pbc->pfc->size > 0) && (pbc->pfc->read_by == NULL)) {
+    class_calloc(pbc->pfc->read_by,pbc->pfc->size,sizeof(int),pbc->error_message);
+  }
+
+  class_call(input_read_from_file(pbc->pfc,pbc->ppr,pbc->pba,pbc->pth,pbc->ppt,pbc->ptr,pbc->ppm,pbc->phr,pbc->pfo,pbc->ple,pbc->psd,pbc->pop,
+                                  pbc->error_message),
+             pbc->error_message,
+             pbc->error_message);
+  pbc->stage_done = batch_input;
+
+  for (stage = batch_background; stage <= batch_thermodynamics; stage++) {
+    class_call(batch_init_stage(pbc,(enum batch_stage)stage),
+               pbc->error_message,
+               pbc->error_message);
+    pbc->stage_done = (enum batch_stage)stage;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute all the modules following the perturbation module for one
+ * cosmology.
+ *
+ * @param pbc Input/Output: pointer to batch_cosmology structure
+ * @return the error status
+ */
+
+int batch_init_late_stages(
+                           struct batch_cosmology * pbc
+                           ) {
+
+  int stage;
+
+  for (stage = batch_primordial; stage <= batch_distortions; stage++) {
+    class_call(batch_init_stage(pbc,(enum batch_stage)stage),
+               pbc->error_message,
+               pbc->error_message);
+    pbc->stage_done = (enum batch_stage)stage;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute one module of one cosmology, assuming that all the modules
+ * it depends on are up to date. The field stage_done is not updated.
+ *
+ * @param pbc   Input/Output: pointer to batch_cosmology structure
+ * @param stage Input: stage to perform (from batch_background to batch_distortions)
+ * @return the error status
+ */
+
+int batch_init_stage(
+                     struct batch_cosmology * pbc,
+                     enum batch_stage stage
+                     ) {
+
+  switch (stage) {
+
+  case batch_background:
+    class_call(background_init(pbc->ppr,pbc->pba),
+               pbc->pba->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_thermodynamics:
+    class_call(thermodynamics_init(pbc->ppr,pbc->pba,pbc->pth),
+               pbc->pth->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_perturbations:
+    class_call(perturbations_init(pbc->ppr,pbc->pba,pbc->pth,pbc->ppt),
+               pbc->ppt->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_primordial:
+    class_call(primordial_init(pbc->ppr,pbc->ppt,pbc->ppm),
+               pbc->ppm->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_fourier:
+    class_call(fourier_init(pbc->ppr,pbc->pba,pbc->pth,pbc->ppt,pbc->ppm,pbc->pfo),
+               pbc->pfo->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_transfer:
+    class_call(transfer_init(pbc->ppr,pbc->pba,pbc->pth,pbc->ppt,pbc->pfo,pbc->ptr),
+               pbc->ptr->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_harmonic:
+    class_call(harmonic_init(pbc->ppr,pbc->pba,pbc->ppt,pbc->ppm,pbc->pfo,pbc->ptr,pbc->phr),
+               pbc->phr->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_lensing:
+    class_call(lensing_init(pbc->ppr,pbc->ppt,pbc->phr,pbc->pfo,pbc->ple),
+               pbc->ple->error_message,
+               pbc->error_message);
+    break;
+
+  case batch_distortions:
+    class_call(distortions_init(pbc->ppr,pbc->pba,pbc->pth,pbc->ppt,pbc->ppm,pbc->psd),
+               pbc->psd->error_message,
+               pbc->error_message);
+    break;
+
+  default:
+    class_stop(pbc->error_message,
+               "stage %d does not correspond to a module",stage);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free one module of one cosmology. The field stage_done is not
+ * updated.
+ *
+ * @param pbc   Input/Output: pointer to batch_cosmology structure
+ * @param stage Input: stage to undo (from batch_background to batch_distortions)
+ * @return the error status
+ */
+
+int batch_free_stage(
+                     struct batch_cosmology * pbc,
+                     enum batch_stage stage
+                     ) {
+
+  switch (stage) {
+
+  case batch_background:
+    class_call(background_free(pbc->pba),pbc->pba->error_message,pbc->error_message);
+    break;
+  case batch_thermodynamics:
+    class_call(thermodynamics_free(pbc->pth),pbc->pth->error_message,pbc->error_message);
+    break;
+  case batch_perturbations:
+    class_call(perturbations_free(pbc->ppt),pbc->ppt->error_message,pbc->error_message);
+    break;
+  case batch_primordial:
+    class_call(primordial_free(pbc->ppm),pbc->ppm->error_message,pbc->error_message);
+    break;
+  case batch_fourier:
+    class_call(fourier_free(pbc->pfo),pbc->pfo->error_message,pbc->error_message);
+    break;
+  case batch_transfer:
+    class_call(transfer_free(pbc->ptr),pbc->ptr->error_message,pbc->error_message);
+    break;
+  case batch_harmonic:
+    class_call(harmonic_free(pbc->phr),pbc->phr->error_message,pbc->error_message);
+    break;
+  case batch_lensing:
+    class_call(lensing_free(pbc->ple),pbc->ple->error_message,pbc->error_message);
+    break;
+  case batch_distortions:
+    class_call(distortions_free(pbc->psd),pbc->psd->error_message,pbc->error_message);
+    break;
+  default:
+    class_stop(pbc->error_message,
+               "stage %d does not correspond to a module",stage);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free all the modules allocated by batch_init(), for each cosmology
+ * of the batch, according to the last stage performed.
+ *
+ * @param cosmo_size Input: number of cosmologies
+ * @param pbc        Input/Output: array of cosmo_size batch_cosmology structures
+ * @return the error status
+ */
+
+int batch_free(
+               int cosmo_size,
+               struct batch_cosmology * pbc
+               ) {
+
+  int index_cosmo;
+  int stage;
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+
+    for (stage = pbc[index_cosmo].stage_done; stage >= batch_background; stage--) {
+      class_call(batch_free_stage(&(pbc[index_cosmo]),(enum batch_stage)stage),
+                 pbc[index_cosmo].error_message,
+                 pbc[index_cosmo].error_message);
+    }
+
+    pbc[index_cosmo].stage_done = batch_none;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Update the input parameters of one cosmology that has already been
+ * computed, and recompute only the modules affected by the change.
+ *
+ * The stages depending on each parameter are deduced from the groups
+ * of input_read_parameters() in which this parameter was read (see
+ * batch_mark_stages()). The set of modules to recompute is then
+ * closed over the dependencies between modules (see
+ * batch_depends_on()). The remaining modules keep their previous
+ * results.
+ *
+ * If the new parameters cannot be read, the cosmology is left
+ * unchanged. If the computation of one of the modules fails, all the
+ * modules following it are freed, and stage_done indicates the last
+ * stage performed, like after batch_init().
+ *
+ * @param pbc     Input/Output: pointer to batch_cosmology structure, previously passed to batch_init() or batch_update()
+ * @param pfc_new Input: new input parameters (they replace pbc->pfc, which is not freed)
+ * @return the error status
+ */
+
+int batch_update(
+                 struct batch_cosmology * pbc,
+                 struct file_content * pfc_new
+                 ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+
+  struct batch_cosmology bc_new;
+  short dirty[batch_distortions+1];
+  int stage,other;
+  int index_new,index_old;
+  short found;
+  enum batch_stage stage_done_old;
+
+  /** - read the new parameters in temporary structures */
+
+  class_alloc(bc_new.ppr,sizeof(struct precision),pbc->error_message);
+  class_alloc(bc_new.pba,sizeof(struct background),pbc->error_message);
+  class_alloc(bc_new.pth,sizeof(struct thermodynamics),pbc->error_message);
+  class_alloc(bc_new.ppt,sizeof(struct perturbations),pbc->error_message);
+  class_alloc(bc_new.ppm,sizeof(struct primordial),pbc->error_message);
+  class_alloc(bc_new.pfo,sizeof(struct fourier),pbc->error_message);
+  class_alloc(bc_new.ptr,sizeof(struct transfer),pbc->error_message);
+  class_alloc(bc_new.phr,sizeof(struct harmonic),pbc->error_message);
+  class_alloc(bc_new.ple,sizeof(struct lensing),pbc->error_message);
+  class_alloc(bc_new.psd,sizeof(struct distortions),pbc->error_message);
+  class_alloc(bc_new.pop,sizeof(struct output),pbc->error_message);
+
+  if ((pfc_new->size > 0) && (pfc_new->read_by == NULL)) {
+    class_calloc(pfc_new->read_by,pfc_new->size,sizeof(int),pbc->error_message);
+  }
+
+  class_call_except(input_read_from_file(pfc_new,bc_new.ppr,bc_new.pba,bc_new.pth,bc_new.ppt,bc_new.ptr,bc_new.ppm,bc_new.phr,bc_new.pfo,bc_new.ple,bc_new.psd,bc_new.pop,
+                                         pbc->error_message),
+                    pbc->error_message,
+                    pbc->error_message,
+                    batch_free_temporary(&bc_new));
+
+  /** - find the stages affected by the parameters that were added,
+      removed, or modified. Stages that were not performed yet are
+      always recomputed. */
+
+  for (stage = batch_none; stage <= batch_distortions; stage++) {
+    dirty[stage] = ((stage > pbc->stage_done) && (stage >= batch_background)) ? _TRUE_ : _FALSE_;
+  }
+
+  for (index_new = 0; index_new < pfc_new->size; index_new++) {
+    found = _FALSE_;
+    for (index_old = 0; index_old < pbc->pfc->size; index_old++) {
+      if (strcmp(pfc_new->name[index_new],pbc->pfc->name[index_old]) == 0) {
+        found = _TRUE_;
+        break;
+      }
+    }
+    if ((found == _FALSE_) || (strcmp(pfc_new->value[index_new],pbc->pfc->value[index_old]) != 0)) {
+      batch_mark_stages(pfc_new,index_new,dirty);
+    }
+  }
+
+  for (index_old = 0; index_old < pbc->pfc->size; index_old++) {
+    found = _FALSE_;
+    for (index_new = 0; index_new < pfc_new->size; index_new++) {
+      if (strcmp(pfc_new->name[index_new],pbc->pfc->name[index_old]) == 0) {
+        found = _TRUE_;
+        break;
+      }
+    }
+    if (found == _FALSE_) {
+      batch_mark_stages(pbc->pfc,index_old,dirty);
+    }
+  }
+
+  /** - propagate to the stages depending on them. Each stage depends
+      only on previous ones, so a single pass is enough. */
+
+  for (stage = batch_background; stage <= batch_distortions; stage++) {
+    for (other = batch_background; other < stage; other++) {
+      if ((dirty[other] == _TRUE_) && (batch_depends_on(&bc_new,(enum batch_stage)stage,(enum batch_stage)other) == _TRUE_)) {
+        dirty[stage] = _TRUE_;
+      }
+    }
+  }
+
+  /** - free the previous results of the stages to recompute */
+
+  stage_done_old = pbc->stage_done;
+
+  for (stage = stage_done_old; stage >= batch_background; stage--) {
+    if (dirty[stage] == _TRUE_) {
+      class_call(batch_free_stage(pbc,(enum batch_stage)stage),
+                 pbc->error_message,
+                 pbc->error_message);
+    }
+  }
+
+  /** - replace the input of the stages to recompute. For the other
+      stages, the input is unchanged, and the copy read in the
+      temporary structures is released. The precision and output
+      structures are not allocated: they are always updated. */
+
+  *(pbc->ppr) = *(bc_new.ppr);
+  *(pbc->pop) = *(bc_new.pop);
+
+  if (dirty[batch_background] == _TRUE_)
+    *(pbc->pba) = *(bc_new.pba);
+  else
+    class_call(background_free_input(bc_new.pba),bc_new.pba->error_message,pbc->error_message);
+
+  if (dirty[batch_thermodynamics] == _TRUE_)
+    *(pbc->pth) = *(bc_new.pth);
+  else
+    class_call(thermodynamics_free_input(bc_new.pth),bc_new.pth->error_message,pbc->error_message);
+
+  if (dirty[batch_perturbations] == _TRUE_)
+    *(pbc->ppt) = *(bc_new.ppt);
+  else
+    class_call(perturbations_free_input(bc_new.ppt),bc_new.ppt->error_message,pbc->error_message);
+
+  if (dirty[batch_primordial] == _TRUE_)
+    *(pbc->ppm) = *(bc_new.ppm);
+  else if (bc_new.ppm->primordial_spec_type == external_Pk)
+    free(bc_new.ppm->command);
+
+  if (dirty[batch_fourier] == _TRUE_) {
+    *(pbc->pfo) = *(bc_new.pfo);
+  }
+  else if (bc_new.pfo->has_pk_eq == _TRUE_) {
+    free(bc_new.pfo->pk_eq_tau);
+    free(bc_new.pfo->pk_eq_w_and_Omega);
+    free(bc_new.pfo->pk_eq_ddw_and_ddOmega);
+  }
+
+  if (dirty[batch_transfer] == _TRUE_)
+    *(pbc->ptr) = *(bc_new.ptr);
+  if (dirty[batch_harmonic] == _TRUE_)
+    *(pbc->phr) = *(bc_new.phr);
+  if (dirty[batch_lensing] == _TRUE_)
+    *(pbc->ple) = *(bc_new.ple);
+  if (dirty[batch_distortions] == _TRUE_)
+    *(pbc->psd) = *(bc_new.psd);
+
+  batch_free_temporary(&bc_new);
+
+  pbc->pfc = pfc_new;
+
+  /** - recompute the stages, in the order of main/class.c. In case of
+      failure, free the stages following the failed one which were
+      kept from the previous computation. */
+
+  pbc->stage_done = batch_input;
+
+  for (stage = batch_background; stage <= batch_distortions; stage++) {
+
+    if (dirty[stage] == _TRUE_) {
+      if (batch_init_stage(pbc,(enum batch_stage)stage) == _FAILURE_) {
+        for (other = batch_distortions; other > stage; other--) {
+          if ((dirty[other] == _FALSE_) && (other <= stage_done_old)) {
+            batch_free_stage(pbc,(enum batch_stage)other);
+          }
+        }
+        return _FAILURE_;
+      }
+    }
+
+    pbc->stage_done = (enum batch_stage)stage;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Mark the stages reading directly one parameter, according to the
+ * groups of input_read_parameters() in which it was read (field
+ * read_by of the file_content structure).
+ *
+ * Parameters whose groups are unknown (e.g. if the file_content
+ * structure was not filled with read_by, or for the targets of the
+ * shooting method, which are replaced by other parameters) are
+ * assumed to affect the background, so that everything is
+ * recomputed. Parameters read only by the output group do not
+ * require any recomputation.
+ *
+ * @param pfc   Input: pointer to file_content structure
+ * @param index Input: index of the parameter in pfc
+ * @param dirty Input/Output: array of flags indexed by enum batch_stage
+ * @return the error status
+ */
+
+int batch_mark_stages(
+                      struct file_content * pfc,
+                      int index,
+                      short * dirty
+                      ) {
+
+  int read_by;
+
+  /** - parameters read in a general group, but whose only effect is on later stages */
+  if ((strcmp(pfc->name[index],"k_output_values") == 0) ||
+      (strcmp(pfc->name[index],"r") == 0)) {
+    dirty[batch_perturbations] = _TRUE_;
+    return _SUCCESS_;
+  }
+
+  /** - parameters read in the output group, but which change the content of the perturbation structure */
+  if (strcmp(pfc->name[index],"perturbations_profile") == 0) {
+    dirty[batch_perturbations] = _TRUE_;
+    return _SUCCESS_;
+  }
+
+  if (pfc->read_by == NULL)
+    read_by = 0;
+  else
+    read_by = pfc->read_by[index];
+
+  if (read_by == 0) {
+    dirty[batch_background] = _TRUE_;
+    return _SUCCESS_;
+  }
+
+  /** - the precision parameters, the parameters of the species and the
+      additional parameters can affect all modules from the background on */
+  if (read_by & ((1<<input_group_precision) | (1<<input_group_general) | (1<<input_group_species) | (1<<input_group_additional)))
+    dirty[batch_background] = _TRUE_;
+  if (read_by & (1<<input_group_injection))
+    dirty[batch_thermodynamics] = _TRUE_;
+  /** - the non-linear, spectra and lensing groups also set the list of sources computed in the perturbation module */
+  if (read_by & ((1<<input_group_nonlinear) | (1<<input_group_spectra) | (1<<input_group_lensing)))
+    dirty[batch_perturbations] = _TRUE_;
+  if (read_by & (1<<input_group_primordial))
+    dirty[batch_primordial] = _TRUE_;
+  if (read_by & (1<<input_group_distortions))
+    dirty[batch_distortions] = _TRUE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Whether a stage uses directly the results of a previous stage,
+ * according to the arguments of the corresponding init functions.
+ *
+ * @param pbc   Input: pointer to batch_cosmology structure (only the input parameters are used)
+ * @param stage Input: stage
+ * @param other Input: previous stage
+ * @return _TRUE_ if stage depends on other, _FALSE_ otherwise
+ */
+
+short batch_depends_on(
+                       struct batch_cosmology * pbc,
+                       enum batch_stage stage,
+                       enum batch_stage other
+                       ) {
+
+  switch (stage) {
+
+  case batch_thermodynamics:
+    return (other == batch_background);
+
+  case batch_perturbations:
+    return ((other == batch_background) || (other == batch_thermodynamics));
+
+  case batch_primordial:
+    return (other == batch_perturbations);
+
+  case batch_fourier:
+    return ((other == batch_background) || (other == batch_thermodynamics) || (other == batch_perturbations) || (other == batch_primordial));
+
+  case batch_transfer:
+    /* the transfer module uses the fourier module only for the non-linear corrections */
+    return ((other == batch_background) || (other == batch_thermodynamics) || (other == batch_perturbations) ||
+            ((other == batch_fourier) && (pbc->pfo->method != nl_none)));
+
+  case batch_harmonic:
+    return ((other == batch_background) || (other == batch_perturbations) || (other == batch_primordial) || (other == batch_fourier) || (other == batch_transfer));
+
+  case batch_lensing:
+    return ((other == batch_perturbations) || (other == batch_harmonic));
+
+  case batch_distortions:
+    return ((other == batch_background) || (other == batch_thermodynamics) || (other == batch_perturbations) || (other == batch_primordial));
+
+  default:
+    return _FALSE_;
+  }
+}
+
+/**
+ * Allocate the structures describing one cosmology, such that the
+ * batch_cosmology structure owns them (instead of pointing towards
+ * structures of the caller, like in main/class.c). The input
+ * parameters pfc remain owned by the caller. The structures must be
+ * released with batch_cosmology_free().
+ *
+ * @param pbc           Output: pointer to batch_cosmology structure
+ * @param pfc           Input: input parameters of this cosmology
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int batch_cosmology_alloc(
+                          struct batch_cosmology * pbc,
+                          struct file_content * pfc,
+                          ErrorMsg error_message
+                          ) {
+
+  pbc->pfc = pfc;
+
+  class_calloc(pbc->ppr,1,sizeof(struct precision),error_message);
+  class_calloc(pbc->pba,1,sizeof(struct background),error_message);
+  class_calloc(pbc->pth,1,sizeof(struct thermodynamics),error_message);
+  class_calloc(pbc->ppt,1,sizeof(struct perturbations),error_message);
+  class_calloc(pbc->ppm,1,sizeof(struct primordial),error_message);
+  class_calloc(pbc->pfo,1,sizeof(struct fourier),error_message);
+  class_calloc(pbc->ptr,1,sizeof(struct transfer),error_message);
+  class_calloc(pbc->phr,1,sizeof(struct harmonic),error_message);
+  class_calloc(pbc->ple,1,sizeof(struct lensing),error_message);
+  class_calloc(pbc->psd,1,sizeof(struct distortions),error_message);
+  class_calloc(pbc->pop,1,sizeof(struct output),error_message);
+
+  pbc->stage_done = batch_none;
+  sprintf(pbc->error_message,"%s","");
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the modules computed for one cosmology, and the structures
+ * allocated by batch_cosmology_alloc().
+ *
+ * @param pbc Input/Output: pointer to batch_cosmology structure
+ * @return the error status
+ */
+
+int batch_cosmology_free(
+                         struct batch_cosmology * pbc
+                         ) {
+
+  class_call_except(batch_free(1,pbc),
+                    pbc->error_message,
+                    pbc->error_message,
+                    batch_free_temporary(pbc));
+
+  class_call(batch_free_temporary(pbc),
+             pbc->error_message,
+             pbc->error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the structures allocated by batch_update() to read the new
+ * input parameters, or by batch_cosmology_alloc() (but not the memory
+ * allocated inside them by the input module or by the other modules).
+ *
+ * @param pbc Input/Output: pointer to batch_cosmology structure
+ * @return the error status
+ */
+
+int batch_free_temporary(
+                         struct batch_cosmology * pbc
+                         ) {
+
+  free(pbc->ppr);
+  free(pbc->pba);
+  free(pbc->pth);
+  free(pbc->ppt);
+  free(pbc->ppm);
+  free(pbc->pfo);
+  free(pbc->ptr);
+  free(pbc->phr);
+  free(pbc->ple);
+  free(pbc->psd);
+  free(pbc->pop);
+
+  return _SUCCESS_;
+}
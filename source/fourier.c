@@ -1210,6 +1210,9 @@ int fourier_init(
   double **ddlnpk_l;
 
   short nl_corr_not_computable_at_this_k = _FALSE_;
+  int index_nl;
+  int index_nl_failed;
+  int abort;
 
   double * pvecback;
   int last_index;
@@ -1217,6 +1220,8 @@ int fourier_init(
 
   struct fourier_workspace nw;
   struct fourier_workspace * pnw;
+  struct fourier_workspace nw_thread;
+  struct fourier_workspace * pnw_thread;
 
   /** - Do we want to compute P(k,z)? Propagate the flag has_pk_matter
       from the perturbations structure to the fourier structure */
@@ -1387,32 +1392,21 @@ int fourier_init(
 	if ((pfo->fourier_verbose > 0) && (pfo->method == nl_HMcode))
       printf("Computing non-linear matter power spectrum with HMcode \n");
 
-    /** --> allocate temporary arrays for spectra at each given time/redshift */
+    pnw = &nw;
 
-    class_alloc(pk_nl,
-                pfo->k_size*sizeof(double),
-                pfo->error_message);
-
-    class_alloc(lnpk_l,
-                pfo->k_size*sizeof(double),
-                pfo->error_message);
+    /** --> Then go through preliminary steps specific to Halofit */
 
-    class_alloc(ddlnpk_l,
-                pfo->k_size*sizeof(double),
-                pfo->error_message);
+    if (pfo->method == nl_halofit){
 
-    for (index_pk=0; index_pk<pfo->pk_size; index_pk++){
-      class_alloc(pk_nl[index_pk],pfo->k_size*sizeof(double),pfo->error_message);
-      class_alloc(lnpk_l[index_pk],pfo->k_size_extra*sizeof(double),pfo->error_message);
-      class_alloc(ddlnpk_l[index_pk],pfo->k_size_extra*sizeof(double),pfo->error_message);
+      class_call(fourier_halofit_workspace_init(ppr,pfo,pnw),
+                 pfo->error_message,
+                 pfo->error_message);
     }
 
     /** --> Then go through preliminary steps specific to HMcode */
 
     if (pfo->method == nl_HMcode){
 
-      pnw = &nw;
-
       class_call(fourier_hmcode_workspace_init(ppr,pba,pfo,pnw),
                  pfo->error_message,
                  pfo->error_message);
@@ -1428,74 +1422,134 @@ int fourier_init(
 
     /** --> Loop over decreasing time/growing redhsift. For each
         time/redshift, compute P_NL(k,z) using either Halofit or
-        HMcode */
-
-    /* this flag will become _TRUE_ at the minimum redshift such that
-       the non-lienar corrections cannot be consistently computed */
-    nl_corr_not_computable_at_this_k = _FALSE_;
+        HMcode. The times are distributed among threads in contiguous
+        chunks. The Halofit search for k_NL starts from the same guess
+        at every time, so that the result does not depend on how the
+        times are split among threads. With HMcode,
+        each thread has its own table of sigma(R), while the
+        time-independent tables of the workspace are shared. */
+
+    /* the calculation is done in order of decreasing time and, for
+       each time, increasing index_pk. This integer will refer to the
+       position in this order of the first (time, index_pk) at which
+       the non-linear corrections cannot be consistently computed
+       (it is equal to tau_size*pk_size if they can always be
+       computed) */
+    index_nl_failed = pfo->tau_size*pfo->pk_size;
 
     /* this index will refer to the value of time corresponding to
        that redhsift */
     pfo->index_tau_min_nl = 0;
 
-    for (index_tau = pfo->tau_size-1; index_tau>=0; index_tau--) {
+    abort = _FALSE_;
 
-      /* loop over index_pk, defined such that it is ensured
-       * that index_pk starts at index_pk_cb when neutrinos are
-       * included. This is necessary for hmcode, since the sigmatable
-       * needs to be filled for sigma_cb only. Thus, when HMcode
-       * evalutes P_m_nl, it needs both P_m_l and P_cb_l. */
+#pragma omp parallel                                                    \
+  shared(ppr,pba,ppt,ppm,pfo,pnw,abort,index_nl_failed)                 \
+  private(index_tau,index_pk,index_k,index_nl,pk_nl,lnpk_l,ddlnpk_l,nl_corr_not_computable_at_this_k,nw_thread,pnw_thread)
 
-      for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+    {
 
-        /* get P_L(k) at this time */
-        class_call(fourier_pk_linear(
-                                     pba,
-                                     ppt,
-                                     ppm,
-                                     pfo,
-                                     index_pk,
-                                     index_tau,
-                                     pfo->k_size_extra,
-                                     lnpk_l[index_pk],
-                                     NULL
-                                     ),
-                   pfo->error_message,
-                   pfo->error_message);
+      /** --> copy of the nonlinear workspace, with the HMcode table of sigma(R) at a given time allocated for each thread */
 
-        /* spline P_L(k) at this time along k */
-        class_call(array_spline_table_columns(
-                                              pfo->ln_k,
-                                              pfo->k_size_extra,
-                                              lnpk_l[index_pk],
-                                              1,
-                                              ddlnpk_l[index_pk],
-                                              _SPLINE_NATURAL_,
-                                              pfo->error_message),
-                   pfo->error_message,
-                   pfo->error_message);
+      nw_thread = *pnw;
+      pnw_thread = &nw_thread;
+
+      if (pfo->method == nl_HMcode) {
+        class_alloc_parallel(pnw_thread->stab,ppr->n_hmcode_tables*sizeof(double),pfo->error_message);
+        class_alloc_parallel(pnw_thread->ddstab,ppr->n_hmcode_tables*sizeof(double),pfo->error_message);
+      }
+
+      /** --> allocate temporary arrays for spectra at each given time/redshift */
+
+      class_alloc_parallel(pk_nl,
+                           pfo->pk_size*sizeof(double*),
+                           pfo->error_message);
+
+      class_alloc_parallel(lnpk_l,
+                           pfo->pk_size*sizeof(double*),
+                           pfo->error_message);
+
+      class_alloc_parallel(ddlnpk_l,
+                           pfo->pk_size*sizeof(double*),
+                           pfo->error_message);
+
+      if (abort == _FALSE_) {
+        for (index_pk=0; index_pk<pfo->pk_size; index_pk++){
+          class_alloc_parallel(pk_nl[index_pk],pfo->k_size*sizeof(double),pfo->error_message);
+          class_alloc_parallel(lnpk_l[index_pk],pfo->k_size_extra*sizeof(double),pfo->error_message);
+          class_alloc_parallel(ddlnpk_l[index_pk],pfo->k_size_extra*sizeof(double),pfo->error_message);
+        }
+      }
 
-        /* if we are still in a range of time where P_NL(k) should be computable */
-        if (nl_corr_not_computable_at_this_k == _FALSE_) {
+#pragma omp for schedule (static)
+
+      for (index_tau = pfo->tau_size-1; index_tau>=0; index_tau--) {
+
+        /* loop over index_pk, defined such that it is ensured
+         * that index_pk starts at index_pk_cb when neutrinos are
+         * included. This is necessary for hmcode, since the sigmatable
+         * needs to be filled for sigma_cb only. Thus, when HMcode
+         * evalutes P_m_nl, it needs both P_m_l and P_cb_l. */
+
+        for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+
+          index_nl = (pfo->tau_size-1-index_tau)*pfo->pk_size+index_pk;
+
+#pragma omp flush(abort,index_nl_failed)
+
+          /* nothing to do if an error occured, or if the
+             non-linear corrections were already found not to be
+             computable at a smaller redshift: they will be set to
+             one after the loop */
+          if ((abort == _TRUE_) || (index_nl > index_nl_failed))
+            continue;
+
+          /* get P_L(k) at this time */
+          class_call_parallel(fourier_pk_linear(
+                                                pba,
+                                                ppt,
+                                                ppm,
+                                                pfo,
+                                                index_pk,
+                                                index_tau,
+                                                pfo->k_size_extra,
+                                                lnpk_l[index_pk],
+                                                NULL
+                                                ),
+                              pfo->error_message,
+                              pfo->error_message);
+
+          /* spline P_L(k) at this time along k */
+          class_call_parallel(array_spline_table_columns(
+                                                         pfo->ln_k,
+                                                         pfo->k_size_extra,
+                                                         lnpk_l[index_pk],
+                                                         1,
+                                                         ddlnpk_l[index_pk],
+                                                         _SPLINE_NATURAL_,
+                                                         pfo->error_message),
+                              pfo->error_message,
+                              pfo->error_message);
 
           /* get P_NL(k) at this time with Halofit */
           if (pfo->method == nl_halofit) {
 
-            class_call(fourier_halofit(
-                                       ppr,
-                                       pba,
-                                       ppt,
-                                       ppm,
-                                       pfo,
-                                       index_pk,
-                                       pfo->tau[index_tau],
-                                       pk_nl[index_pk],
-                                       lnpk_l[index_pk],
-                                       ddlnpk_l[index_pk],
-                                       &(pfo->k_nl[index_pk][index_tau]),
-                                       &nl_corr_not_computable_at_this_k),
-                       pfo->error_message,
-                       pfo->error_message);
+            class_call_parallel(fourier_halofit(
+                                                ppr,
+                                                pba,
+                                                ppt,
+                                                ppm,
+                                                pfo,
+                                                index_pk,
+                                                pfo->tau[index_tau],
+                                                pk_nl[index_pk],
+                                                lnpk_l[index_pk],
+                                                ddlnpk_l[index_pk],
+                                                &(pfo->k_nl[index_pk][index_tau]),
+                                                &nl_corr_not_computable_at_this_k,
+                                                pnw_thread),
+                                pfo->error_message,
+                                pfo->error_message);
 
           }
 
@@ -1504,36 +1558,39 @@ int fourier_init(
 
             /* (preliminary step: fill table of sigma's, only for _cb if there is both _cb and _m) */
             if (index_pk == 0) {
-              class_call(fourier_hmcode_fill_sigtab(ppr,
-                                                    pba,
-                                                    ppt,
-                                                    ppm,
-                                                    pfo,
-                                                    index_tau,
-                                                    lnpk_l[index_pk],
-                                                    ddlnpk_l[index_pk],
-                                                    pnw),
-                         pfo->error_message, pfo->error_message);
+              class_call_parallel(fourier_hmcode_fill_sigtab(ppr,
+                                                             pba,
+                                                             ppt,
+                                                             ppm,
+                                                             pfo,
+                                                             index_tau,
+                                                             lnpk_l[index_pk],
+                                                             ddlnpk_l[index_pk],
+                                                             pnw_thread),
+                                  pfo->error_message, pfo->error_message);
             }
 
-            class_call(fourier_hmcode(ppr,
-                                      pba,
-                                      ppt,
-                                      ppm,
-                                      pfo,
-                                      index_pk,
-                                      index_tau,
-                                      pfo->tau[index_tau],
-                                      pk_nl[index_pk],
-                                      lnpk_l,
-                                      ddlnpk_l,
-                                      &(pfo->k_nl[index_pk][index_tau]),
-                                      &nl_corr_not_computable_at_this_k,
-                                      pnw),
-                       pfo->error_message,
-                       pfo->error_message);
+            class_call_parallel(fourier_hmcode(ppr,
+                                               pba,
+                                               ppt,
+                                               ppm,
+                                               pfo,
+                                               index_pk,
+                                               index_tau,
+                                               pfo->tau[index_tau],
+                                               pk_nl[index_pk],
+                                               lnpk_l,
+                                               ddlnpk_l,
+                                               &(pfo->k_nl[index_pk][index_tau]),
+                                               &nl_corr_not_computable_at_this_k,
+                                               pnw_thread),
+                                pfo->error_message,
+                                pfo->error_message);
           }
 
+          if (abort == _TRUE_)
+            continue;
+
           /* infer and store R_NL=(P_NL/P_L)^1/2 */
           if (nl_corr_not_computable_at_this_k == _FALSE_) {
             for (index_k=0; index_k<pfo->k_size; index_k++) {
@@ -1541,59 +1598,86 @@ int fourier_init(
             }
           }
 
-          /* otherwise we met the first problematic value of time */
+          /* otherwise keep track of the first problematic value of time */
           else {
-
-            /* store the index of that value */
-            pfo->index_tau_min_nl = MIN(pfo->tau_size-1,index_tau+1); //this MIN() ensures that index_tau_min_nl is never out of bounds
-
-            /* store R_NL=1 for that time */
-            for (index_k=0; index_k<pfo->k_size; index_k++) {
-              pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k] = 1.;
-            }
-
-            /* send a warning to inform user about the corresponding value of redshift */
-            if (pfo->fourier_verbose > 0) {
-              class_alloc(pvecback,pba->bg_size*sizeof(double),pfo->error_message);
-              class_call(background_at_tau(pba,pfo->tau[index_tau],short_info,inter_normal,&last_index,pvecback),
-                         pba->error_message,
-                         pfo->error_message);
-              a = pvecback[pba->index_bg_a];
-              /* redshift (remeber that a in the code stands for (a/a_0)) */
-              z = 1./a-1.;
-              fprintf(stdout,
-                      " -> [WARNING:] Non-linear corrections could not be computed at redshift z=%5.2f and higher.\n    This is because k_max is too small for the algorithm (Halofit or HMcode) to be able to compute the scale k_NL at this redshift.\n    If non-linear corrections at such high redshift really matter for you,\n    just try to increase the precision parameter nonlinear_min_k_max (currently at %e) until k_NL can be computed at the desired z.\n",z,ppr->nonlinear_min_k_max);
-
-              free(pvecback);
+#pragma omp critical (fourier_nl_failed)
+            {
+              if (index_nl < index_nl_failed)
+                index_nl_failed = index_nl;
             }
           }
-        }
 
-        /* if we are still in a range of time where P_NL(k) should NOT be computable */
-        else {
-          /* store R_NL=1 for that time */
-          for (index_k=0; index_k<pfo->k_size; index_k++) {
-            pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k] = 1.;
-          }
+        } // end loop over index_pk
+      } //end loop over index_tau
 
+      if (abort == _FALSE_) {
+        for (index_pk=0; index_pk<pfo->pk_size; index_pk++){
+          free(pk_nl[index_pk]);
+          free(lnpk_l[index_pk]);
+          free(ddlnpk_l[index_pk]);
         }
+      }
 
-        /** --> fill the array of nonlinear power spectra (only if we
-            are at a late time where P(k) and T(k) are supposed to
-            be stored, i.e., such that z(tau < z_max_pk) */
+      free(pk_nl);
+      free(lnpk_l);
+      free(ddlnpk_l);
 
-        if (index_tau >= pfo->tau_size - pfo->ln_tau_size) {
+      if (pfo->method == nl_HMcode) {
+        free(pnw_thread->stab);
+        free(pnw_thread->ddstab);
+      }
 
-          index_tau_late = index_tau - (pfo->tau_size - pfo->ln_tau_size);
+    } /* end of parallel region */
 
-          for (index_k=0; index_k<pfo->k_size; index_k++) {
-            pfo->ln_pk_nl[index_pk][index_tau_late * pfo->k_size + index_k] = pfo->ln_pk_l[index_pk][index_tau_late * pfo->k_size + index_k] + 2.*log(pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k]);
-          }
+    if (abort == _TRUE_) return _FAILURE_;
+
+    /** --> store R_NL=1 from the first problematic value of time on */
+
+    if (index_nl_failed < pfo->tau_size*pfo->pk_size) {
+
+      index_tau = pfo->tau_size-1-index_nl_failed/pfo->pk_size;
+
+      /* store the index of the last value of time at which the
+         corrections could be computed */
+      pfo->index_tau_min_nl = MIN(pfo->tau_size-1,index_tau+1); //this MIN() ensures that index_tau_min_nl is never out of bounds
+
+      for (index_nl=index_nl_failed; index_nl<pfo->tau_size*pfo->pk_size; index_nl++) {
+        index_pk = index_nl%pfo->pk_size;
+        for (index_k=0; index_k<pfo->k_size; index_k++) {
+          pfo->nl_corr_density[index_pk][(pfo->tau_size-1-index_nl/pfo->pk_size) * pfo->k_size + index_k] = 1.;
         }
+      }
 
-      } // end loop over index_pk
-    } //end loop over index_tau
+      /* send a warning to inform user about the corresponding value of redshift */
+      if (pfo->fourier_verbose > 0) {
+        class_alloc(pvecback,pba->bg_size*sizeof(double),pfo->error_message);
+        class_call(background_at_tau(pba,pfo->tau[index_tau],short_info,inter_normal,&last_index,pvecback),
+                   pba->error_message,
+                   pfo->error_message);
+        a = pvecback[pba->index_bg_a];
+        /* redshift (remeber that a in the code stands for (a/a_0)) */
+        z = 1./a-1.;
+        fprintf(stdout,
+                " -> [WARNING:] Non-linear corrections could not be computed at redshift z=%5.2f and higher.\n    This is because k_max is too small for the algorithm (Halofit or HMcode) to be able to compute the scale k_NL at this redshift.\n    If non-linear corrections at such high redshift really matter for you,\n    just try to increase the precision parameter nonlinear_min_k_max (currently at %e) until k_NL can be computed at the desired z.\n",z,ppr->nonlinear_min_k_max);
+
+        free(pvecback);
+      }
+    }
 
+    /** --> fill the array of nonlinear power spectra (only at late
+        times where P(k) and T(k) are supposed to be stored, i.e.,
+        such that z(tau < z_max_pk) */
+
+    for (index_tau_late=0; index_tau_late<pfo->ln_tau_size; index_tau_late++) {
+
+      index_tau = pfo->tau_size - pfo->ln_tau_size + index_tau_late;
+
+      for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+        for (index_k=0; index_k<pfo->k_size; index_k++) {
+          pfo->ln_pk_nl[index_pk][index_tau_late * pfo->k_size + index_k] = pfo->ln_pk_l[index_pk][index_tau_late * pfo->k_size + index_k] + 2.*log(pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k]);
+        }
+      }
+    }
 
     /** --> spline the array of nonlinear power spectrum */
 
@@ -1612,19 +1696,14 @@ int fourier_init(
       }
     }
 
-    /* --> free temporary arrays */
-
-    for (index_pk=0; index_pk<pfo->pk_size; index_pk++){
-      free(pk_nl[index_pk]);
-      free(lnpk_l[index_pk]);
-      free(ddlnpk_l[index_pk]);
-    }
+    /** --> free the nonlinear workspace */
 
-    free(pk_nl);
-    free(lnpk_l);
-    free(ddlnpk_l);
+    if (pfo->method == nl_halofit) {
 
-    /** --> free the nonlinear workspace */
+      class_call(fourier_halofit_workspace_free(pnw),
+                 pfo->error_message,
+                 pfo->error_message);
+    }
 
     if (pfo->method == nl_HMcode) {
 
@@ -1981,7 +2060,7 @@ int fourier_get_source(
 
   /** - use precomputed values */
   if (index_k < pfo->k_size) {
-    *source = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + index_k];
+    *source = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][_source_index_(pfo->index_md_scalars,index_tau,index_k)];
   }
   /** - extrapolate **/
   else {
@@ -1992,13 +2071,13 @@ int fourier_get_source(
      * --> Get last source and k, which are used in (almost) all methods
      */
     k_max = pfo->k[pfo->k_size-1];
-    source_max = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + pfo->k_size - 1];
+    source_max = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][_source_index_(pfo->index_md_scalars,index_tau,pfo->k_size-1)];
 
     /**
      * --> Get previous source and k, which are used in best methods
      */
     k_previous = pfo->k[pfo->k_size-2];
-    source_previous = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + pfo->k_size - 2];
+    source_previous = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][_source_index_(pfo->index_md_scalars,index_tau,pfo->k_size-2)];
 
     switch(pfo->extrapolation_method){
       /**
@@ -2549,6 +2628,7 @@ int fourier_sigma_at_z(
  * @param ddlnpk_l    Input: array of second derivative of log(P(k)_linear) wrt k, for spline interpolation
  * @param k_nl        Output: non-linear wavenumber
  * @param nl_corr_not_computable_at_this_k Ouput: flag concerning the status of the calculation (_TRUE_ if not possible)
+ * @param pnw         Input: pointer to nonlinear workspace, filled by fourier_halofit_workspace_init()
  * @return the error status
  */
 
@@ -2564,7 +2644,8 @@ int fourier_halofit(
                     double *lnpk_l,
                     double *ddlnpk_l,
                     double *k_nl,
-                    short * nl_corr_not_computable_at_this_k
+                    short * nl_corr_not_computable_at_this_k,
+                    struct fourier_workspace * pnw
                     ) {
 
   double Omega_m,Omega_v,fnu,w, dw_over_da_fld, integral_fld;
@@ -2574,7 +2655,7 @@ int fourier_halofit(
   int index_k;
   double pk_lin,pk_quasi,pk_halo,rk;
   double sigma,rknl,rneff,rncur,d1,d2;
-  double diff,xlogr1,xlogr2,rmid;
+  double diff,xlogr1,xlogr2,xlogr,xlogr_new,rmid,f;
 
   double gam,a,b,c,xmu,xnu,alpha,beta,f1,f2,f3;
   double pk_linaa;
@@ -2588,20 +2669,7 @@ int fourier_halofit(
   double sum1,sum2,sum3;
   double anorm;
 
-  double *integrand_array;
-  int integrand_size;
-  int index_ia_k;
-  int index_ia_pk;
-  int index_ia_sum;
-  int index_ia_ddsum;
-  /*
-    int index_ia_sum2;
-    int index_ia_ddsum2;
-    int index_ia_sum3;
-    int index_ia_ddsum3;
-  */
-  int ia_size;
-  int index_ia;
+  double *integrand;
 
   double k_integrand;
   double lnpk_integrand;
@@ -2675,32 +2743,21 @@ int fourier_halofit(
   /*      Until the 17.02.2015 the values of k used for integrating sigma(R) quantities needed by Halofit where the same as in the perturbation module.
           Since then, we sample these integrals on more values, in order to get more precise integrals (thanks Matteo Zennaro for noticing the need for this).
 
-          We create a temporary integrand_array which columns will be:
-          - k in 1/Mpc
-          - just linear P(k) in Mpc**3
-          - 1/(2(pi**2)) P(k) k**2 exp(-(kR)**2) or 1/(2(pi**2)) P(k) k**2 2 (kR) exp(-(kR)**2) or 1/(2(pi**2)) P(k) k**2 4 (kR)(1-kR) exp(-(kR)**2)
-          - second derivative of previous line with spline
+          These values of k and the corresponding integration weights
+          are the same at all times and stored in the workspace. We
+          only need a temporary array integrand containing the
+          R-independent part of the integrands, w8 * 1/(2(pi**2)) P(k) k**2
   */
 
-  index_ia=0;
-  class_define_index(index_ia_k,     _TRUE_,index_ia,1);
-  class_define_index(index_ia_pk,    _TRUE_,index_ia,1);
-  class_define_index(index_ia_sum,   _TRUE_,index_ia,1);
-  class_define_index(index_ia_ddsum, _TRUE_,index_ia,1);
-  ia_size = index_ia;
-
-  integrand_size=(int)(log(pfo->k[pfo->k_size-1]/pfo->k[0])/log(10.)*ppr->halofit_k_per_decade)+1;
+  class_alloc(integrand,pnw->halofit_k_size*sizeof(double),pfo->error_message);
 
-  class_alloc(integrand_array,integrand_size*ia_size*sizeof(double),pfo->error_message);
-
-
-  /* we fill integrand_array with values of k and P(k) using interpolation */
+  /* we fill integrand with values of P(k) obtained by interpolation */
 
   last_index=0;
 
-  for (index_k=0; index_k < integrand_size; index_k++) {
+  for (index_k=0; index_k < pnw->halofit_k_size; index_k++) {
 
-    k_integrand=pfo->k[0]*pow(10.,index_k/ppr->halofit_k_per_decade);
+    k_integrand=pnw->halofit_k[index_k];
 
     if (index_k ==0 ) {
       lnpk_integrand = lnpk_l[0];
@@ -2722,8 +2779,7 @@ int fourier_halofit(
                  pfo->error_message);
     }
 
-    integrand_array[index_k*ia_size + index_ia_k] = k_integrand;
-    integrand_array[index_k*ia_size + index_ia_pk] = exp(lnpk_integrand);
+    integrand[index_k] = pnw->halofit_w8[index_k]*exp(lnpk_integrand)*k_integrand*k_integrand*anorm;
 
   }
 
@@ -2752,20 +2808,15 @@ int fourier_halofit(
      other redshifts, so there is normally no need to change i
   */
 
-  R=sqrt(-log(ppr->halofit_sigma_precision))/integrand_array[(integrand_size-1)*ia_size + index_ia_k];
+  R=sqrt(-log(ppr->halofit_sigma_precision))/pnw->halofit_k[pnw->halofit_k_size-1];
 
   class_call(fourier_halofit_integrate(
-                                       pfo,
-                                       integrand_array,
-                                       integrand_size,
-                                       ia_size,
-                                       index_ia_k,
-                                       index_ia_pk,
-                                       index_ia_sum,
-                                       index_ia_ddsum,
+                                       pnw,
+                                       integrand,
                                        R,
-                                       halofit_integral_one,
-                                       &sum1
+                                       &sum1,
+                                       &sum2,
+                                       &sum3
                                        ),
              pfo->error_message,
              pfo->error_message);
@@ -2782,7 +2833,7 @@ int fourier_halofit(
   /*
     class_test_except(sigma < 1.,
     pfo->error_message,
-    free(pvecback);free(integrand_array),
+    free(pvecback);free(integrand),
     "Your k_max=%g 1/Mpc is too small for Halofit to find the non-linearity scale z_nl at z=%g. Increase input parameter P_k_max_h/Mpc or P_k_max_1/Mpc",
     pfo->k[pfo->k_size-1],
     1./pvecback[pba->index_bg_a]-1.);
@@ -2791,7 +2842,7 @@ int fourier_halofit(
   if (sigma < 1.) {
     * nl_corr_not_computable_at_this_k = _TRUE_;
     free(pvecback);
-    free(integrand_array);
+    free(integrand);
     return _SUCCESS_;
   }
   else {
@@ -2813,17 +2864,12 @@ int fourier_halofit(
 
   /* corresponding value of sigma_R */
   class_call(fourier_halofit_integrate(
-                                       pfo,
-                                       integrand_array,
-                                       integrand_size,
-                                       ia_size,
-                                       index_ia_k,
-                                       index_ia_pk,
-                                       index_ia_sum,
-                                       index_ia_ddsum,
+                                       pnw,
+                                       integrand,
                                        R,
-                                       halofit_integral_one,
-                                       &sum1
+                                       &sum1,
+                                       &sum2,
+                                       &sum3
                                        ),
              pfo->error_message,
              pfo->error_message);
@@ -2837,23 +2883,25 @@ int fourier_halofit(
 
   xlogr2 = log(R)/log(10.);
 
+  /* first guess for R_nl: the middle of the bracket [xlogr1,
+     xlogr2]. The search does not start from the value found at
+     another time, so that the result does not depend on how times
+     are shared between threads */
+
+  xlogr = (xlogr1+xlogr2)/2.;
+
   counter = 0;
   do {
-    rmid = pow(10,(xlogr2+xlogr1)/2.0);
+    rmid = pow(10,xlogr);
     counter ++;
 
     class_call(fourier_halofit_integrate(
-                                         pfo,
-                                         integrand_array,
-                                         integrand_size,
-                                         ia_size,
-                                         index_ia_k,
-                                         index_ia_pk,
-                                         index_ia_sum,
-                                         index_ia_ddsum,
+                                         pnw,
+                                         integrand,
                                          rmid,
-                                         halofit_integral_one,
-                                         &sum1
+                                         &sum1,
+                                         &sum2,
+                                         &sum3
                                          ),
                pfo->error_message,
                pfo->error_message);
@@ -2863,17 +2911,32 @@ int fourier_halofit(
     diff = sigma - 1.0;
 
     if (diff > ppr->halofit_tol_sigma){
-      xlogr1=log10(rmid);
+      xlogr1=xlogr;
     }
     else if (diff < -ppr->halofit_tol_sigma) {
-      xlogr2 = log10(rmid);
+      xlogr2 = xlogr;
     }
 
+    /* first and second derivative of ln(sigma**2) with respect to
+       ln(R), given by the same integrals */
+    d1 = -sum2/sum1;
+    d2 = -sum2*sum2/sum1/sum1 - sum3/sum1;
+
+    /* Halley step towards ln(sigma**2)=0, replaced by a bisection
+       step whenever it would leave the current bracket */
+    f = log(sum1);
+    xlogr_new = xlogr - 2.*f*d1/(2.*d1*d1-f*d2)/log(10.);
+
+    if ((xlogr_new > xlogr1) && (xlogr_new < xlogr2))
+      xlogr = xlogr_new;
+    else
+      xlogr = (xlogr1+xlogr2)/2.;
+
     /* The first version of this test woukld let the code continue: */
     /*
       class_test_except(counter > _MAX_IT_,
       pfo->error_message,
-      free(pvecback);free(integrand_array),
+      free(pvecback);free(integrand),
       "could not converge within maximum allowed number of iterations");
     */
     /* ... but in this situation it sounds better to make it stop and return an error! */
@@ -2883,43 +2946,7 @@ int fourier_halofit(
 
   } while (fabs(diff) > ppr->halofit_tol_sigma);
 
-  /* evaluate all the other integrals at R=rmid */
-
-  class_call(fourier_halofit_integrate(
-                                       pfo,
-                                       integrand_array,
-                                       integrand_size,
-                                       ia_size,
-                                       index_ia_k,
-                                       index_ia_pk,
-                                       index_ia_sum,
-                                       index_ia_ddsum,
-                                       rmid,
-                                       halofit_integral_two,
-                                       &sum2
-                                       ),
-             pfo->error_message,
-             pfo->error_message);
-
-  class_call(fourier_halofit_integrate(
-                                       pfo,
-                                       integrand_array,
-                                       integrand_size,
-                                       ia_size,
-                                       index_ia_k,
-                                       index_ia_pk,
-                                       index_ia_sum,
-                                       index_ia_ddsum,
-                                       rmid,
-                                       halofit_integral_three,
-                                       &sum3
-                                       ),
-             pfo->error_message,
-             pfo->error_message);
-
-  sigma  = sqrt(sum1);
-  d1 = -sum2/sum1;
-  d2 = -sum2*sum2/sum1/sum1 - sum3/sum1;
+  /* d1 and d2 have been evaluated at R=rmid in the last iteration */
 
   rknl  = 1./rmid;
   rneff = -3.-d1;
@@ -2995,82 +3022,159 @@ int fourier_halofit(
   }
 
   free(pvecback);
-  free(integrand_array);
+  free(integrand);
   return _SUCCESS_;
 }
 
 /**
  * Internal routione of Halofit. In original Halofit, this is
  * equivalent to the function wint(). It performs convolutions of the
- * linear spectrum with two window functions.
+ * linear spectrum with the three window functions giving sigma(R)
+ * and its first and second derivative with respect to ln(R), in a
+ * single pass over the wavenumbers of the workspace.
  *
- * @param pfo             Input: pointer to non linear structure
- * @param integrand_array Input: array with k, P_L(k) values
- * @param integrand_size  Input: one dimension of that array
- * @param ia_size         Input: other dimension of that array
- * @param index_ia_k      Input: index for k
- * @param index_ia_pk     Input: index for pk
- * @param index_ia_sum    Input: index for the result
- * @param index_ia_ddsum  Input: index for its spline
- * @param R               Input: radius
- * @param type            Input: which window function to use
- * @param sum             Output: result of the integral
+ * @param pnw       Input: pointer to nonlinear workspace
+ * @param integrand Input: array of w8 * P_L(k) k^2/(2 pi^2) at each wavenumber of the workspace
+ * @param R         Input: radius
+ * @param sum1      Output: integral of P_L(k) k^2/(2 pi^2) exp(-(kR)^2), that is, sigma^2(R)
+ * @param sum2      Output: same with an extra factor 2 (kR)^2, that is, -d sigma^2/d ln(R)
+ * @param sum3      Output: same with an extra factor 4 (kR)^2 (1-(kR)^2), that is, d sum2/d ln(R)
  * @return the error status
  */
 
 int fourier_halofit_integrate(
-                              struct fourier *pfo,
-                              double * integrand_array,
-                              int integrand_size,
-                              int ia_size,
-                              int index_ia_k,
-                              int index_ia_pk,
-                              int index_ia_sum,
-                              int index_ia_ddsum,
+                              struct fourier_workspace * pnw,
+                              double * integrand,
                               double R,
-                              enum halofit_integral_type type,
-                              double * sum
+                              double * sum1,
+                              double * sum2,
+                              double * sum3
                               ) {
 
-  double k,pk,x2,integrand;
+  double x2,integrand_x;
+  double s1=0.,s2=0.,s3=0.;
   int index_k;
-  double anorm = 1./(2*pow(_PI_,2));
 
-  for (index_k=0; index_k < integrand_size; index_k++) {
-    k = integrand_array[index_k*ia_size + index_ia_k];
-    pk = integrand_array[index_k*ia_size + index_ia_pk];
-    x2 = k*k*R*R;
+#pragma omp simd private(x2,integrand_x) reduction(+:s1,s2,s3)
+  for (index_k=0; index_k < pnw->halofit_k_size; index_k++) {
+    x2 = pnw->halofit_k2[index_k]*R*R;
+    integrand_x = integrand[index_k]*exp(-x2);
+    s1 += integrand_x;
+    s2 += integrand_x*x2;
+    s3 += integrand_x*x2*(1.-x2);
+  }
 
-    integrand = pk*k*k*anorm*exp(-x2);
-    if (type == halofit_integral_two) integrand *= 2.*x2;
-    if (type == halofit_integral_three) integrand *= 4.*x2*(1.-x2);
+  *sum1 = s1;
+  *sum2 = 2.*s2;
+  *sum3 = 4.*s3;
 
-    integrand_array[index_k*ia_size + index_ia_sum] = integrand;
-  }
+  return _SUCCESS_;
+}
 
-  /* fill in second derivatives */
-  class_call(array_spline(integrand_array,
-                          ia_size,
-                          integrand_size,
-                          index_ia_k,
-                          index_ia_sum,
-                          index_ia_ddsum,
-                          _SPLINE_NATURAL_,
-                          pfo->error_message),
-             pfo->error_message,
-             pfo->error_message);
+/**
+ * Allocate and fill the arrays of the nonlinear workspace used by
+ * Halofit: the wavenumbers at which the integrals of
+ * fourier_halofit_integrate() are sampled (logarithmically spaced
+ * with halofit_k_per_decade points per decade) and their weights.
+ *
+ * The weights are those of an integration with
+ * array_integrate_all_spline() of the natural cubic spline going
+ * through the integrand, which is a linear function of the integrand
+ * values. Since the wavenumbers are the same at all times, the spline
+ * system is solved once here, instead of once per integral.
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pfo Input: pointer to fourier structure
+ * @param pnw Output: pointer to nonlinear workspace
+ * @return the error status
+ */
 
-  /* integrate */
-  class_call(array_integrate_all_spline(integrand_array,
-                                        ia_size,
-                                        integrand_size,
-                                        index_ia_k,
-                                        index_ia_sum,
-                                        index_ia_ddsum,
-                                        sum,
-                                        pfo->error_message),
+int fourier_halofit_workspace_init(
+                                   struct precision *ppr,
+                                   struct fourier *pfo,
+                                   struct fourier_workspace * pnw
+                                   ){
+
+  int n,i;
+  double * h;
+  double * lambda;
+  double * c_prime;
+  double a,b,denom;
+
+  n = (int)(log(pfo->k[pfo->k_size-1]/pfo->k[0])/log(10.)*ppr->halofit_k_per_decade)+1;
+
+  class_test(n < 3,
              pfo->error_message,
-             pfo->error_message);
+             "k range too small for Halofit integrals: only %d points with halofit_k_per_decade=%e",n,ppr->halofit_k_per_decade);
+
+  pnw->halofit_k_size = n;
+
+  class_alloc(pnw->halofit_k,n*sizeof(double),pfo->error_message);
+  class_alloc(pnw->halofit_k2,n*sizeof(double),pfo->error_message);
+  class_alloc(pnw->halofit_w8,n*sizeof(double),pfo->error_message);
+
+  for (i=0; i<n; i++) {
+    pnw->halofit_k[i] = pfo->k[0]*pow(10.,i/ppr->halofit_k_per_decade);
+    pnw->halofit_k2[i] = pnw->halofit_k[i]*pnw->halofit_k[i];
+  }
+
+  class_alloc(h,(n-1)*sizeof(double),pfo->error_message);
+  class_calloc(lambda,n,sizeof(double),pfo->error_message);
+  class_alloc(c_prime,n*sizeof(double),pfo->error_message);
+
+  for (i=0; i<n-1; i++)
+    h[i] = pnw->halofit_k[i+1]-pnw->halofit_k[i];
+
+  /** - the second derivatives y''_i of the natural spline (with
+      y''_0=y''_{n-1}=0) solve A y'' = D y, with A the symmetric
+      tridiagonal matrix of diagonal (h_{i-1}+h_i)/3 and off-diagonal
+      h_i/6. The spline integral is sum_i t_i y_i + sum_i c_i y''_i
+      with trapezoidal weights t_i and c_i = (h_{i-1}^3+h_i^3)/24,
+      hence the weights t + D^T lambda with A lambda = c. Solve for
+      lambda with the Thomas algorithm: */
+
+  c_prime[0] = 0.;
+  for (i=1; i<n-1; i++) {
+    a = h[i-1]/6.;
+    b = (h[i-1]+h[i])/3.;
+    denom = b-a*c_prime[i-1];
+    c_prime[i] = h[i]/6./denom;
+    lambda[i] = ((h[i-1]*h[i-1]*h[i-1]+h[i]*h[i]*h[i])/24.-a*lambda[i-1])/denom;
+  }
+  for (i=n-3; i>=1; i--)
+    lambda[i] -= c_prime[i]*lambda[i+1];
+
+  /** - add D^T lambda to the trapezoidal weights */
+
+  for (i=0; i<n; i++) {
+    pnw->halofit_w8[i] = 0.;
+    if (i > 0)
+      pnw->halofit_w8[i] += h[i-1]/2.+(lambda[i-1]-lambda[i])/h[i-1];
+    if (i < n-1)
+      pnw->halofit_w8[i] += h[i]/2.+(lambda[i+1]-lambda[i])/h[i];
+  }
+
+  free(h);
+  free(lambda);
+  free(c_prime);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Deallocate the arrays of the nonlinear workspace used by Halofit
+ *
+ * @param pnw Input: pointer to nonlinear workspace
+ * @return the error status
+ */
+
+int fourier_halofit_workspace_free(
+                                   struct fourier_workspace * pnw
+                                   ) {
+
+  free(pnw->halofit_k);
+  free(pnw->halofit_k2);
+  free(pnw->halofit_w8);
 
   return _SUCCESS_;
 }
@@ -3165,6 +3269,8 @@ int fourier_hmcode(
   double * r_virial;
   double * r_real;
   double * nu_arr;
+  double * nu_eta;
+  double * mass_hmf;
 
   double * p1h_integrand;
 
@@ -3475,9 +3581,25 @@ int fourier_hmcode(
   i++;
   index_ncol=i;
 
-  for (index_k = 0; index_k < pfo->k_size; index_k++){
+  class_alloc(p1h_integrand,index_cut*index_ncol*sizeof(double),pfo->error_message);
+  class_alloc(nu_eta,index_cut*sizeof(double),pfo->error_message);
+  class_alloc(mass_hmf,index_cut*sizeof(double),pfo->error_message);
+
+  /* the nu values, the nu^eta factors of the window and the halo
+     mass function do not depend on k: compute them once for all k's */
+  for (index_mass=0; index_mass<index_cut; index_mass++){
+    //get the value of the halo mass function
+    class_call(fourier_hmcode_halomassfunction(
+                                               nu_arr[index_mass],
+                                               &gst),
+               pfo->error_message, pfo->error_message);
 
-    class_alloc(p1h_integrand,index_cut*index_ncol*sizeof(double),pfo->error_message);
+    nu_eta[index_mass] = pow(nu_arr[index_mass], eta);
+    mass_hmf[index_mass] = mass[index_mass]*gst;
+    p1h_integrand[index_mass*index_ncol+index_nu] = nu_arr[index_mass];
+  }
+
+  for (index_k = 0; index_k < pfo->k_size; index_k++){
 
     pk_lin = exp(lnpk_l[index_pk][index_k])*pow(pfo->k[index_k],3)*anorm; //convert P_k to Delta_k^2
 
@@ -3485,20 +3607,13 @@ int fourier_hmcode(
       //get the nu^eta-value of the window
       class_call(fourier_hmcode_window_nfw(
                                            pfo,
-                                           pow(nu_arr[index_mass], eta)*pfo->k[index_k],
+                                           nu_eta[index_mass]*pfo->k[index_k],
                                            r_virial[index_mass],
                                            conc[index_mass],
                                            &window_nfw),
                  pfo->error_message, pfo->error_message);
-      //get the value of the halo mass function
-      class_call(fourier_hmcode_halomassfunction(
-                                                 nu_arr[index_mass],
-                                                 &gst),
-                 pfo->error_message, pfo->error_message);
 
-      p1h_integrand[index_mass*index_ncol+index_nu] = nu_arr[index_mass];
-
-      p1h_integrand[index_mass*index_ncol+index_y] = mass[index_mass]*gst*pow(window_nfw, 2.);
+      p1h_integrand[index_mass*index_ncol+index_y] = mass_hmf[index_mass]*pow(window_nfw, 2.);
       //if ((tau==pba->conformal_age) && (index_k == 0)) {
       //fprintf(stdout, "%d %e %e\n", index_cut, p1h_integrand[index_mass*index_ncol+index_nu], p1h_integrand[index_mass*index_ncol+index_y]);
       //}
@@ -3544,10 +3659,12 @@ int fourier_hmcode(
     }
     if (pk_2h<0.) pk_2h=0.;
     pk_nl[index_k] = pow((pow(pk_1h, alpha) + pow(pk_2h, alpha)), (1./alpha))/pow(pfo->k[index_k],3)/anorm; //converted back to P_k
-
-    free(p1h_integrand);
   }
 
+  free(p1h_integrand);
+  free(nu_eta);
+  free(mass_hmf);
+
   // print parameter values
   if ((pfo->fourier_verbose > 1 && tau==pba->conformal_age) || pfo->fourier_verbose > 3){
     fprintf(stdout, " -> Parameters at redshift z = %e:\n", z_at_tau);
@@ -3607,11 +3724,9 @@ int fourier_hmcode_workspace_init(
   int ng;
   int index_pk;
 
-  /** - allocate arrays of the nonlinear workspace */
-
-  class_alloc(pnw->rtab,ppr->n_hmcode_tables*sizeof(double),pfo->error_message);
-  class_alloc(pnw->stab,ppr->n_hmcode_tables*sizeof(double),pfo->error_message);
-  class_alloc(pnw->ddstab,ppr->n_hmcode_tables*sizeof(double),pfo->error_message);
+  /** - allocate arrays of the nonlinear workspace (the table of sigma
+      at a given time, pnw->stab and pnw->ddstab, is allocated
+      separately for each thread in fourier_init()) */
 
   ng = ppr->n_hmcode_tables;
 
@@ -3637,6 +3752,12 @@ int fourier_hmcode_workspace_init(
              pfo->error_message,
              pfo->error_message);
 
+  /** - fill the time-independent part of the table of sigma(R) */
+
+  class_call(fourier_hmcode_fill_sigtab_window(ppr,pba,pfo,pnw),
+             pfo->error_message,
+             pfo->error_message);
+
   return _SUCCESS_;
 }
 
@@ -3656,8 +3777,9 @@ int fourier_hmcode_workspace_free(
   int index_pk;
 
   free(pnw->rtab);
-  free(pnw->stab);
-  free(pnw->ddstab);
+  free(pnw->sigtab_k);
+  free(pnw->sigtab_t);
+  free(pnw->sigtab_window);
 
   free(pnw->growtable);
   free(pnw->ztable);
@@ -3802,10 +3924,82 @@ int fourier_hmcode_baryonic_feedback(
 }
 
 /**
- * Function that fills pnw->rtab, pnw->stab and pnw->ddstab with (r,
- * sigma, ddsigma) logarithmically spaced in r.  Called by
- * fourier_init at for all tau to account for scale-dependant growth
- * before fourier_hmcode is called
+ * Function that fills pnw->rtab with values of r logarithmically
+ * spaced, and the time-independent part of the integrals giving
+ * sigma(r): the wavenumbers and integration variable used by
+ * fourier_sigmas(), and the factor k^3 W^2(kr)/(t(1-t)) of the
+ * integrand for each r. Called once by fourier_hmcode_workspace_init()
+ * before the loop over tau.
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pba Input: pointer to background structure
+ * @param pfo Input: pointer to fourier structure
+ * @param pnw Output: pointer to nonlinear workspace
+ * @return the error status
+ */
+
+int fourier_hmcode_fill_sigtab_window(
+                                      struct precision * ppr,
+                                      struct background * pba,
+                                      struct fourier * pfo,
+                                      struct fourier_workspace * pnw
+                                      ) {
+
+  double rmin, rmax;
+  double k,t,x,W;
+  int index_k, index_t, index_r, nsig, n;
+
+  rmin = ppr->rmin_for_sigtab/pba->h;
+  rmax = ppr->rmax_for_sigtab/pba->h;
+  nsig = ppr->n_hmcode_tables;
+
+  class_alloc(pnw->rtab,nsig*sizeof(double),pfo->error_message);
+
+  for (index_r=0;index_r<nsig;index_r++){
+    pnw->rtab[index_r]=exp(log(rmin)+log(rmax/rmin)*index_r/(nsig-1));
+  }
+
+  /* same sampling as in fourier_sigmas() */
+  n=(int)(log(pfo->k[pfo->k_size_extra-1]/pfo->k[0])/log(10.)*ppr->sigma_k_per_decade)+1;
+  pnw->sigtab_k_size = n;
+
+  class_alloc(pnw->sigtab_k,n*sizeof(double),pfo->error_message);
+  class_alloc(pnw->sigtab_t,n*sizeof(double),pfo->error_message);
+  class_alloc(pnw->sigtab_window,n*nsig*sizeof(double),pfo->error_message);
+
+  for (index_k=0; index_k<n; index_k++) {
+
+    k=pfo->k[0]*pow(10.,index_k/ppr->sigma_k_per_decade);
+    pnw->sigtab_k[index_k] = k;
+
+    t = 1./(1.+k);
+    if (index_k == (n-1)) k *= 0.9999999; // to prevent rounding error leading to k being bigger than maximum value
+
+    index_t = n-1-index_k;
+    pnw->sigtab_t[index_t] = t;
+
+    for (index_r=0; index_r<nsig; index_r++) {
+      x=k*pnw->rtab[index_r];
+      if (x<0.01)
+        W = 1.-x*x/10.;
+      else
+        W = 3./x/x/x*(sin(x)-x*cos(x));
+      pnw->sigtab_window[index_t*nsig+index_r] = k*k*k*W*W/(t*(1.-t));
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Function that fills pnw->stab and pnw->ddstab with (sigma, ddsigma)
+ * at the values of r of pnw->rtab. Called by fourier_init at for all
+ * tau to account for scale-dependant growth before fourier_hmcode is
+ * called. The linear power spectrum is interpolated once, and the
+ * integrals are performed for all r at the same time, with the
+ * time-independent factors filled by
+ * fourier_hmcode_fill_sigtab_window(). The result is the same as with
+ * one call of fourier_sigmas() for each r.
  *
  * @param ppr Input: pointer to precision structure
  * @param pba Input: pointer to background structure
@@ -3831,70 +4025,98 @@ int fourier_hmcode_fill_sigtab(
                                struct fourier_workspace * pnw
                                ) {
 
-  double r;
-  double rmin, rmax;
-  double sig;
-  double * sigtab;
-  int i, index_r, index_sig, index_ddsig, index_n, nsig;
+  double lnpk, h;
+  double * pk;
+  double * integrand;
+  double * ddintegrand;
+  double * sigma2;
+  int index_k, index_t, index_r, nsig, n;
+  int last_index=0;
 
-  rmin = ppr->rmin_for_sigtab/pba->h;
-  rmax = ppr->rmax_for_sigtab/pba->h;
   nsig = ppr->n_hmcode_tables;
+  n = pnw->sigtab_k_size;
 
-  i=0;
-  index_r=i;
-  i++;
-  index_sig=i;
-  i++;
-  index_ddsig=i;
-  i++;
-  index_n=i;
+  class_alloc(pk,n*sizeof(double),pfo->error_message);
+  class_alloc(integrand,n*nsig*sizeof(double),pfo->error_message);
+  class_alloc(ddintegrand,n*nsig*sizeof(double),pfo->error_message);
+  class_calloc(sigma2,nsig,sizeof(double),pfo->error_message);
 
-  class_alloc((sigtab),(nsig*index_n*sizeof(double)),pfo->error_message);
+  /** - interpolate P(k) once at all wavenumbers */
 
-  for (i=0;i<nsig;i++){
-    r=exp(log(rmin)+log(rmax/rmin)*i/(nsig-1));
+  for (index_k=0; index_k<n; index_k++) {
 
-    class_call(fourier_sigmas(pfo,
-                              r,
-                              lnpk_l,
-                              ddlnpk_l,
-                              pfo->k_size_extra,
-                              ppr->sigma_k_per_decade,
-                              out_sigma,
-                              &sig),
-               pfo->error_message,
-               pfo->error_message);
+    if (index_k==0) {
+      pk[index_k] = exp(lnpk_l[0]);
+    }
+    else {
+      class_call(array_interpolate_spline(
+                                          pfo->ln_k,
+                                          pfo->k_size_extra,
+                                          lnpk_l,
+                                          ddlnpk_l,
+                                          1,
+                                          log(pnw->sigtab_k[index_k]),
+                                          &last_index,
+                                          &lnpk,
+                                          1,
+                                          pfo->error_message),
+                 pfo->error_message,
+                 pfo->error_message);
 
-    sigtab[i*index_n+index_r]=r;
-    sigtab[i*index_n+index_sig]=sig;
+      pk[index_k] = exp(lnpk);
+    }
+  }
+
+  /** - integrands for all values of r, as a function of t */
+
+  for (index_t=0; index_t<n; index_t++) {
+    index_k = n-1-index_t;
+    for (index_r=0; index_r<nsig; index_r++) {
+      integrand[index_t*nsig+index_r] = pk[index_k]*pnw->sigtab_window[index_t*nsig+index_r];
+    }
   }
 
-  class_call(array_spline(sigtab,
-						  index_n,
-						  nsig,
-						  index_r,
-						  index_sig,
-						  index_ddsig,
-						  _SPLINE_EST_DERIV_,
-						  pfo->error_message),
+  /** - spline and integrate them over t */
+
+  class_call(array_spline_table_lines(pnw->sigtab_t,
+                                      n,
+                                      integrand,
+                                      nsig,
+                                      ddintegrand,
+                                      _SPLINE_EST_DERIV_,
+                                      pfo->error_message),
              pfo->error_message,
              pfo->error_message);
-  if (index_tau == pfo->tau_size-1){
-    for (i=0;i<nsig;i++){
-      pnw->rtab[i] = sigtab[i*index_n+index_r];
-      pnw->stab[i] = sigtab[i*index_n+index_sig];
-      pnw->ddstab[i] = sigtab[i*index_n+index_ddsig];
+
+  for (index_t=0; index_t<n-1; index_t++) {
+    h = pnw->sigtab_t[index_t+1]-pnw->sigtab_t[index_t];
+    for (index_r=0; index_r<nsig; index_r++) {
+      sigma2[index_r] +=
+        (integrand[index_t*nsig+index_r]+integrand[(index_t+1)*nsig+index_r])*h/2.+
+        (ddintegrand[index_t*nsig+index_r]+ddintegrand[(index_t+1)*nsig+index_r])*h*h*h/24.;
     }
   }
-  else{
-    for (i=0;i<nsig;i++){
-      pnw->stab[i] = sigtab[i*index_n+index_sig];
-      pnw->ddstab[i] = sigtab[i*index_n+index_ddsig];
-    }
+
+  for (index_r=0; index_r<nsig; index_r++) {
+    pnw->stab[index_r] = sqrt(sigma2[index_r]/(2.*_PI_*_PI_));
   }
 
-  free(sigtab);
+  /** - spline sigma(r) */
+
+  class_call(array_spline_table_lines(pnw->rtab,
+                                      nsig,
+                                      pnw->stab,
+                                      1,
+                                      pnw->ddstab,
+                                      _SPLINE_EST_DERIV_,
+                                      pfo->error_message),
+             pfo->error_message,
+             pfo->error_message);
+
+  free(pk);
+  free(integrand);
+  free(ddintegrand);
+  free(sigma2);
 
   return _SUCCESS_;
 }
@@ -4093,32 +4315,20 @@ int fourier_hmcode_window_nfw(
 
   ks = k*rv/c;
 
-  class_call(sine_integral(
-                           ks*(1.+c),
-                           &si2,
-                           pfo->error_message
-                           ),
-             pfo->error_message, pfo->error_message);
-
-  class_call(sine_integral(
-                           ks,
-                           &si1,
-                           pfo->error_message
-                           ),
-             pfo->error_message, pfo->error_message);
-
-  class_call(cosine_integral(
-                             ks*(1.+c),
-                             &ci2,
-                             pfo->error_message
-                             ),
+  class_call(sine_cosine_integral(
+                                  ks*(1.+c),
+                                  &si2,
+                                  &ci2,
+                                  pfo->error_message
+                                  ),
              pfo->error_message, pfo->error_message);
 
-  class_call(cosine_integral(
-                             ks,
-                             &ci1,
-                             pfo->error_message
-                             ),
+  class_call(sine_cosine_integral(
+                                  ks,
+                                  &si1,
+                                  &ci1,
+                                  pfo->error_message
+                                  ),
              pfo->error_message, pfo->error_message);
 
   p1=cos(ks)*(ci2-ci1);
@@ -674,13 +674,14 @@ int harmonic_cls(
   int index_md;
   int index_ic1,index_ic2,index_ic1_ic2;
   int index_l;
+  int index_q;
   int index_ct;
   int cl_integrand_num_columns;
 
   double * cl_integrand; /* array with argument cl_integrand[index_k*cl_integrand_num_columns+1+phr->index_ct] */
   double * transfer_ic1; /* array with argument transfer_ic1[index_tt] */
   double * transfer_ic2; /* idem */
-  double * primordial_pk;  /* array with argument primordial_pk[index_ic_ic]*/
+  double * primordial_pk;  /* array with argument primordial_pk[index_q*ic_ic_size+index_ic_ic]*/
 
   /* This code can be optionally compiled with the openmp option for parallel computation.
      Inside parallel regions, the use of the command "return" is forbidden.
@@ -722,6 +723,27 @@ int harmonic_cls(
     class_alloc(phr->ddcl[index_md],sizeof(double)*phr->l_size[index_md]*phr->ct_size*phr->ic_ic_size[index_md],phr->error_message);
     cl_integrand_num_columns = 1+phr->ct_size*2; /* one for k, ct_size for each type, ct_size for each second derivative of each type */
 
+    /** - --> (b') tabulate the primordial spectra at each wavenumber
+        of the transfer module. They do not depend on l, so this table
+        is computed once for this mode and shared by all threads */
+
+    class_alloc(primordial_pk,
+                sizeof(double)*ptr->q_size*phr->ic_ic_size[index_md],
+                phr->error_message);
+
+    for (index_q=0; index_q < ptr->q_size; index_q++) {
+
+      class_call(primordial_spectrum_at_k(ppm,
+                                          index_md,
+                                          linear,
+                                          ptr->k[index_md][index_q],
+                                          primordial_pk+index_q*phr->ic_ic_size[index_md]),
+                 ppm->error_message,
+                 phr->error_message);
+
+      /* above routine checks that k>0: no possible division by zero in harmonic_compute_cl() */
+    }
+
     /** - --> (c) loop over initial conditions */
 
     for (index_ic1 = 0; index_ic1 < phr->ic_size[index_md]; index_ic1++) {
@@ -737,8 +759,8 @@ int harmonic_cls(
           /* beginning of parallel region */
 
 #pragma omp parallel                                                    \
-  shared(ptr,ppm,index_md,phr,ppt,cl_integrand_num_columns,index_ic1,index_ic2,abort) \
-  private(tstart,cl_integrand,primordial_pk,transfer_ic1,transfer_ic2,index_l,tstop)
+  shared(ptr,ppm,index_md,phr,ppt,cl_integrand_num_columns,index_ic1,index_ic2,abort,primordial_pk) \
+  private(tstart,cl_integrand,transfer_ic1,transfer_ic2,index_l,tstop)
 
           {
 
@@ -750,10 +772,6 @@ int harmonic_cls(
                                  ptr->q_size*cl_integrand_num_columns*sizeof(double),
                                  phr->error_message);
 
-            class_alloc_parallel(primordial_pk,
-                                 phr->ic_ic_size[index_md]*sizeof(double),
-                                 phr->error_message);
-
             class_alloc_parallel(transfer_ic1,
                                  ptr->tt_size[index_md]*sizeof(double),
                                  phr->error_message);
@@ -800,8 +818,6 @@ int harmonic_cls(
 #endif
             free(cl_integrand);
 
-            free(primordial_pk);
-
             free(transfer_ic1);
 
             free(transfer_ic2);
@@ -826,6 +842,8 @@ int harmonic_cls(
       }
     }
 
+    free(primordial_pk);
+
     /** - --> (d) now that for a given mode, all possible \f$ C_l\f$'s have been computed,
         compute second derivative of the array in which they are stored,
         in view of spline interpolation. */
@@ -861,7 +879,7 @@ int harmonic_cls(
  * @param index_l       Input: index of multipole under consideration
  * @param cl_integrand_num_columns Input: number of columns in cl_integrand
  * @param cl_integrand  Input: an allocated workspace
- * @param primordial_pk Input: table of primordial spectrum values
+ * @param primordial_pk_table Input: table of primordial spectrum values for this mode, with argument primordial_pk_table[index_q*ic_ic_size+index_ic1_ic2]
  * @param transfer_ic1  Input: table of transfer function values for first initial condition
  * @param transfer_ic2  Input: table of transfer function values for second initial condition
  * @return the error status
@@ -879,7 +897,7 @@ int harmonic_compute_cl(
                         int index_l,
                         int cl_integrand_num_columns,
                         double * cl_integrand,
-                        double * primordial_pk,
+                        double * primordial_pk_table,
                         double * transfer_ic1,
                         double * transfer_ic2
                         ) {
@@ -890,6 +908,7 @@ int harmonic_compute_cl(
   int index_d1,index_d2;
   double k;
   double clvalue;
+  double * primordial_pk;
   int index_ic1_ic2;
   double transfer_ic1_temp=0.;
   double transfer_ic2_temp=0.;
@@ -912,11 +931,7 @@ int harmonic_compute_cl(
 
     cl_integrand[index_q*cl_integrand_num_columns+0] = k;
 
-    class_call(primordial_spectrum_at_k(ppm,index_md,linear,k,primordial_pk),
-               ppm->error_message,
-               phr->error_message);
-
-    /* above routine checks that k>0: no possible division by zero below */
+    primordial_pk = primordial_pk_table + index_q*phr->ic_ic_size[index_md];
 
     for (index_tt=0; index_tt < ptr->tt_size[index_md]; index_tt++) {
 
@@ -399,15 +399,26 @@ int input_read_from_file(struct file_content * pfc,
   /** - Define local variables */
   int input_verbose = 0;
   int has_shooting;
+  short * read_before=NULL;
 
   /** Set default values
       Before getting into the assignment of parameters and the shooting, we want
       to already fix our precision parameters. No precision parameter should
       depend on any input parameter  */
+  if ((pfc->size > 0) && (pfc->read_by != NULL)) {
+    class_alloc(read_before,pfc->size*sizeof(short),errmsg);
+  }
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_precisions(pfc,ppr,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,
                                    errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_precision),
+             errmsg,
+             errmsg);
+  free(read_before);
 
   class_read_int("input_verbose",input_verbose);
   if (input_verbose >0) printf("Reading input parameters\n");
@@ -724,6 +735,9 @@ int input_shooting(struct file_content * pfc,
     }
 
     /** Read all parameters from the fc obtained through shooting */
+    if (pfc->read_by != NULL) {
+      class_calloc(fzw.fc.read_by,fzw.fc.size,sizeof(int),errmsg);
+    }
     class_call(input_read_parameters(&(fzw.fc),ppr,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,
                                      errmsg),
                errmsg,
@@ -743,6 +757,8 @@ int input_shooting(struct file_content * pfc,
     for (i=0; i < pfc->size; i ++) {
       if (fzw.fc.read[i] == _TRUE_)
         pfc->read[i] = _TRUE_;
+      if (pfc->read_by != NULL)
+        pfc->read_by[i] |= fzw.fc.read_by[i];
     }
 
     /* Free tuned pfc */
@@ -846,6 +862,9 @@ int input_shooting(struct file_content * pfc,
     }
 
     /* Now read the remaining parameters from the fine tuned fzw into the individual structures */
+    if (pfc->read_by != NULL) {
+      class_calloc(fzw.fc.read_by,fzw.fc.size,sizeof(int),errmsg);
+    }
     class_call(input_read_parameters(&(fzw.fc),ppr,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,
                                      errmsg),
                errmsg,
@@ -857,6 +876,8 @@ int input_shooting(struct file_content * pfc,
     for (i=0; i < pfc->size; i ++) {
       if (fzw.fc.read[i] == _TRUE_)
         pfc->read[i] = _TRUE_;
+      if (pfc->read_by != NULL)
+        pfc->read_by[i] |= fzw.fc.read_by[i];
     }
 
     /* Free tuned pfc */
@@ -1645,6 +1666,13 @@ int input_read_parameters(struct file_content * pfc,
 
   /** Define local variables */
   int input_verbose=0;
+  short * read_before=NULL;
+
+  /** If requested, keep track of the group of parameters in which
+      each parameter is read (see input_read_group_start()) */
+  if ((pfc->size > 0) && (pfc->read_by != NULL)) {
+    class_alloc(read_before,pfc->size*sizeof(short),errmsg);
+  }
 
   /** Set all input parameters to default values */
   class_call(input_default_params(pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop),
@@ -1660,66 +1688,128 @@ int input_read_parameters(struct file_content * pfc,
    * This function is exclusively for those parameters, NOT
    *  related to any physical species
    * */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_general(pfc,pba,pth,ppt,psd,
                                            errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_general),
+             errmsg,
+             errmsg);
 
   /** Read the parameters for each physical species (has to be called after the general read) */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_species(pfc,ppr,pba,pth,ppt,
                                            input_verbose,
                                            errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_species),
+             errmsg,
+             errmsg);
 
   /** Read parameters for exotic energy injection quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_injection(pfc,ppr,pth,
                                              errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_injection),
+             errmsg,
+             errmsg);
 
   /** Read parameters for nonlinear quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_nonlinear(pfc,ppr,pba,pth,ppt,pfo,
                                              input_verbose,
                                              errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_nonlinear),
+             errmsg,
+             errmsg);
 
   /** Read parameters for primordial quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_primordial(pfc,ppt,ppm,
                                               errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_primordial),
+             errmsg,
+             errmsg);
 
   /** Read parameters for spectra quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_spectra(pfc,ppr,pba,ppm,ppt,ptr,phr,pop,
                                            errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_spectra),
+             errmsg,
+             errmsg);
 
   /** Read parameters for lensing quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_lensing(pfc,ppr,ppt,ptr,ple,
                                            errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_lensing),
+             errmsg,
+             errmsg);
 
   /** Read parameters for distortions quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_distortions(pfc,ppr,psd,
                                                errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_distortions),
+             errmsg,
+             errmsg);
 
   /** Read obsolete parameters */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_additional(pfc,ppr,pba,pth,
                                               errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_additional),
+             errmsg,
+             errmsg);
 
   /** Read parameters for output quantities */
+  class_call(input_read_group_start(pfc,read_before),
+             errmsg,
+             errmsg);
   class_call(input_read_parameters_output(pfc,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,
                                           errmsg),
              errmsg,
              errmsg);
+  class_call(input_read_group_end(pfc,read_before,input_group_output),
+             errmsg,
+             errmsg);
+
+  free(read_before);
 
   return _SUCCESS_;
 
@@ -1754,6 +1844,7 @@ int input_read_parameters_general(struct file_content * pfc,
   /** - Define local variables */
   int flag1,flag2;
   double param1,param2;
+  int index_p;
   char string1[_ARGUMENT_LENGTH_MAX_];
   char * options_output[33] =  {"tCl","pCl","lCl","nCl","dCl","sCl","mPk","mTk","dTk","vTk","sd",
                                 "TCl","PCl","LCl","NCl","DCl","SCl","MPk","MTk","DTk","VTk","Sd",
@@ -2173,6 +2264,56 @@ int input_read_parameters_general(struct file_content * pfc,
     }
   }
 
+  /** 7.b) Recombination emulator */
+  /* Read */
+  class_call(parser_read_string(pfc,"recombination_emulator",&string1,&flag1,errmsg),
+             errmsg,
+             errmsg);
+  /* Complete set of parameters */
+  if (flag1 == _TRUE_){
+    if ((strstr(string1,"train") != NULL) || (strstr(string1,"TRAIN") != NULL)){
+      pth->recombination_emulator = rec_emulator_train;
+    }
+    else if ((strstr(string1,"y") != NULL) || (strstr(string1,"Y") != NULL)){
+      pth->recombination_emulator = rec_emulator_use;
+    }
+    else if ((strstr(string1,"n") != NULL) || (strstr(string1,"N") != NULL)){
+      pth->recombination_emulator = rec_emulator_none;
+    }
+    else{
+      class_stop(errmsg,
+                 "You specified 'recombination_emulator' as '%s'. It has to be one of {'yes','no','train'}.",string1);
+    }
+  }
+
+  if (pth->recombination_emulator != rec_emulator_none){
+    class_call(parser_read_string(pfc,"recombination_emulator_file",&string1,&flag1,errmsg),
+               errmsg,
+               errmsg);
+    if (flag1 == _TRUE_){
+      class_test(strlen(string1)>=_FILENAMESIZE_,errmsg,"Emulator file name is too long. Please choose another file name, or increase _FILENAMESIZE_ in common.h");
+      strcpy(pth->recombination_emulator_file,string1);
+    }
+    class_read_flag("recombination_emulator_check",pth->recombination_emulator_check);
+  }
+
+  if (pth->recombination_emulator == rec_emulator_train){
+    class_read_int("recombination_emulator_points",pth->recombination_emulator_points);
+    class_read_double("recombination_emulator_delta_omega_b",pth->recombination_emulator_delta[rec_emulator_omega_b]);
+    class_read_double("recombination_emulator_delta_omega_cdm",pth->recombination_emulator_delta[rec_emulator_omega_cdm]);
+    class_read_double("recombination_emulator_delta_YHe",pth->recombination_emulator_delta[rec_emulator_YHe]);
+    class_read_double("recombination_emulator_delta_Neff",pth->recombination_emulator_delta[rec_emulator_Neff]);
+    /* Test */
+    class_test(pth->recombination_emulator_points < 2,
+               errmsg,
+               "recombination_emulator_points=%d, but at least two points are needed along each direction",pth->recombination_emulator_points);
+    for (index_p=0; index_p<rec_emulator_parameter_size; index_p++){
+      class_test(pth->recombination_emulator_delta[index_p] <= 0.,
+                 errmsg,
+                 "the half-widths 'recombination_emulator_delta_...' of the training range must be positive");
+    }
+  }
+
   /** 8) Reionization parametrization */
   /* Read */
   class_call(parser_read_string(pfc,"reio_parametrization",&string1,&flag1,errmsg),
@@ -5472,6 +5613,42 @@ int input_read_parameters_output(struct file_content * pfc,
   /* Read */
   class_read_flag_or_deprecated("write_distortions","write distortions",pop->write_distortions);
 
+  /** 1.n) Persistent cache of source functions */
+  /* Read */
+  class_read_flag("perturbations_cache",ppt->has_perturbations_cache);
+  class_call(parser_read_string(pfc,"perturbations_cache_directory",&string1,&flag1,errmsg),
+             errmsg,
+             errmsg);
+  /* Complete set of parameters */
+  if (flag1 == _TRUE_){
+    class_test(strlen(string1)>_FILENAMESIZE_-64,errmsg,"Cache directory name is too long. Please choose another directory, or increase _FILENAMESIZE_ in common.h");
+    strcpy(ppt->perturbations_cache_directory,string1);
+  }
+
+  /** 1.o) Memory-mapped file of flat spherical Bessel functions */
+  /* Read */
+  class_read_flag("hyperspherical_cache",ptr->has_hyperspherical_cache);
+  class_call(parser_read_string(pfc,"hyperspherical_cache_directory",&string1,&flag1,errmsg),
+             errmsg,
+             errmsg);
+  /* Complete set of parameters */
+  if (flag1 == _TRUE_){
+    class_test(strlen(string1)>_FILENAMESIZE_-32,errmsg,"Cache directory name is too long. Please choose another directory, or increase _FILENAMESIZE_ in common.h");
+    strcpy(ptr->hyperspherical_cache_directory,string1);
+  }
+
+  /** 1.p) Profile of the integration of perturbations */
+  /* Read */
+  class_read_flag("perturbations_profile",ppt->has_perturbations_profile);
+  class_call(parser_read_string(pfc,"perturbations_profile_file",&string1,&flag1,errmsg),
+             errmsg,
+             errmsg);
+  /* Complete set of parameters */
+  if (flag1 == _TRUE_){
+    class_test(strlen(string1)>=_FILENAMESIZE_,errmsg,"Profile file name is too long. Please choose another file name, or increase _FILENAMESIZE_ in common.h");
+    strcpy(ppt->perturbations_profile_file,string1);
+  }
+
   /** 2) Verbosity */
   /* Read */
   class_read_int("background_verbose",pba->background_verbose);
@@ -5490,6 +5667,64 @@ int input_read_parameters_output(struct file_content * pfc,
 
 }
 
+/**
+ * Start reading a group of parameters, when the field read_by of the
+ * file_content structure is allocated (otherwise, do nothing): store
+ * the flags telling which parameters were already read, and reset
+ * them, such that input_read_group_end() can find out which
+ * parameters are read by this group.
+ *
+ * @param pfc         Input/Output: pointer to file content
+ * @param read_before Output: copy of the flags pfc->read (allocated with pfc->size elements)
+ * @return the error status
+ */
+
+int input_read_group_start(struct file_content * pfc,
+                           short * read_before){
+
+  int i;
+
+  if ((pfc->size == 0) || (pfc->read_by == NULL))
+    return _SUCCESS_;
+
+  for (i=0; i<pfc->size; i++) {
+    read_before[i] = pfc->read[i];
+    pfc->read[i] = _FALSE_;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * End reading a group of parameters started with
+ * input_read_group_start(): flag the parameters read by this group in
+ * pfc->read_by, and restore the flags of the parameters read before.
+ *
+ * @param pfc         Input/Output: pointer to file content
+ * @param read_before Input: flags stored by input_read_group_start()
+ * @param group       Input: group of parameters just read
+ * @return the error status
+ */
+
+int input_read_group_end(struct file_content * pfc,
+                         short * read_before,
+                         enum input_group group){
+
+  int i;
+
+  if ((pfc->size == 0) || (pfc->read_by == NULL))
+    return _SUCCESS_;
+
+  for (i=0; i<pfc->size; i++) {
+    if (pfc->read[i] == _TRUE_)
+      pfc->read_by[i] |= (1 << group);
+    else
+      pfc->read[i] = read_before[i];
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * Write the info related to the used and unused parameters
  * Additionally, write the warnings for unused parameters
@@ -5678,6 +5913,15 @@ int input_default_params(struct background *pba,
   /** 7) Recombination algorithm */
   pth->recombination=hyrec;
   pth->recfast_photoion_mode=recfast_photoion_Tmat;
+  /** 7.b) Recombination emulator */
+  pth->recombination_emulator = rec_emulator_none;
+  sprintf(pth->recombination_emulator_file,"recombination_emulator.dat");
+  pth->recombination_emulator_check = _FALSE_;
+  pth->recombination_emulator_points = 3;
+  pth->recombination_emulator_delta[rec_emulator_omega_b] = 0.001;
+  pth->recombination_emulator_delta[rec_emulator_omega_cdm] = 0.01;
+  pth->recombination_emulator_delta[rec_emulator_YHe] = 0.02;
+  pth->recombination_emulator_delta[rec_emulator_Neff] = 0.5;
 
   /** 8) Parametrization of reionization */
   pth->reio_parametrization=reio_camb;
@@ -6128,6 +6372,15 @@ int input_default_params(struct background *pba,
   pop->write_noninjection = _FALSE_;
   /** 1.i) Spectral distortions */
   pop->write_distortions = _FALSE_;
+  /** 1.n) Persistent cache of source functions */
+  ppt->has_perturbations_cache = _FALSE_;
+  sprintf(ppt->perturbations_cache_directory,"cache");
+  /** 1.o) Memory-mapped file of flat spherical Bessel functions */
+  ptr->has_hyperspherical_cache = _FALSE_;
+  sprintf(ptr->hyperspherical_cache_directory,"cache");
+  /** 1.p) Profile of the integration of perturbations */
+  ppt->has_perturbations_profile = _FALSE_;
+  ppt->perturbations_profile_file[0] = '\0';
 
 
   /** 2) Verbosity */
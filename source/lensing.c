@@ -92,47 +92,7 @@ int lensing_init(
   /** Summary: */
   /** - Define local variables */
 
-  double * mu; /* mu[index_mu]: discretized values of mu
-                  between -1 and 1, roots of Legendre polynomial */
-  double * w8; /* Corresponding Gauss-Legendre quadrature weights */
-  double theta,delta_theta;
-
-  double ** d00;  /* dmn[index_mu][index_l] */
-  double ** d11;
-  double ** d2m2;
-  double ** d22 = NULL;
-  double ** d20 = NULL;
-  double ** d1m1;
-  double ** d31 = NULL;
-  double ** d40 = NULL;
-  double ** d3m1 = NULL;
-  double ** d3m3 = NULL;
-  double ** d4m2 = NULL;
-  double ** d4m4 = NULL;
-  double * buf_dxx; /* buffer */
-
-  double * Cgl;   /* Cgl[index_mu] */
-  double * Cgl2;  /* Cgl2[index_mu] */
-  double * sigma2; /* sigma[index_mu] */
-
-  double * ksi = NULL;  /* ksi[index_mu] */
-  double * ksiX = NULL;  /* ksiX[index_mu] */
-  double * ksip = NULL;  /* ksip[index_mu] */
-  double * ksim = NULL;  /* ksim[index_mu] */
-
-  double fac,fac1;
-  double X_000;
-  double X_p000;
-  double X_220;
-  double X_022;
-  double X_p022;
-  double X_121;
-  double X_132;
-  double X_242;
-
-  int num_mu,index_mu,icount;
   int l;
-  double ll;
   double * cl_unlensed;  /* cl_unlensed[index_ct] */
   double * cl_tt; /* unlensed  cl, to be filled to avoid repeated calls to harmonic_cl_at_l */
   double * cl_te = NULL; /* unlensed  cl, to be filled to avoid repeated calls to harmonic_cl_at_l */
@@ -140,15 +100,6 @@ int lensing_init(
   double * cl_bb = NULL; /* unlensed  cl, to be filled to avoid repeated calls to harmonic_cl_at_l */
   double * cl_pp; /* potential cl, to be filled to avoid repeated calls to harmonic_cl_at_l */
 
-  double res,resX,lens;
-  double resp, resm, lensp, lensm;
-
-  double * sqrt1;
-  double * sqrt2;
-  double * sqrt3;
-  double * sqrt4;
-  double * sqrt5;
-
   double ** cl_md_ic; /* array with argument
                          cl_md_ic[index_md][index_ic1_ic2*phr->ct_size+index_ct] */
 
@@ -157,10 +108,6 @@ int lensing_init(
 
   int index_md;
 
-  /* Timing */
-  //double debut, fin;
-  //double cpu_time;
-
   /** - check that we really want to compute at least one spectrum */
 
   if (ple->has_lensed_cls == _FALSE_) {
@@ -171,7 +118,9 @@ int lensing_init(
   else {
     if (ple->lensing_verbose > 0) {
       printf("Computing lensed spectra ");
-      if (ppr->accurate_lensing==_TRUE_)
+      if (ppr->lensing_fft_transforms==_TRUE_)
+        printf("(FFT mode)\n");
+      else if (ppr->accurate_lensing==_TRUE_)
         printf("(accurate mode)\n");
       else
         printf("(fast mode)\n");
@@ -185,236 +134,6 @@ int lensing_init(
              ple->error_message,
              ple->error_message);
 
-  /** - put all precision variables hare; will be stored later in precision structure */
-  /** - Last element in \f$ \mu \f$ will be for \f$ \mu=1 \f$, needed for sigma2.
-      The rest will be chosen as roots of a Gauss-Legendre quadrature **/
-
-  if (ppr->accurate_lensing == _TRUE_) {
-    num_mu=(ple->l_unlensed_max+ppr->num_mu_minus_lmax); /* Must be even ?? CHECK */
-    num_mu += num_mu%2; /* Force it to be even */
-  } else {
-    /* Integrate correlation function difference on [0,pi/16] */
-    num_mu = (ple->l_unlensed_max * 2 )/16;
-  }
-  /** - allocate array of \f$ \mu \f$ values, as well as quadrature weights */
-
-  class_alloc(mu,
-              num_mu*sizeof(double),
-              ple->error_message);
-  /* Reserve last element of mu for mu=1, needed for sigma2 */
-  mu[num_mu-1] = 1.0;
-
-  class_alloc(w8,
-              (num_mu-1)*sizeof(double),
-              ple->error_message);
-
-  if (ppr->accurate_lensing == _TRUE_) {
-
-    //debut = omp_get_wtime();
-    class_call(quadrature_gauss_legendre(mu,
-                                         w8,
-                                         num_mu-1,
-                                         ppr->tol_gauss_legendre,
-                                         ple->error_message),
-               ple->error_message,
-               ple->error_message);
-    //fin = omp_get_wtime();
-    //cpu_time = (fin-debut);
-    //printf("time in quadrature_gauss_legendre=%4.3f s\n",cpu_time);
-
-  } else { /* Crude integration on [0,pi/16]: Riemann sum on theta */
-
-    delta_theta = _PI_/16. / (double)(num_mu-1);
-    for (index_mu=0;index_mu<num_mu-1;index_mu++) {
-      theta = (index_mu+1)*delta_theta;
-      mu[index_mu] = cos(theta);
-      w8[index_mu] = sin(theta)*delta_theta; /* We integrate on mu */
-    }
-  }
-
-  /** - Compute \f$ d^l_{mm'} (\mu) \f$*/
-
-  icount = 0;
-  class_alloc(d00,
-              num_mu*sizeof(double*),
-              ple->error_message);
-
-  class_alloc(d11,
-              num_mu*sizeof(double*),
-              ple->error_message);
-
-  class_alloc(d1m1,
-              num_mu*sizeof(double*),
-              ple->error_message);
-
-  class_alloc(d2m2,
-              num_mu*sizeof(double*),
-              ple->error_message);
-  icount += 4*num_mu*(ple->l_unlensed_max+1);
-
-  if (ple->has_te==_TRUE_) {
-
-    class_alloc(d20,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d3m1,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d4m2,
-                num_mu*sizeof(double*),
-                ple->error_message);
-    icount += 3*num_mu*(ple->l_unlensed_max+1);
-  }
-
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-    class_alloc(d22,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d31,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d3m3,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d40,
-                num_mu*sizeof(double*),
-                ple->error_message);
-
-    class_alloc(d4m4,
-                num_mu*sizeof(double*),
-                ple->error_message);
-    icount += 5*num_mu*(ple->l_unlensed_max+1);
-  }
-
-  icount += 5*(ple->l_unlensed_max+1); /* for arrays sqrt1[l] to sqrt5[l] */
-
-  /** - Allocate main contiguous buffer **/
-  class_alloc(buf_dxx,
-              icount * sizeof(double),
-              ple->error_message);
-
-  icount = 0;
-  for (index_mu=0; index_mu<num_mu; index_mu++) {
-
-    d00[index_mu] = &(buf_dxx[icount+index_mu            * (ple->l_unlensed_max+1)]);
-    d11[index_mu] = &(buf_dxx[icount+(index_mu+num_mu)   * (ple->l_unlensed_max+1)]);
-    d1m1[index_mu]= &(buf_dxx[icount+(index_mu+2*num_mu) * (ple->l_unlensed_max+1)]);
-    d2m2[index_mu]= &(buf_dxx[icount+(index_mu+3*num_mu) * (ple->l_unlensed_max+1)]);
-  }
-  icount += 4*num_mu*(ple->l_unlensed_max+1);
-
-  if (ple->has_te==_TRUE_) {
-    for (index_mu=0; index_mu<num_mu; index_mu++) {
-      d20[index_mu] = &(buf_dxx[icount+index_mu            * (ple->l_unlensed_max+1)]);
-      d3m1[index_mu]= &(buf_dxx[icount+(index_mu+num_mu)   * (ple->l_unlensed_max+1)]);
-      d4m2[index_mu]= &(buf_dxx[icount+(index_mu+2*num_mu) * (ple->l_unlensed_max+1)]);
-    }
-    icount += 3*num_mu*(ple->l_unlensed_max+1);
-  }
-
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-    for (index_mu=0; index_mu<num_mu; index_mu++) {
-      d22[index_mu] = &(buf_dxx[icount+index_mu            * (ple->l_unlensed_max+1)]);
-      d31[index_mu] = &(buf_dxx[icount+(index_mu+num_mu)   * (ple->l_unlensed_max+1)]);
-      d3m3[index_mu]= &(buf_dxx[icount+(index_mu+2*num_mu) * (ple->l_unlensed_max+1)]);
-      d40[index_mu] = &(buf_dxx[icount+(index_mu+3*num_mu) * (ple->l_unlensed_max+1)]);
-      d4m4[index_mu]= &(buf_dxx[icount+(index_mu+4*num_mu) * (ple->l_unlensed_max+1)]);
-    }
-    icount += 5*num_mu*(ple->l_unlensed_max+1);
-  }
-
-  sqrt1 = &(buf_dxx[icount]);
-  icount += ple->l_unlensed_max+1;
-  sqrt2 = &(buf_dxx[icount]);
-  icount += ple->l_unlensed_max+1;
-  sqrt3 = &(buf_dxx[icount]);
-  icount += ple->l_unlensed_max+1;
-  sqrt4 = &(buf_dxx[icount]);
-  icount += ple->l_unlensed_max+1;
-  sqrt5 = &(buf_dxx[icount]);
-  icount += ple->l_unlensed_max+1;
-
-  //debut = omp_get_wtime();
-  class_call(lensing_d00(mu,num_mu,ple->l_unlensed_max,d00),
-             ple->error_message,
-             ple->error_message);
-
-  class_call(lensing_d11(mu,num_mu,ple->l_unlensed_max,d11),
-             ple->error_message,
-             ple->error_message);
-
-  class_call(lensing_d1m1(mu,num_mu,ple->l_unlensed_max,d1m1),
-             ple->error_message,
-             ple->error_message);
-
-  class_call(lensing_d2m2(mu,num_mu,ple->l_unlensed_max,d2m2),
-             ple->error_message,
-             ple->error_message);
-  //fin = omp_get_wtime();
-  //cpu_time = (fin-debut);
-  //printf("time in lensing_dxx=%4.3f s\n",cpu_time);
-
-
-  if (ple->has_te==_TRUE_) {
-
-    class_call(lensing_d20(mu,num_mu,ple->l_unlensed_max,d20),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d3m1(mu,num_mu,ple->l_unlensed_max,d3m1),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d4m2(mu,num_mu,ple->l_unlensed_max,d4m2),
-               ple->error_message,
-               ple->error_message);
-
-  }
-
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-    class_call(lensing_d22(mu,num_mu,ple->l_unlensed_max,d22),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d31(mu,num_mu,ple->l_unlensed_max,d31),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d3m3(mu,num_mu,ple->l_unlensed_max,d3m3),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d40(mu,num_mu,ple->l_unlensed_max,d40),
-               ple->error_message,
-               ple->error_message);
-
-    class_call(lensing_d4m4(mu,num_mu,ple->l_unlensed_max,d4m4),
-               ple->error_message,
-               ple->error_message);
-  }
-
-  /** - compute \f$ Cgl(\mu)\f$, \f$ Cgl2(\mu) \f$ and sigma2(\f$\mu\f$) */
-
-  class_alloc(Cgl,
-              num_mu*sizeof(double),
-              ple->error_message);
-
-  class_alloc(Cgl2,
-              num_mu*sizeof(double),
-              ple->error_message);
-
-  class_alloc(sigma2,
-              (num_mu-1)*sizeof(double), /* Zero separation is omitted */
-              ple->error_message);
-
   class_alloc(cl_unlensed,
               phr->ct_size*sizeof(double),
               ple->error_message);
@@ -493,244 +212,46 @@ int lensing_init(
   free(cl_md_ic);
   free(cl_md);
 
-  /** - Compute sigma2\f$(\mu)\f$ and Cgl2(\f$\mu\f$) **/
+  /** - compute the lensed \f$ C_l\f$'s, either with fast transforms or with
+      quadratures over \f$ \mu \f$ */
 
-  //debut = omp_get_wtime();
-#pragma omp parallel for                        \
-  private (index_mu,l)                          \
-  schedule (static)
-  for (index_mu=0; index_mu<num_mu; index_mu++) {
-
-    Cgl[index_mu]=0;
-    Cgl2[index_mu]=0;
+  if (ppr->lensing_fft_transforms == _TRUE_) {
+    class_call(lensing_lensed_cl_fft(ppr,ple,cl_tt,cl_te,cl_ee,cl_bb,cl_pp),
+               ple->error_message,
+               ple->error_message);
+  }
+  else {
+    class_call(lensing_lensed_cl_quadrature(ppr,ple,cl_tt,cl_te,cl_ee,cl_bb,cl_pp),
+               ple->error_message,
+               ple->error_message);
+  }
 
-    for (l=2; l<=ple->l_unlensed_max; l++) {
+  /** - normalise the lensed \f$ C_l\f$'s, and in fast or FFT mode add back the unlensed ones */
 
-      Cgl[index_mu] += (2.*l+1.)*l*(l+1.)*
-        cl_pp[l]*d11[index_mu][l];
+  class_call(lensing_lensed_cl_normalize(ple),
+             ple->error_message,
+             ple->error_message);
 
-      Cgl2[index_mu] += (2.*l+1.)*l*(l+1.)*
-        cl_pp[l]*d1m1[index_mu][l];
+  if ((ppr->accurate_lensing == _FALSE_) || (ppr->lensing_fft_transforms == _TRUE_)) {
 
+    if (ple->has_tt==_TRUE_) {
+      class_call(lensing_addback_cl_tt(ple,cl_tt),
+                 ple->error_message,
+                 ple->error_message);
     }
 
-    Cgl[index_mu] /= 4.*_PI_;
-    Cgl2[index_mu] /= 4.*_PI_;
-
-  }
+    if (ple->has_te==_TRUE_) {
+      class_call(lensing_addback_cl_te(ple,cl_te),
+                 ple->error_message,
+                 ple->error_message);
+    }
 
-  for (index_mu=0; index_mu<num_mu-1; index_mu++) {
-    /* Cgl(1.0) - Cgl(mu) */
-    sigma2[index_mu] = Cgl[num_mu-1] - Cgl[index_mu];
-  }
-  //fin = omp_get_wtime();
-  //cpu_time = (fin-debut);
-  //printf("time in Cgl,Cgl2,sigma2=%4.3f s\n",cpu_time);
-
-
-  /** - compute ksi, ksi+, ksi-, ksiX */
-
-  /** - --> ksi is for TT **/
-  if (ple->has_tt==_TRUE_) {
-
-    class_calloc(ksi,
-                 (num_mu-1),
-                 sizeof(double),
-                 ple->error_message);
-  }
-
-  /** - --> ksiX is for TE **/
-  if (ple->has_te==_TRUE_) {
-
-    class_calloc(ksiX,
-                 (num_mu-1),
-                 sizeof(double),
-                 ple->error_message);
-  }
-
-  /** - --> ksip, ksim for EE, BB **/
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-    class_calloc(ksip,
-                 (num_mu-1),
-                 sizeof(double),
-                 ple->error_message);
-
-    class_calloc(ksim,
-                 (num_mu-1),
-                 sizeof(double),
-                 ple->error_message);
-  }
-
-  for (l=2;l<=ple->l_unlensed_max;l++) {
-
-    ll = (double)l;
-    sqrt1[l]=sqrt((ll+2)*(ll+1)*ll*(ll-1));
-    sqrt2[l]=sqrt((ll+2)*(ll-1));
-    sqrt3[l]=sqrt((ll+3)*(ll-2));
-    sqrt4[l]=sqrt((ll+4)*(ll+3)*(ll-2.)*(ll-3));
-    sqrt5[l]=sqrt(ll*(ll+1));
-  }
-
-
-  //debut = omp_get_wtime();
-#pragma omp parallel for                                                \
-  private (index_mu,l,ll,res,resX,resp,resm,lens,lensp,lensm,           \
-           fac,fac1,X_000,X_p000,X_220,X_022,X_p022,X_121,X_132,X_242)	\
-  schedule (static)
-
-  for (index_mu=0;index_mu<num_mu-1;index_mu++) {
-
-    for (l=2;l<=ple->l_unlensed_max;l++) {
-
-      ll = (double)l;
-
-      fac = ll*(ll+1)/4.;
-      fac1 = (2*ll+1)/(4.*_PI_);
-
-      /* In the following we will keep terms of the form (sigma2)^k*(Cgl2)^m
-         with k+m <= 2 */
-
-      X_000 = exp(-fac*sigma2[index_mu]);
-      X_p000 = -fac*X_000;
-      /* X_220 = 0.25*sqrt1[l] * exp(-(fac-0.5)*sigma2[index_mu]); */
-      X_220 = 0.25*sqrt1[l] * X_000; /* Order 0 */
-      /* next 5 lines useless, but avoid compiler warning 'may be used uninitialized' */
-      X_242=0.;
-      X_132=0.;
-      X_121=0.;
-      X_p022=0.;
-      X_022=0.;
-
-      if (ple->has_te==_TRUE_ || ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-        /* X_022 = exp(-(fac-1.)*sigma2[index_mu]); */
-        X_022 = X_000 * (1+sigma2[index_mu]*(1+0.5*sigma2[index_mu])); /* Order 2 */
-        X_p022 = -(fac-1.)*X_022; /* Old versions were missing the
-                                     minus sign in this line, which introduced a very small error
-                                     on the high-l C_l^TE lensed spectrum [credits for bug fix:
-                                     Selim Hotinli] */
-
-        /* X_242 = 0.25*sqrt4[l] * exp(-(fac-5./2.)*sigma2[index_mu]); */
-        X_242 = 0.25*sqrt4[l] * X_000; /* Order 0 */
-        if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-          /* X_121 = - 0.5*sqrt2[l] * exp(-(fac-2./3.)*sigma2[index_mu]);
-             X_132 = - 0.5*sqrt3[l] * exp(-(fac-5./3.)*sigma2[index_mu]); */
-          X_121 = -0.5*sqrt2[l] * X_000 * (1+2./3.*sigma2[index_mu]); /* Order 1 */
-          X_132 = -0.5*sqrt3[l] * X_000 * (1+5./3.*sigma2[index_mu]); /* Order 1 */
-        }
-      }
-
-
-      if (ple->has_tt==_TRUE_) {
-
-        res = fac1*cl_tt[l];
-
-        lens = (X_000*X_000*d00[index_mu][l] +
-                X_p000*X_p000*d1m1[index_mu][l]
-                *Cgl2[index_mu]*8./(ll*(ll+1)) +
-                (X_p000*X_p000*d00[index_mu][l] +
-                 X_220*X_220*d2m2[index_mu][l])
-                *Cgl2[index_mu]*Cgl2[index_mu]);
-        if (ppr->accurate_lensing == _FALSE_) {
-          /* Remove unlensed correlation function */
-          lens -= d00[index_mu][l];
-        }
-        res *= lens;
-        ksi[index_mu] += res;
-      }
-
-      if (ple->has_te==_TRUE_) {
-
-        resX = fac1*cl_te[l];
-
-
-        lens = ( X_022*X_000*d20[index_mu][l] +
-                 Cgl2[index_mu]*2.*X_p000/sqrt5[l] *
-                 (X_121*d11[index_mu][l] + X_132*d3m1[index_mu][l]) +
-                 0.5 * Cgl2[index_mu] * Cgl2[index_mu] *
-                 ( ( 2.*X_p022*X_p000+X_220*X_220 ) *
-                   d20[index_mu][l] + X_220*X_242*d4m2[index_mu][l] ) );
-        if (ppr->accurate_lensing == _FALSE_) {
-          lens -= d20[index_mu][l];
-        }
-        resX *= lens;
-        ksiX[index_mu] += resX;
-      }
-
-      if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-        resp = fac1*(cl_ee[l]+cl_bb[l]);
-        resm = fac1*(cl_ee[l]-cl_bb[l]);
-
-        lensp = ( X_022*X_022*d22[index_mu][l] +
-                  2.*Cgl2[index_mu]*X_132*X_121*d31[index_mu][l] +
-                  Cgl2[index_mu]*Cgl2[index_mu] *
-                  ( X_p022*X_p022*d22[index_mu][l] +
-                    X_242*X_220*d40[index_mu][l] ) );
-
-        lensm = ( X_022*X_022*d2m2[index_mu][l] +
-                  Cgl2[index_mu] *
-                  ( X_121*X_121*d1m1[index_mu][l] +
-                    X_132*X_132*d3m3[index_mu][l] ) +
-                  0.5 * Cgl2[index_mu] * Cgl2[index_mu] *
-                  ( 2.*X_p022*X_p022*d2m2[index_mu][l] +
-                    X_220*X_220*d00[index_mu][l] +
-                    X_242*X_242*d4m4[index_mu][l] ) );
-        if (ppr->accurate_lensing == _FALSE_) {
-          lensp -= d22[index_mu][l];
-          lensm -= d2m2[index_mu][l];
-        }
-        resp *= lensp;
-        resm *= lensm;
-        ksip[index_mu] += resp;
-        ksim[index_mu] += resm;
-      }
-    }
-  }
-  //fin = omp_get_wtime();
-  //cpu_time = (fin-debut);
-  //printf("time in ksi=%4.3f s\n",cpu_time);
-
-
-  /** - compute lensed \f$ C_l\f$'s by integration */
-  //debut = omp_get_wtime();
-  if (ple->has_tt==_TRUE_) {
-    class_call(lensing_lensed_cl_tt(ksi,d00,w8,num_mu-1,ple),
-               ple->error_message,
-               ple->error_message);
-    if (ppr->accurate_lensing == _FALSE_) {
-      class_call(lensing_addback_cl_tt(ple,cl_tt),
-                 ple->error_message,
-                 ple->error_message);
-    }
-  }
-
-  if (ple->has_te==_TRUE_) {
-    class_call(lensing_lensed_cl_te(ksiX,d20,w8,num_mu-1,ple),
-               ple->error_message,
-               ple->error_message);
-    if (ppr->accurate_lensing == _FALSE_) {
-      class_call(lensing_addback_cl_te(ple,cl_te),
-                 ple->error_message,
-                 ple->error_message);
-    }
-  }
-
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-
-    class_call(lensing_lensed_cl_ee_bb(ksip,ksim,d22,d2m2,w8,num_mu-1,ple),
-               ple->error_message,
-               ple->error_message);
-    if (ppr->accurate_lensing == _FALSE_) {
+    if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
       class_call(lensing_addback_cl_ee_bb(ple,cl_ee,cl_bb),
                  ple->error_message,
                  ple->error_message);
     }
   }
-  //fin=omp_get_wtime();
-  //cpu_time = (fin-debut);
-  //printf("time in final lensing computation=%4.3f s\n",cpu_time);
 
   /** - spline computed \f$ C_l\f$'s in view of interpolation */
 
@@ -745,40 +266,6 @@ int lensing_init(
              ple->error_message);
 
   /** - Free lots of stuff **/
-  free(buf_dxx);
-
-  free(d00);
-  free(d11);
-  free(d1m1);
-  free(d2m2);
-  if (ple->has_te==_TRUE_) {
-    free(d20);
-    free(d3m1);
-    free(d4m2);
-  }
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-    free(d22);
-    free(d31);
-    free(d3m3);
-    free(d40);
-    free(d4m4);
-  }
-
-  if (ple->has_tt==_TRUE_)
-    free(ksi);
-  if (ple->has_te==_TRUE_)
-    free(ksiX);
-  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
-    free(ksip);
-    free(ksim);
-  }
-  free(Cgl);
-  free(Cgl2);
-  free(sigma2);
-
-  free(mu);
-  free(w8);
-
   free(cl_unlensed);
   free(cl_tt);
   if (ple->has_te==_TRUE_)
@@ -1032,7 +519,73 @@ int lensing_indices(
 }
 
 /**
- * This routine computes the lensed power spectra by Gaussian quadrature
+ * This routine sets to zero the lensed power spectra, before the
+ * quadrature sums are accumulated over blocks of \f$ \mu \f$ values
+ * by lensing_lensed_cl_tt(), lensing_lensed_cl_te(),
+ * lensing_lensed_cl_ee_bb()
+ *
+ * @param ple  Input/output: Pointer to the lensing structure
+ * @return the error status
+ */
+
+int lensing_lensed_cl_reset(
+                            struct lensing * ple
+                            ) {
+
+  int index_l;
+
+  for (index_l=0; index_l<ple->l_size; index_l++) {
+    if (ple->has_tt==_TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt]=0.;
+    if (ple->has_te==_TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te]=0.;
+    if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee]=0.;
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb]=0.;
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine turns the quadrature sums accumulated by
+ * lensing_lensed_cl_tt(), lensing_lensed_cl_te(),
+ * lensing_lensed_cl_ee_bb() into lensed power spectra (for EE and
+ * BB, the sums for \f$ \xi_+ \f$ and \f$ \xi_- \f$ are stored in the EE
+ * and BB slots until this step)
+ *
+ * @param ple  Input/output: Pointer to the lensing structure
+ * @return the error status
+ */
+
+int lensing_lensed_cl_normalize(
+                                struct lensing * ple
+                                ) {
+
+  double clp, clm;
+  int index_l;
+
+  for (index_l=0; index_l<ple->l_size; index_l++) {
+    if (ple->has_tt==_TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt]=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt]*2.0*_PI_;
+    if (ple->has_te==_TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te]=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te]*2.0*_PI_;
+    if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+      clp = ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee];
+      clm = ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb];
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee]=(clp+clm)*_PI_;
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb]=(clp-clm)*_PI_;
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine adds the contribution of nmu quadrature points to the
+ * Gaussian quadrature giving the lensed TT power spectrum (normalised
+ * later by lensing_lensed_cl_normalize())
  *
  * @param ksi  Input: Lensed correlation function (ksi[index_mu])
  * @param d00  Input: Legendre polynomials (\f$ d^l_{00}\f$[l][index_mu])
@@ -1061,11 +614,11 @@ int lensing_lensed_cl_tt(
   schedule (static)
 
   for (index_l=0; index_l<ple->l_size; index_l++){
-    cle=0;
+    cle=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt];
     for (imu=0;imu<nmu;imu++) {
       cle += ksi[imu]*d00[imu][(int)ple->l[index_l]]*w8[imu]; /* loop could be optimized */
     }
-    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt]=cle*2.0*_PI_;
+    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt]=cle;
   }
 
   return _SUCCESS_;
@@ -1095,7 +648,9 @@ int lensing_addback_cl_tt(
 }
 
 /**
- * This routine computes the lensed power spectra by Gaussian quadrature
+ * This routine adds the contribution of nmu quadrature points to the
+ * Gaussian quadrature giving the lensed TE power spectrum (normalised
+ * later by lensing_lensed_cl_normalize())
  *
  * @param ksiX Input: Lensed correlation function (ksiX[index_mu])
  * @param d20  Input: Wigner d-function (\f$ d^l_{20}\f$[l][index_mu])
@@ -1124,11 +679,11 @@ int lensing_lensed_cl_te(
   schedule (static)
 
   for (index_l=0; index_l < ple->l_size; index_l++){
-    clte=0;
+    clte=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te];
     for (imu=0;imu<nmu;imu++) {
       clte += ksiX[imu]*d20[imu][(int)ple->l[index_l]]*w8[imu]; /* loop could be optimized */
     }
-    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te]=clte*2.0*_PI_;
+    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te]=clte;
   }
 
   return _SUCCESS_;
@@ -1158,7 +713,10 @@ int lensing_addback_cl_te(
 }
 
 /**
- * This routine computes the lensed power spectra by Gaussian quadrature
+ * This routine adds the contribution of nmu quadrature points to the
+ * Gaussian quadratures giving the lensed EE and BB power spectra. The
+ * sums for \f$ \xi_+ \f$ and \f$ \xi_- \f$ are kept in the EE and BB
+ * slots until lensing_lensed_cl_normalize() combines them.
  *
  * @param ksip Input: Lensed correlation function (ksi+[index_mu])
  * @param ksim Input: Lensed correlation function (ksi-[index_mu])
@@ -1191,15 +749,139 @@ int lensing_lensed_cl_ee_bb(
   schedule (static)
 
   for (index_l=0; index_l < ple->l_size; index_l++){
-    clp=0; clm=0;
+    clp=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee];
+    clm=ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb];
     for (imu=0;imu<nmu;imu++) {
       clp += ksip[imu]*d22[imu][(int)ple->l[index_l]]*w8[imu]; /* loop could be optimized */
       clm += ksim[imu]*d2m2[imu][(int)ple->l[index_l]]*w8[imu]; /* loop could be optimized */
     }
-    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee]=(clp+clm)*_PI_;
-    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb]=(clp-clm)*_PI_;
+    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee]=clp;
+    ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb]=clm;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine adds the contribution of nmu quadrature points to the
+ * Gaussian quadratures giving all lensed power spectra at once, with
+ * the same result as lensing_lensed_cl_tt(), lensing_lensed_cl_te()
+ * and lensing_lensed_cl_ee_bb() (up to rounding errors).
+ *
+ * The weights are first multiplied by the correlation functions. The
+ * sums are then computed in a single parallel loop over tiles of
+ * _LENSING_L_TILE_ multipoles; within a tile, the values of \f$ \mu \f$
+ * are taken by tiles of _LENSING_MU_TILE_, so that the cache lines
+ * of the d-functions loaded for one multipole are reused for the
+ * next ones, and the innermost loops over \f$ \mu \f$ are vectorized.
+ *
+ * @param ksi  Input: Lensed correlation function (ksi[index_mu], only if ple->has_tt)
+ * @param ksiX Input: Lensed correlation function (ksiX[index_mu], only if ple->has_te)
+ * @param ksip Input: Lensed correlation function (ksi+[index_mu], only if ple->has_ee or ple->has_bb)
+ * @param ksim Input: Lensed correlation function (ksi-[index_mu], only if ple->has_ee or ple->has_bb)
+ * @param d00  Input: Legendre polynomials (\f$ d^l_{00}\f$[index_mu][l])
+ * @param d20  Input: Wigner d-function (\f$ d^l_{20}\f$[index_mu][l])
+ * @param d22  Input: Wigner d-function (\f$ d^l_{22}\f$[index_mu][l])
+ * @param d2m2 Input: Wigner d-function (\f$ d^l_{2-2}\f$[index_mu][l])
+ * @param w8   Input: Legendre quadrature weights (w8[index_mu])
+ * @param mu_start Input: First quadrature point
+ * @param nmu  Input: Number of quadrature points (mu_start<=index_mu<mu_start+nmu)
+ * @param ple  Input/output: Pointer to the lensing structure
+ * @return the error status
+ */
+
+int lensing_lensed_cl_all(
+                          double *ksi,
+                          double *ksiX,
+                          double *ksip,
+                          double *ksim,
+                          double **d00,
+                          double **d20,
+                          double **d22,
+                          double **d2m2,
+                          double *w8,
+                          int mu_start,
+                          int nmu,
+                          struct lensing * ple
+                          ) {
+
+  short has_pol;
+  int imu,imu_start,imu_end;
+  int index_l,index_l_start,index_l_end,l;
+  double cle,clte,clp,clm;
+  double * w8_ksi;  /* w8_ksi[imu]: products of the weights with the correlation functions at index_mu=mu_start+imu */
+  double * w8_ksiX;
+  double * w8_ksip;
+  double * w8_ksim;
+
+  has_pol = ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) ? _TRUE_ : _FALSE_;
+
+  class_alloc(w8_ksi,4*nmu*sizeof(double),ple->error_message);
+  w8_ksiX = w8_ksi+nmu;
+  w8_ksip = w8_ksi+2*nmu;
+  w8_ksim = w8_ksi+3*nmu;
+
+  for (imu=0; imu<nmu; imu++) {
+    if (ple->has_tt == _TRUE_)
+      w8_ksi[imu] = w8[mu_start+imu]*ksi[mu_start+imu];
+    if (ple->has_te == _TRUE_)
+      w8_ksiX[imu] = w8[mu_start+imu]*ksiX[mu_start+imu];
+    if (has_pol == _TRUE_) {
+      w8_ksip[imu] = w8[mu_start+imu]*ksip[mu_start+imu];
+      w8_ksim[imu] = w8[mu_start+imu]*ksim[mu_start+imu];
+    }
+  }
+
+  /** Integration by Gauss-Legendre quadrature. **/
+#pragma omp parallel for                                                \
+  private (index_l_start,index_l_end,index_l,l,imu_start,imu_end,imu,cle,clte,clp,clm) \
+  schedule (static)
+
+  for (index_l_start=0; index_l_start<ple->l_size; index_l_start+=_LENSING_L_TILE_) {
+
+    index_l_end = MIN(index_l_start+_LENSING_L_TILE_,ple->l_size);
+
+    for (imu_start=0; imu_start<nmu; imu_start+=_LENSING_MU_TILE_) {
+
+      imu_end = MIN(imu_start+_LENSING_MU_TILE_,nmu);
+
+      for (index_l=index_l_start; index_l<index_l_end; index_l++) {
+
+        l = (int)ple->l[index_l];
+
+        if (ple->has_tt == _TRUE_) {
+          cle = 0.;
+#pragma omp simd reduction(+:cle)
+          for (imu=imu_start; imu<imu_end; imu++)
+            cle += w8_ksi[imu]*d00[mu_start+imu][l];
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt] += cle;
+        }
+
+        if (ple->has_te == _TRUE_) {
+          clte = 0.;
+#pragma omp simd reduction(+:clte)
+          for (imu=imu_start; imu<imu_end; imu++)
+            clte += w8_ksiX[imu]*d20[mu_start+imu][l];
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te] += clte;
+        }
+
+        if (has_pol == _TRUE_) {
+          clp = 0.;
+          clm = 0.;
+#pragma omp simd reduction(+:clp,clm)
+          for (imu=imu_start; imu<imu_end; imu++) {
+            clp += w8_ksip[imu]*d22[mu_start+imu][l];
+            clm += w8_ksim[imu]*d2m2[mu_start+imu][l];
+          }
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee] += clp;
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb] += clm;
+        }
+      }
+    }
   }
 
+  free(w8_ksi);
+
   return _SUCCESS_;
 }
 
@@ -1230,6 +912,2106 @@ int lensing_addback_cl_ee_bb(
 
 }
 
+/**
+ * This routine computes the lensed power spectra with quadratures
+ * over \f$ \mu \f$: Gauss-Legendre quadrature of the full lensed
+ * correlation functions in accurate mode, or Riemann sum of their
+ * difference with the unlensed ones on \f$ [0,\pi/16] \f$ in fast
+ * mode. On output, ple->cl_lens contains the un-normalised sums
+ * accumulated by lensing_lensed_cl_tt(), lensing_lensed_cl_te(),
+ * lensing_lensed_cl_ee_bb().
+ *
+ * @param ppr   Input: pointer to precision structure
+ * @param ple   Input/output: pointer to the lensing structure
+ * @param cl_tt Input: unlensed \f$ C_l^{TT}\f$ (cl_tt[l])
+ * @param cl_te Input: unlensed \f$ C_l^{TE}\f$ (only if ple->has_te)
+ * @param cl_ee Input: unlensed \f$ C_l^{EE}\f$ (only if ple->has_ee or ple->has_bb)
+ * @param cl_bb Input: unlensed \f$ C_l^{BB}\f$ (only if ple->has_ee or ple->has_bb)
+ * @param cl_pp Input: lensing potential \f$ C_l^{\phi\phi}\f$
+ * @return the error status
+ */
+
+int lensing_lensed_cl_quadrature(
+                                 struct precision * ppr,
+                                 struct lensing * ple,
+                                 double * cl_tt,
+                                 double * cl_te,
+                                 double * cl_ee,
+                                 double * cl_bb,
+                                 double * cl_pp
+                                 ) {
+
+  /** Summary: */
+  /** - Define local variables */
+
+  double * mu; /* mu[index_mu]: discretized values of mu
+                  between -1 and 1, roots of Legendre polynomial */
+  double * w8; /* Corresponding Gauss-Legendre quadrature weights */
+  double theta,delta_theta;
+
+  double ** d00;  /* dmn[index_mu][index_l] */
+  double ** d11;
+  double ** d2m2;
+  double ** d22 = NULL;
+  double ** d20 = NULL;
+  double ** d1m1;
+  double ** d31 = NULL;
+  double ** d40 = NULL;
+  double ** d3m1 = NULL;
+  double ** d3m3 = NULL;
+  double ** d4m2 = NULL;
+  double ** d4m4 = NULL;
+  double * buf_dxx; /* buffer */
+
+  double * Cgl;   /* Cgl[index_mu] */
+  double * Cgl2;  /* Cgl2[index_mu] */
+  double * sigma2; /* sigma[index_mu] */
+
+  double * ksi = NULL;  /* ksi[index_mu] */
+  double * ksiX = NULL;  /* ksiX[index_mu] */
+  double * ksip = NULL;  /* ksip[index_mu] */
+  double * ksim = NULL;  /* ksim[index_mu] */
+
+  double fac,fac1;
+  double X_000;
+  double X_p000;
+  double X_220;
+  double X_022;
+  double X_p022;
+  double X_121;
+  double X_132;
+  double X_242;
+
+  int num_mu,index_mu,icount;
+  int mu_block_size,mu_start,mu_size;
+  int first_te_table,first_ee_table;
+  int l;
+  double ll;
+
+  double res,resX,lens;
+  double resp, resm, lensp, lensm;
+
+  double * sqrt1;
+  double * sqrt2;
+  double * sqrt3;
+  double * sqrt4;
+  double * sqrt5;
+
+  /* Timing */
+  //double debut, fin;
+  //double cpu_time;
+
+  /** - put all precision variables hare; will be stored later in precision structure */
+  /** - Last element in \f$ \mu \f$ will be for \f$ \mu=1 \f$, needed for sigma2.
+      The rest will be chosen as roots of a Gauss-Legendre quadrature **/
+
+  if (ppr->accurate_lensing == _TRUE_) {
+    num_mu=(ple->l_unlensed_max+ppr->num_mu_minus_lmax); /* Must be even ?? CHECK */
+    num_mu += num_mu%2; /* Force it to be even */
+  } else {
+    /* Integrate correlation function difference on [0,pi/16] */
+    num_mu = (ple->l_unlensed_max * 2 )/16;
+  }
+  /** - allocate array of \f$ \mu \f$ values, as well as quadrature weights */
+
+  class_alloc(mu,
+              num_mu*sizeof(double),
+              ple->error_message);
+  /* Reserve last element of mu for mu=1, needed for sigma2 */
+  mu[num_mu-1] = 1.0;
+
+  class_alloc(w8,
+              (num_mu-1)*sizeof(double),
+              ple->error_message);
+
+  if (ppr->accurate_lensing == _TRUE_) {
+
+    //debut = omp_get_wtime();
+    class_call(quadrature_gauss_legendre(mu,
+                                         w8,
+                                         num_mu-1,
+                                         ppr->tol_gauss_legendre,
+                                         ple->error_message),
+               ple->error_message,
+               ple->error_message);
+    //fin = omp_get_wtime();
+    //cpu_time = (fin-debut);
+    //printf("time in quadrature_gauss_legendre=%4.3f s\n",cpu_time);
+
+  } else { /* Crude integration on [0,pi/16]: Riemann sum on theta */
+
+    delta_theta = _PI_/16. / (double)(num_mu-1);
+    for (index_mu=0;index_mu<num_mu-1;index_mu++) {
+      theta = (index_mu+1)*delta_theta;
+      mu[index_mu] = cos(theta);
+      w8[index_mu] = sin(theta)*delta_theta; /* We integrate on mu */
+    }
+  }
+
+  /** - Allocate tables for \f$ d^l_{mm'} (\mu) \f$. They are computed
+      by blocks of at most mu_block_size values of \f$ \mu \f$ (see the
+      precision parameter lensing_mu_block_size), so that only
+      mu_block_size*(l_unlensed_max+1) values per table are held in
+      memory at a time. The arrays of pointers d00[index_mu], etc. have
+      num_mu elements, but only those of the current block point to
+      allocated rows. */
+
+  if ((ppr->lensing_mu_block_size > 0) && (ppr->lensing_mu_block_size < num_mu-1))
+    mu_block_size = ppr->lensing_mu_block_size;
+  else
+    mu_block_size = num_mu-1;
+
+  icount = 0;
+  class_alloc(d00,
+              num_mu*sizeof(double*),
+              ple->error_message);
+
+  class_alloc(d11,
+              num_mu*sizeof(double*),
+              ple->error_message);
+
+  class_alloc(d1m1,
+              num_mu*sizeof(double*),
+              ple->error_message);
+
+  class_alloc(d2m2,
+              num_mu*sizeof(double*),
+              ple->error_message);
+  icount += 4*mu_block_size*(ple->l_unlensed_max+1);
+
+  if (ple->has_te==_TRUE_) {
+
+    class_alloc(d20,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d3m1,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d4m2,
+                num_mu*sizeof(double*),
+                ple->error_message);
+    icount += 3*mu_block_size*(ple->l_unlensed_max+1);
+  }
+
+  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+
+    class_alloc(d22,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d31,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d3m3,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d40,
+                num_mu*sizeof(double*),
+                ple->error_message);
+
+    class_alloc(d4m4,
+                num_mu*sizeof(double*),
+                ple->error_message);
+    icount += 5*mu_block_size*(ple->l_unlensed_max+1);
+  }
+
+  icount += 5*(ple->l_unlensed_max+1); /* for arrays sqrt1[l] to sqrt5[l] */
+
+  /** - Allocate main contiguous buffer **/
+  class_alloc(buf_dxx,
+              icount * sizeof(double),
+              ple->error_message);
+
+  icount = 5*(ple->l_unlensed_max+1);
+
+  /* position of the first TE and EE/BB tables in each block */
+  first_te_table = 4;
+  first_ee_table = (ple->has_te==_TRUE_) ? 7 : 4;
+
+  sqrt1 = &(buf_dxx[0]);
+  sqrt2 = &(buf_dxx[ple->l_unlensed_max+1]);
+  sqrt3 = &(buf_dxx[2*(ple->l_unlensed_max+1)]);
+  sqrt4 = &(buf_dxx[3*(ple->l_unlensed_max+1)]);
+  sqrt5 = &(buf_dxx[4*(ple->l_unlensed_max+1)]);
+
+  /** - compute \f$ Cgl(\mu)\f$, \f$ Cgl2(\mu) \f$ and sigma2(\f$\mu\f$) */
+
+  class_alloc(Cgl,
+              num_mu*sizeof(double),
+              ple->error_message);
+
+  class_alloc(Cgl2,
+              num_mu*sizeof(double),
+              ple->error_message);
+
+  class_alloc(sigma2,
+              (num_mu-1)*sizeof(double), /* Zero separation is omitted */
+              ple->error_message);
+
+  /** - Compute Cgl(\f$\mu=1\f$), needed by sigma2\f$(\mu)\f$ in all blocks. At \f$\mu=1\f$,
+      \f$ d^l_{1-1} \f$ vanishes, and so does Cgl2. **/
+
+  d11[num_mu-1] = &(buf_dxx[icount]);
+  class_call(lensing_d11(&(mu[num_mu-1]),1,ple->l_unlensed_max,&(d11[num_mu-1])),
+             ple->error_message,
+             ple->error_message);
+
+  Cgl[num_mu-1]=0;
+  for (l=2; l<=ple->l_unlensed_max; l++) {
+    Cgl[num_mu-1] += (2.*l+1.)*l*(l+1.)*
+      cl_pp[l]*d11[num_mu-1][l];
+  }
+  Cgl[num_mu-1] /= 4.*_PI_;
+  Cgl2[num_mu-1]=0.;
+
+  /** - allocate ksi, ksi+, ksi-, ksiX */
+
+  /** - --> ksi is for TT **/
+  if (ple->has_tt==_TRUE_) {
+
+    class_calloc(ksi,
+                 (num_mu-1),
+                 sizeof(double),
+                 ple->error_message);
+  }
+
+  /** - --> ksiX is for TE **/
+  if (ple->has_te==_TRUE_) {
+
+    class_calloc(ksiX,
+                 (num_mu-1),
+                 sizeof(double),
+                 ple->error_message);
+  }
+
+  /** - --> ksip, ksim for EE, BB **/
+  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+
+    class_calloc(ksip,
+                 (num_mu-1),
+                 sizeof(double),
+                 ple->error_message);
+
+    class_calloc(ksim,
+                 (num_mu-1),
+                 sizeof(double),
+                 ple->error_message);
+  }
+
+  for (l=2;l<=ple->l_unlensed_max;l++) {
+
+    ll = (double)l;
+    sqrt1[l]=sqrt((ll+2)*(ll+1)*ll*(ll-1));
+    sqrt2[l]=sqrt((ll+2)*(ll-1));
+    sqrt3[l]=sqrt((ll+3)*(ll-2));
+    sqrt4[l]=sqrt((ll+4)*(ll+3)*(ll-2.)*(ll-3));
+    sqrt5[l]=sqrt(ll*(ll+1));
+  }
+
+
+  /** - Reset the lensed \f$ C_l\f$'s, which will be accumulated block by block */
+
+  class_call(lensing_lensed_cl_reset(ple),
+             ple->error_message,
+             ple->error_message);
+
+  /** - Loop over blocks of \f$ \mu \f$ values */
+
+  for (mu_start=0; mu_start<num_mu-1; mu_start+=mu_block_size) {
+
+    mu_size = MIN(mu_block_size,num_mu-1-mu_start);
+
+    /** - --> point the rows of the current block to the buffer */
+    for (index_mu=0; index_mu<mu_size; index_mu++) {
+      d00[mu_start+index_mu] = &(buf_dxx[icount+index_mu             * (ple->l_unlensed_max+1)]);
+      d11[mu_start+index_mu] = &(buf_dxx[icount+(index_mu+mu_size)   * (ple->l_unlensed_max+1)]);
+      d1m1[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+2*mu_size) * (ple->l_unlensed_max+1)]);
+      d2m2[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+3*mu_size) * (ple->l_unlensed_max+1)]);
+      if (ple->has_te==_TRUE_) {
+        d20[mu_start+index_mu] = &(buf_dxx[icount+(index_mu+first_te_table*mu_size) * (ple->l_unlensed_max+1)]);
+        d3m1[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+(1+first_te_table)*mu_size) * (ple->l_unlensed_max+1)]);
+        d4m2[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+(2+first_te_table)*mu_size) * (ple->l_unlensed_max+1)]);
+      }
+      if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+        d22[mu_start+index_mu] = &(buf_dxx[icount+(index_mu+first_ee_table*mu_size) * (ple->l_unlensed_max+1)]);
+        d31[mu_start+index_mu] = &(buf_dxx[icount+(index_mu+(1+first_ee_table)*mu_size) * (ple->l_unlensed_max+1)]);
+        d3m3[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+(2+first_ee_table)*mu_size) * (ple->l_unlensed_max+1)]);
+        d40[mu_start+index_mu] = &(buf_dxx[icount+(index_mu+(3+first_ee_table)*mu_size) * (ple->l_unlensed_max+1)]);
+        d4m4[mu_start+index_mu]= &(buf_dxx[icount+(index_mu+(4+first_ee_table)*mu_size) * (ple->l_unlensed_max+1)]);
+      }
+    }
+
+    /** - --> compute \f$ d^l_{mm'} (\mu) \f$ in the current block */
+    class_call(lensing_d00(mu+mu_start,mu_size,ple->l_unlensed_max,d00+mu_start),
+               ple->error_message,
+               ple->error_message);
+
+    class_call(lensing_d11(mu+mu_start,mu_size,ple->l_unlensed_max,d11+mu_start),
+               ple->error_message,
+               ple->error_message);
+
+    class_call(lensing_d1m1(mu+mu_start,mu_size,ple->l_unlensed_max,d1m1+mu_start),
+               ple->error_message,
+               ple->error_message);
+
+    class_call(lensing_d2m2(mu+mu_start,mu_size,ple->l_unlensed_max,d2m2+mu_start),
+               ple->error_message,
+               ple->error_message);
+
+    if (ple->has_te==_TRUE_) {
+
+      class_call(lensing_d20(mu+mu_start,mu_size,ple->l_unlensed_max,d20+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d3m1(mu+mu_start,mu_size,ple->l_unlensed_max,d3m1+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d4m2(mu+mu_start,mu_size,ple->l_unlensed_max,d4m2+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+    }
+
+    if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+
+      class_call(lensing_d22(mu+mu_start,mu_size,ple->l_unlensed_max,d22+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d31(mu+mu_start,mu_size,ple->l_unlensed_max,d31+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d3m3(mu+mu_start,mu_size,ple->l_unlensed_max,d3m3+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d40(mu+mu_start,mu_size,ple->l_unlensed_max,d40+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+
+      class_call(lensing_d4m4(mu+mu_start,mu_size,ple->l_unlensed_max,d4m4+mu_start),
+                 ple->error_message,
+                 ple->error_message);
+    }
+
+    /** - --> compute Cgl(\f$\mu\f$), Cgl2(\f$\mu\f$) and sigma2(\f$\mu\f$) in the current block */
+
+#pragma omp parallel for                        \
+  private (index_mu,l)                          \
+  schedule (static)
+    for (index_mu=mu_start; index_mu<mu_start+mu_size; index_mu++) {
+
+      Cgl[index_mu]=0;
+      Cgl2[index_mu]=0;
+
+      for (l=2; l<=ple->l_unlensed_max; l++) {
+
+        Cgl[index_mu] += (2.*l+1.)*l*(l+1.)*
+          cl_pp[l]*d11[index_mu][l];
+
+        Cgl2[index_mu] += (2.*l+1.)*l*(l+1.)*
+          cl_pp[l]*d1m1[index_mu][l];
+
+      }
+
+      Cgl[index_mu] /= 4.*_PI_;
+      Cgl2[index_mu] /= 4.*_PI_;
+
+      /* Cgl(1.0) - Cgl(mu) */
+      sigma2[index_mu] = Cgl[num_mu-1] - Cgl[index_mu];
+    }
+
+    /** - --> compute ksi, ksi+, ksi-, ksiX in the current block */
+
+  #pragma omp parallel for                                                \
+    private (index_mu,l,ll,res,resX,resp,resm,lens,lensp,lensm,           \
+             fac,fac1,X_000,X_p000,X_220,X_022,X_p022,X_121,X_132,X_242)	\
+    schedule (static)
+
+    for (index_mu=mu_start;index_mu<mu_start+mu_size;index_mu++) {
+
+      for (l=2;l<=ple->l_unlensed_max;l++) {
+
+        ll = (double)l;
+
+        fac = ll*(ll+1)/4.;
+        fac1 = (2*ll+1)/(4.*_PI_);
+
+        /* In the following we will keep terms of the form (sigma2)^k*(Cgl2)^m
+           with k+m <= 2 */
+
+        X_000 = exp(-fac*sigma2[index_mu]);
+        X_p000 = -fac*X_000;
+        /* X_220 = 0.25*sqrt1[l] * exp(-(fac-0.5)*sigma2[index_mu]); */
+        X_220 = 0.25*sqrt1[l] * X_000; /* Order 0 */
+        /* next 5 lines useless, but avoid compiler warning 'may be used uninitialized' */
+        X_242=0.;
+        X_132=0.;
+        X_121=0.;
+        X_p022=0.;
+        X_022=0.;
+
+        if (ple->has_te==_TRUE_ || ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+          /* X_022 = exp(-(fac-1.)*sigma2[index_mu]); */
+          X_022 = X_000 * (1+sigma2[index_mu]*(1+0.5*sigma2[index_mu])); /* Order 2 */
+          X_p022 = -(fac-1.)*X_022; /* Old versions were missing the
+                                       minus sign in this line, which introduced a very small error
+                                       on the high-l C_l^TE lensed spectrum [credits for bug fix:
+                                       Selim Hotinli] */
+
+          /* X_242 = 0.25*sqrt4[l] * exp(-(fac-5./2.)*sigma2[index_mu]); */
+          X_242 = 0.25*sqrt4[l] * X_000; /* Order 0 */
+          if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+
+            /* X_121 = - 0.5*sqrt2[l] * exp(-(fac-2./3.)*sigma2[index_mu]);
+               X_132 = - 0.5*sqrt3[l] * exp(-(fac-5./3.)*sigma2[index_mu]); */
+            X_121 = -0.5*sqrt2[l] * X_000 * (1+2./3.*sigma2[index_mu]); /* Order 1 */
+            X_132 = -0.5*sqrt3[l] * X_000 * (1+5./3.*sigma2[index_mu]); /* Order 1 */
+          }
+        }
+
+
+        if (ple->has_tt==_TRUE_) {
+
+          res = fac1*cl_tt[l];
+
+          lens = (X_000*X_000*d00[index_mu][l] +
+                  X_p000*X_p000*d1m1[index_mu][l]
+                  *Cgl2[index_mu]*8./(ll*(ll+1)) +
+                  (X_p000*X_p000*d00[index_mu][l] +
+                   X_220*X_220*d2m2[index_mu][l])
+                  *Cgl2[index_mu]*Cgl2[index_mu]);
+          if (ppr->accurate_lensing == _FALSE_) {
+            /* Remove unlensed correlation function */
+            lens -= d00[index_mu][l];
+          }
+          res *= lens;
+          ksi[index_mu] += res;
+        }
+
+        if (ple->has_te==_TRUE_) {
+
+          resX = fac1*cl_te[l];
+
+
+          lens = ( X_022*X_000*d20[index_mu][l] +
+                   Cgl2[index_mu]*2.*X_p000/sqrt5[l] *
+                   (X_121*d11[index_mu][l] + X_132*d3m1[index_mu][l]) +
+                   0.5 * Cgl2[index_mu] * Cgl2[index_mu] *
+                   ( ( 2.*X_p022*X_p000+X_220*X_220 ) *
+                     d20[index_mu][l] + X_220*X_242*d4m2[index_mu][l] ) );
+          if (ppr->accurate_lensing == _FALSE_) {
+            lens -= d20[index_mu][l];
+          }
+          resX *= lens;
+          ksiX[index_mu] += resX;
+        }
+
+        if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+
+          resp = fac1*(cl_ee[l]+cl_bb[l]);
+          resm = fac1*(cl_ee[l]-cl_bb[l]);
+
+          lensp = ( X_022*X_022*d22[index_mu][l] +
+                    2.*Cgl2[index_mu]*X_132*X_121*d31[index_mu][l] +
+                    Cgl2[index_mu]*Cgl2[index_mu] *
+                    ( X_p022*X_p022*d22[index_mu][l] +
+                      X_242*X_220*d40[index_mu][l] ) );
+
+          lensm = ( X_022*X_022*d2m2[index_mu][l] +
+                    Cgl2[index_mu] *
+                    ( X_121*X_121*d1m1[index_mu][l] +
+                      X_132*X_132*d3m3[index_mu][l] ) +
+                    0.5 * Cgl2[index_mu] * Cgl2[index_mu] *
+                    ( 2.*X_p022*X_p022*d2m2[index_mu][l] +
+                      X_220*X_220*d00[index_mu][l] +
+                      X_242*X_242*d4m4[index_mu][l] ) );
+          if (ppr->accurate_lensing == _FALSE_) {
+            lensp -= d22[index_mu][l];
+            lensm -= d2m2[index_mu][l];
+          }
+          resp *= lensp;
+          resm *= lensm;
+          ksip[index_mu] += resp;
+          ksim[index_mu] += resm;
+        }
+      }
+    }
+
+    /** - --> add the contribution of the current block to the lensed \f$ C_l\f$'s */
+
+    class_call(lensing_lensed_cl_all(ksi,ksiX,ksip,ksim,d00,d20,d22,d2m2,w8,mu_start,mu_size,ple),
+               ple->error_message,
+               ple->error_message);
+  }
+
+  /** - Free lots of stuff **/
+  free(buf_dxx);
+
+  free(d00);
+  free(d11);
+  free(d1m1);
+  free(d2m2);
+  if (ple->has_te==_TRUE_) {
+    free(d20);
+    free(d3m1);
+    free(d4m2);
+  }
+  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+    free(d22);
+    free(d31);
+    free(d3m3);
+    free(d40);
+    free(d4m4);
+  }
+
+  if (ple->has_tt==_TRUE_)
+    free(ksi);
+  if (ple->has_te==_TRUE_)
+    free(ksiX);
+  if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
+    free(ksip);
+    free(ksim);
+  }
+  free(Cgl);
+  free(Cgl2);
+  free(sigma2);
+
+  free(mu);
+  free(w8);
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine computes the lensed power spectra with fast transforms,
+ * as an alternative to lensing_lensed_cl_quadrature() for large
+ * l_max (used when the precision parameter lensing_fft_transforms is
+ * set). On output, ple->cl_lens contains the same un-normalised sums
+ * as after lensing_lensed_cl_tt(), lensing_lensed_cl_te(),
+ * lensing_lensed_cl_ee_bb() in fast mode: only
+ * the lensing correction to the correlation functions is integrated,
+ * up to the angle lensing_fft_theta_max, and the unlensed spectra are
+ * added back later.
+ *
+ * Below the multipole lensing_fft_l_switch, the sums over l and the
+ * integrals over angles use the exact Wigner d-functions. Above it,
+ * they use the Bessel approximation
+ * \f$ d^l_{mn}(\theta) \simeq \sqrt{\theta/\sin\theta} J_{m-n}(L\theta) \f$
+ * with \f$ L^2=(l+1/2)^2+[1/4-(m-n)^2]/3-mn \f$ (this choice cancels
+ * the terms of order \f$ \theta^0 \f$ in the difference between
+ * the differential equations satisfied by both sides, and the
+ * approximation is accurate to \f$ {\cal O}(l^{-2}) \f$), and the
+ * sums over l become integrals over L.
+ * On logarithmic grids of L and \f$ \theta \f$ with the same step,
+ * the kernels only depend on the sum of the two indices, and all
+ * transforms are discrete correlations computed by FFT. The Gaussian
+ * factor \f$ \exp[-l(l+1)\sigma^2(\theta)/2] \f$ of the lensed
+ * correlation functions does not factorize; it is written as
+ * \f$ \exp(\sigma^2/8)\exp[-(L\theta)^2 v(\theta)] \f$ with a slowly
+ * varying \f$ v(\theta)=\sigma^2/(2\theta^2) \f$, and interpolated in
+ * \f$ \ln v \f$ between lensing_fft_v_nodes Chebyshev nodes, each
+ * of them giving a kernel of \f$ L\theta \f$ only.
+ *
+ * @param ppr   Input: pointer to precision structure
+ * @param ple   Input/output: pointer to the lensing structure
+ * @param cl_tt Input: unlensed \f$ C_l^{TT}\f$ (cl_tt[l], only if ple->has_tt)
+ * @param cl_te Input: unlensed \f$ C_l^{TE}\f$ (only if ple->has_te)
+ * @param cl_ee Input: unlensed \f$ C_l^{EE}\f$ (only if ple->has_ee or ple->has_bb)
+ * @param cl_bb Input: unlensed \f$ C_l^{BB}\f$ (only if ple->has_ee or ple->has_bb)
+ * @param cl_pp Input: lensing potential \f$ C_l^{\phi\phi}\f$
+ * @return the error status
+ */
+
+int lensing_lensed_cl_fft(
+                          struct precision * ppr,
+                          struct lensing * ple,
+                          double * cl_tt,
+                          double * cl_te,
+                          double * cl_ee,
+                          double * cl_bb,
+                          double * cl_pp
+                          ) {
+
+  int lmax,l_switch,l,index_l;
+  int num_L,num_theta,num_x,num_fft,num_out,num_v,num_terms,num_kernels;
+  int index_L,index_theta,index_x,index_nu,index_term,index_term2,index_ksi,index_d,index_v,index_v2,index_kernel;
+  int theta_block_size,theta_start,theta_size;
+  double L_max,theta_max,dlog,trapezoid,weight,cl,q,a,X2,y,y_min,y_max,sum,expfac,v,l_shifted;
+
+  double * L;             /* L[index_L]: values of l+1/2 on a logarithmic grid */
+  double * theta;         /* theta[index_theta]: angles on a logarithmic grid with the same step */
+  double * mu;            /* cos(theta) */
+  double * bessel_factor; /* sqrt(theta/sin(theta)) */
+  double * x;             /* x[index_L+index_theta] = L[index_L]*theta[index_theta] */
+  double ** jnu;          /* jnu[index_nu][index_x] = J_{2 index_nu}(x) */
+  double ** spectrum_jnu; /* discrete Fourier transform of jnu[index_nu] */
+  double ** spectrum_kernel; /* same for the damped kernels at a given node in v */
+  double * twiddle;       /* twiddle factors of the FFTs */
+  double * work;          /* workspace of the FFTs */
+  double * kernel1;
+  double * kernel2;
+  double * out1;
+  double * out2;
+
+  double * blend;         /* blend[l]: weight of the exact sums for l<l_switch */
+  double * coef_pp;       /* coef_pp[l]: weight of the exact sums for sigma2, Cgl2 */
+  double * a_pp;          /* a_pp[index_L]: weight of the integrals for sigma2 */
+  double * a_pp2;         /* a_pp2[index_L]: weight of the integrals for Cgl2 */
+  double * spectrum_pp;
+  double * spectrum_pp2;
+  double * sigma2;        /* sigma2[index_theta] */
+  double * Cgl2;          /* Cgl2[index_theta] */
+
+  double ** coef_low;     /* coef_low[index_term][l]: weight of the exact sums for each term */
+  double ** a_high;       /* a_high[index_term][index_L]: weight of the integrals for each term */
+  double ** spectrum_high;
+  double ** a_theta;      /* a_theta[index_term][index_theta]: angular factor of each term */
+  double ** H;            /* H[index_term][index_theta]: integral for each term, interpolated in v */
+  double ** U;            /* U[index_term][index_theta]: unlensed integral of leading terms */
+  double ** ksi;          /* ksi[index_ksi][index_theta]: lensing correction to correlation functions */
+  double * b;             /* b[index_ksi*num_theta+index_theta]: weights of the integrals over theta */
+
+  double * y_v;           /* y_v[index_v]: Chebyshev nodes in ln(v) */
+  double * w_v;           /* barycentric weights of the nodes */
+  double ** lambda;       /* lambda[index_v][index_theta]: interpolation weights of the nodes */
+
+  double * l_high;        /* l_high[index_L] = L[index_L]-1/2 */
+  double * cl_high;       /* cl_high[index_L*fft_ksi_size+index_ksi]: integrals over theta for l>=l_switch */
+  double * ddcl_high;
+  double cl_fft[fft_ksi_size];
+  double cl_interpolated[fft_ksi_size];
+  int last_index_ksi[fft_ksi_size];
+
+  double *** d;           /* d[index_d][index_theta][l] for l<l_switch, by blocks of theta */
+  double * buf_d;
+
+  double * mu_large;      /* Gauss-Legendre nodes in mu for theta>theta_max */
+  double * w8_large;      /* corresponding weights */
+  double ** coef_large;   /* coef_large[index_term][l]: weight of the sums over all l for each term */
+  double * coef_pp_large; /* coef_pp_large[l]: weight of the sums over all l for sigma2, Cgl2 */
+  double *** d_large;     /* d_large[index_d][index_mu][l] for all l, by blocks of mu */
+  double * buf_d_large;
+  double sigma2_large,Cgl2_large,X2_step,X2_ratio,unlensed;
+  double a_node[_LENSING_FFT_TERMS_];
+  double ksi_node[fft_ksi_size];
+  double * ksi_large[fft_ksi_size]; /* ksi_large[index_ksi][index_mu]: lensed correlation functions for theta>theta_max */
+  int abort;
+  double * overlap_diagonal[fft_ksi_size]; /* overlap_diagonal[index_ksi][l]: integral of (d^l)^2 for theta>theta_max */
+  double mu_overlap[5];
+  short has_d_overlap[fft_d_size];
+  double theta_step,d_l,dd_l,d_l2,dd_l2,overlap;
+  int index_l2;
+  /* leading term of each correlation function */
+  int lead_of_ksi[fft_ksi_size] = {0,4,10,14};
+  int num_mu_large,num_mu_beyond,num_mu_strip,mu_block_size,mu_start,mu_size,index_mu;
+  short has_d[fft_d_size];
+  short has_d_cgl[fft_d_size];
+  short has_d_large[fft_d_size];
+  short has_ksi[fft_ksi_size];
+  short has_kernel[10];
+  int kernel_list[10];
+
+  int term_list[_LENSING_FFT_TERMS_];
+  int term_ksi[_LENSING_FFT_TERMS_];
+  int term_d[_LENSING_FFT_TERMS_];
+  short term_leading[_LENSING_FFT_TERMS_];
+  int term_kernel[_LENSING_FFT_TERMS_];
+
+  /* for each d-function d_mn: order m-n of the Bessel function approximating it, and
+     product mn; d-function used in the integral over theta for each correlation function */
+  int nu_of_d[fft_d_size] = {0,0,2,4,2,4,6,0,2,6,4,8};
+  int mn_of_d[fft_d_size] = {0,1,-1,-4,0,-3,-8,4,3,-9,0,-16};
+  int d_of_ksi[fft_ksi_size] = {fft_d00,fft_d20,fft_d22,fft_d2m2};
+  double shift_of_d[fft_d_size]; /* shift of L^2 in the Bessel approximation */
+
+  /** Summary: */
+
+  /** - check precision parameters and define the grids */
+
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    shift_of_d[index_d] = (0.25-nu_of_d[index_d]*nu_of_d[index_d])/3.-mn_of_d[index_d];
+
+  lmax = ple->l_unlensed_max;
+  l_switch = ppr->lensing_fft_l_switch;
+  theta_max = ppr->lensing_fft_theta_max;
+
+  class_test((l_switch < 8) || (l_switch > lmax),
+             ple->error_message,
+             "lensing_fft_l_switch=%d should be between 8 and l_max=%d",l_switch,lmax);
+
+  class_test((theta_max <= 0.) || (theta_max > _PI_/2.),
+             ple->error_message,
+             "lensing_fft_theta_max=%e should be between 0 and pi/2",theta_max);
+
+  class_test((ppr->lensing_fft_taper <= 0.) || (ppr->lensing_fft_taper > 1.),
+             ple->error_message,
+             "lensing_fft_taper=%e should be between 0 and 1",ppr->lensing_fft_taper);
+
+  class_test((ppr->lensing_fft_sampling <= 0.) || (ppr->lensing_fft_x_min <= 0.),
+             ple->error_message,
+             "lensing_fft_sampling=%e and lensing_fft_x_min=%e should be positive",
+             ppr->lensing_fft_sampling,ppr->lensing_fft_x_min);
+
+  class_test(ppr->lensing_fft_v_nodes < 2,
+             ple->error_message,
+             "lensing_fft_v_nodes=%d should be at least 2",ppr->lensing_fft_v_nodes);
+
+  /* The grid of L ends at l_max+1, just above the last multipole
+     l_max+1/2, and starts below l_switch/2+1/2, where the integrals
+     have zero weight. The grid of theta ends at theta_max. The step
+     is small enough for resolving the oscillations of all kernels
+     J(L theta) in log(L) and log(theta). */
+
+  L_max = lmax+1.;
+  dlog = _PI_/(ppr->lensing_fft_sampling*L_max*theta_max);
+  num_L = (int)ceil(log(L_max/(l_switch/2+0.5))/dlog)+1;
+  num_theta = (int)ceil(log(theta_max*L_max/ppr->lensing_fft_x_min)/dlog)+1;
+  num_x = num_L+num_theta-1;
+  num_fft = fft_size(num_x);
+  num_out = MAX(num_L,num_theta);
+
+  if (ple->lensing_verbose > 1)
+    printf(" -> FFT transforms of size %d (%d multipoles, %d angles)\n",num_fft,num_L,num_theta);
+
+  class_alloc(L,num_L*sizeof(double),ple->error_message);
+  class_alloc(l_high,num_L*sizeof(double),ple->error_message);
+  class_alloc(theta,num_theta*sizeof(double),ple->error_message);
+  class_alloc(mu,num_theta*sizeof(double),ple->error_message);
+  class_alloc(bessel_factor,num_theta*sizeof(double),ple->error_message);
+  class_alloc(x,num_x*sizeof(double),ple->error_message);
+
+  for (index_L=0; index_L<num_L; index_L++) {
+    L[index_L] = L_max*exp(-(num_L-1-index_L)*dlog);
+    l_high[index_L] = L[index_L]-0.5;
+  }
+
+  for (index_theta=0; index_theta<num_theta; index_theta++) {
+    theta[index_theta] = theta_max*exp(-(num_theta-1-index_theta)*dlog);
+    mu[index_theta] = cos(theta[index_theta]);
+    bessel_factor[index_theta] = sqrt(theta[index_theta]/sin(theta[index_theta]));
+  }
+
+  for (index_x=0; index_x<num_x; index_x++)
+    x[index_x] = L[0]*theta[0]*exp(index_x*dlog);
+
+  /** - tabulate the Bessel functions \f$ J_{2n}(x) \f$ for n=0...4, and
+      compute their discrete Fourier transforms */
+
+  class_alloc(twiddle,num_fft*sizeof(double),ple->error_message);
+  class_call(fft_twiddle_init(twiddle,num_fft,ple->error_message),
+             ple->error_message,
+             ple->error_message);
+
+  class_alloc(work,2*num_fft*sizeof(double),ple->error_message);
+  class_alloc(kernel1,num_x*sizeof(double),ple->error_message);
+  class_alloc(kernel2,num_x*sizeof(double),ple->error_message);
+  class_alloc(out1,num_out*sizeof(double),ple->error_message);
+  class_alloc(out2,num_out*sizeof(double),ple->error_message);
+
+  class_alloc(jnu,5*sizeof(double*),ple->error_message);
+  class_alloc(spectrum_jnu,5*sizeof(double*),ple->error_message);
+
+  for (index_nu=0; index_nu<5; index_nu++) {
+    class_alloc(jnu[index_nu],num_x*sizeof(double),ple->error_message);
+    class_alloc(spectrum_jnu[index_nu],2*num_fft*sizeof(double),ple->error_message);
+    for (index_x=0; index_x<num_x; index_x++)
+      jnu[index_nu][index_x] = jn(2*index_nu,x[index_x]);
+  }
+
+  for (index_nu=0; index_nu<4; index_nu+=2) {
+    lensing_fft_spectra(jnu[index_nu],jnu[index_nu+1],num_x,twiddle,num_fft,work,spectrum_jnu[index_nu],spectrum_jnu[index_nu+1]);
+  }
+  lensing_fft_spectra(jnu[4],NULL,num_x,twiddle,num_fft,work,spectrum_jnu[4],NULL);
+
+  /** - list the terms of the correlation functions that we need, and
+      the kernel used for each of them in the integrals over L:
+      \f$ e^{-v x^2} J_\nu(x) \f$, or \f$ (e^{-v x^2}-1) J_\nu(x) \f$
+      for the leading terms from which the unlensed part is removed */
+
+  has_ksi[fft_ksi] = ple->has_tt;
+  has_ksi[fft_ksiX] = ple->has_te;
+  has_ksi[fft_ksip] = ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) ? _TRUE_ : _FALSE_;
+  has_ksi[fft_ksim] = has_ksi[fft_ksip];
+
+  for (index_d=0; index_d<fft_d_size; index_d++) {
+    has_d[index_d] = _FALSE_;
+    has_d_cgl[index_d] = _FALSE_;
+  }
+  has_d_cgl[fft_d11] = _TRUE_;
+  has_d_cgl[fft_d1m1] = _TRUE_;
+
+  for (index_kernel=0; index_kernel<10; index_kernel++)
+    has_kernel[index_kernel] = _FALSE_;
+
+  num_terms = 0;
+  for (index_term=0; index_term<_LENSING_FFT_TERMS_; index_term++) {
+    class_call(lensing_fft_term(index_term,2.,0.,0.,
+                                &(term_ksi[index_term]),&(term_d[index_term]),&(term_leading[index_term]),&q,&a),
+               ple->error_message,
+               ple->error_message);
+    if (has_ksi[term_ksi[index_term]] == _TRUE_) {
+      term_list[num_terms] = index_term;
+      num_terms++;
+      has_d[term_d[index_term]] = _TRUE_;
+      term_kernel[index_term] = nu_of_d[term_d[index_term]]/2 + 5*term_leading[index_term];
+      has_kernel[term_kernel[index_term]] = _TRUE_;
+    }
+  }
+
+  /** - weights of the sums over l: exact sums with weight blend(l)
+      below l_switch (coef_low), integrals over L with weight
+      1-blend(l) (a_high, on which we take discrete Fourier
+      transforms). Since \f$ L dL = (l+1/2) dl \f$, the integrand
+      at a given L is that of the sums at the multipole l_shifted
+      such that \f$ (l+1/2)^2 = L^2-\delta \f$, where \f$ \delta \f$
+      is the shift of \f$ L^2 \f$ for the d-function of each term */
+
+  class_alloc(blend,l_switch*sizeof(double),ple->error_message);
+  class_alloc(coef_pp,l_switch*sizeof(double),ple->error_message);
+  class_alloc(a_pp,num_L*sizeof(double),ple->error_message);
+  class_alloc(a_pp2,num_L*sizeof(double),ple->error_message);
+  class_alloc(spectrum_pp,2*num_fft*sizeof(double),ple->error_message);
+  class_alloc(spectrum_pp2,2*num_fft*sizeof(double),ple->error_message);
+
+  for (l=2; l<l_switch; l++) {
+    blend[l] = lensing_fft_blend(l,l_switch);
+    coef_pp[l] = blend[l]*(2.*l+1.)/(4.*_PI_)*l*(l+1.)*cl_pp[l];
+  }
+
+  for (index_L=0; index_L<num_L; index_L++) {
+    trapezoid = (index_L == num_L-1) ? 0.5 : 1.;
+
+    l_shifted = sqrt(L[index_L]*L[index_L]-shift_of_d[fft_d11])-0.5;
+    weight = trapezoid*dlog*L[index_L]*L[index_L]/(2.*_PI_)*(1.-lensing_fft_blend(l_shifted,l_switch));
+    if (weight > 0.)
+      a_pp[index_L] = weight*l_shifted*(l_shifted+1.)*lensing_fft_cl_at_l(cl_pp,lmax,l_shifted);
+    else
+      a_pp[index_L] = 0.;
+
+    l_shifted = sqrt(L[index_L]*L[index_L]-shift_of_d[fft_d1m1])-0.5;
+    weight = trapezoid*dlog*L[index_L]*L[index_L]/(2.*_PI_)*(1.-lensing_fft_blend(l_shifted,l_switch));
+    if (weight > 0.)
+      a_pp2[index_L] = weight*l_shifted*(l_shifted+1.)*lensing_fft_cl_at_l(cl_pp,lmax,l_shifted);
+    else
+      a_pp2[index_L] = 0.;
+  }
+
+  lensing_fft_spectra(a_pp,a_pp2,num_L,twiddle,num_fft,work,spectrum_pp,spectrum_pp2);
+
+  class_alloc(coef_low,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+  class_alloc(a_high,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+  class_alloc(spectrum_high,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+
+  for (index_term2=0; index_term2<num_terms; index_term2++) {
+
+    index_term = term_list[index_term2];
+
+    class_alloc(coef_low[index_term],l_switch*sizeof(double),ple->error_message);
+    class_alloc(a_high[index_term],num_L*sizeof(double),ple->error_message);
+    class_alloc(spectrum_high[index_term],2*num_fft*sizeof(double),ple->error_message);
+
+    for (l=2; l<l_switch; l++) {
+
+      class_call(lensing_fft_term(index_term,l,0.,0.,&index_ksi,&index_d,&(term_leading[index_term]),&q,&a),
+                 ple->error_message,
+                 ple->error_message);
+
+      switch (index_ksi) {
+      case fft_ksi:
+        cl = cl_tt[l];
+        break;
+      case fft_ksiX:
+        cl = cl_te[l];
+        break;
+      case fft_ksip:
+        cl = cl_ee[l]+cl_bb[l];
+        break;
+      default:
+        cl = cl_ee[l]-cl_bb[l];
+      }
+
+      coef_low[index_term][l] = blend[l]*(2.*l+1.)/(4.*_PI_)*cl*q;
+    }
+
+    for (index_L=0; index_L<num_L; index_L++) {
+
+      trapezoid = (index_L == num_L-1) ? 0.5 : 1.;
+      l_shifted = sqrt(L[index_L]*L[index_L]-shift_of_d[term_d[index_term]])-0.5;
+      weight = trapezoid*dlog*L[index_L]*L[index_L]/(2.*_PI_)*(1.-lensing_fft_blend(l_shifted,l_switch));
+
+      if (weight > 0.) {
+
+        class_call(lensing_fft_term(index_term,l_shifted,0.,0.,&index_ksi,&index_d,&(term_leading[index_term]),&q,&a),
+                   ple->error_message,
+                   ple->error_message);
+
+        switch (index_ksi) {
+        case fft_ksi:
+          cl = lensing_fft_cl_at_l(cl_tt,lmax,l_shifted);
+          break;
+        case fft_ksiX:
+          cl = lensing_fft_cl_at_l(cl_te,lmax,l_shifted);
+          break;
+        case fft_ksip:
+          cl = lensing_fft_cl_at_l(cl_ee,lmax,l_shifted)+lensing_fft_cl_at_l(cl_bb,lmax,l_shifted);
+          break;
+        default:
+          cl = lensing_fft_cl_at_l(cl_ee,lmax,l_shifted)-lensing_fft_cl_at_l(cl_bb,lmax,l_shifted);
+        }
+
+        a_high[index_term][index_L] = weight*cl*q;
+      }
+      else {
+        a_high[index_term][index_L] = 0.;
+      }
+    }
+  }
+
+  for (index_term2=0; index_term2<num_terms; index_term2+=2) {
+    if (index_term2+1 < num_terms)
+      lensing_fft_spectra(a_high[term_list[index_term2]],a_high[term_list[index_term2+1]],num_L,twiddle,num_fft,work,
+                          spectrum_high[term_list[index_term2]],spectrum_high[term_list[index_term2+1]]);
+    else
+      lensing_fft_spectra(a_high[term_list[index_term2]],NULL,num_L,twiddle,num_fft,work,
+                          spectrum_high[term_list[index_term2]],NULL);
+  }
+
+  /** - allocate the Wigner d-functions for l<l_switch, computed by
+      blocks of theta values like in lensing_lensed_cl_quadrature() */
+
+  if ((ppr->lensing_mu_block_size > 0) && (ppr->lensing_mu_block_size < num_theta))
+    theta_block_size = ppr->lensing_mu_block_size;
+  else
+    theta_block_size = num_theta;
+
+  class_alloc(d,fft_d_size*sizeof(double**),ple->error_message);
+  class_alloc(buf_d,fft_d_size*theta_block_size*l_switch*sizeof(double),ple->error_message);
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    class_alloc(d[index_d],num_theta*sizeof(double*),ple->error_message);
+
+  /** - compute sigma2(theta) and Cgl2(theta): exact sums over l<l_switch
+      by blocks of theta, and integrals over L of the approximations
+      \f$ 1-d^l_{11} \simeq (1-J_0) + (1-\sqrt{\theta/\sin\theta})J_0 \f$
+      and \f$ d^l_{1-1} \simeq \sqrt{\theta/\sin\theta} J_2 \f$ */
+
+  class_calloc(sigma2,num_theta,sizeof(double),ple->error_message);
+  class_calloc(Cgl2,num_theta,sizeof(double),ple->error_message);
+
+  for (theta_start=0; theta_start<num_theta; theta_start+=theta_block_size) {
+
+    theta_size = MIN(theta_block_size,num_theta-theta_start);
+
+    class_call(lensing_fft_wigner_d(mu+theta_start,theta_size,l_switch-1,has_d_cgl,d,theta_start,buf_d,theta_block_size,ple->error_message),
+               ple->error_message,
+               ple->error_message);
+
+    for (index_theta=theta_start; index_theta<theta_start+theta_size; index_theta++) {
+      for (l=2; l<l_switch; l++) {
+        sigma2[index_theta] += coef_pp[l]*(1.-d[fft_d11][index_theta][l]);
+        Cgl2[index_theta] += coef_pp[l]*d[fft_d1m1][index_theta][l];
+      }
+    }
+  }
+
+  for (index_x=0; index_x<num_x; index_x++) {
+    if (x[index_x] < 1.e-3)
+      kernel1[index_x] = x[index_x]*x[index_x]/4.*(1.-x[index_x]*x[index_x]/16.);
+    else
+      kernel1[index_x] = 1.-jnu[0][index_x];
+  }
+
+  num_kernels = 0;
+  class_alloc(spectrum_kernel,10*sizeof(double*),ple->error_message);
+  for (index_kernel=0; index_kernel<10; index_kernel++) {
+    if (has_kernel[index_kernel] == _TRUE_) {
+      kernel_list[num_kernels] = index_kernel;
+      num_kernels++;
+    }
+    if ((has_kernel[index_kernel] == _TRUE_) || (index_kernel == 0))
+      class_alloc(spectrum_kernel[index_kernel],2*num_fft*sizeof(double),ple->error_message);
+  }
+
+  lensing_fft_spectra(kernel1,NULL,num_x,twiddle,num_fft,work,spectrum_kernel[0],NULL);
+
+  lensing_fft_correlate(spectrum_pp,spectrum_kernel[0],spectrum_pp,spectrum_jnu[0],twiddle,num_fft,work,out1,out2,num_theta);
+
+  for (index_theta=0; index_theta<num_theta; index_theta++)
+    sigma2[index_theta] += out1[index_theta] + (1.-bessel_factor[index_theta])*out2[index_theta];
+
+  lensing_fft_correlate(spectrum_pp2,spectrum_jnu[1],NULL,NULL,twiddle,num_fft,work,out1,NULL,num_theta);
+
+  for (index_theta=0; index_theta<num_theta; index_theta++)
+    Cgl2[index_theta] += bessel_factor[index_theta]*out1[index_theta];
+
+  /** - angular factor of each term, and interpolation weights of the
+      Chebyshev nodes in \f$ y=\ln v \f$ */
+
+  class_alloc(a_theta,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+  for (index_term2=0; index_term2<num_terms; index_term2++) {
+    index_term = term_list[index_term2];
+    class_alloc(a_theta[index_term],num_theta*sizeof(double),ple->error_message);
+    for (index_theta=0; index_theta<num_theta; index_theta++) {
+      class_call(lensing_fft_term(index_term,2.,sigma2[index_theta],Cgl2[index_theta],
+                                  &index_ksi,&index_d,&(term_leading[index_term]),&q,&(a_theta[index_term][index_theta])),
+                 ple->error_message,
+                 ple->error_message);
+    }
+  }
+
+  y_min = 0.;
+  y_max = 0.;
+  for (index_theta=0; index_theta<num_theta; index_theta++) {
+    class_test(sigma2[index_theta] <= 0.,
+               ple->error_message,
+               "sigma2=%e should be positive at theta=%e",sigma2[index_theta],theta[index_theta]);
+    y = log(sigma2[index_theta]/2./theta[index_theta]/theta[index_theta]);
+    if ((index_theta == 0) || (y < y_min))
+      y_min = y;
+    if ((index_theta == 0) || (y > y_max))
+      y_max = y;
+  }
+
+  num_v = ppr->lensing_fft_v_nodes;
+  class_alloc(y_v,num_v*sizeof(double),ple->error_message);
+  class_alloc(w_v,num_v*sizeof(double),ple->error_message);
+  class_alloc(lambda,num_v*sizeof(double*),ple->error_message);
+
+  for (index_v=0; index_v<num_v; index_v++) {
+    y_v[index_v] = 0.5*(y_max+y_min)+0.5*(y_max-y_min)*cos(_PI_*index_v/(num_v-1));
+    w_v[index_v] = ((index_v%2 == 0) ? 1. : -1.) * (((index_v == 0) || (index_v == num_v-1)) ? 0.5 : 1.);
+    class_alloc(lambda[index_v],num_theta*sizeof(double),ple->error_message);
+  }
+
+  for (index_theta=0; index_theta<num_theta; index_theta++) {
+    y = log(sigma2[index_theta]/2./theta[index_theta]/theta[index_theta]);
+    /* barycentric Lagrange interpolation, exact at the nodes */
+    for (index_v=0; index_v<num_v; index_v++) {
+      if (y == y_v[index_v])
+        break;
+    }
+    if (index_v < num_v) {
+      for (index_v2=0; index_v2<num_v; index_v2++)
+        lambda[index_v2][index_theta] = (index_v2 == index_v) ? 1. : 0.;
+    }
+    else {
+      sum = 0.;
+      for (index_v=0; index_v<num_v; index_v++) {
+        lambda[index_v][index_theta] = w_v[index_v]/(y-y_v[index_v]);
+        sum += lambda[index_v][index_theta];
+      }
+      for (index_v=0; index_v<num_v; index_v++)
+        lambda[index_v][index_theta] /= sum;
+    }
+  }
+
+  /** - integrals over L of each term: unlensed integral for the
+      leading terms, and integrals with the damped kernels at each
+      node in v, interpolated at v(theta) */
+
+  class_alloc(H,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+  class_alloc(U,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+
+  for (index_term2=0; index_term2<num_terms; index_term2++) {
+    index_term = term_list[index_term2];
+    class_calloc(H[index_term],num_theta,sizeof(double),ple->error_message);
+    if (term_leading[index_term] == _TRUE_) {
+      class_alloc(U[index_term],num_theta*sizeof(double),ple->error_message);
+      lensing_fft_correlate(spectrum_high[index_term],spectrum_jnu[nu_of_d[term_d[index_term]]/2],NULL,NULL,
+                            twiddle,num_fft,work,U[index_term],NULL,num_theta);
+    }
+  }
+
+  for (index_v=0; index_v<num_v; index_v++) {
+
+    v = exp(y_v[index_v]);
+
+    /* discrete Fourier transforms of the kernels needed at this node, by pairs */
+    for (index_kernel=0; index_kernel<num_kernels; index_kernel+=2) {
+      for (index_x=0; index_x<num_x; index_x++) {
+        kernel1[index_x] = lensing_fft_damping(kernel_list[index_kernel],v*x[index_x]*x[index_x])
+          *jnu[kernel_list[index_kernel]%5][index_x];
+        if (index_kernel+1 < num_kernels)
+          kernel2[index_x] = lensing_fft_damping(kernel_list[index_kernel+1],v*x[index_x]*x[index_x])
+            *jnu[kernel_list[index_kernel+1]%5][index_x];
+      }
+      lensing_fft_spectra(kernel1,
+                          (index_kernel+1 < num_kernels) ? kernel2 : NULL,
+                          num_x,twiddle,num_fft,work,
+                          spectrum_kernel[kernel_list[index_kernel]],
+                          (index_kernel+1 < num_kernels) ? spectrum_kernel[kernel_list[index_kernel+1]] : NULL);
+    }
+
+    /* correlations, by pairs of terms */
+    for (index_term2=0; index_term2<num_terms; index_term2+=2) {
+      index_term = term_list[index_term2];
+      if (index_term2+1 < num_terms) {
+        lensing_fft_correlate(spectrum_high[index_term],spectrum_kernel[term_kernel[index_term]],
+                              spectrum_high[term_list[index_term2+1]],spectrum_kernel[term_kernel[term_list[index_term2+1]]],
+                              twiddle,num_fft,work,out1,out2,num_theta);
+        for (index_theta=0; index_theta<num_theta; index_theta++) {
+          H[index_term][index_theta] += lambda[index_v][index_theta]*out1[index_theta];
+          H[term_list[index_term2+1]][index_theta] += lambda[index_v][index_theta]*out2[index_theta];
+        }
+      }
+      else {
+        lensing_fft_correlate(spectrum_high[index_term],spectrum_kernel[term_kernel[index_term]],NULL,NULL,
+                              twiddle,num_fft,work,out1,NULL,num_theta);
+        for (index_theta=0; index_theta<num_theta; index_theta++)
+          H[index_term][index_theta] += lambda[index_v][index_theta]*out1[index_theta];
+      }
+    }
+  }
+
+  /** - lensing correction to the correlation functions from the
+      integrals over L */
+
+  class_alloc(ksi,fft_ksi_size*sizeof(double*),ple->error_message);
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++)
+    class_calloc(ksi[index_ksi],num_theta,sizeof(double),ple->error_message);
+
+  for (index_theta=0; index_theta<num_theta; index_theta++) {
+    for (index_term2=0; index_term2<num_terms; index_term2++) {
+      index_term = term_list[index_term2];
+      /* Gaussian factor exp[-l(l+1) sigma2/2] = expfac exp[-(L theta)^2 v] */
+      expfac = exp((0.25+shift_of_d[term_d[index_term]])*sigma2[index_theta]/2.);
+      a = a_theta[index_term][index_theta]*expfac;
+      ksi[term_ksi[index_term]][index_theta] += bessel_factor[index_theta]*a*H[index_term][index_theta];
+      if (term_leading[index_term] == _TRUE_)
+        ksi[term_ksi[index_term]][index_theta] += bessel_factor[index_theta]*(a-1.)*U[index_term][index_theta];
+    }
+  }
+
+  /** - by blocks of theta, add the exact sums over l<l_switch to the
+      correlation functions, and compute the integrals over theta
+      for l<l_switch with the exact d-functions. Like for larger
+      multipoles, the correlation functions are tapered to zero at
+      theta_max: they oscillate with the frequency l_max, and the
+      trapezoidal rule would have an error of order
+      \f$ (l_{max} \delta\theta)^2 \f$ at a sharp cut, biasing the
+      low-l B modes by a few percent for l_max=2000. The complement
+      of the taper is integrated below at the nodes of a
+      Gauss-Legendre quadrature. */
+
+  class_call(lensing_lensed_cl_reset(ple),
+             ple->error_message,
+             ple->error_message);
+
+  for (theta_start=0; theta_start<num_theta; theta_start+=theta_block_size) {
+
+    theta_size = MIN(theta_block_size,num_theta-theta_start);
+
+    class_call(lensing_fft_wigner_d(mu+theta_start,theta_size,l_switch-1,has_d,d,theta_start,buf_d,theta_block_size,ple->error_message),
+               ple->error_message,
+               ple->error_message);
+
+    for (index_theta=theta_start; index_theta<theta_start+theta_size; index_theta++) {
+      for (l=2; l<l_switch; l++) {
+        X2 = exp(-l*(l+1.)*sigma2[index_theta]/2.);
+        for (index_term2=0; index_term2<num_terms; index_term2++) {
+          index_term = term_list[index_term2];
+          ksi[term_ksi[index_term]][index_theta] += coef_low[index_term][l]
+            *(a_theta[index_term][index_theta]*X2-(double)term_leading[index_term])
+            *d[term_d[index_term]][index_theta][l];
+        }
+      }
+    }
+
+    for (index_l=0; index_l<ple->l_size; index_l++) {
+
+      l = (int)ple->l[index_l];
+      if (l >= l_switch)
+        break;
+
+      for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+        cl_fft[index_ksi] = 0.;
+        if (has_ksi[index_ksi] == _FALSE_)
+          continue;
+        for (index_theta=theta_start; index_theta<theta_start+theta_size; index_theta++) {
+          trapezoid = ((index_theta == 0) || (index_theta == num_theta-1)) ? 0.5 : 1.;
+          cl_fft[index_ksi] += trapezoid*dlog*theta[index_theta]*sin(theta[index_theta])
+            *ksi[index_ksi][index_theta]*d[d_of_ksi[index_ksi]][index_theta][l]
+            *lensing_fft_taper(theta[index_theta],ppr->lensing_fft_taper*theta_max,theta_max);
+        }
+      }
+
+      if (ple->has_tt == _TRUE_)
+        ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt] += cl_fft[fft_ksi];
+      if (ple->has_te == _TRUE_)
+        ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te] += cl_fft[fft_ksiX];
+      if ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) {
+        ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee] += cl_fft[fft_ksip];
+        ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb] += cl_fft[fft_ksim];
+      }
+    }
+  }
+
+  /** - lensing correction at angles larger than theta_max, only
+      relevant for l<l_switch (for larger multipoles, the sums over l
+      of these smooth functions of l cancel out). The lensed
+      correlation functions are computed with exact sums over all
+      multipoles at the nodes of a Gauss-Legendre quadrature on
+      \f$ -1 \leq \mu \leq \cos\theta_{max} \f$, by blocks of
+      \f$ \mu \f$ values. The residual oscillations of frequency
+      l_max, from the sharp cut of the spectra, are only partially
+      damped by the lensing: the number of nodes is at least
+      (l_max+l_switch)/2, for which the quadrature of polynomials of
+      degree l_max+l_switch is exact (with fewer nodes, the low-l B
+      modes are off by a few permille). The unlensed
+      correlation functions are computed below with overlap integrals
+      of d-functions instead.
+      The same sums give the lensing correction to the correlation
+      functions on the strip where they are tapered, integrated with
+      the complementary weight at the nodes of a second Gauss-Legendre
+      quadrature on \f$ \cos\theta_{max} \leq \mu \leq \cos\theta_{taper} \f$,
+      with enough nodes for resolving the oscillations of frequency
+      l_max. */
+
+  num_mu_beyond = MAX(ppr->lensing_fft_num_mu_large,(lmax+l_switch)/2+1);
+  if (ppr->lensing_fft_taper < 1.)
+    num_mu_strip = (int)(lmax*(1.-ppr->lensing_fft_taper)*theta_max)+l_switch;
+  else
+    num_mu_strip = 0;
+  num_mu_large = num_mu_beyond+num_mu_strip;
+
+  class_alloc(mu_large,num_mu_large*sizeof(double),ple->error_message);
+  class_alloc(w8_large,num_mu_large*sizeof(double),ple->error_message);
+
+  class_call(quadrature_gauss_legendre(mu_large,
+                                       w8_large,
+                                       num_mu_beyond,
+                                       ppr->tol_gauss_legendre,
+                                       ple->error_message),
+             ple->error_message,
+             ple->error_message);
+
+  for (index_mu=0; index_mu<num_mu_beyond; index_mu++) {
+    mu_large[index_mu] = -1.+0.5*(mu_large[index_mu]+1.)*(1.+cos(theta_max));
+    w8_large[index_mu] *= 0.5*(1.+cos(theta_max));
+  }
+
+  if (num_mu_strip > 0) {
+
+    class_call(quadrature_gauss_legendre(mu_large+num_mu_beyond,
+                                         w8_large+num_mu_beyond,
+                                         num_mu_strip,
+                                         ppr->tol_gauss_legendre,
+                                         ple->error_message),
+               ple->error_message,
+               ple->error_message);
+
+    for (index_mu=num_mu_beyond; index_mu<num_mu_large; index_mu++) {
+      mu_large[index_mu] = cos(theta_max)+0.5*(mu_large[index_mu]+1.)
+        *(cos(ppr->lensing_fft_taper*theta_max)-cos(theta_max));
+      w8_large[index_mu] *= 0.5*(cos(ppr->lensing_fft_taper*theta_max)-cos(theta_max))
+        *(1.-lensing_fft_taper(acos(mu_large[index_mu]),ppr->lensing_fft_taper*theta_max,theta_max));
+    }
+  }
+
+  class_alloc(coef_pp_large,(lmax+1)*sizeof(double),ple->error_message);
+  for (l=2; l<=lmax; l++)
+    coef_pp_large[l] = (2.*l+1.)/(4.*_PI_)*l*(l+1.)*cl_pp[l];
+
+  class_alloc(coef_large,_LENSING_FFT_TERMS_*sizeof(double*),ple->error_message);
+  for (index_term2=0; index_term2<num_terms; index_term2++) {
+    index_term = term_list[index_term2];
+    class_alloc(coef_large[index_term],(lmax+1)*sizeof(double),ple->error_message);
+    for (l=2; l<=lmax; l++) {
+      class_call(lensing_fft_term(index_term,l,0.,0.,&index_ksi,&index_d,&(term_leading[index_term]),&q,&a),
+                 ple->error_message,
+                 ple->error_message);
+      switch (index_ksi) {
+      case fft_ksi:
+        cl = cl_tt[l];
+        break;
+      case fft_ksiX:
+        cl = cl_te[l];
+        break;
+      case fft_ksip:
+        cl = cl_ee[l]+cl_bb[l];
+        break;
+      default:
+        cl = cl_ee[l]-cl_bb[l];
+      }
+      coef_large[index_term][l] = (2.*l+1.)/(4.*_PI_)*cl*q;
+    }
+  }
+
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+    class_calloc(overlap_diagonal[index_ksi],l_switch,sizeof(double),ple->error_message);
+    class_calloc(ksi_large[index_ksi],num_mu_large,sizeof(double),ple->error_message);
+  }
+
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    has_d_large[index_d] = ((has_d[index_d] == _TRUE_) || (has_d_cgl[index_d] == _TRUE_)) ? _TRUE_ : _FALSE_;
+
+  if ((ppr->lensing_mu_block_size > 0) && (ppr->lensing_mu_block_size < num_mu_large))
+    mu_block_size = ppr->lensing_mu_block_size;
+  else
+    mu_block_size = num_mu_large;
+
+  class_alloc(d_large,fft_d_size*sizeof(double**),ple->error_message);
+  class_alloc(buf_d_large,fft_d_size*mu_block_size*(lmax+1)*sizeof(double),ple->error_message);
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    class_alloc(d_large[index_d],num_mu_large*sizeof(double*),ple->error_message);
+
+  for (mu_start=0; mu_start<num_mu_large; mu_start+=mu_block_size) {
+
+    mu_size = MIN(mu_block_size,num_mu_large-mu_start);
+
+    class_call(lensing_fft_wigner_d(mu_large+mu_start,mu_size,lmax,has_d_large,d_large,mu_start,buf_d_large,mu_block_size,ple->error_message),
+               ple->error_message,
+               ple->error_message);
+
+    abort = _FALSE_;
+
+#pragma omp parallel for                                                \
+  private (index_mu,l,index_term2,index_term,index_ksi,index_d,q,       \
+           sigma2_large,Cgl2_large,X2,X2_step,X2_ratio,unlensed,a_node,ksi_node) \
+  schedule (static)
+
+    for (index_mu=mu_start; index_mu<mu_start+mu_size; index_mu++) {
+
+      sigma2_large = 0.;
+      Cgl2_large = 0.;
+      for (l=2; l<=lmax; l++) {
+        sigma2_large += coef_pp_large[l]*(1.-d_large[fft_d11][index_mu][l]);
+        Cgl2_large += coef_pp_large[l]*d_large[fft_d1m1][index_mu][l];
+      }
+
+      for (index_term2=0; index_term2<num_terms; index_term2++) {
+        index_term = term_list[index_term2];
+        class_call_parallel(lensing_fft_term(index_term,2.,sigma2_large,Cgl2_large,&index_ksi,&index_d,
+                                             &(term_leading[index_term]),&q,&(a_node[index_term])),
+                            ple->error_message,
+                            ple->error_message);
+      }
+
+      for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++)
+        ksi_node[index_ksi] = 0.;
+
+      /* on the strip below theta_max, lensing correction only */
+      unlensed = (index_mu < num_mu_beyond) ? 0. : 1.;
+
+      /* exp[-l(l+1) sigma2/2] by recurrence over l */
+      X2 = exp(-3.*sigma2_large);
+      X2_step = X2;
+      X2_ratio = exp(-sigma2_large);
+
+      for (l=2; l<=lmax; l++) {
+        for (index_term2=0; index_term2<num_terms; index_term2++) {
+          index_term = term_list[index_term2];
+          ksi_node[term_ksi[index_term]] += coef_large[index_term][l]
+            *(a_node[index_term]*X2-unlensed*(double)term_leading[index_term])
+            *d_large[term_d[index_term]][index_mu][l];
+        }
+        X2 *= X2_step;
+        X2_step *= X2_ratio;
+      }
+
+      for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++)
+        ksi_large[index_ksi][index_mu] = ksi_node[index_ksi];
+    }
+
+    if (abort == _TRUE_) return _FAILURE_;
+
+    for (index_mu=mu_start; index_mu<mu_start+mu_size; index_mu++) {
+
+      for (l=2; (l<l_switch) && (index_mu<num_mu_beyond); l++) {
+        for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+          if (has_ksi[index_ksi] == _TRUE_)
+            overlap_diagonal[index_ksi][l] += w8_large[index_mu]
+              *d_large[d_of_ksi[index_ksi]][index_mu][l]*d_large[d_of_ksi[index_ksi]][index_mu][l];
+        }
+      }
+
+      for (index_l=0; index_l<ple->l_size; index_l++) {
+
+        l = (int)ple->l[index_l];
+        if (l >= l_switch)
+          break;
+
+        if (ple->has_tt == _TRUE_)
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt] += w8_large[index_mu]*ksi_large[fft_ksi][index_mu]*d_large[fft_d00][index_mu][l];
+        if (ple->has_te == _TRUE_)
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te] += w8_large[index_mu]*ksi_large[fft_ksiX][index_mu]*d_large[fft_d20][index_mu][l];
+        if ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) {
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee] += w8_large[index_mu]*ksi_large[fft_ksip][index_mu]*d_large[fft_d22][index_mu][l];
+          ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb] += w8_large[index_mu]*ksi_large[fft_ksim][index_mu]*d_large[fft_d2m2][index_mu][l];
+        }
+      }
+    }
+  }
+
+  /** - contribution of the unlensed correlation functions at angles
+      larger than theta_max. For two d-functions with the same m, n,
+      the differential equation satisfied by them gives
+      \f$ \int_{\theta_{max}}^\pi d^{l'} d^l \sin\theta d\theta =
+      \sin\theta_{max} [d^{l'} \partial_\theta d^l - d^l \partial_\theta d^{l'}]_{\theta_{max}}
+      / [l(l+1)-l'(l'+1)] \f$ for \f$ l' \neq l \f$. For \f$ l'=l \f$,
+      the quadrature above is exact. The derivatives are computed
+      with finite differences of step theta_step. */
+
+  theta_step = 1.e-2/lmax;
+  for (index_mu=0; index_mu<5; index_mu++)
+    mu_overlap[index_mu] = cos(theta_max+(index_mu-2)*theta_step);
+
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    has_d_overlap[index_d] = _FALSE_;
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+    if (has_ksi[index_ksi] == _TRUE_)
+      has_d_overlap[d_of_ksi[index_ksi]] = _TRUE_;
+  }
+
+  class_call(lensing_fft_wigner_d(mu_overlap,5,lmax,has_d_overlap,d_large,0,buf_d_large,5,ple->error_message),
+             ple->error_message,
+             ple->error_message);
+
+  for (index_l=0; index_l<ple->l_size; index_l++) {
+
+    l = (int)ple->l[index_l];
+    if (l >= l_switch)
+      break;
+
+    for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+
+      cl_fft[index_ksi] = 0.;
+      if (has_ksi[index_ksi] == _FALSE_)
+        continue;
+
+      index_d = d_of_ksi[index_ksi];
+      d_l = d_large[index_d][2][l];
+      dd_l = (8.*(d_large[index_d][3][l]-d_large[index_d][1][l])-(d_large[index_d][4][l]-d_large[index_d][0][l]))/(12.*theta_step);
+
+      for (index_l2=2; index_l2<=lmax; index_l2++) {
+        if (index_l2 == l) {
+          overlap = overlap_diagonal[index_ksi][l];
+        }
+        else {
+          d_l2 = d_large[index_d][2][index_l2];
+          dd_l2 = (8.*(d_large[index_d][3][index_l2]-d_large[index_d][1][index_l2])
+                   -(d_large[index_d][4][index_l2]-d_large[index_d][0][index_l2]))/(12.*theta_step);
+          overlap = sin(theta_max)*(d_l2*dd_l-d_l*dd_l2)/(l*(l+1.)-index_l2*(index_l2+1.));
+        }
+        cl_fft[index_ksi] -= coef_large[lead_of_ksi[index_ksi]][index_l2]*overlap;
+      }
+    }
+
+    if (ple->has_tt == _TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt] += cl_fft[fft_ksi];
+    if (ple->has_te == _TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te] += cl_fft[fft_ksiX];
+    if ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) {
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee] += cl_fft[fft_ksip];
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb] += cl_fft[fft_ksim];
+    }
+  }
+
+  /** - integrals over theta for l>=l_switch with the Bessel
+      approximation, on the grid of L, and interpolation at each l.
+      The correlation functions are smoothly tapered to zero at
+      theta_max: a sharp cut would leak into all multipoles, like
+      \f$ \xi(\theta_{max})/l^{3/2} \f$, which is larger than the
+      lensed damping tail at high l */
+
+  class_alloc(b,fft_ksi_size*num_theta*sizeof(double),ple->error_message);
+  class_calloc(cl_high,fft_ksi_size*num_L,sizeof(double),ple->error_message);
+  class_alloc(ddcl_high,fft_ksi_size*num_L*sizeof(double),ple->error_message);
+
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+    if (has_ksi[index_ksi] == _FALSE_)
+      continue;
+    for (index_theta=0; index_theta<num_theta; index_theta++) {
+      trapezoid = ((index_theta == 0) || (index_theta == num_theta-1)) ? 0.5 : 1.;
+      b[index_ksi*num_theta+index_theta] = trapezoid*dlog*theta[index_theta]*sin(theta[index_theta])
+        *bessel_factor[index_theta]*ksi[index_ksi][index_theta]
+        *lensing_fft_taper(theta[index_theta],ppr->lensing_fft_taper*theta_max,theta_max);
+    }
+  }
+
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi+=2) {
+
+    if ((has_ksi[index_ksi] == _FALSE_) && (has_ksi[index_ksi+1] == _FALSE_))
+      continue;
+
+    /* the kernel spectra of the last node are not needed anymore */
+    lensing_fft_spectra(b+index_ksi*num_theta,b+(index_ksi+1)*num_theta,num_theta,twiddle,num_fft,work,
+                        spectrum_pp,spectrum_kernel[0]);
+
+    lensing_fft_correlate(spectrum_pp,spectrum_jnu[nu_of_d[d_of_ksi[index_ksi]]/2],
+                          spectrum_kernel[0],spectrum_jnu[nu_of_d[d_of_ksi[index_ksi+1]]/2],
+                          twiddle,num_fft,work,out1,out2,num_L);
+
+    for (index_L=0; index_L<num_L; index_L++) {
+      cl_high[index_L*fft_ksi_size+index_ksi] = out1[index_L];
+      cl_high[index_L*fft_ksi_size+index_ksi+1] = out2[index_L];
+    }
+  }
+
+  class_call(array_spline_table_lines(l_high,
+                                      num_L,
+                                      cl_high,
+                                      fft_ksi_size,
+                                      ddcl_high,
+                                      _SPLINE_EST_DERIV_,
+                                      ple->error_message),
+             ple->error_message,
+             ple->error_message);
+
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++)
+    last_index_ksi[index_ksi] = 0;
+
+  for (index_l=0; index_l<ple->l_size; index_l++) {
+
+    if (ple->l[index_l] < l_switch)
+      continue;
+
+    /* each correlation function is integrated against a different
+       d-function, with its own shift of L^2 */
+    for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+
+      l_shifted = sqrt((ple->l[index_l]+0.5)*(ple->l[index_l]+0.5)+shift_of_d[d_of_ksi[index_ksi]])-0.5;
+
+      class_call(array_interpolate_spline(l_high,
+                                          num_L,
+                                          cl_high,
+                                          ddcl_high,
+                                          fft_ksi_size,
+                                          l_shifted,
+                                          &(last_index_ksi[index_ksi]),
+                                          cl_interpolated,
+                                          fft_ksi_size,
+                                          ple->error_message),
+                 ple->error_message,
+                 ple->error_message);
+
+      cl_fft[index_ksi] = cl_interpolated[index_ksi];
+    }
+
+    if (ple->has_tt == _TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_tt] += cl_fft[fft_ksi];
+    if (ple->has_te == _TRUE_)
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_te] += cl_fft[fft_ksiX];
+    if ((ple->has_ee == _TRUE_) || (ple->has_bb == _TRUE_)) {
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_ee] += cl_fft[fft_ksip];
+      ple->cl_lens[index_l*ple->lt_size+ple->index_lt_bb] += cl_fft[fft_ksim];
+    }
+  }
+
+  /** - free local arrays */
+
+  for (index_term2=0; index_term2<num_terms; index_term2++)
+    free(coef_large[term_list[index_term2]]);
+  free(coef_large);
+  free(coef_pp_large);
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    free(d_large[index_d]);
+  free(d_large);
+  free(buf_d_large);
+  free(mu_large);
+  free(w8_large);
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++) {
+    free(overlap_diagonal[index_ksi]);
+    free(ksi_large[index_ksi]);
+  }
+
+  for (index_ksi=0; index_ksi<fft_ksi_size; index_ksi++)
+    free(ksi[index_ksi]);
+  free(ksi);
+  free(b);
+  free(cl_high);
+  free(ddcl_high);
+
+  for (index_term2=0; index_term2<num_terms; index_term2++) {
+    index_term = term_list[index_term2];
+    free(coef_low[index_term]);
+    free(a_high[index_term]);
+    free(spectrum_high[index_term]);
+    free(a_theta[index_term]);
+    free(H[index_term]);
+    if (term_leading[index_term] == _TRUE_)
+      free(U[index_term]);
+  }
+  free(coef_low);
+  free(a_high);
+  free(spectrum_high);
+  free(a_theta);
+  free(H);
+  free(U);
+
+  for (index_v=0; index_v<num_v; index_v++)
+    free(lambda[index_v]);
+  free(lambda);
+  free(y_v);
+  free(w_v);
+
+  for (index_d=0; index_d<fft_d_size; index_d++)
+    free(d[index_d]);
+  free(d);
+  free(buf_d);
+
+  for (index_kernel=0; index_kernel<10; index_kernel++) {
+    if ((has_kernel[index_kernel] == _TRUE_) || (index_kernel == 0))
+      free(spectrum_kernel[index_kernel]);
+  }
+  free(spectrum_kernel);
+
+  for (index_nu=0; index_nu<5; index_nu++) {
+    free(jnu[index_nu]);
+    free(spectrum_jnu[index_nu]);
+  }
+  free(jnu);
+  free(spectrum_jnu);
+
+  free(sigma2);
+  free(Cgl2);
+  free(blend);
+  free(coef_pp);
+  free(a_pp);
+  free(a_pp2);
+  free(spectrum_pp);
+  free(spectrum_pp2);
+  free(twiddle);
+  free(work);
+  free(kernel1);
+  free(kernel2);
+  free(out1);
+  free(out2);
+  free(L);
+  free(l_high);
+  free(theta);
+  free(mu);
+  free(bessel_factor);
+  free(x);
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine returns one of the terms of the lensed correlation
+ * functions computed in lensing_lensed_cl_quadrature(), in the form used by
+ * lensing_lensed_cl_fft(): the contribution of multipole l to the
+ * correlation function index_ksi reads
+ *
+ * \f$ \frac{2l+1}{4\pi} C_l \, q(l) \, a(\sigma^2, C_{gl,2}) \, e^{-l(l+1)\sigma^2/2} d^l(\theta) \f$
+ *
+ * where \f$ C_l \f$ is \f$ C_l^{TT} \f$, \f$ C_l^{TE} \f$,
+ * \f$ C_l^{EE}+C_l^{BB} \f$ or \f$ C_l^{EE}-C_l^{BB} \f$ and
+ * \f$ d^l \f$ is the Wigner d-function index_d. For leading terms
+ * (the first term of each correlation function) the unlensed
+ * contribution, with \f$ a=1 \f$ and \f$ \sigma^2=0 \f$, is
+ * subtracted.
+ *
+ * @param index_term Input: index of the term, between 0 and _LENSING_FFT_TERMS_-1
+ * @param l          Input: multipole (not necessarily an integer)
+ * @param sigma2     Input: \f$ \sigma^2(\theta) \f$
+ * @param Cgl2       Input: \f$ C_{gl,2}(\theta) \f$
+ * @param index_ksi  Output: correlation function to which the term contributes
+ * @param index_d    Output: Wigner d-function of the term
+ * @param leading    Output: _TRUE_ for leading terms
+ * @param q          Output: factor \f$ q(l) \f$
+ * @param a          Output: factor \f$ a(\sigma^2, C_{gl,2}) \f$
+ * @return the error status
+ */
+
+int lensing_fft_term(
+                     int index_term,
+                     double l,
+                     double sigma2,
+                     double Cgl2,
+                     int * index_ksi,
+                     int * index_d,
+                     short * leading,
+                     double * q,
+                     double * a
+                     ) {
+
+  double fac,s1,s2,s3,s4,s5,E,F,G;
+
+  /* same notations as in lensing_lensed_cl_quadrature() */
+  fac = l*(l+1.)/4.;
+  s1 = sqrt(MAX((l+2.)*(l+1.)*l*(l-1.),0.));
+  s2 = sqrt(MAX((l+2.)*(l-1.),0.));
+  s3 = sqrt(MAX((l+3.)*(l-2.),0.));
+  s4 = sqrt(MAX((l+4.)*(l+3.)*(l-2.)*(l-3.),0.));
+  s5 = sqrt(l*(l+1.));
+  E = 1.+sigma2*(1.+0.5*sigma2);
+  F = 1.+2./3.*sigma2;
+  G = 1.+5./3.*sigma2;
+
+  *leading = _FALSE_;
+
+  switch (index_term) {
+
+    /* TT */
+  case 0:
+    *index_ksi = fft_ksi; *index_d = fft_d00; *leading = _TRUE_;
+    *q = 1.; *a = 1.;
+    break;
+  case 1:
+    *index_ksi = fft_ksi; *index_d = fft_d1m1;
+    *q = l*(l+1.)/16.; *a = 8.*Cgl2;
+    break;
+  case 2:
+    *index_ksi = fft_ksi; *index_d = fft_d00;
+    *q = fac*fac; *a = Cgl2*Cgl2;
+    break;
+  case 3:
+    *index_ksi = fft_ksi; *index_d = fft_d2m2;
+    *q = s1*s1/16.; *a = Cgl2*Cgl2;
+    break;
+
+    /* TE */
+  case 4:
+    *index_ksi = fft_ksiX; *index_d = fft_d20; *leading = _TRUE_;
+    *q = 1.; *a = E;
+    break;
+  case 5:
+    *index_ksi = fft_ksiX; *index_d = fft_d11;
+    *q = fac*s2/s5; *a = Cgl2*F;
+    break;
+  case 6:
+    *index_ksi = fft_ksiX; *index_d = fft_d3m1;
+    *q = fac*s3/s5; *a = Cgl2*G;
+    break;
+  case 7:
+    *index_ksi = fft_ksiX; *index_d = fft_d20;
+    *q = fac*(fac-1.); *a = Cgl2*Cgl2*E;
+    break;
+  case 8:
+    *index_ksi = fft_ksiX; *index_d = fft_d20;
+    *q = s1*s1/16.; *a = 0.5*Cgl2*Cgl2;
+    break;
+  case 9:
+    *index_ksi = fft_ksiX; *index_d = fft_d4m2;
+    *q = s1*s4/16.; *a = 0.5*Cgl2*Cgl2;
+    break;
+
+    /* ksi+ */
+  case 10:
+    *index_ksi = fft_ksip; *index_d = fft_d22; *leading = _TRUE_;
+    *q = 1.; *a = E*E;
+    break;
+  case 11:
+    *index_ksi = fft_ksip; *index_d = fft_d31;
+    *q = 0.25*s2*s3; *a = 2.*Cgl2*F*G;
+    break;
+  case 12:
+    *index_ksi = fft_ksip; *index_d = fft_d22;
+    *q = (fac-1.)*(fac-1.); *a = Cgl2*Cgl2*E*E;
+    break;
+  case 13:
+    *index_ksi = fft_ksip; *index_d = fft_d40;
+    *q = s1*s4/16.; *a = Cgl2*Cgl2;
+    break;
+
+    /* ksi- */
+  case 14:
+    *index_ksi = fft_ksim; *index_d = fft_d2m2; *leading = _TRUE_;
+    *q = 1.; *a = E*E;
+    break;
+  case 15:
+    *index_ksi = fft_ksim; *index_d = fft_d1m1;
+    *q = 0.25*s2*s2; *a = Cgl2*F*F;
+    break;
+  case 16:
+    *index_ksi = fft_ksim; *index_d = fft_d3m3;
+    *q = 0.25*s3*s3; *a = Cgl2*G*G;
+    break;
+  case 17:
+    *index_ksi = fft_ksim; *index_d = fft_d2m2;
+    *q = (fac-1.)*(fac-1.); *a = Cgl2*Cgl2*E*E;
+    break;
+  case 18:
+    *index_ksi = fft_ksim; *index_d = fft_d00;
+    *q = s1*s1/16.; *a = 0.5*Cgl2*Cgl2;
+    break;
+  case 19:
+    *index_ksi = fft_ksim; *index_d = fft_d4m4;
+    *q = s4*s4/16.; *a = 0.5*Cgl2*Cgl2;
+    break;
+
+  default:
+    return _FAILURE_;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Weight of the exact sums over multipoles in
+ * lensing_lensed_cl_fft(): one up to l_switch/2, zero from l_switch,
+ * with a smooth transition in between. The integrals over L have the
+ * complementary weight.
+ *
+ * @param l        Input: multipole (not necessarily an integer)
+ * @param l_switch Input: precision parameter lensing_fft_l_switch
+ * @return the weight
+ */
+
+double lensing_fft_blend(
+                         double l,
+                         int l_switch
+                         ) {
+
+  double t;
+
+  if (l <= 0.5*l_switch)
+    return 1.;
+  if (l >= l_switch)
+    return 0.;
+
+  t = cos(0.5*_PI_*(l-0.5*l_switch)/(0.5*l_switch));
+  return t*t;
+}
+
+/**
+ * Window applied to the lensing correction to the correlation
+ * functions in the integrals over theta of lensing_lensed_cl_fft()
+ * for l>=l_switch: one up to theta_taper, zero from theta_max, with a
+ * smooth transition in between.
+ *
+ * @param theta       Input: angle
+ * @param theta_taper Input: angle where the window starts decreasing
+ * @param theta_max   Input: precision parameter lensing_fft_theta_max
+ * @return the window
+ */
+
+double lensing_fft_taper(
+                         double theta,
+                         double theta_taper,
+                         double theta_max
+                         ) {
+
+  double t;
+
+  if (theta <= theta_taper)
+    return 1.;
+  if (theta >= theta_max)
+    return 0.;
+
+  t = cos(0.5*_PI_*(theta-theta_taper)/(theta_max-theta_taper));
+  return t*t;
+}
+
+/**
+ * Interpolation of a spectrum tabulated at integer multipoles
+ * 2<=l<=lmax at a non-integer multipole, with a cubic Lagrange
+ * polynomial through the four nearest points
+ *
+ * @param cl   Input: spectrum (cl[l])
+ * @param lmax Input: last multipole in the table
+ * @param l    Input: multipole
+ * @return the interpolated spectrum
+ */
+
+double lensing_fft_cl_at_l(
+                           double * cl,
+                           int lmax,
+                           double l
+                           ) {
+
+  int l0,i,j;
+  double result=0.,weight;
+
+  l0 = (int)floor(l)-1;
+  l0 = MAX(l0,2);
+  l0 = MIN(l0,lmax-3);
+
+  for (i=0; i<4; i++) {
+    weight = 1.;
+    for (j=0; j<4; j++) {
+      if (j != i)
+        weight *= (l-(l0+j))/(double)(i-j);
+    }
+    result += weight*cl[l0+i];
+  }
+
+  return result;
+}
+
+/**
+ * Damping factor of the kernels of the integrals over L in
+ * lensing_lensed_cl_fft(): \f$ e^{-v x^2} \f$ for index_kernel<5, and
+ * \f$ e^{-v x^2}-1 \f$ (computed without cancellation) for the
+ * kernels of leading terms, from which the unlensed part is removed
+ *
+ * @param index_kernel Input: index of the kernel
+ * @param vx2          Input: \f$ v x^2 \f$
+ * @return the damping factor
+ */
+
+double lensing_fft_damping(
+                           int index_kernel,
+                           double vx2
+                           ) {
+
+  if (index_kernel < 5)
+    return exp(-vx2);
+  else
+    return expm1(-vx2);
+}
+
+/**
+ * This routine computes the Wigner d-functions flagged in has_d for
+ * a block of \f$ \mu \f$ values, up to lmax. The rows
+ * d[index_d][index_start...index_start+num_mu-1] are pointed to the
+ * buffer, that must contain fft_d_size*block_size*(lmax+1) values.
+ *
+ * @param mu            Input: values of \f$ \mu \f$ in the block
+ * @param num_mu        Input: number of values in the block (at most block_size)
+ * @param lmax          Input: maximum multipole
+ * @param has_d         Input: which d-functions should be computed (has_d[index_d])
+ * @param d             Output: d-functions (d[index_d][index_mu][l])
+ * @param index_start   Input: index of the first value of \f$ \mu \f$ of the block in d[index_d]
+ * @param buffer        Input: buffer for the values of the d-functions
+ * @param block_size    Input: maximum number of values in a block
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int lensing_fft_wigner_d(
+                         double * mu,
+                         int num_mu,
+                         int lmax,
+                         short * has_d,
+                         double *** d,
+                         int index_start,
+                         double * buffer,
+                         int block_size,
+                         ErrorMsg error_message
+                         ) {
+
+  int index_d,index_mu;
+
+  /* same order as in enum lensing_fft_d */
+  int (*wigner_d[fft_d_size])(double*,int,int,double**) = {
+    lensing_d00,lensing_d11,lensing_d1m1,lensing_d2m2,lensing_d20,lensing_d3m1,
+    lensing_d4m2,lensing_d22,lensing_d31,lensing_d3m3,lensing_d40,lensing_d4m4};
+
+  for (index_d=0; index_d<fft_d_size; index_d++) {
+
+    if (has_d[index_d] == _FALSE_)
+      continue;
+
+    for (index_mu=0; index_mu<num_mu; index_mu++)
+      d[index_d][index_start+index_mu] = buffer+(index_d*block_size+index_mu)*(lmax+1);
+
+    class_test(wigner_d[index_d](mu,num_mu,lmax,d[index_d]+index_start) == _FAILURE_,
+               error_message,
+               "could not compute Wigner d-functions");
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Discrete Fourier transforms of one or two real arrays, padded with
+ * zeros to the size of the transform
+ *
+ * @param a1        Input: first array
+ * @param a2        Input: second array (or NULL)
+ * @param n_a       Input: size of the arrays
+ * @param twiddle   Input: twiddle factors for transforms of size n_fft
+ * @param n_fft     Input: size of the transforms
+ * @param work      Input: workspace of 2*n_fft values
+ * @param spectrum1 Output: transform of a1 (2*n_fft values, interleaved real and imaginary parts)
+ * @param spectrum2 Output: transform of a2 (or NULL)
+ * @return the error status
+ */
+
+int lensing_fft_spectra(
+                        double * a1,
+                        double * a2,
+                        int n_a,
+                        double * twiddle,
+                        int n_fft,
+                        double * work,
+                        double * spectrum1,
+                        double * spectrum2
+                        ) {
+
+  int i;
+
+  for (i=0; i<n_fft; i++) {
+    work[2*i] = (i < n_a) ? a1[i] : 0.;
+    work[2*i+1] = ((i < n_a) && (a2 != NULL)) ? a2[i] : 0.;
+  }
+
+  return fft_real_pair(work,twiddle,n_fft,spectrum1,(a2 != NULL) ? spectrum2 : NULL);
+}
+
+/**
+ * Discrete correlations \f$ out_j = \sum_i a_i k_{i+j} \f$ of one or
+ * two pairs of real arrays, from their transforms computed by
+ * lensing_fft_spectra(), with a single inverse transform. The size of
+ * the transforms must be at least the size of a plus the number of
+ * outputs minus one, and k must contain that many values.
+ *
+ * @param spectrum_a1 Input: transform of a for the first correlation
+ * @param spectrum_k1 Input: transform of k for the first correlation
+ * @param spectrum_a2 Input: transform of a for the second correlation (or NULL)
+ * @param spectrum_k2 Input: transform of k for the second correlation (or NULL)
+ * @param twiddle     Input: twiddle factors for transforms of size n_fft
+ * @param n_fft       Input: size of the transforms
+ * @param work        Input: workspace of 2*n_fft values
+ * @param out1        Output: first correlation
+ * @param out2        Output: second correlation (or NULL)
+ * @param n_out       Input: number of outputs
+ * @return the error status
+ */
+
+int lensing_fft_correlate(
+                          double * spectrum_a1,
+                          double * spectrum_k1,
+                          double * spectrum_a2,
+                          double * spectrum_k2,
+                          double * twiddle,
+                          int n_fft,
+                          double * work,
+                          double * out1,
+                          double * out2,
+                          int n_out
+                          ) {
+
+  int k;
+  double p1r,p1i,p2r,p2i;
+
+  /* Z = conj(A1) K1 + i conj(A2) K2: the real and imaginary parts of
+     its inverse transform are the two correlations */
+  for (k=0; k<n_fft; k++) {
+    p1r = spectrum_a1[2*k]*spectrum_k1[2*k]+spectrum_a1[2*k+1]*spectrum_k1[2*k+1];
+    p1i = spectrum_a1[2*k]*spectrum_k1[2*k+1]-spectrum_a1[2*k+1]*spectrum_k1[2*k];
+    if (spectrum_a2 != NULL) {
+      p2r = spectrum_a2[2*k]*spectrum_k2[2*k]+spectrum_a2[2*k+1]*spectrum_k2[2*k+1];
+      p2i = spectrum_a2[2*k]*spectrum_k2[2*k+1]-spectrum_a2[2*k+1]*spectrum_k2[2*k];
+    }
+    else {
+      p2r = 0.;
+      p2i = 0.;
+    }
+    work[2*k] = p1r-p2i;
+    work[2*k+1] = p1i+p2r;
+  }
+
+  fft_complex(work,twiddle,n_fft,1);
+
+  for (k=0; k<n_out; k++) {
+    out1[k] = work[2*k]/n_fft;
+    if (out2 != NULL)
+      out2[k] = work[2*k+1]/n_fft;
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * This routine computes the d00 term
  *
@@ -199,6 +199,16 @@ int output_init(
 
   }
 
+  /** - deal with the profile of the integration of perturbations */
+
+  if (ppt->has_perturbations_profile == _TRUE_ && ppt->has_perturbations) {
+
+    class_call(output_perturbations_profile(ppt,pop),
+               pop->error_message,
+               pop->error_message);
+
+  }
+
   /** - deal with primordial spectra */
 
   if (pop->write_primordial == _TRUE_ && ppt->has_perturbations) {
@@ -1213,6 +1223,64 @@ int output_perturbations(
 
 }
 
+/**
+ * This routine writes the profile of the integration of
+ * perturbations (cost of each mode, initial condition and
+ * wavenumber) in the file '<root>perturbations_profile.dat'.
+ *
+ * @param ppt Input: pointer to perturbation structure
+ * @param pop Input: pointer to output structure
+ * @return the error status
+ */
+
+int output_perturbations_profile(
+                                 struct perturbations * ppt,
+                                 struct output * pop
+                                 ) {
+
+  FileName file_name;
+  FILE * out;
+  char titles[_MAXTITLESTRINGLENGTH_]={0};
+  double * data;
+  int index_md, size_data, number_of_titles;
+
+  class_call(perturbations_profile_titles(ppt,titles),
+             ppt->error_message,
+             pop->error_message);
+  number_of_titles = get_number_of_titles(titles);
+
+  size_data = 0;
+  for (index_md = 0; index_md < ppt->md_size; index_md++)
+    size_data += number_of_titles*ppt->ic_size[index_md]*ppt->k_size[index_md];
+
+  class_alloc(data,sizeof(double)*size_data,pop->error_message);
+
+  class_call(perturbations_profile_data(ppt,number_of_titles,data),
+             ppt->error_message,
+             pop->error_message);
+
+  sprintf(file_name,"%s%s",pop->root,"perturbations_profile.dat");
+  class_open(out,file_name,"w",pop->error_message);
+
+  if (pop->write_header == _TRUE_) {
+    fprintf(out,"# Cost of the integration of perturbations for each mode, initial condition and wavenumber\n");
+    fprintf(out,"# (mode and ic are the indices index_md and index_ic of the perturbation module;\n");
+    fprintf(out,"#  derivs and jacobians are the number of calls to perturbations_derivs() and perturbations_jacobian(),\n");
+    fprintf(out,"#  intervals the number of time intervals with a uniform approximation scheme)\n");
+  }
+
+  output_print_data(out,
+                    titles,
+                    data,
+                    size_data);
+
+  free(data);
+  fclose(out);
+
+  return _SUCCESS_;
+
+}
+
 int output_primordial(
                       struct perturbations * ppt,
                       struct primordial * ppm,
@@ -1471,17 +1539,25 @@ int output_print_data(FILE *out,
   int index_title, index_tau;
   char thetitle[_MAXTITLESTRINGLENGTH_];
   char *pch;
+  char *pend;
 
   /** Summary*/
 
-  /** - First we print the titles */
+  /** - First we print the titles (split by hand rather than with
+      strtok(), which is not reentrant) */
   fprintf(out,"#");
 
   strcpy(thetitle,titles);
-  pch = strtok(thetitle,_DELIMITER_);
+  pch = thetitle;
   while (pch != NULL){
-    class_fprintf_columntitle(out, pch, _TRUE_, colnum);
-    pch = strtok(NULL,_DELIMITER_);
+    pend = strstr(pch,_DELIMITER_);
+    if (pend != NULL){
+      pend[0] = '\0';
+      pend += strlen(_DELIMITER_);
+    }
+    if (pch[0] != '\0')
+      class_fprintf_columntitle(out, pch, _TRUE_, colnum);
+    pch = pend;
   }
   fprintf(out,"\n");
 
@@ -25,6 +25,8 @@
  */
 
 #include "perturbations.h"
+#include <unistd.h>
+#include <time.h>
 
 
 /**
@@ -284,7 +286,7 @@ int perturbations_output_data_at_z(
       for (index_tp=0; index_tp<ppt->tp_size[index_md]; index_tp++) {
         for (index_ic=0; index_ic<ppt->ic_size[index_md]; index_ic++) {
           tkfull[(index_k * ppt->ic_size[index_md] + index_ic) * ppt->tp_size[index_md] + index_tp]
-            = ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index_tp][(ppt->tau_size-1) * ppt->k_size[index_md] + index_k];
+            = ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index_tp][_source_index_(index_md,ppt->tau_size-1,index_k)];
         }
       }
     }
@@ -681,6 +683,9 @@ int perturbations_output_firstline_and_ic_suffix(
  *   relevant perturbations, integrate the differential system,
  *   compute and store the source functions.
  *
+ * This is the particular case of perturbations_init_batch() with a
+ * single cosmology.
+ *
  * @param ppr Input: pointer to precision structure
  * @param pba Input: pointer to background structure
  * @param pth Input: pointer to thermodynamics structure
@@ -695,44 +700,810 @@ int perturbations_init(
                        struct perturbations * ppt
                        ) {
 
+  int status;
+
+  class_call(perturbations_init_batch(1,&ppr,&pba,&pth,&ppt,&status),
+             ppt->error_message,
+             ppt->error_message);
+
+  return status;
+}
+
+/**
+ * Initialize the perturbations structures of several cosmologies at
+ * once.
+ *
+ * The preliminary steps (indices, k and tau sampling, cache lookup)
+ * and the final splines are performed for each cosmology in turn,
+ * but the integration of all (cosmology, mode, initial condition,
+ * wavenumber) tasks is distributed from a single queue to the threads
+ * of one parallel region. Hence threads are not waiting for each
+ * other at the boundary between modes, initial conditions or
+ * cosmologies.
+ *
+ * A failure in one cosmology does not stop the others: the error
+ * status of each cosmology is returned in status[index_cosmo], and
+ * the error message is written in the corresponding perturbation
+ * structure.
+ *
+ * @param cosmo_size Input: number of cosmologies
+ * @param pppr       Input: array of pointers to precision structures
+ * @param ppba       Input: array of pointers to background structures
+ * @param ppth       Input: array of pointers to thermodynamics structures
+ * @param pppt       Output: array of pointers to initialized perturbation structures
+ * @param status     Output: array of error status for each cosmology
+ * @return the error status (_FAILURE_ only if the batch itself could not be processed)
+ */
+
+int perturbations_init_batch(
+                             int cosmo_size,
+                             struct precision ** pppr,
+                             struct background ** ppba,
+                             struct thermodynamics ** ppth,
+                             struct perturbations ** pppt,
+                             int * status
+                             ) {
+
   /** Summary: */
 
   /** - define local variables */
 
+  /* running index for cosmologies */
+  int index_cosmo;
   /* running index for modes */
   int index_md;
   /* running index for initial conditions */
   int index_ic;
   /* running index for wavenumbers */
   int index_k;
-  /* running index for type of perturbation */
-  int index_tp;
-  /* pointer to one struct perturbations_workspace per thread (one if no openmp) */
+  /* running index for tasks (one task = one cosmology, mode, initial condition and wavenumber) */
+  int index_task;
+  /* total number of tasks, and list of (cosmology, mode, initial condition, wavenumber) for each of them */
+  int task_size;
+  struct perturbations_task * task;
+  /* for each cosmology, do we need to integrate the perturbations (or were sources found in the cache)? */
+  short * needs_integration;
+  /* for each cosmology, key of the source functions in the cache */
+  unsigned long long * cache_key;
+  /* for each cosmology, position of its first mode in the list of workspaces */
+  int * md_offset;
+  int md_total;
+  /* pointer to one struct perturbations_workspace per thread, cosmology and mode (one per cosmology and mode if no openmp) */
   struct perturbations_workspace ** pppw;
-  /* background quantities */
-  double w_fld_ini, w_fld_0,dw_over_da_fld,integral_fld;
+  /* pointer to one struct perturbations_workspace per cosmology and mode, integrating its reference tasks */
+  struct perturbations_workspace ** reference_workspace;
+  /* index of cosmology and mode (md_offset[index_cosmo]+index_md), number of its tasks, position of a task among them, and number of reference tasks integrated */
+  int index_group;
+  int group_size;
+  int index_position;
+  int reference_size;
   /* number of threads (always one if no openmp) */
   int number_of_threads=1;
   /* index of the thread (always 0 if no openmp) */
   int thread=0;
-
-  /* This code can be optionally compiled with the openmp option for parallel computation.
-     Inside parallel regions, the use of the command "return" is forbidden.
-     For error management, instead of "return _FAILURE_", we will set the variable below
-     to "abort = _TRUE_". This will lead to a "return _FAILURE_" just after leaving the
-     parallel region. */
-  int abort;
-
-  /* unsigned integer that will be set to the size of the workspace */
-  size_t sz;
+  struct perturbations * ppt;
 
 #ifdef _OPENMP
   /* instrumentation times */
   double tstart, tstop, tspent;
 #endif
 
+  class_alloc(needs_integration,cosmo_size*sizeof(short),pppt[0]->error_message);
+  class_alloc(cache_key,cosmo_size*sizeof(unsigned long long),pppt[0]->error_message);
+  class_alloc(md_offset,cosmo_size*sizeof(int),pppt[0]->error_message);
+
+  /** - for each cosmology, perform preliminary checks, compute
+      indices and sampling, and look for the sources in the cache,
+      with perturbations_prepare() */
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+
+    status[index_cosmo] = perturbations_prepare(pppr[index_cosmo],
+                                                ppba[index_cosmo],
+                                                ppth[index_cosmo],
+                                                pppt[index_cosmo],
+                                                &(needs_integration[index_cosmo]),
+                                                &(cache_key[index_cosmo]));
+    if (status[index_cosmo] == _FAILURE_)
+      needs_integration[index_cosmo] = _FALSE_;
+  }
+
+  /** - build the list of tasks, and sort it by decreasing estimated
+      cost (see perturbations_task_cost()). With dynamic scheduling,
+      the most expensive integrations of all cosmologies, modes and
+      initial conditions are then started first, and the cheap ones
+      fill the gaps at the end of the parallel region. */
+
+  task_size = 0;
+  md_total = 0;
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    md_offset[index_cosmo] = md_total;
+    if (needs_integration[index_cosmo] == _TRUE_) {
+      ppt = pppt[index_cosmo];
+      md_total += ppt->md_size;
+      for (index_md = 0; index_md < ppt->md_size; index_md++)
+        task_size += ppt->ic_size[index_md]*ppt->k_size[index_md];
+    }
+  }
+
+  class_alloc(task,MAX(task_size,1)*sizeof(struct perturbations_task),pppt[0]->error_message);
+
+  index_task = 0;
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+
+    if (needs_integration[index_cosmo] == _FALSE_)
+      continue;
+
+    ppt = pppt[index_cosmo];
+
+    for (index_md = 0; index_md < ppt->md_size; index_md++) {
+
+      if (ppt->perturbations_verbose > 1)
+        printf("Evolving mode %d/%d\n",index_md+1,ppt->md_size);
+
+      for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+
+        if (ppt->perturbations_verbose > 1) {
+          printf("Evolving ic %d/%d\n",index_ic+1,ppt->ic_size[index_md]);
+          printf("evolving %d wavenumbers\n",ppt->k_size[index_md]);
+        }
+
+        for (index_k = ppt->k_size[index_md]-1; index_k >=0; index_k--) {
+          task[index_task].cost = perturbations_task_cost(ppba[index_cosmo],ppt,index_md,index_k);
+          task[index_task].index_cosmo = index_cosmo;
+          task[index_task].index_md = index_md;
+          task[index_task].index_ic = index_ic;
+          task[index_task].index_k = index_k;
+          task[index_task].order = index_task;
+          task[index_task].is_reference = _FALSE_;
+          index_task++;
+        }
+      }
+    }
+  }
+
+  qsort(task,task_size,sizeof(struct perturbations_task),perturbations_compare_tasks);
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    ppt = pppt[index_cosmo];
+    if ((needs_integration[index_cosmo] == _FALSE_) || (ppt->profile_cost == NULL))
+      continue;
+    for (index_md = 0; index_md < ppt->md_size; index_md++)
+      free(ppt->profile_cost[index_md]);
+    free(ppt->profile_cost);
+    ppt->profile_cost = NULL;
+  }
+
+  /** - create an array of workspaces for each thread, cosmology and
+      mode. Each workspace is initialized by the thread using it, the
+      first time that this thread needs it. */
+
+#ifdef _OPENMP
+
+#pragma omp parallel
+  {
+    number_of_threads = omp_get_num_threads();
+  }
+#endif
+
+  class_calloc(pppw,MAX(number_of_threads*md_total,1),sizeof(struct perturbations_workspace *),pppt[0]->error_message);
+  class_calloc(reference_workspace,MAX(md_total,1),sizeof(struct perturbations_workspace *),pppt[0]->error_message);
+
+  /** - evolve perturbations and compute source functions with
+      perturbations_solve() for all tasks */
+
+#pragma omp parallel                                                    \
+  shared(pppw,reference_workspace,pppr,ppba,ppth,pppt,task,task_size,md_offset,md_total,status) \
+  private(index_task,index_cosmo,index_md,index_ic,index_k,index_group,group_size,index_position,reference_size,ppt,thread,tstart,tstop,tspent) \
+  num_threads(number_of_threads)
+
+  {
+
+    struct perturbations_workspace ** ppw_here;
+
+#ifdef _OPENMP
+    thread=omp_get_thread_num();
+    tspent=0.;
+#endif
+
+    /** - --> (a) the ndf15 evolver reuses the sparsity pattern,
+        ordering and pivots of its jacobians from one wavenumber to
+        the next. For the results not to depend on the number of
+        threads and on the scheduling, _REFERENCE_TASKS_ tasks of
+        each cosmology and mode (from the most to the least expensive
+        one, in order to meet all approximation schemes) are
+        integrated one after the other in a reference workspace, and
+        all the other tasks start from the jacobians found at the
+        end. */
+
+#pragma omp for schedule (dynamic)
+
+    for (index_group = 0; index_group < md_total; index_group++) {
+
+      group_size = 0;
+      for (index_task = 0; index_task < task_size; index_task++) {
+        if (md_offset[task[index_task].index_cosmo]+task[index_task].index_md == index_group)
+          group_size++;
+      }
+
+      reference_size = 0;
+      index_position = 0;
+
+      for (index_task = 0; (index_task < task_size) && (reference_size < MIN(group_size,_REFERENCE_TASKS_)); index_task++) {
+
+        index_cosmo = task[index_task].index_cosmo;
+        index_md    = task[index_task].index_md;
+        index_ic    = task[index_task].index_ic;
+        index_k     = task[index_task].index_k;
+        ppt = pppt[index_cosmo];
+
+        if (md_offset[index_cosmo]+index_md != index_group)
+          continue;
+
+        /* take reference tasks evenly spaced in the list sorted by cost, from the first to the last one */
+        index_position++;
+        if ((MIN(group_size,_REFERENCE_TASKS_) > 1) &&
+            (index_position-1 != reference_size*(group_size-1)/(MIN(group_size,_REFERENCE_TASKS_)-1)))
+          continue;
+
+        if ((status[index_cosmo] == _FAILURE_) || (pppr[index_cosmo]->evolver != ndf15))
+          break;
+
+        if (reference_workspace[index_group] == NULL) {
+          reference_workspace[index_group] = malloc(sizeof(struct perturbations_workspace));
+          if (reference_workspace[index_group] == NULL) {
+            class_alloc_message(ppt->error_message,"reference_workspace[index_group]",(int)sizeof(struct perturbations_workspace));
+            status[index_cosmo] = _FAILURE_;
+            break;
+          }
+          if (perturbations_workspace_init(pppr[index_cosmo],
+                                           ppba[index_cosmo],
+                                           ppth[index_cosmo],
+                                           ppt,
+                                           index_md,
+                                           reference_workspace[index_group]) == _FAILURE_) {
+            class_call_message(ppt->error_message,"perturbations_workspace_init(ppr,pba,pth,ppt,index_md,reference_workspace[index_group])",ppt->error_message);
+            free(reference_workspace[index_group]);
+            reference_workspace[index_group] = NULL;
+            status[index_cosmo] = _FAILURE_;
+            break;
+          }
+        }
+
+        /* the first reference task starts from empty jacobians, the next ones from those of the previous one */
+        if (reference_size == 0)
+          reference_workspace[index_group]->jacobian_cache_reference = NULL;
+        else
+          reference_workspace[index_group]->jacobian_cache_reference = &(reference_workspace[index_group]->jacobian_cache);
+
+        if (perturbations_solve(pppr[index_cosmo],
+                                ppba[index_cosmo],
+                                ppth[index_cosmo],
+                                ppt,
+                                index_md,
+                                index_ic,
+                                index_k,
+                                reference_workspace[index_group]) == _FAILURE_) {
+          class_call_message(ppt->error_message,"perturbations_solve(ppr,pba,pth,ppt,index_md,index_ic,index_k,reference_workspace[index_group])",ppt->error_message);
+          status[index_cosmo] = _FAILURE_;
+          break;
+        }
+
+        task[index_task].is_reference = _TRUE_;
+        reference_size++;
+      }
+    }
+
+    /** - --> (b) integrate all the other tasks */
+
+#pragma omp for schedule (dynamic)
+
+    for (index_task = 0; index_task < task_size; index_task++) {
+
+      index_cosmo = task[index_task].index_cosmo;
+      index_md    = task[index_task].index_md;
+      index_ic    = task[index_task].index_ic;
+      index_k     = task[index_task].index_k;
+      ppt = pppt[index_cosmo];
+
+      if ((status[index_cosmo] == _FAILURE_) || (task[index_task].is_reference == _TRUE_))
+        continue;
+
+      if (ppt->perturbations_verbose > 2) {
+        printf("evolving mode k=%e /Mpc  (%d/%d)",ppt->k[index_md][index_k],index_k+1,ppt->k_size[index_md]);
+        if (ppba[index_cosmo]->sgnK != 0)
+          printf(" (for scalar modes, corresponds to nu=%e)",sqrt(ppt->k[index_md][index_k]*ppt->k[index_md][index_k]+ppba[index_cosmo]->K)/sqrt(ppba[index_cosmo]->sgnK*ppba[index_cosmo]->K));
+        printf("\n");
+      }
+
+#ifdef _OPENMP
+      tstart = omp_get_wtime();
+#endif
+
+      /** - --> (c) create and initialize the workspace of this thread for this cosmology and mode, if not done yet */
+
+      ppw_here = &(pppw[thread*md_total+md_offset[index_cosmo]+index_md]);
+
+      if (*ppw_here == NULL) {
+        *ppw_here = malloc(sizeof(struct perturbations_workspace));
+        if (*ppw_here == NULL) {
+          class_alloc_message(ppt->error_message,"pppw[thread]",(int)sizeof(struct perturbations_workspace));
+          status[index_cosmo] = _FAILURE_;
+          continue;
+        }
+        if (perturbations_workspace_init(pppr[index_cosmo],
+                                         ppba[index_cosmo],
+                                         ppth[index_cosmo],
+                                         ppt,
+                                         index_md,
+                                         *ppw_here) == _FAILURE_) {
+          class_call_message(ppt->error_message,"perturbations_workspace_init(ppr,pba,pth,ppt,index_md,pppw[thread])",ppt->error_message);
+          free(*ppw_here);
+          *ppw_here = NULL;
+          status[index_cosmo] = _FAILURE_;
+          continue;
+        }
+      }
+
+      /** - --> (d) evolve perturbations and compute source functions,
+          starting from the jacobians of the reference tasks */
+
+      index_group = md_offset[index_cosmo]+index_md;
+      if (reference_workspace[index_group] != NULL)
+        (*ppw_here)->jacobian_cache_reference = &(reference_workspace[index_group]->jacobian_cache);
+
+      if (perturbations_solve(pppr[index_cosmo],
+                              ppba[index_cosmo],
+                              ppth[index_cosmo],
+                              ppt,
+                              index_md,
+                              index_ic,
+                              index_k,
+                              *ppw_here) == _FAILURE_) {
+        class_call_message(ppt->error_message,"perturbations_solve(ppr,pba,pth,ppt,index_md,index_ic,index_k,pppw[thread])",ppt->error_message);
+        status[index_cosmo] = _FAILURE_;
+      }
+
+#ifdef _OPENMP
+      tstop = omp_get_wtime();
+
+      tspent += tstop-tstart;
+#endif
+
+    } /* end of loop over tasks */
+
+#ifdef _OPENMP
+    if (pppt[0]->perturbations_verbose>2)
+      printf("In %s: time spent in parallel region (loop over k's) = %e s for thread %d\n",
+             __func__,tspent,omp_get_thread_num());
+#endif
+
+  } /* end of parallel region */
+
+  /** - free the workspaces */
+
+  for (thread = 0; thread < number_of_threads; thread++) {
+    for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+      if (needs_integration[index_cosmo] == _FALSE_)
+        continue;
+      for (index_md = 0; index_md < pppt[index_cosmo]->md_size; index_md++) {
+        if (pppw[thread*md_total+md_offset[index_cosmo]+index_md] != NULL) {
+          class_call_try(perturbations_workspace_free(pppt[index_cosmo],index_md,pppw[thread*md_total+md_offset[index_cosmo]+index_md]),
+                         pppt[index_cosmo]->error_message,
+                         pppt[index_cosmo]->error_message,
+                         status[index_cosmo]=_FAILURE_);
+        }
+      }
+    }
+  }
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    if (needs_integration[index_cosmo] == _FALSE_)
+      continue;
+    for (index_md = 0; index_md < pppt[index_cosmo]->md_size; index_md++) {
+      if (reference_workspace[md_offset[index_cosmo]+index_md] != NULL) {
+        class_call_try(perturbations_workspace_free(pppt[index_cosmo],index_md,reference_workspace[md_offset[index_cosmo]+index_md]),
+                       pppt[index_cosmo]->error_message,
+                       pppt[index_cosmo]->error_message,
+                       status[index_cosmo]=_FAILURE_);
+      }
+    }
+  }
+
+  free(reference_workspace);
+  free(pppw);
+  free(task);
+
+  /** - free the background and thermodynamics tables at the times of tau_sampling, which were only needed by perturbations_sources() */
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+    if (needs_integration[index_cosmo] == _FALSE_)
+      continue;
+    free(pppt[index_cosmo]->pvecback_sampling);
+    free(pppt[index_cosmo]->pvecthermo_sampling);
+    pppt[index_cosmo]->pvecback_sampling = NULL;
+    pppt[index_cosmo]->pvecthermo_sampling = NULL;
+  }
+
+  /** - for each cosmology, store the new source functions in the
+      cache if requested, and spline them with
+      perturbations_spline_sources() */
+
+  for (index_cosmo = 0; index_cosmo < cosmo_size; index_cosmo++) {
+
+    ppt = pppt[index_cosmo];
+
+    if ((status[index_cosmo] == _FAILURE_) || (ppt->has_perturbations == _FALSE_))
+      continue;
+
+    if ((needs_integration[index_cosmo] == _TRUE_) && (ppt->has_perturbations_cache == _TRUE_) && (ppt->store_perturbations == _FALSE_)) {
+      class_call_try(perturbations_cache_write(ppt,cache_key[index_cosmo]),
+                     ppt->error_message,
+                     ppt->error_message,
+                     status[index_cosmo]=_FAILURE_;continue);
+    }
+
+    class_call_try(perturbations_spline_sources(ppt),
+                   ppt->error_message,
+                   ppt->error_message,
+                   status[index_cosmo]=_FAILURE_);
+  }
+
+  free(needs_integration);
+  free(cache_key);
+  free(md_offset);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Estimate the relative cost of integrating the perturbations of one
+ * wavenumber, used for ordering the tasks of perturbations_init_batch().
+ *
+ * The number of steps of the integrator is roughly proportional to
+ * the number of oscillations of the photon and neutrino hierarchies,
+ * i.e. to \f$ k \tau_0 / 2 \pi \f$, plus a constant accounting for
+ * the non-oscillatory regime and the calculation of the sources.
+ * This is the same assumption as in the former loop over k in
+ * reverse order, but it allows to compare tasks of different modes,
+ * initial conditions and cosmologies.
+ *
+ * When a profile of a previous run was read by
+ * perturbations_profile_read(), the cost measured in this run is
+ * used instead.
+ *
+ * @param pba      Input: pointer to background structure
+ * @param ppt      Input: pointer to perturbation structure
+ * @param index_md Input: index of mode
+ * @param index_k  Input: index of wavenumber
+ * @return the estimated cost (arbitrary units)
+ */
+
+double perturbations_task_cost(
+                               struct background * pba,
+                               struct perturbations * ppt,
+                               int index_md,
+                               int index_k
+                               ) {
+
+  if ((ppt->profile_cost != NULL) && (ppt->profile_cost[index_md] != NULL))
+    return ppt->profile_cost[index_md][index_k];
+
+  return 1. + ppt->k[index_md][index_k]*pba->conformal_age/_TWOPI_;
+}
+
+/**
+ * Comparison function passed to qsort() for sorting the tasks of
+ * perturbations_init_batch() by decreasing cost. Tasks with equal
+ * cost keep their original order.
+ *
+ * @param a Input: pointer to first task
+ * @param b Input: pointer to second task
+ * @return negative if a should be performed before b, positive otherwise
+ */
+
+int perturbations_compare_tasks(
+                                const void * a,
+                                const void * b
+                                ) {
+
+  const struct perturbations_task * task_a = (const struct perturbations_task *) a;
+  const struct perturbations_task * task_b = (const struct perturbations_task *) b;
+
+  if (task_a->cost > task_b->cost)
+    return -1;
+  if (task_a->cost < task_b->cost)
+    return 1;
+  return task_a->order - task_b->order;
+}
+
+/**
+ * Read the profile written by a previous run in the file
+ * ppt->perturbations_profile_file (see perturbations_profile_data()),
+ * and infer the cost of each wavenumber of the current k sampling,
+ * stored in ppt->profile_cost. This cost is not a smooth function of
+ * k: it depends on the times at which the approximation schemes are
+ * switched, and on the species included, which the estimate of
+ * perturbations_task_cost() ignores.
+ *
+ * For each mode, the measured time is interpolated linearly in
+ * log(k) for each initial condition (and taken constant outside of
+ * the range of the file), then averaged over initial conditions. For
+ * modes absent from the file, the estimate of
+ * perturbations_task_cost() is rescaled to the measured times of the
+ * other modes.
+ *
+ * @param pba Input: pointer to background structure
+ * @param ppt Input/Output: pointer to perturbation structure
+ * @return the error status
+ */
+
+int perturbations_profile_read(
+                               struct background * pba,
+                               struct perturbations * ppt
+                               ) {
+
+  FILE * profile_file;
+  char line[_LINE_LENGTH_MAX_];
+  char * left;
+  double mode,ic,k,time;
+  int row_size,index_row,first_row,last_row;
+  int * row_md;
+  int * row_ic;
+  double * row_lnk;
+  double * row_time;
+  int index_md,index_k,block_size;
+  double lnk,sum_measured=0.,sum_estimated=0.;
+  double * cost;
+  short has_data;
+
+  /** - read all rows of the file (lines starting with '#' are comments) */
+
+  class_open(profile_file,ppt->perturbations_profile_file,"r",ppt->error_message);
+
+  row_size = 0;
+  while (fgets(line,_LINE_LENGTH_MAX_-1,profile_file) != NULL) {
+    left=line;
+    while (left[0]==' ')
+      left++;
+    if ((left[0] != '#') && (sscanf(left,"%lf %lf %lf %lf",&mode,&ic,&k,&time) == 4))
+      row_size++;
+  }
+
+  class_alloc(row_md,MAX(row_size,1)*sizeof(int),ppt->error_message);
+  class_alloc(row_ic,MAX(row_size,1)*sizeof(int),ppt->error_message);
+  class_alloc(row_lnk,MAX(row_size,1)*sizeof(double),ppt->error_message);
+  class_alloc(row_time,MAX(row_size,1)*sizeof(double),ppt->error_message);
+
+  rewind(profile_file);
+
+  index_row = 0;
+  while ((index_row < row_size) && (fgets(line,_LINE_LENGTH_MAX_-1,profile_file) != NULL)) {
+    left=line;
+    while (left[0]==' ')
+      left++;
+    if ((left[0] != '#') && (sscanf(left,"%lf %lf %lf %lf",&mode,&ic,&k,&time) == 4)) {
+      class_test(k <= 0.,
+                 ppt->error_message,
+                 "found k=%e in profile file %s",k,ppt->perturbations_profile_file);
+      row_md[index_row] = (int)mode;
+      row_ic[index_row] = (int)ic;
+      row_lnk[index_row] = log(k);
+      row_time[index_row] = time;
+      index_row++;
+    }
+  }
+
+  fclose(profile_file);
+
+  /** - for each mode, interpolate the time measured for each initial
+      condition (rows of a given mode and initial condition are
+      contiguous, and ordered by increasing k) */
+
+  class_alloc(ppt->profile_cost,ppt->md_size*sizeof(double*),ppt->error_message);
+
+  has_data = _FALSE_;
+
+  for (index_md = 0; index_md < ppt->md_size; index_md++) {
+
+    ppt->profile_cost[index_md] = NULL;
+    block_size = 0;
+
+    for (first_row = 0; first_row < row_size; first_row = last_row) {
+
+      for (last_row = first_row+1; last_row < row_size; last_row++) {
+        if ((row_md[last_row] != row_md[first_row]) || (row_ic[last_row] != row_ic[first_row]))
+          break;
+        class_test(row_lnk[last_row] <= row_lnk[last_row-1],
+                   ppt->error_message,
+                   "wavenumbers are not increasing in profile file %s",ppt->perturbations_profile_file);
+      }
+
+      if (row_md[first_row] != index_md)
+        continue;
+
+      if (ppt->profile_cost[index_md] == NULL)
+        class_calloc(ppt->profile_cost[index_md],ppt->k_size[index_md],sizeof(double),ppt->error_message);
+
+      index_row = first_row;
+
+      for (index_k = 0; index_k < ppt->k_size[index_md]; index_k++) {
+
+        lnk = log(ppt->k[index_md][index_k]);
+
+        while ((index_row < last_row-2) && (row_lnk[index_row+1] < lnk))
+          index_row++;
+
+        if ((lnk <= row_lnk[first_row]) || (last_row-first_row == 1))
+          ppt->profile_cost[index_md][index_k] += row_time[first_row];
+        else if (lnk >= row_lnk[last_row-1])
+          ppt->profile_cost[index_md][index_k] += row_time[last_row-1];
+        else
+          ppt->profile_cost[index_md][index_k] += row_time[index_row]
+            + (row_time[index_row+1]-row_time[index_row])
+            * (lnk-row_lnk[index_row])/(row_lnk[index_row+1]-row_lnk[index_row]);
+      }
+
+      block_size++;
+    }
+
+    if (block_size > 0) {
+      has_data = _TRUE_;
+      cost = ppt->profile_cost[index_md];
+      ppt->profile_cost[index_md] = NULL;
+      for (index_k = 0; index_k < ppt->k_size[index_md]; index_k++) {
+        cost[index_k] /= (double)block_size;
+        sum_measured += cost[index_k];
+        sum_estimated += perturbations_task_cost(pba,ppt,index_md,index_k);
+      }
+      ppt->profile_cost[index_md] = cost;
+    }
+  }
+
+  /** - for modes absent from the file, rescale the estimated cost to
+      the measured one; if no mode was found, use only estimates */
+
+  for (index_md = 0; index_md < ppt->md_size; index_md++) {
+
+    if (has_data == _FALSE_) {
+      free(ppt->profile_cost[index_md]);
+    }
+    else if (ppt->profile_cost[index_md] == NULL) {
+      class_alloc(cost,ppt->k_size[index_md]*sizeof(double),ppt->error_message);
+      for (index_k = 0; index_k < ppt->k_size[index_md]; index_k++)
+        cost[index_k] = sum_measured/sum_estimated*perturbations_task_cost(pba,ppt,index_md,index_k);
+      ppt->profile_cost[index_md] = cost;
+    }
+  }
+
+  if (has_data == _FALSE_) {
+    free(ppt->profile_cost);
+    ppt->profile_cost = NULL;
+  }
+
+  free(row_md);
+  free(row_ic);
+  free(row_lnk);
+  free(row_time);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Fill the titles of the columns of the profile of the integration
+ * of the perturbations.
+ *
+ * @param ppt    Input: pointer to perturbation structure
+ * @param titles Output: titles string containing all titles
+ * @return the error status
+ */
+
+int perturbations_profile_titles(
+                                 struct perturbations * ppt,
+                                 char titles[_MAXTITLESTRINGLENGTH_]
+                                 ) {
+
+  class_store_columntitle(titles,"mode",_TRUE_);
+  class_store_columntitle(titles,"ic",_TRUE_);
+  class_store_columntitle(titles,"k [1/Mpc]",_TRUE_);
+  class_store_columntitle(titles,"time [s]",_TRUE_);
+  class_store_columntitle(titles,"derivs",_TRUE_);
+  class_store_columntitle(titles,"jacobians",_TRUE_);
+  class_store_columntitle(titles,"intervals",_TRUE_);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Fill the profile of the integration of the perturbations: one row
+ * per mode, initial condition and wavenumber (in this order, with
+ * increasing k), with the columns listed in
+ * perturbations_profile_titles(). The number of rows is the sum over
+ * modes of ic_size[index_md]*k_size[index_md]. All costs are zero if
+ * the source functions were read from the cache.
+ *
+ * @param ppt              Input: pointer to perturbation structure
+ * @param number_of_titles Input: number of columns
+ * @param data             Output: table of size number_of_titles times the number of rows
+ * @return the error status
+ */
+
+int perturbations_profile_data(
+                               struct perturbations * ppt,
+                               int number_of_titles,
+                               double * data
+                               ) {
+
+  int index_md,index_ic,index_k,index_ic_k,storeidx;
+  double * dataptr;
+
+  class_test(ppt->has_perturbations_profile == _FALSE_,
+             ppt->error_message,
+             "the profile of the perturbations was not recorded: set 'perturbations_profile' to 'yes'");
+
+  dataptr = data;
+
+  for (index_md = 0; index_md < ppt->md_size; index_md++) {
+    for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+      for (index_k = 0; index_k < ppt->k_size[index_md]; index_k++) {
+
+        index_ic_k = index_ic*ppt->k_size[index_md]+index_k;
+        storeidx = 0;
+
+        class_store_double(dataptr,index_md,_TRUE_,storeidx);
+        class_store_double(dataptr,index_ic,_TRUE_,storeidx);
+        class_store_double(dataptr,ppt->k[index_md][index_k],_TRUE_,storeidx);
+        class_store_double(dataptr,ppt->profile_time[index_md][index_ic_k],_TRUE_,storeidx);
+        class_store_double(dataptr,ppt->profile_derivs[index_md][index_ic_k],_TRUE_,storeidx);
+        class_store_double(dataptr,ppt->profile_jacobians[index_md][index_ic_k],_TRUE_,storeidx);
+        class_store_double(dataptr,ppt->profile_intervals[index_md][index_ic_k],_TRUE_,storeidx);
+
+        dataptr += number_of_titles;
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Perform all the steps of the perturbation module preceding the
+ * integration of the perturbations: checks, initialization of
+ * indices, k and tau sampling, allocation of the source table, and
+ * lookup in the persistent cache.
+ *
+ * @param ppr               Input: pointer to precision structure
+ * @param pba               Input: pointer to background structure
+ * @param pth               Input: pointer to thermodynamics structure
+ * @param ppt               Input/Output: pointer to perturbation structure
+ * @param needs_integration Output: _TRUE_ if the perturbations must be integrated (_FALSE_ if there is nothing to do, or if the sources were read from the cache)
+ * @param cache_key         Output: key of the source functions in the cache (set only if the cache is used)
+ * @return the error status
+ */
+
+int perturbations_prepare(
+                          struct precision * ppr,
+                          struct background * pba,
+                          struct thermodynamics * pth,
+                          struct perturbations * ppt,
+                          short * needs_integration,
+                          unsigned long long * cache_key
+                          ) {
+
+  /* background quantities */
+  double w_fld_ini, w_fld_0,dw_over_da_fld,integral_fld;
+  /* flag telling whether the sources were found in the cache */
+  short cache_found;
+
   /** - perform preliminary checks */
 
+  *needs_integration = _FALSE_;
+  ppt->pvecback_sampling = NULL;
+  ppt->pvecthermo_sampling = NULL;
+  ppt->profile_cost = NULL;
+
   if (ppt->has_perturbations == _FALSE_) {
     if (ppt->perturbations_verbose > 0)
       printf("No sources requested. Perturbation module skipped.\n");
@@ -878,189 +1649,109 @@ int perturbations_init(
              ppt->error_message);
 
 
-  if (ppt->z_max_pk > pth->z_rec) {
-
-    class_test(ppt->has_cmb == _TRUE_,
-               ppt->error_message,
-               "You requested a very high z_pk=%e, higher than z_rec=%e. This works very well when you don't ask for a calculation of the CMB source function(s). Remove any CMB from your output and try e.g. with 'output=mTk' or 'output=mTk,vTk'",
-               ppt->z_max_pk,
-               pth->z_rec);
-
-    class_test(ppt->has_source_delta_m == _TRUE_,
-               ppt->error_message,
-               "You requested a very high z_pk=%e, higher than z_rec=%e. This works very well when you ask only transfer functions, e.g. with 'output=mTk' or 'output=mTk,vTk'. But if you need the total matter (e.g. with 'mPk', 'dCl', etc.) there is an issue with the calculation of delta_m at very early times. By default, delta_m is a gauge-invariant variable (the density fluctuation in comoving gauge) and this quantity is hard to get accurately at very early times. The solution is to define delta_m as the density fluctuation in the current gauge, synchronous or newtonian. For the moment this must be done manually by commenting the line 'ppw->delta_m += 3. *ppw->pvecback[pba->index_bg_a]*ppw->pvecback[pba->index_bg_H] * ppw->theta_m/k2;' in perturbations_sources(). In the future there will be an option for doing it in an easier way.",
-               ppt->z_max_pk,
-               pth->z_rec);
-
-  }
-
-
-
-  /** - define the common time sampling for all sources using
-      perturbations_timesampling_for_sources() */
-
-  class_call(perturbations_timesampling_for_sources(ppr,
-                                                    pba,
-                                                    pth,
-                                                    ppt),
-             ppt->error_message,
-             ppt->error_message);
-
-  /** - if we want to store perturbations for given k values, write titles and allocate storage */
-  class_call(perturbations_prepare_k_output(pba,ppt),
-             ppt->error_message,
-             ppt->error_message);
-
-  /** - create an array of workspaces in multi-thread case */
-
-#ifdef _OPENMP
-
-#pragma omp parallel
-  {
-    number_of_threads = omp_get_num_threads();
-  }
-#endif
-
-  class_alloc(pppw,number_of_threads * sizeof(struct perturbations_workspace *),ppt->error_message);
-
-  /** - loop over modes (scalar, tensors, etc). For each mode: */
-
-  for (index_md = 0; index_md < ppt->md_size; index_md++) {
-
-    if (ppt->perturbations_verbose > 1)
-      printf("Evolving mode %d/%d\n",index_md+1,ppt->md_size);
-
-    abort = _FALSE_;
-
-    sz = sizeof(struct perturbations_workspace);
-
-#pragma omp parallel                                            \
-  shared(pppw,ppr,pba,pth,ppt,index_md,abort,number_of_threads) \
-  private(thread)                                               \
-  num_threads(number_of_threads)
-
-    {
-
-#ifdef _OPENMP
-      thread=omp_get_thread_num();
-#endif
-
-      /** - --> (a) create a workspace (one per thread in multi-thread case) */
-
-      class_alloc_parallel(pppw[thread],sz,ppt->error_message);
-
-      /** - --> (b) initialize indices of vectors of perturbations with perturbations_indices_of_current_vectors() */
-
-      class_call_parallel(perturbations_workspace_init(ppr,
-                                                       pba,
-                                                       pth,
-                                                       ppt,
-                                                       index_md,
-                                                       pppw[thread]),
-                          ppt->error_message,
-                          ppt->error_message);
-
-    } /* end of parallel region */
-
-    if (abort == _TRUE_) return _FAILURE_;
-
-    /** - --> (c) loop over initial conditions and wavenumbers; for each of them, evolve perturbations and compute source functions with perturbations_solve() */
-
-    for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
-
-      if (ppt->perturbations_verbose > 1) {
-        printf("Evolving ic %d/%d\n",index_ic+1,ppt->ic_size[index_md]);
-        printf("evolving %d wavenumbers\n",ppt->k_size[index_md]);
-      }
-
-      abort = _FALSE_;
-
-#pragma omp parallel                                                    \
-  shared(pppw,ppr,pba,pth,ppt,index_md,index_ic,abort,number_of_threads) \
-  private(index_k,thread,tstart,tstop,tspent)                           \
-  num_threads(number_of_threads)
-
-      {
+  if (ppt->z_max_pk > pth->z_rec) {
 
-#ifdef _OPENMP
-        thread=omp_get_thread_num();
-        tspent=0.;
-#endif
+    class_test(ppt->has_cmb == _TRUE_,
+               ppt->error_message,
+               "You requested a very high z_pk=%e, higher than z_rec=%e. This works very well when you don't ask for a calculation of the CMB source function(s). Remove any CMB from your output and try e.g. with 'output=mTk' or 'output=mTk,vTk'",
+               ppt->z_max_pk,
+               pth->z_rec);
 
-#pragma omp for schedule (dynamic)
+    class_test(ppt->has_source_delta_m == _TRUE_,
+               ppt->error_message,
+               "You requested a very high z_pk=%e, higher than z_rec=%e. This works very well when you ask only transfer functions, e.g. with 'output=mTk' or 'output=mTk,vTk'. But if you need the total matter (e.g. with 'mPk', 'dCl', etc.) there is an issue with the calculation of delta_m at very early times. By default, delta_m is a gauge-invariant variable (the density fluctuation in comoving gauge) and this quantity is hard to get accurately at very early times. The solution is to define delta_m as the density fluctuation in the current gauge, synchronous or newtonian. For the moment this must be done manually by commenting the line 'ppw->delta_m += 3. *ppw->pvecback[pba->index_bg_a]*ppw->pvecback[pba->index_bg_H] * ppw->theta_m/k2;' in perturbations_sources(). In the future there will be an option for doing it in an easier way.",
+               ppt->z_max_pk,
+               pth->z_rec);
 
-        /* integrating backwards is slightly more optimal for parallel runs */
-        //for (index_k = 0; index_k < ppt->k_size; index_k++) {
-        for (index_k = ppt->k_size[index_md]-1; index_k >=0; index_k--) {
+  }
 
-          if ((ppt->perturbations_verbose > 2) && (abort == _FALSE_)) {
-            printf("evolving mode k=%e /Mpc  (%d/%d)",ppt->k[index_md][index_k],index_k+1,ppt->k_size[index_md]);
-            if (pba->sgnK != 0)
-              printf(" (for scalar modes, corresponds to nu=%e)",sqrt(ppt->k[index_md][index_k]*ppt->k[index_md][index_k]+pba->K)/sqrt(pba->sgnK*pba->K));
-            printf("\n");
-          }
 
-#ifdef _OPENMP
-          tstart = omp_get_wtime();
-#endif
 
-          class_call_parallel(perturbations_solve(ppr,
-                                                  pba,
-                                                  pth,
-                                                  ppt,
-                                                  index_md,
-                                                  index_ic,
-                                                  index_k,
-                                                  pppw[thread]),
-                              ppt->error_message,
-                              ppt->error_message);
+  /** - define the common time sampling for all sources using
+      perturbations_timesampling_for_sources() */
 
-#ifdef _OPENMP
-          tstop = omp_get_wtime();
+  class_call(perturbations_timesampling_for_sources(ppr,
+                                                    pba,
+                                                    pth,
+                                                    ppt),
+             ppt->error_message,
+             ppt->error_message);
 
-          tspent += tstop-tstart;
-#endif
+  /** - if we want to store perturbations for given k values, write titles and allocate storage */
+  class_call(perturbations_prepare_k_output(pba,ppt),
+             ppt->error_message,
+             ppt->error_message);
 
-#pragma omp flush(abort)
+  /** - if a persistent cache of source functions is requested, look
+      for a table computed previously with the same precision,
+      background, thermodynamics and perturbation settings (the
+      sources do not depend on the primordial spectrum). The cache is
+      not used when perturbations are stored for given k values,
+      since these are only produced during the integration. */
 
-        } /* end of loop over wavenumbers */
+  cache_found = _FALSE_;
 
-#ifdef _OPENMP
-        if (ppt->perturbations_verbose>2)
-          printf("In %s: time spent in parallel region (loop over k's) = %e s for thread %d\n",
-                 __func__,tspent,omp_get_thread_num());
-#endif
+  if ((ppt->has_perturbations_cache == _TRUE_) && (ppt->store_perturbations == _FALSE_)) {
 
-      } /* end of parallel region */
+    class_call(perturbations_cache_key(ppr,pba,pth,ppt,cache_key),
+               ppt->error_message,
+               ppt->error_message);
 
-      if (abort == _TRUE_) return _FAILURE_;
+    class_call(perturbations_cache_read(ppt,*cache_key,&cache_found),
+               ppt->error_message,
+               ppt->error_message);
+  }
 
-    } /* end of loop over initial conditions */
+  *needs_integration = (cache_found == _FALSE_);
 
-    abort = _FALSE_;
+  /** - if the sources must be computed, tabulate the background and
+      thermodynamics quantities at the times of tau_sampling, which
+      are the same for all wavenumbers */
 
-#pragma omp parallel                                \
-  shared(pppw,ppt,index_md,abort,number_of_threads) \
-  private(thread)                                   \
-  num_threads(number_of_threads)
+  if (*needs_integration == _TRUE_) {
+    class_call(perturbations_timesampling_background(pba,pth,ppt),
+               ppt->error_message,
+               ppt->error_message);
+  }
 
-    {
+  /** - if the profile of a previous run is available, read the
+      measured cost of each wavenumber, used to order the
+      integrations */
 
-#ifdef _OPENMP
-      thread=omp_get_thread_num();
-#endif
+  if ((*needs_integration == _TRUE_) && (ppt->perturbations_profile_file[0] != '\0')) {
+    class_call(perturbations_profile_read(pba,ppt),
+               ppt->error_message,
+               ppt->error_message);
+  }
 
-      class_call_parallel(perturbations_workspace_free(ppt,index_md,pppw[thread]),
-                          ppt->error_message,
-                          ppt->error_message);
+  return _SUCCESS_;
+}
 
-    } /* end of parallel region */
+/**
+ * Spline the late-time part of the source table with respect to the
+ * time variable (used for the interpolation of Fourier transfer
+ * functions and spectra).
+ *
+ * @param ppt Input/Output: pointer to perturbation structure with source table filled
+ * @return the error status
+ */
 
-    if (abort == _TRUE_) return _FAILURE_;
+int perturbations_spline_sources(
+                                 struct perturbations * ppt
+                                 ) {
 
-  } /* end loop over modes */
+  int index_md;
+  int index_ic;
+  int index_tp;
+  int number_of_threads=1;
+  int abort;
 
-  free(pppw);
+#ifdef _OPENMP
+#pragma omp parallel
+  {
+    number_of_threads = omp_get_num_threads();
+  }
+#endif
 
   /** - spline the source array with respect to the time variable */
 
@@ -1165,6 +1856,13 @@ int perturbations_free(
       free(ppt->late_sources[index_md]);
       free(ppt->ddlate_sources[index_md]);
 
+      if (ppt->has_perturbations_profile == _TRUE_) {
+        free(ppt->profile_time[index_md]);
+        free(ppt->profile_derivs[index_md]);
+        free(ppt->profile_jacobians[index_md]);
+        free(ppt->profile_intervals[index_md]);
+      }
+
       free(ppt->k[index_md]);
 
     }
@@ -1173,6 +1871,13 @@ int perturbations_free(
     if (ppt->ln_tau_size > 1)
       free(ppt->ln_tau);
 
+    if (ppt->has_perturbations_profile == _TRUE_) {
+      free(ppt->profile_time);
+      free(ppt->profile_derivs);
+      free(ppt->profile_jacobians);
+      free(ppt->profile_intervals);
+    }
+
     free(ppt->tp_size);
 
     free(ppt->ic_size);
@@ -2091,6 +2796,85 @@ int perturbations_timesampling_for_sources(
     }
   }
 
+  /** - if requested, allocate the profile of the integrations (set to zero if the sources are read from the cache) */
+
+  if (ppt->has_perturbations_profile == _TRUE_) {
+
+    class_alloc(ppt->profile_time,ppt->md_size*sizeof(double*),ppt->error_message);
+    class_alloc(ppt->profile_derivs,ppt->md_size*sizeof(int*),ppt->error_message);
+    class_alloc(ppt->profile_jacobians,ppt->md_size*sizeof(int*),ppt->error_message);
+    class_alloc(ppt->profile_intervals,ppt->md_size*sizeof(int*),ppt->error_message);
+
+    for (index_md = 0; index_md < ppt->md_size; index_md++) {
+      class_calloc(ppt->profile_time[index_md],ppt->ic_size[index_md]*ppt->k_size[index_md],sizeof(double),ppt->error_message);
+      class_calloc(ppt->profile_derivs[index_md],ppt->ic_size[index_md]*ppt->k_size[index_md],sizeof(int),ppt->error_message);
+      class_calloc(ppt->profile_jacobians[index_md],ppt->ic_size[index_md]*ppt->k_size[index_md],sizeof(int),ppt->error_message);
+      class_calloc(ppt->profile_intervals[index_md],ppt->ic_size[index_md]*ppt->k_size[index_md],sizeof(int),ppt->error_message);
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Tabulate the background and thermodynamics quantities at each time
+ * of ppt->tau_sampling.
+ *
+ * The source functions of all wavenumbers are computed at the same
+ * times, so these quantities are interpolated once here rather than
+ * once per wavenumber in perturbations_sources().
+ *
+ * @param pba Input: pointer to background structure
+ * @param pth Input: pointer to thermodynamics structure
+ * @param ppt Input/Output: perturbation structure with tau_sampling already defined
+ * @return the error status
+ */
+
+int perturbations_timesampling_background(
+                                          struct background * pba,
+                                          struct thermodynamics * pth,
+                                          struct perturbations * ppt
+                                          ) {
+
+  int index_tau;
+  int last_index_back=0;
+  int last_index_thermo=0;
+  double * pvecback;
+  double * pvecthermo;
+
+  class_alloc(ppt->pvecback_sampling,
+              ppt->tau_size*pba->bg_size_normal*sizeof(double),
+              ppt->error_message);
+
+  class_alloc(ppt->pvecthermo_sampling,
+              ppt->tau_size*pth->th_size*sizeof(double),
+              ppt->error_message);
+
+  for (index_tau = 0; index_tau < ppt->tau_size; index_tau++) {
+
+    pvecback = ppt->pvecback_sampling + index_tau*pba->bg_size_normal;
+    pvecthermo = ppt->pvecthermo_sampling + index_tau*pth->th_size;
+
+    class_call(background_at_tau(pba,
+                                 ppt->tau_sampling[index_tau],
+                                 normal_info,
+                                 inter_closeby,
+                                 &last_index_back,
+                                 pvecback),
+               pba->error_message,
+               ppt->error_message);
+
+    class_call(thermodynamics_at_z(pba,
+                                   pth,
+                                   1./pvecback[pba->index_bg_a]-1.,  /* redshift z=1/a-1 */
+                                   inter_closeby,
+                                   &last_index_thermo,
+                                   pvecback,
+                                   pvecthermo),
+               pth->error_message,
+               ppt->error_message);
+  }
+
   return _SUCCESS_;
 }
 
@@ -2854,6 +3638,13 @@ int perturbations_workspace_init(
   class_alloc(ppw->pvecthermo,pth->th_size*sizeof(double),ppt->error_message);
   class_alloc(ppw->pvecmetric,ppw->mt_size*sizeof(double),ppt->error_message);
 
+  /** - allocate buffer for the source functions of one wavenumber */
+  class_alloc(ppw->sources_buffer,MAX(ppt->tp_size[index_md]*ppt->tau_size,1)*sizeof(double),ppt->error_message);
+
+  /** - initialize the cache of jacobians for the ndf15 evolver */
+  jacobian_cache_init(&(ppw->jacobian_cache));
+  ppw->jacobian_cache_reference = NULL;
+
   /** - count number of approximations, initialize their indices, and allocate their flags */
   index_ap=0;
 
@@ -2941,6 +3732,8 @@ int perturbations_workspace_free (
   free(ppw->pvecback);
   free(ppw->pvecthermo);
   free(ppw->pvecmetric);
+  free(ppw->sources_buffer);
+  jacobian_cache_free(&(ppw->jacobian_cache));
   if (ppw->ap_size > 0)
     free(ppw->approx);
 
@@ -3041,17 +3834,33 @@ int perturbations_solve(
 
   int n_ncdm,is_early_enough;
 
-  /* function pointer to ODE evolver and names of possible evolvers */
+  /* function pointer to ODE evolver (see evolver_function in common.h) */
+
+  evolver_function generic_evolver;
 
-  extern int evolver_rk();
-  extern int evolver_ndf15();
-  int (*generic_evolver)();
+  /* function pointer to the analytic Jacobian (NULL if not available) */
+  int (*perhaps_jacobian)();
+  short jacobian_available;
 
 
   /* Related to the perturbation output */
   int (*perhaps_print_variables)();
   int index_ikout;
 
+  /* time at the beginning of the integration, for the profile */
+  double tstart;
+
+  /** - start the counters of the profile */
+
+#ifdef _OPENMP
+  tstart = omp_get_wtime();
+#else
+  tstart = (double)clock()/CLOCKS_PER_SEC;
+#endif
+
+  ppw->derivs_calls = 0;
+  ppw->jacobian_calls = 0;
+
   /** - initialize indices relevant for back/thermo tables search */
   ppw->last_index_back=0;
   ppw->last_index_thermo=0;
@@ -3264,6 +4073,21 @@ int perturbations_solve(
     }
   }
 
+  /** - start from the sparsity pattern, ordering and pivots found for
+      the reference wavenumbers, if any, rather than from those of the
+      previous wavenumber of this workspace: the latter depend on which
+      wavenumbers this thread integrated before, and the result for
+      each wavenumber should not. Memory is kept. */
+
+  if (ppw->jacobian_cache_reference == NULL) {
+    jacobian_cache_reset(&(ppw->jacobian_cache));
+  }
+  else {
+    class_call(jacobian_cache_copy(&(ppw->jacobian_cache),ppw->jacobian_cache_reference,ppt->error_message),
+               ppt->error_message,
+               ppt->error_message);
+  }
+
   /** - loop over intervals over which approximation scheme is uniform. For each interval: */
 
   for (index_interval=0; index_interval<interval_number; index_interval++) {
@@ -3315,6 +4139,25 @@ int perturbations_solve(
       generic_evolver = evolver_ndf15;
     }
 
+    /* Jacobian computed analytically by perturbations_jacobian() when
+       possible, or numerically by the ndf15 evolver otherwise */
+    perhaps_jacobian = NULL;
+    if ((generic_evolver == evolver_ndf15) && (ppr->perturbations_analytic_jacobian == _TRUE_)) {
+      class_call(perturbations_jacobian_available(pba,pth,ppt,index_md,ppw,&jacobian_available),
+                 ppt->error_message,
+                 ppt->error_message);
+      if (jacobian_available == _TRUE_)
+        perhaps_jacobian = perturbations_jacobian;
+    }
+
+    /* The structure of the system depends only on the approximation
+       scheme: the ndf15 evolver can use the sparsity pattern and LU
+       ordering of its Jacobian found in previous intervals with the
+       same scheme */
+    ppw->jacobian_cache.key = 0;
+    for (index_ap=0; index_ap<ppw->ap_size; index_ap++)
+      ppw->jacobian_cache.key = 2*ppw->jacobian_cache.key + ppw->approx[index_ap];
+
     class_call(generic_evolver(perturbations_derivs,
                                interval_limit[index_interval],
                                interval_limit[index_interval+1],
@@ -3330,6 +4173,8 @@ int perturbations_solve(
                                tau_actual_size,
                                perturbations_sources,
                                perhaps_print_variables,
+                               perhaps_jacobian,
+                               &(ppw->jacobian_cache),
                                ppt->error_message),
                ppt->error_message,
                ppt->error_message);
@@ -3344,14 +4189,37 @@ int perturbations_solve(
   /** - fill the source terms array with zeros for all times between
       the last integrated time tau_max and tau_today. */
 
-  for (index_tau = tau_actual_size; index_tau < ppt->tau_size; index_tau++) {
+  for (index_tp = 0; index_tp < ppt->tp_size[index_md]; index_tp++) {
+    for (index_tau = tau_actual_size; index_tau < ppt->tau_size; index_tau++) {
+      ppw->sources_buffer[index_tp * ppt->tau_size + index_tau] = 0.;
+    }
+  }
+
+  /** - copy the source functions of this wavenumber from the
+      buffer of the workspace to the source table */
+
+  for (index_tau = 0; index_tau < ppt->tau_size; index_tau++) {
     for (index_tp = 0; index_tp < ppt->tp_size[index_md]; index_tp++) {
       ppt->sources[index_md]
         [index_ic * ppt->tp_size[index_md] + index_tp]
-        [index_tau * ppt->k_size[index_md] + index_k] = 0.;
+        [_source_index_(index_md,index_tau,index_k)] =
+        ppw->sources_buffer[index_tp * ppt->tau_size + index_tau];
     }
   }
 
+  /** - store the profile of this integration */
+
+  if (ppt->has_perturbations_profile == _TRUE_) {
+#ifdef _OPENMP
+    ppt->profile_time[index_md][index_ic*ppt->k_size[index_md]+index_k] = omp_get_wtime()-tstart;
+#else
+    ppt->profile_time[index_md][index_ic*ppt->k_size[index_md]+index_k] = (double)clock()/CLOCKS_PER_SEC-tstart;
+#endif
+    ppt->profile_derivs[index_md][index_ic*ppt->k_size[index_md]+index_k] = ppw->derivs_calls;
+    ppt->profile_jacobians[index_md][index_ic*ppt->k_size[index_md]+index_k] = ppw->jacobian_calls;
+    ppt->profile_intervals[index_md][index_ic*ppt->k_size[index_md]+index_k] = interval_number;
+  }
+
   /** - free quantities allocated at the beginning of the routine */
 
   class_call(perturbations_vector_free(ppw->pv),
@@ -3484,14 +4352,383 @@ int perturbations_prepare_k_output(struct background * pba,
         }
       }
 
-      ppt->number_of_tensor_titles =
-        get_number_of_titles(ppt->tensor_titles);
+      ppt->number_of_tensor_titles =
+        get_number_of_titles(ppt->tensor_titles);
+
+    }
+
+  }
+  return _SUCCESS_;
+
+}
+
+/**
+ * Compute the key identifying the source functions in the persistent
+ * cache. This is a hash of everything that the source functions
+ * depend on: all precision parameters, the background and
+ * thermodynamics tables (together with the few parameters of these
+ * structures read directly by this module), the perturbation flags,
+ * and the time and wavenumber sampling. It does not depend on the
+ * primordial parameters, so that a change of the primordial spectrum
+ * alone leads to the same key.
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pba Input: pointer to background structure
+ * @param pth Input: pointer to thermodynamics structure
+ * @param ppt Input: pointer to perturbation structure (with k and tau sampling already computed)
+ * @param key Output: hash of all inputs
+ * @return the error status
+ */
+
+int perturbations_cache_key(
+                            struct precision * ppr,
+                            struct background * pba,
+                            struct thermodynamics * pth,
+                            struct perturbations * ppt,
+                            unsigned long long * key
+                            ) {
+
+  unsigned long long hash = _HASH_INIT_;
+  int index_md;
+  int n_ncdm;
+
+#define class_hash_field(field) hash = class_hash(hash,&(field),sizeof(field))
+
+  /** - hash all precision parameters (these very concise lines loop
+      over all precision parameters thanks to the macros defined in
+      macros_precision.h) */
+#define __HASH_PRECISION_PARAMETER__
+#include "precisions.h"
+#undef __HASH_PRECISION_PARAMETER__
+
+  /** - hash the background table and the background parameters read directly in this module */
+  hash = class_hash(hash,pba->tau_table,pba->bt_size*sizeof(double));
+  hash = class_hash(hash,pba->background_table,pba->bt_size*pba->bg_size*sizeof(double));
+
+  class_hash_field(pba->H0);
+  class_hash_field(pba->h);
+  class_hash_field(pba->K);
+  class_hash_field(pba->sgnK);
+  class_hash_field(pba->T_cmb);
+  class_hash_field(pba->Omega0_b);
+  class_hash_field(pba->Omega0_idm);
+  class_hash_field(pba->Omega0_idr);
+  class_hash_field(pba->Gamma_dcdm);
+  class_hash_field(pba->cs2_fld);
+  class_hash_field(pba->use_ppf);
+  class_hash_field(pba->c_gamma_over_c_fld);
+  class_hash_field(pba->conformal_age);
+  class_hash_field(pba->has_cdm);
+  class_hash_field(pba->has_idm);
+  class_hash_field(pba->has_dcdm);
+  class_hash_field(pba->has_dr);
+  class_hash_field(pba->has_ncdm);
+  class_hash_field(pba->has_lambda);
+  class_hash_field(pba->has_fld);
+  class_hash_field(pba->has_scf);
+  class_hash_field(pba->has_ur);
+  class_hash_field(pba->has_idr);
+  class_hash_field(pba->has_curvature);
+  class_hash_field(pba->N_ncdm);
+
+  for (n_ncdm=0; n_ncdm<pba->N_ncdm; n_ncdm++) {
+    class_hash_field(pba->M_ncdm[n_ncdm]);
+    class_hash_field(pba->factor_ncdm[n_ncdm]);
+    class_hash_field(pba->q_size_ncdm[n_ncdm]);
+    hash = class_hash(hash,pba->q_ncdm[n_ncdm],pba->q_size_ncdm[n_ncdm]*sizeof(double));
+    hash = class_hash(hash,pba->w_ncdm[n_ncdm],pba->q_size_ncdm[n_ncdm]*sizeof(double));
+    hash = class_hash(hash,pba->dlnf0_dlnq_ncdm[n_ncdm],pba->q_size_ncdm[n_ncdm]*sizeof(double));
+  }
+
+  /** - hash the thermodynamics table and the thermodynamics parameters read directly in this module */
+  hash = class_hash(hash,pth->z_table,pth->tt_size*sizeof(double));
+  hash = class_hash(hash,pth->thermodynamics_table,pth->tt_size*pth->th_size*sizeof(double));
+
+  class_hash_field(pth->YHe);
+  class_hash_field(pth->z_rec);
+  class_hash_field(pth->tau_rec);
+  class_hash_field(pth->rs_rec);
+  class_hash_field(pth->tau_ini);
+  class_hash_field(pth->tau_free_streaming);
+  class_hash_field(pth->tau_idr_free_streaming);
+  class_hash_field(pth->angular_rescaling);
+  class_hash_field(pth->has_idm_dr);
+  class_hash_field(pth->has_idm_b);
+  class_hash_field(pth->has_idm_g);
+  class_hash_field(pth->a_idm_dr);
+  class_hash_field(pth->b_idr);
+  class_hash_field(pth->n_index_idm_dr);
+  class_hash_field(pth->n_index_idm_g);
+
+  /** - hash the perturbation flags and settings */
+  class_hash_field(ppt->gauge);
+  class_hash_field(ppt->has_perturbed_recombination);
+  class_hash_field(ppt->tensor_method);
+  class_hash_field(ppt->evolve_tensor_ur);
+  class_hash_field(ppt->evolve_tensor_ncdm);
+  class_hash_field(ppt->has_Nbody_gauge_transfers);
+  class_hash_field(ppt->has_nl_corrections_based_on_delta_m);
+  class_hash_field(ppt->switch_sw);
+  class_hash_field(ppt->switch_eisw);
+  class_hash_field(ppt->switch_lisw);
+  class_hash_field(ppt->switch_dop);
+  class_hash_field(ppt->switch_pol);
+  class_hash_field(ppt->eisw_lisw_split_z);
+  class_hash_field(ppt->three_ceff2_ur);
+  class_hash_field(ppt->three_cvis2_ur);
+  class_hash_field(ppt->z_max_pk);
+  class_hash_field(ppt->idr_nature);
+  class_hash_field(ppt->has_idm_dr);
+  class_hash_field(ppt->has_idm_soundspeed);
+  class_hash_field(ppt->has_cmb);
+  class_hash_field(ppt->has_lss);
+
+  if (ppt->alpha_idm_dr != NULL)
+    hash = class_hash(hash,ppt->alpha_idm_dr,(ppr->l_max_idr-1)*sizeof(double));
+  if (ppt->beta_idr != NULL)
+    hash = class_hash(hash,ppt->beta_idr,(ppr->l_max_idr-1)*sizeof(double));
+
+  /** - hash the list of modes, initial conditions and types, and the
+      sampling in k and tau. The mode and type indices are only
+      defined when the corresponding mode or source is requested, so
+      the flags from which they are deduced are hashed instead */
+  class_hash_field(ppt->md_size);
+  class_hash_field(ppt->has_scalars);
+  class_hash_field(ppt->has_vectors);
+  class_hash_field(ppt->has_tensors);
+  class_hash_field(ppt->has_ad);
+  class_hash_field(ppt->has_bi);
+  class_hash_field(ppt->has_cdi);
+  class_hash_field(ppt->has_nid);
+  class_hash_field(ppt->has_niv);
+  class_hash_field(ppt->has_source_t);
+  class_hash_field(ppt->has_source_p);
+  class_hash_field(ppt->has_source_delta_m);
+  class_hash_field(ppt->has_source_delta_cb);
+  class_hash_field(ppt->has_source_delta_tot);
+  class_hash_field(ppt->has_source_delta_g);
+  class_hash_field(ppt->has_source_delta_b);
+  class_hash_field(ppt->has_source_delta_cdm);
+  class_hash_field(ppt->has_source_delta_idm);
+  class_hash_field(ppt->has_source_delta_idr);
+  class_hash_field(ppt->has_source_delta_dcdm);
+  class_hash_field(ppt->has_source_delta_fld);
+  class_hash_field(ppt->has_source_delta_scf);
+  class_hash_field(ppt->has_source_delta_dr);
+  class_hash_field(ppt->has_source_delta_ur);
+  class_hash_field(ppt->has_source_delta_ncdm);
+  class_hash_field(ppt->has_source_theta_m);
+  class_hash_field(ppt->has_source_theta_cb);
+  class_hash_field(ppt->has_source_theta_tot);
+  class_hash_field(ppt->has_source_theta_g);
+  class_hash_field(ppt->has_source_theta_b);
+  class_hash_field(ppt->has_source_theta_cdm);
+  class_hash_field(ppt->has_source_theta_idm);
+  class_hash_field(ppt->has_source_theta_idr);
+  class_hash_field(ppt->has_source_theta_dcdm);
+  class_hash_field(ppt->has_source_theta_fld);
+  class_hash_field(ppt->has_source_theta_scf);
+  class_hash_field(ppt->has_source_theta_dr);
+  class_hash_field(ppt->has_source_theta_ur);
+  class_hash_field(ppt->has_source_theta_ncdm);
+  class_hash_field(ppt->has_source_phi);
+  class_hash_field(ppt->has_source_phi_prime);
+  class_hash_field(ppt->has_source_phi_plus_psi);
+  class_hash_field(ppt->has_source_psi);
+  class_hash_field(ppt->has_source_h);
+  class_hash_field(ppt->has_source_h_prime);
+  class_hash_field(ppt->has_source_eta);
+  class_hash_field(ppt->has_source_eta_prime);
+  class_hash_field(ppt->has_source_H_T_Nb_prime);
+  class_hash_field(ppt->has_source_k2gamma_Nb);
+
+  for (index_md=0; index_md<ppt->md_size; index_md++) {
+    class_hash_field(ppt->ic_size[index_md]);
+    class_hash_field(ppt->tp_size[index_md]);
+    class_hash_field(ppt->k_size[index_md]);
+    hash = class_hash(hash,ppt->k[index_md],ppt->k_size[index_md]*sizeof(double));
+  }
+
+  class_hash_field(ppt->tau_size);
+  hash = class_hash(hash,ppt->tau_sampling,ppt->tau_size*sizeof(double));
+
+#undef class_hash_field
+
+  *key = hash;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Look for a file containing the source functions with the given key
+ * in the cache directory, and if it exists and is consistent with the
+ * current dimensions of the source table, fill the table with its
+ * content.
+ *
+ * @param ppt   Input/Output: pointer to perturbation structure (with source table already allocated)
+ * @param key   Input: key computed by perturbations_cache_key()
+ * @param found Output: _TRUE_ if the source table was read from the cache
+ * @return the error status
+ */
+
+int perturbations_cache_read(
+                             struct perturbations * ppt,
+                             unsigned long long key,
+                             short * found
+                             ) {
+
+  FileName filename;
+  FILE * cachefile;
+  char magic[8];
+  unsigned long long key_read;
+  int md_size,ic_size,tp_size,k_size,tau_size;
+  int index_md,index_ic,index_tp;
+  size_t sz;
+  short consistent;
+
+  *found = _FALSE_;
+
+  class_test(snprintf(filename,_FILENAMESIZE_,"%s/sources_%016llx.bin",ppt->perturbations_cache_directory,key) >= _FILENAMESIZE_,
+             ppt->error_message,
+             "the name of the cache file in directory %s is longer than %d characters",
+             ppt->perturbations_cache_directory,_FILENAMESIZE_-1);
+
+  cachefile = fopen(filename,"rb");
+  if (cachefile == NULL)
+    return _SUCCESS_;
+
+  /** - check the header: it should match the key and all current dimensions */
+  consistent = _FALSE_;
+
+  if ((fread(magic,sizeof(char),8,cachefile) == 8) &&
+      (strncmp(magic,"CLASSPPT",8) == 0) &&
+      (fread(&key_read,sizeof(unsigned long long),1,cachefile) == 1) &&
+      (key_read == key) &&
+      (fread(&md_size,sizeof(int),1,cachefile) == 1) &&
+      (md_size == ppt->md_size) &&
+      (fread(&tau_size,sizeof(int),1,cachefile) == 1) &&
+      (tau_size == ppt->tau_size)) {
+
+    consistent = _TRUE_;
+
+    for (index_md=0; index_md<ppt->md_size; index_md++) {
+      if ((fread(&ic_size,sizeof(int),1,cachefile) != 1) ||
+          (fread(&tp_size,sizeof(int),1,cachefile) != 1) ||
+          (fread(&k_size,sizeof(int),1,cachefile) != 1) ||
+          (ic_size != ppt->ic_size[index_md]) ||
+          (tp_size != ppt->tp_size[index_md]) ||
+          (k_size != ppt->k_size[index_md])) {
+        consistent = _FALSE_;
+        break;
+      }
+    }
+  }
+
+  /** - read the source table */
+  if (consistent == _TRUE_) {
+
+    for (index_md=0; (index_md<ppt->md_size) && (consistent == _TRUE_); index_md++) {
+
+      sz = (size_t)ppt->tau_size*ppt->k_size[index_md];
+
+      for (index_ic=0; index_ic<ppt->ic_size[index_md]; index_ic++) {
+        for (index_tp=0; index_tp<ppt->tp_size[index_md]; index_tp++) {
+          if (fread(ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp],sizeof(double),sz,cachefile) != sz) {
+            consistent = _FALSE_;
+            break;
+          }
+        }
+        if (consistent == _FALSE_)
+          break;
+      }
+    }
+  }
+
+  fclose(cachefile);
+
+  if (consistent == _TRUE_) {
+    *found = _TRUE_;
+    if (ppt->perturbations_verbose > 0)
+      printf(" -> read source functions from cache file %s\n",filename);
+  }
+  else {
+    if (ppt->perturbations_verbose > 0)
+      printf(" -> [WARNING:] cache file %s is inconsistent with current settings, sources will be recomputed\n",filename);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Write the source functions in the cache directory, in a file
+ * labelled by the given key. The file is first written under a
+ * temporary name and then renamed, such that several processes
+ * sharing the same cache never read an incomplete file.
+ *
+ * @param ppt Input: pointer to perturbation structure
+ * @param key Input: key computed by perturbations_cache_key()
+ * @return the error status
+ */
+
+int perturbations_cache_write(
+                              struct perturbations * ppt,
+                              unsigned long long key
+                              ) {
+
+  FileName filename;
+  FileName tmpname;
+  FILE * cachefile;
+  int index_md,index_ic,index_tp;
+  size_t sz;
+
+  class_test(snprintf(filename,_FILENAMESIZE_,"%s/sources_%016llx.bin",ppt->perturbations_cache_directory,key) >= _FILENAMESIZE_,
+             ppt->error_message,
+             "the name of the cache file in directory %s is longer than %d characters",
+             ppt->perturbations_cache_directory,_FILENAMESIZE_-1);
+  /* the temporary name is unique to this process and this structure, since several cosmologies may be computed at the same time */
+  class_test(snprintf(tmpname,_FILENAMESIZE_,"%s.%ld.%lx.tmp",filename,(long)getpid(),(unsigned long)(size_t)ppt) >= _FILENAMESIZE_,
+             ppt->error_message,
+             "the name of the temporary cache file %s.*.tmp is longer than %d characters",
+             filename,_FILENAMESIZE_-1);
+
+  class_open(cachefile,tmpname,"wb",ppt->error_message);
+
+  fwrite("CLASSPPT",sizeof(char),8,cachefile);
+  fwrite(&key,sizeof(unsigned long long),1,cachefile);
+  fwrite(&(ppt->md_size),sizeof(int),1,cachefile);
+  fwrite(&(ppt->tau_size),sizeof(int),1,cachefile);
+
+  for (index_md=0; index_md<ppt->md_size; index_md++) {
+    fwrite(&(ppt->ic_size[index_md]),sizeof(int),1,cachefile);
+    fwrite(&(ppt->tp_size[index_md]),sizeof(int),1,cachefile);
+    fwrite(&(ppt->k_size[index_md]),sizeof(int),1,cachefile);
+  }
+
+  for (index_md=0; index_md<ppt->md_size; index_md++) {
+
+    sz = (size_t)ppt->tau_size*ppt->k_size[index_md];
+
+    for (index_ic=0; index_ic<ppt->ic_size[index_md]; index_ic++) {
+      for (index_tp=0; index_tp<ppt->tp_size[index_md]; index_tp++) {
+        class_test_except(fwrite(ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp],sizeof(double),sz,cachefile) != sz,
+                          ppt->error_message,
+                          fclose(cachefile);remove(tmpname),
+                          "could not write source functions in cache file %s",tmpname);
+      }
+    }
+  }
+
+  fclose(cachefile);
 
-    }
+  class_test_except(rename(tmpname,filename) != 0,
+                    ppt->error_message,
+                    remove(tmpname),
+                    "could not rename cache file %s into %s",tmpname,filename);
 
-  }
-  return _SUCCESS_;
+  if (ppt->perturbations_verbose > 0)
+    printf(" -> wrote source functions in cache file %s\n",filename);
 
+  return _SUCCESS_;
 }
 
 /**
@@ -7461,8 +8698,6 @@ int perturbations_sources(
   struct thermodynamics * pth;
   struct perturbations * ppt;
   int index_md;
-  int index_ic;
-  int index_k;
   double k;
   double z;
   struct perturbations_workspace * ppw;
@@ -7493,8 +8728,6 @@ int perturbations_sources(
   pth = pppaw->pth;
   ppt = pppaw->ppt;
   index_md = pppaw->index_md;
-  index_ic = pppaw->index_ic;
-  index_k = pppaw->index_k;
   k = pppaw->k;
   ppw = pppaw->ppw;
 
@@ -7502,30 +8735,21 @@ int perturbations_sources(
   pvecthermo = ppw->pvecthermo;
   pvecmetric = ppw->pvecmetric;
 
-  /** - get background/thermo quantities in this point */
+  /** - get background/thermo quantities in this point, from the
+      tables filled at the times of tau_sampling by
+      perturbations_timesampling_background() */
 
-  class_call(background_at_tau(pba,
-                               tau,
-                               normal_info,
-                               inter_closeby,
-                               &(ppw->last_index_back),
-                               pvecback),
-             pba->error_message,
-             error_message);
+  memcpy(pvecback,
+         ppt->pvecback_sampling + index_tau*pba->bg_size_normal,
+         pba->bg_size_normal*sizeof(double));
+
+  memcpy(pvecthermo,
+         ppt->pvecthermo_sampling + index_tau*pth->th_size,
+         pth->th_size*sizeof(double));
 
   /* redshift (remember that a in the code stands for (a/a_0)) */
   z = 1./pvecback[pba->index_bg_a]-1.;
 
-  class_call(thermodynamics_at_z(pba,
-                                 pth,
-                                 z,  /* redshift z=1/a-1 */
-                                 inter_closeby,
-                                 &(ppw->last_index_thermo),
-                                 pvecback,
-                                 pvecthermo),
-             pth->error_message,
-             error_message);
-
   a = ppw->pvecback[pba->index_bg_a];
   a2 = a * a;
 
@@ -8808,6 +10032,8 @@ int perturbations_derivs(double tau,
   pvecmetric = ppw->pvecmetric;
   pv = ppw->pv;
 
+  ppw->derivs_calls++;
+
   /** - get background/thermo quantities in this point */
 
   class_call(background_at_tau(pba,
@@ -9946,6 +11172,451 @@ int perturbations_derivs(double tau,
   return _SUCCESS_;
 }
 
+/**
+ * Check whether the Jacobian of the system integrated by
+ * perturbations_derivs() can be computed analytically by
+ * perturbations_jacobian() within the current approximation scheme.
+ *
+ * This is the case for scalar modes in the synchronous gauge, with
+ * photons (tight-coupling and radiation streaming approximations
+ * off), baryons, cdm, ur relics (fluid approximation off) and ncdm
+ * species (fluid approximation off), i.e. during the stage of the
+ * integration where the number of equations is the largest. Other
+ * species or approximations are integrated with the numerical
+ * Jacobian of the ndf15 evolver.
+ *
+ * @param pba       Input: pointer to background structure
+ * @param pth       Input: pointer to thermodynamics structure
+ * @param ppt       Input: pointer to perturbation structure
+ * @param index_md  Input: index of mode under consideration (scalar/.../tensor)
+ * @param ppw       Input: pointer to perturbation workspace (for the current approximation scheme)
+ * @param available Output: _TRUE_ if perturbations_jacobian() can be used
+ * @return the error status
+ */
+
+int perturbations_jacobian_available(
+                                     struct background * pba,
+                                     struct thermodynamics * pth,
+                                     struct perturbations * ppt,
+                                     int index_md,
+                                     struct perturbations_workspace * ppw,
+                                     short * available
+                                     ) {
+
+  *available = _FALSE_;
+
+  if (!(_scalars_) || (ppt->gauge != synchronous))
+    return _SUCCESS_;
+
+  if ((pba->has_idm == _TRUE_) || (pba->has_idr == _TRUE_) || (pba->has_dcdm == _TRUE_) || (pba->has_dr == _TRUE_) ||
+      (pba->has_fld == _TRUE_) || (pba->has_scf == _TRUE_) || (ppt->has_perturbed_recombination == _TRUE_))
+    return _SUCCESS_;
+
+  if ((ppw->approx[ppw->index_ap_tca] == (int)tca_on) || (ppw->approx[ppw->index_ap_rsa] == (int)rsa_on))
+    return _SUCCESS_;
+
+  if ((pba->has_ur == _TRUE_) && (ppw->approx[ppw->index_ap_ufa] == (int)ufa_on))
+    return _SUCCESS_;
+
+  if ((pba->has_ncdm == _TRUE_) && (ppw->approx[ppw->index_ap_ncdmfa] == (int)ncdmfa_on))
+    return _SUCCESS_;
+
+  *available = _TRUE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute the non-zero entries of the Jacobian d(dy)/dy of the system
+ * integrated by perturbations_derivs(), in the cases listed in
+ * perturbations_jacobian_available().
+ *
+ * This function is passed to the ndf15 evolver, which otherwise
+ * evaluates the Jacobian numerically with one call to
+ * perturbations_derivs() per group of independent columns. The
+ * equations are linear in y, so the entries below are simply the
+ * coefficients of the equations of perturbations_derivs(), in the
+ * same order; any change of these equations should be reported here.
+ * The couplings through the metric perturbations h' and eta' are
+ * added by perturbations_jacobian_metric().
+ *
+ * @param tau                      Input: conformal time
+ * @param y                        Input: vector of perturbations (not used, the system being linear)
+ * @param pje                      Output: list of non-zero entries
+ * @param parameters_and_workspace Input/Output: fixed parameters (e.g. indices), workspace
+ * @param error_message            Output: error message
+ * @return the error status
+ */
+
+int perturbations_jacobian(
+                           double tau,
+                           double * y,
+                           struct jacobian_entries * pje,
+                           void * parameters_and_workspace,
+                           ErrorMsg error_message
+                           ) {
+  /** Summary: */
+
+  /** - define local variables */
+
+  int l,index_q,n_ncdm,idx;
+  double a,a2,a_prime_over_a,R,dkappa,cb2;
+  double k,k2,cotKgen,sqrt_absK,s2_squared;
+  double P0_coef,coef;
+  double q,epsilon,dlnf0_dlnq,qk_div_epsilon;
+
+  struct perturbations_parameters_and_workspace * pppaw;
+  struct background * pba;
+  struct thermodynamics * pth;
+  struct perturbations * ppt;
+  struct perturbations_workspace * ppw;
+  struct perturbations_vector * pv;
+  double * pvecback;
+  double * s_l;
+
+  pppaw = parameters_and_workspace;
+  k = pppaw->k;
+  k2 = k*k;
+  pba = pppaw->pba;
+  pth = pppaw->pth;
+  ppt = pppaw->ppt;
+  ppw = pppaw->ppw;
+  pv = ppw->pv;
+  pvecback = ppw->pvecback;
+  s_l = ppw->s_l;
+
+  ppw->jacobian_calls++;
+
+  /** - get background/thermo quantities in this point */
+
+  class_call(background_at_tau(pba,
+                               tau,
+                               normal_info,
+                               inter_closeby,
+                               &(ppw->last_index_back),
+                               pvecback),
+             pba->error_message,
+             error_message);
+
+  class_call(thermodynamics_at_z(pba,
+                                 pth,
+                                 1./pvecback[pba->index_bg_a]-1.,
+                                 inter_closeby,
+                                 &(ppw->last_index_thermo),
+                                 pvecback,
+                                 ppw->pvecthermo),
+             pth->error_message,
+             error_message);
+
+  a = pvecback[pba->index_bg_a];
+  a2 = a*a;
+  a_prime_over_a = pvecback[pba->index_bg_H] * a;
+  R = 4./3. * pvecback[pba->index_bg_rho_g]/pvecback[pba->index_bg_rho_b];
+  dkappa = ppw->pvecthermo[pth->index_th_dkappa];
+  cb2 = ppw->pvecthermo[pth->index_th_cb2];
+
+  if (pba->has_curvature == _FALSE_){
+    cotKgen = 1.0/(k*tau);
+  }
+  else{
+    sqrt_absK = sqrt(fabs(pba->K));
+    if (pba->K < 0)
+      cotKgen = sqrt_absK/k/tanh(sqrt_absK*tau);
+    else
+      cotKgen = sqrt_absK/k/tan(sqrt_absK*tau);
+  }
+
+  s2_squared = 1.-3.*pba->K/k2;
+
+  /** - photon temperature density: -4/3 (theta_g + h'/2) */
+
+  _add_jacobian_entry_(pv->index_pt_delta_g,pv->index_pt_theta_g,-4./3.);
+  class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_delta_g,-4./3./2.,0.,pje,error_message),
+             error_message,
+             error_message);
+
+  /** - baryon density and velocity */
+
+  _add_jacobian_entry_(pv->index_pt_delta_b,pv->index_pt_theta_b,-1.);
+  class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_delta_b,-1./2.,0.,pje,error_message),
+             error_message,
+             error_message);
+
+  _add_jacobian_entry_(pv->index_pt_theta_b,pv->index_pt_theta_b,-a_prime_over_a-R*dkappa);
+  _add_jacobian_entry_(pv->index_pt_theta_b,pv->index_pt_delta_b,k2*cb2);
+  _add_jacobian_entry_(pv->index_pt_theta_b,pv->index_pt_theta_g,R*dkappa);
+
+  /** - photon temperature velocity */
+
+  _add_jacobian_entry_(pv->index_pt_theta_g,pv->index_pt_delta_g,k2/4.);
+  _add_jacobian_entry_(pv->index_pt_theta_g,pv->index_pt_shear_g,-k2*s2_squared);
+  _add_jacobian_entry_(pv->index_pt_theta_g,pv->index_pt_theta_b,dkappa);
+  _add_jacobian_entry_(pv->index_pt_theta_g,pv->index_pt_theta_g,-dkappa);
+
+  /** - photon temperature shear, with P0 = (G0 + G2 + 2 s_2 F2)/8 */
+
+  P0_coef = 0.5*dkappa*4./5./s_l[2]/8.;
+  _add_jacobian_entry_(pv->index_pt_shear_g,pv->index_pt_theta_g,0.5*8./15.);
+  _add_jacobian_entry_(pv->index_pt_shear_g,pv->index_pt_l3_g,-0.5*3./5.*k*s_l[3]/s_l[2]);
+  _add_jacobian_entry_(pv->index_pt_shear_g,pv->index_pt_shear_g,-dkappa+P0_coef*2.*s_l[2]);
+  _add_jacobian_entry_(pv->index_pt_shear_g,pv->index_pt_pol0_g,P0_coef);
+  _add_jacobian_entry_(pv->index_pt_shear_g,pv->index_pt_pol2_g,P0_coef);
+  class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_shear_g,0.5*8./15./2.,0.5*8./15.*3.,pje,error_message),
+             error_message,
+             error_message);
+
+  /** - photon temperature l=3 */
+
+  l = 3;
+  _add_jacobian_entry_(pv->index_pt_l3_g,pv->index_pt_shear_g,k/(2.0*l+1.0)*l*s_l[l]*2.*s_l[2]);
+  _add_jacobian_entry_(pv->index_pt_l3_g,pv->index_pt_l3_g+1,-k/(2.0*l+1.0)*(l+1.)*s_l[l+1]);
+  _add_jacobian_entry_(pv->index_pt_l3_g,pv->index_pt_l3_g,-dkappa);
+
+  /** - photon temperature l>3 and lmax */
+
+  for (l = 4; l < pv->l_max_g; l++) {
+    _add_jacobian_entry_(pv->index_pt_delta_g+l,pv->index_pt_delta_g+l-1,k/(2.0*l+1.0)*l*s_l[l]);
+    _add_jacobian_entry_(pv->index_pt_delta_g+l,pv->index_pt_delta_g+l+1,-k/(2.0*l+1.0)*(l+1)*s_l[l+1]);
+    _add_jacobian_entry_(pv->index_pt_delta_g+l,pv->index_pt_delta_g+l,-dkappa);
+  }
+
+  l = pv->l_max_g;
+  _add_jacobian_entry_(pv->index_pt_delta_g+l,pv->index_pt_delta_g+l-1,k*s_l[l]);
+  _add_jacobian_entry_(pv->index_pt_delta_g+l,pv->index_pt_delta_g+l,-k*(1.+l)*cotKgen-dkappa);
+
+  /** - photon polarization l=0, 1, 2 */
+
+  P0_coef = 4.*dkappa/8.;
+  _add_jacobian_entry_(pv->index_pt_pol0_g,pv->index_pt_pol1_g,-k);
+  _add_jacobian_entry_(pv->index_pt_pol0_g,pv->index_pt_pol0_g,-dkappa+P0_coef);
+  _add_jacobian_entry_(pv->index_pt_pol0_g,pv->index_pt_pol2_g,P0_coef);
+  _add_jacobian_entry_(pv->index_pt_pol0_g,pv->index_pt_shear_g,P0_coef*2.*s_l[2]);
+
+  _add_jacobian_entry_(pv->index_pt_pol1_g,pv->index_pt_pol0_g,k/3.);
+  _add_jacobian_entry_(pv->index_pt_pol1_g,pv->index_pt_pol2_g,-k/3.*2.*s_l[2]);
+  _add_jacobian_entry_(pv->index_pt_pol1_g,pv->index_pt_pol1_g,-dkappa);
+
+  P0_coef = 4./5.*dkappa/8.;
+  _add_jacobian_entry_(pv->index_pt_pol2_g,pv->index_pt_pol1_g,k/5.*2.*s_l[2]);
+  _add_jacobian_entry_(pv->index_pt_pol2_g,pv->index_pt_pol2_g+1,-k/5.*3.*s_l[3]);
+  _add_jacobian_entry_(pv->index_pt_pol2_g,pv->index_pt_pol2_g,-dkappa+P0_coef);
+  _add_jacobian_entry_(pv->index_pt_pol2_g,pv->index_pt_pol0_g,P0_coef);
+  _add_jacobian_entry_(pv->index_pt_pol2_g,pv->index_pt_shear_g,P0_coef*2.*s_l[2]);
+
+  /** - photon polarization l>2 and lmax_pol */
+
+  for (l=3; l < pv->l_max_pol_g; l++) {
+    _add_jacobian_entry_(pv->index_pt_pol0_g+l,pv->index_pt_pol0_g+l-1,k/(2.*l+1)*l*s_l[l]);
+    _add_jacobian_entry_(pv->index_pt_pol0_g+l,pv->index_pt_pol0_g+l+1,-k/(2.*l+1)*(l+1.)*s_l[l+1]);
+    _add_jacobian_entry_(pv->index_pt_pol0_g+l,pv->index_pt_pol0_g+l,-dkappa);
+  }
+
+  l = pv->l_max_pol_g;
+  _add_jacobian_entry_(pv->index_pt_pol0_g+l,pv->index_pt_pol0_g+l-1,k*s_l[l]);
+  _add_jacobian_entry_(pv->index_pt_pol0_g+l,pv->index_pt_pol0_g+l,-k*(l+1)*cotKgen-dkappa);
+
+  /** - cdm density (synchronous gauge) */
+
+  if (pba->has_cdm == _TRUE_) {
+    class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_delta_cdm,-1./2.,0.,pje,error_message),
+               error_message,
+               error_message);
+  }
+
+  /** - ur density, velocity, shear, l=3, l>3, lmax */
+
+  if (pba->has_ur == _TRUE_) {
+
+    _add_jacobian_entry_(pv->index_pt_delta_ur,pv->index_pt_theta_ur,-4./3.+(1.-ppt->three_ceff2_ur)*a_prime_over_a*4.*a_prime_over_a/k/k);
+    _add_jacobian_entry_(pv->index_pt_delta_ur,pv->index_pt_delta_ur,(1.-ppt->three_ceff2_ur)*a_prime_over_a);
+    class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_delta_ur,-4./3./2.,0.,pje,error_message),
+               error_message,
+               error_message);
+
+    _add_jacobian_entry_(pv->index_pt_theta_ur,pv->index_pt_delta_ur,k2*ppt->three_ceff2_ur/4.);
+    _add_jacobian_entry_(pv->index_pt_theta_ur,pv->index_pt_shear_ur,-k2*s2_squared);
+    _add_jacobian_entry_(pv->index_pt_theta_ur,pv->index_pt_theta_ur,-(1.-ppt->three_ceff2_ur)*a_prime_over_a);
+
+    coef = 0.5*(8./15.-(1.-ppt->three_cvis2_ur)*8./15.);
+    _add_jacobian_entry_(pv->index_pt_shear_ur,pv->index_pt_theta_ur,coef);
+    _add_jacobian_entry_(pv->index_pt_shear_ur,pv->index_pt_shear_ur+1,-0.5*3./5.*k*s_l[3]/s_l[2]);
+    class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_shear_ur,coef/2.,coef*3.,pje,error_message),
+               error_message,
+               error_message);
+
+    l = 3;
+    _add_jacobian_entry_(pv->index_pt_l3_ur,pv->index_pt_shear_ur,k/(2.*l+1.)*l*2.*s_l[l]*s_l[2]);
+    _add_jacobian_entry_(pv->index_pt_l3_ur,pv->index_pt_l3_ur+1,-k/(2.*l+1.)*(l+1.)*s_l[l+1]);
+
+    for (l = 4; l < pv->l_max_ur; l++) {
+      _add_jacobian_entry_(pv->index_pt_delta_ur+l,pv->index_pt_delta_ur+l-1,k/(2.*l+1)*l*s_l[l]);
+      _add_jacobian_entry_(pv->index_pt_delta_ur+l,pv->index_pt_delta_ur+l+1,-k/(2.*l+1)*(l+1.)*s_l[l+1]);
+    }
+
+    l = pv->l_max_ur;
+    _add_jacobian_entry_(pv->index_pt_delta_ur+l,pv->index_pt_delta_ur+l-1,k*s_l[l]);
+    _add_jacobian_entry_(pv->index_pt_delta_ur+l,pv->index_pt_delta_ur+l,-k*(1.+l)*cotKgen);
+  }
+
+  /** - ncdm hierarchy for each momentum bin */
+
+  if (pba->has_ncdm == _TRUE_) {
+
+    idx = pv->index_pt_psi0_ncdm1;
+
+    for (n_ncdm=0; n_ncdm<pv->N_ncdm; n_ncdm++) {
+
+      for (index_q=0; index_q < pv->q_size_ncdm[n_ncdm]; index_q++) {
+
+        dlnf0_dlnq = pba->dlnf0_dlnq_ncdm[n_ncdm][index_q];
+        q = pba->q_ncdm[n_ncdm][index_q];
+        epsilon = sqrt(q*q+a2*pba->M_ncdm[n_ncdm]*pba->M_ncdm[n_ncdm]);
+        qk_div_epsilon = k*q/epsilon;
+
+        _add_jacobian_entry_(idx,idx+1,-qk_div_epsilon);
+        class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,idx,dlnf0_dlnq/3./2.,0.,pje,error_message),
+                   error_message,
+                   error_message);
+
+        _add_jacobian_entry_(idx+1,idx,qk_div_epsilon/3.0);
+        _add_jacobian_entry_(idx+1,idx+2,-qk_div_epsilon/3.0*2*s_l[2]);
+
+        _add_jacobian_entry_(idx+2,idx+1,qk_div_epsilon/5.0*2*s_l[2]);
+        _add_jacobian_entry_(idx+2,idx+3,-qk_div_epsilon/5.0*3.*s_l[3]);
+        coef = -s_l[2]*2./15.*dlnf0_dlnq;
+        class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,idx+2,coef/2.,coef*3.,pje,error_message),
+                   error_message,
+                   error_message);
+
+        for (l=3; l<pv->l_max_ncdm[n_ncdm]; l++){
+          _add_jacobian_entry_(idx+l,idx+(l-1),qk_div_epsilon/(2.*l+1.0)*l*s_l[l]);
+          _add_jacobian_entry_(idx+l,idx+(l+1),-qk_div_epsilon/(2.*l+1.0)*(l+1.)*s_l[l+1]);
+        }
+
+        _add_jacobian_entry_(idx+l,idx+l-1,qk_div_epsilon);
+        _add_jacobian_entry_(idx+l,idx+l,-(1.+l)*k*cotKgen);
+
+        idx += (pv->l_max_ncdm[n_ncdm]+1);
+      }
+    }
+  }
+
+  /** - eta of synchronous gauge */
+
+  class_call(perturbations_jacobian_metric(pba,ppt,ppw,k,pv->index_pt_eta,0.,1.,pje,error_message),
+             error_message,
+             error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Add to the Jacobian computed by perturbations_jacobian() the
+ * derivatives of a term (weight_h_prime h' + weight_eta_prime eta')
+ * in the equation of y[index_row], where h' and eta' are given by the
+ * Einstein equations of perturbations_einstein() as linear
+ * combinations of eta, of the density perturbations and (for eta')
+ * of the velocity perturbations summed in
+ * perturbations_total_stress_energy().
+ *
+ * @param pba              Input: pointer to background structure
+ * @param ppt              Input: pointer to perturbation structure
+ * @param ppw              Input: pointer to perturbation workspace (with background quantities at current time)
+ * @param k                Input: wavenumber
+ * @param index_row        Input: index of equation
+ * @param weight_h_prime   Input: coefficient of h' in this equation
+ * @param weight_eta_prime Input: coefficient of eta' in this equation
+ * @param pje              Input/Output: list of non-zero entries
+ * @param error_message    Output: error message
+ * @return the error status
+ */
+
+int perturbations_jacobian_metric(
+                                  struct background * pba,
+                                  struct perturbations * ppt,
+                                  struct perturbations_workspace * ppw,
+                                  double k,
+                                  int index_row,
+                                  double weight_h_prime,
+                                  double weight_eta_prime,
+                                  struct jacobian_entries * pje,
+                                  ErrorMsg error_message
+                                  ) {
+
+  int index_q,n_ncdm,idx;
+  double a,a2,a_prime_over_a,k2,s2_squared,factor,q,q2,epsilon;
+  double coef_h_prime,coef_delta_rho,coef_theta;
+  double * pvecback;
+  struct perturbations_vector * pv;
+
+  pvecback = ppw->pvecback;
+  pv = ppw->pv;
+
+  k2 = k*k;
+  a = pvecback[pba->index_bg_a];
+  a2 = a*a;
+  a_prime_over_a = pvecback[pba->index_bg_H] * a;
+  s2_squared = 1.-3.*pba->K/k2;
+
+  /* eta' = (1.5 a^2 (rho+p)theta + 0.5 K h')/k^2/s2_squared, with
+     h' = (k^2 s2_squared eta + 1.5 a^2 delta_rho)/(0.5 a'/a) */
+
+  coef_h_prime = weight_h_prime + weight_eta_prime*0.5*pba->K/k2/s2_squared;
+  coef_delta_rho = coef_h_prime*1.5*a2/(0.5*a_prime_over_a);
+  coef_theta = weight_eta_prime*1.5*a2/k2/s2_squared;
+
+  if (coef_h_prime != 0.) {
+    _add_jacobian_entry_(index_row,pv->index_pt_eta,coef_h_prime*k2*s2_squared/(0.5*a_prime_over_a));
+  }
+
+  if (coef_delta_rho != 0.) {
+    _add_jacobian_entry_(index_row,pv->index_pt_delta_g,coef_delta_rho*pvecback[pba->index_bg_rho_g]);
+    _add_jacobian_entry_(index_row,pv->index_pt_delta_b,coef_delta_rho*pvecback[pba->index_bg_rho_b]);
+    if (pba->has_cdm == _TRUE_) {
+      _add_jacobian_entry_(index_row,pv->index_pt_delta_cdm,coef_delta_rho*pvecback[pba->index_bg_rho_cdm]);
+    }
+    if (pba->has_ur == _TRUE_) {
+      _add_jacobian_entry_(index_row,pv->index_pt_delta_ur,coef_delta_rho*pvecback[pba->index_bg_rho_ur]);
+    }
+  }
+
+  if (coef_theta != 0.) {
+    _add_jacobian_entry_(index_row,pv->index_pt_theta_g,coef_theta*4./3.*pvecback[pba->index_bg_rho_g]);
+    _add_jacobian_entry_(index_row,pv->index_pt_theta_b,coef_theta*pvecback[pba->index_bg_rho_b]);
+    if (pba->has_ur == _TRUE_) {
+      _add_jacobian_entry_(index_row,pv->index_pt_theta_ur,coef_theta*4./3.*pvecback[pba->index_bg_rho_ur]);
+    }
+  }
+
+  if (pba->has_ncdm == _TRUE_) {
+
+    idx = pv->index_pt_psi0_ncdm1;
+
+    for (n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++){
+
+      factor = pba->factor_ncdm[n_ncdm]/pow(a,4);
+
+      for (index_q=0; index_q < pv->q_size_ncdm[n_ncdm]; index_q ++) {
+
+        q = pba->q_ncdm[n_ncdm][index_q];
+        q2 = q*q;
+        epsilon = sqrt(q2+pba->M_ncdm[n_ncdm]*pba->M_ncdm[n_ncdm]*a2);
+
+        if (coef_delta_rho != 0.) {
+          _add_jacobian_entry_(index_row,idx,coef_delta_rho*factor*q2*epsilon*pba->w_ncdm[n_ncdm][index_q]);
+        }
+        if (coef_theta != 0.) {
+          _add_jacobian_entry_(index_row,idx+1,coef_theta*k*factor*q2*q*pba->w_ncdm[n_ncdm][index_q]);
+        }
+
+        idx+=(pv->l_max_ncdm[n_ncdm]+1);
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * Compute the baryon-photon slip (theta_g - theta_b)' and the photon
  * shear in the tight-coupling approximation
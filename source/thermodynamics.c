@@ -32,12 +32,22 @@
  */
 
 #include "thermodynamics.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "history.h"
 #include "hyrectools.h"
 #include "helium.h"
 #include "wrap_hyrec.h"
 
+/**
+ * Content of the emulator file of the recombination history, read
+ * once and shared by all the runs of the process (see
+ * thermodynamics_emulator_table_get()).
+ */
+static struct recombination_emulator_table * emulator_shared_table = NULL;
+static int emulator_shared_refcount = 0;
+
 
 /**
  * Thermodynamics quantities at given redshift z.
@@ -248,7 +258,29 @@ int thermodynamics_at_z(
     /* in the "normal" case, use spline interpolation */
     else {
 
-      if (inter_mode == inter_normal) {
+      if ((inter_mode == inter_normal) && (pth->has_index_guide == _TRUE_)) {
+
+        *last_index = array_index_guide_find(pth->z_guide,
+                                             pth->z_guide_size,
+                                             pth->z_guide_u_min,
+                                             pth->z_guide_du,
+                                             log1p(z));
+
+        class_call(array_interpolate_spline_guided(pth->z_table,
+                                                   pth->tt_size,
+                                                   pth->thermodynamics_table,
+                                                   pth->d2thermodynamics_dz2_table,
+                                                   pth->th_size,
+                                                   z,
+                                                   last_index,
+                                                   pvecthermo,
+                                                   pth->th_size,
+                                                   pth->error_message),
+                   pth->error_message,
+                   pth->error_message);
+      }
+
+      else if (inter_mode == inter_normal) {
 
         class_call(array_interpolate_spline(pth->z_table,
                                             pth->tt_size,
@@ -452,6 +484,8 @@ int thermodynamics_free(
   free(pth->tau_table);
   free(pth->thermodynamics_table);
   free(pth->d2thermodynamics_dz2_table);
+  if (pth->has_index_guide == _TRUE_)
+    free(pth->z_guide);
 
   class_call(thermodynamics_free_input(pth),
              pth->error_message,
@@ -1111,7 +1145,8 @@ int thermodynamics_lists(
 
   pth->tt_size = ptw->Nz_tot;
 
-  /** - allocate tables*/
+  /** - allocate tables (the index guide is only switched on once they are filled) */
+  pth->has_index_guide = _FALSE_;
   class_alloc(pth->tau_table,pth->tt_size*sizeof(double),pth->error_message);
   class_alloc(pth->z_table,pth->tt_size*sizeof(double),pth->error_message);
   class_alloc(pth->thermodynamics_table,pth->th_size*pth->tt_size*sizeof(double),pth->error_message);
@@ -1548,14 +1583,18 @@ int thermodynamics_solve(
   /* other z sampling variables */
   int i;
   double * mz_output;
+  /* emulated recombination history */
+  double * emulated = NULL;
+  int * emulated_line = NULL;
+  short found = _FALSE_;
+  int index_tau_min,z_size;
+  int index_interval_start = 0;
 
   /* contains all fixed parameters which should be passed to thermodynamics_derivs */
   struct thermodynamics_parameters_and_workspace tpaw;
 
-  /* function pointer to ODE evolver and names of possible evolvers. */
-  extern int evolver_rk();
-  extern int evolver_ndf15();
-  int (*generic_evolver)() = evolver_ndf15;
+  /* function pointer to ODE evolver (see evolver_function in common.h) */
+  evolver_function generic_evolver = evolver_ndf15;
 
   /** - choose evolver */
   switch (ppr->thermo_evolver) {
@@ -1596,15 +1635,54 @@ int thermodynamics_solve(
     interval_limit[index_ap+1] = -ptw->ptdw->ap_z_limits[index_ap];
   }
 
+  /** - if requested, interpolate the history before reionization in
+      the emulator table. If this is possible, the table is filled up
+      to the beginning of reionization, and only the reionization
+      interval will be integrated (unless we just want to compare the
+      two results, in which case all intervals are integrated) */
+
+  pth->recombination_emulator_used = _FALSE_;
+  pth->recombination_emulator_error = -1.;
+
+  if (pth->recombination_emulator == rec_emulator_use) {
+
+    class_call(thermodynamics_emulator_sampling(ppr,pth,&index_tau_min,&emulated_line,&z_size),
+               pth->error_message,
+               pth->error_message);
+
+    class_alloc(emulated,(3*(pth->tt_size-index_tau_min)+3)*sizeof(double),pth->error_message);
+
+    class_call(thermodynamics_emulator_evaluate(ppr,pba,pth,index_tau_min,emulated_line,z_size,emulated,&found),
+               pth->error_message,
+               pth->error_message);
+
+    if ((found == _TRUE_) && (pth->recombination_emulator_check == _FALSE_)) {
+
+      class_call(thermodynamics_emulator_start(pth,ptw,index_tau_min,emulated),
+                 pth->error_message,
+                 pth->error_message);
+
+      index_interval_start = ptw->ptdw->index_ap_reio;
+      pth->recombination_emulator_used = _TRUE_;
+    }
+  }
+
   /** - loop over intervals over which approximation scheme is
       uniform. For each interval: */
 
-  for (index_interval=0; index_interval<interval_number; index_interval++) {
+  for (index_interval=index_interval_start; index_interval<interval_number; index_interval++) {
 
     /** - --> (a) fix current approximation scheme. */
 
     ptw->ptdw->ap_current = index_interval;
 
+    /* keep track of the state of the network at the beginning of reionization (used to train the emulator) */
+    if (index_interval == ptw->ptdw->index_ap_reio) {
+      pth->x_H_reio_start = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_x_H];
+      pth->x_He_reio_start = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_x_He];
+      pth->D_Tmat_reio_start = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_D_Tmat];
+    }
+
     /** - --> (b) define the vector of quantities to be integrated
         over. If the current interval starts from the
         initial time zinitial, fill the vector with initial
@@ -1671,6 +1749,8 @@ int thermodynamics_solve(
                                  pth->tt_size, // size of previous array
                                  thermodynamics_sources, // function for output
                                  NULL, // print variables
+                                 NULL, // jacobian (computed numerically)
+                                 NULL, // jacobian cache (not kept between calls)
                                  pth->error_message),
                  pth->error_message,
                  pth->error_message);
@@ -1678,6 +1758,24 @@ int thermodynamics_solve(
 
   }
 
+  /** - if requested, compare the integrated history with the emulated one */
+  if ((found == _TRUE_) && (pth->recombination_emulator_check == _TRUE_)) {
+
+    class_call(thermodynamics_emulator_compare(pth,index_tau_min,emulated,&(pth->recombination_emulator_error)),
+               pth->error_message,
+               pth->error_message);
+
+    if (pth->thermodynamics_verbose > 0) {
+      printf(" -> emulated recombination history differs from the integrated one by at most %e (tolerance %e)\n",
+             pth->recombination_emulator_error,ppr->recombination_emulator_tolerance);
+    }
+  }
+
+  if (emulated != NULL) {
+    free(emulated);
+    free(emulated_line);
+  }
+
   /** - Compute reionization optical depth, if not supplied as input parameter */
   if (pth->reio_z_or_tau == reio_z) {
 
@@ -1761,6 +1859,27 @@ int thermodynamics_calculate_remaining_quantities(
              pth->error_message,
              pth->error_message);
 
+  /** - if requested, build the index guide used by thermodynamics_at_z()
+      to find its interpolation interval without bisection. The z
+      sampling is linear at low z and logarithmic at high z, so the
+      guide is uniform in log(1+z), with as many nodes as lines in
+      the table */
+  if (ppr->interpolation_index_guide == _TRUE_) {
+    pth->z_guide_size = pth->tt_size;
+    class_alloc(pth->z_guide,pth->z_guide_size*sizeof(int),pth->error_message);
+    class_call(array_index_guide_init(pth->z_table,
+                                      pth->tt_size,
+                                      log1p,
+                                      pth->z_guide_size,
+                                      pth->z_guide,
+                                      &(pth->z_guide_u_min),
+                                      &(pth->z_guide_du),
+                                      pth->error_message),
+               pth->error_message,
+               pth->error_message);
+    pth->has_index_guide = _TRUE_;
+  }
+
   class_call(thermodynamics_calculate_recombination_quantities(ppr,pba,pth,pvecback),
              pth->error_message,
              pth->error_message);
@@ -2189,10 +2308,8 @@ int thermodynamics_reionization_evolve_with_tau(
   struct thermodynamics * pth;
   struct thermo_workspace * ptw;
 
-  /* function pointer to ODE evolver and names of possible evolvers */
-  extern int evolver_rk();
-  extern int evolver_ndf15();
-  int (*generic_evolver)() = evolver_ndf15;
+  /* function pointer to ODE evolver (see evolver_function in common.h) */
+  evolver_function generic_evolver = evolver_ndf15;
 
   /* pointers towards two thermo vector stuctures (see below) */
 
@@ -2297,6 +2414,8 @@ int thermodynamics_reionization_evolve_with_tau(
                              mz_size, // size of previous array
                              thermodynamics_sources, // function for output
                              NULL, // print variables
+                             NULL, // jacobian (computed numerically)
+                             NULL, // jacobian cache (not kept between calls)
                              pth->error_message),
              pth->error_message,
              pth->error_message);
@@ -2362,6 +2481,8 @@ int thermodynamics_reionization_evolve_with_tau(
                              mz_size, // size of previous array
                              thermodynamics_sources, // function for output
                              NULL, // print variables
+                             NULL, // jacobian (computed numerically)
+                             NULL, // jacobian cache (not kept between calls)
                              pth->error_message),
              pth->error_message,
              pth->error_message);
@@ -2436,6 +2557,8 @@ int thermodynamics_reionization_evolve_with_tau(
                                mz_size, // size of previous array
                                thermodynamics_sources, // function for output
                                NULL, // print variables
+                               NULL, // jacobian (computed numerically)
+                               NULL, // jacobian cache (not kept between calls)
                                pth->error_message),
                pth->error_message,
                pth->error_message);
@@ -2980,26 +3103,9 @@ int thermodynamics_sources(
 
   /** - Store the results in the table. Results are obtained in order of decreasing z, and stored in order of growing z */
 
-  /* ionization fraction */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_xe] = x;
-
-  /* Tb */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_Tb] = Tmat;
-
-  /* Baryon temperature derivative */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_dTb] = dTmat;
-
-  /* wb = (k_B/mu) Tb */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_wb]
-    = _k_B_ / ( _c_ * _c_ * _m_H_ ) * (1. + (1./_not4_ - 1.) * ptw->YHe + x * (1.-ptw->YHe)) * Tmat;
-
-  /* cb2 = (k_B/mu) Tb (1-1/3 dlnTb/dlna) = (k_B/mu) Tb (1 + 1/3 (1+z) dlnTb/dz) */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_cb2]
-    = _k_B_ / ( _c_ * _c_ * _m_H_ ) * (1. + (1./_not4_ - 1.) * ptw->YHe + x * (1.-ptw->YHe)) * Tmat * (1. + (1.+z) * dTmat / Tmat / 3.);
-
-  /* dkappa/dtau = a n_e x_e sigma_T = a^{-2} n_e(today) x_e sigma_T (in units of 1/Mpc) */
-  pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size+pth->index_th_dkappa]
-    = (1.+z) * (1.+z) * ptw->SIunit_nH0 * x * sigmaTrescale * _sigma_ * _Mpc_over_m_;
+  class_call(thermodynamics_table_store(pth,ptw,pth->tt_size-index_z-1,z,x,Tmat,dTmat,sigmaTrescale),
+             pth->error_message,
+             error_message);
 
   if (pba->has_idm == _TRUE_) {
     pth->thermodynamics_table[(pth->tt_size-index_z-1)*pth->th_size + pth->index_th_T_idm] = ptdw->T_idm;
@@ -3023,6 +3129,57 @@ int thermodynamics_sources(
   return _SUCCESS_;
 }
 
+/**
+ * Store in one line of the thermodynamics table the ionization
+ * fraction, the baryon temperature, and the quantities directly
+ * inferred from them.
+ *
+ * @param pth           Input/Output: pointer to the thermodynamics structure
+ * @param ptw           Input: pointer to thermodynamics workspace
+ * @param index_tau     Input: index of the line in the table
+ * @param z             Input: redshift
+ * @param x             Input: ionization fraction
+ * @param Tmat          Input: baryon temperature
+ * @param dTmat         Input: derivative of the baryon temperature with respect to z
+ * @param sigmaTrescale Input: rescaling of the Thomson cross-section (for varying fundamental constants)
+ * @return the error status
+ */
+
+int thermodynamics_table_store(
+                               struct thermodynamics * pth,
+                               struct thermo_workspace * ptw,
+                               int index_tau,
+                               double z,
+                               double x,
+                               double Tmat,
+                               double dTmat,
+                               double sigmaTrescale
+                               ) {
+
+  /* ionization fraction */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_xe] = x;
+
+  /* Tb */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_Tb] = Tmat;
+
+  /* Baryon temperature derivative */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_dTb] = dTmat;
+
+  /* wb = (k_B/mu) Tb */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_wb]
+    = _k_B_ / ( _c_ * _c_ * _m_H_ ) * (1. + (1./_not4_ - 1.) * ptw->YHe + x * (1.-ptw->YHe)) * Tmat;
+
+  /* cb2 = (k_B/mu) Tb (1-1/3 dlnTb/dlna) = (k_B/mu) Tb (1 + 1/3 (1+z) dlnTb/dz) */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_cb2]
+    = _k_B_ / ( _c_ * _c_ * _m_H_ ) * (1. + (1./_not4_ - 1.) * ptw->YHe + x * (1.-ptw->YHe)) * Tmat * (1. + (1.+z) * dTmat / Tmat / 3.);
+
+  /* dkappa/dtau = a n_e x_e sigma_T = a^{-2} n_e(today) x_e sigma_T (in units of 1/Mpc) */
+  pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_dkappa]
+    = (1.+z) * (1.+z) * ptw->SIunit_nH0 * x * sigmaTrescale * _sigma_ * _Mpc_over_m_;
+
+  return _SUCCESS_;
+}
+
 /**
  * Get the optical depth of reionization tau_reio for a given thermodynamical history.
  *
@@ -4763,3 +4920,1015 @@ int thermodynamics_idm_initial_temperature(
 
   return _SUCCESS_;
 }
+
+/**
+ * Compute the parameters on which the emulated recombination history
+ * depends, in the order of the enumeration recombination_emulator_parameter.
+ *
+ * @param pba       Input: pointer to background structure
+ * @param pth       Input: pointer to thermodynamics structure
+ * @param parameter Output: array of size rec_emulator_parameter_size
+ * @return the error status
+ */
+
+int thermodynamics_emulator_parameters(
+                                       struct background * pba,
+                                       struct thermodynamics * pth,
+                                       double * parameter
+                                       ) {
+
+  parameter[rec_emulator_omega_b] = pba->Omega0_b*pba->h*pba->h;
+  parameter[rec_emulator_omega_cdm] = pba->Omega0_cdm*pba->h*pba->h;
+  parameter[rec_emulator_YHe] = pth->YHe;
+  parameter[rec_emulator_Neff] = pba->Neff;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Define the lines of the thermodynamics table stored in the emulator
+ * file, between the beginning of reionization (line index_tau_min)
+ * and the initial redshift (last line). The lines in between, if any,
+ * are obtained by spline interpolation in z.
+ *
+ * We store one line every recombination_emulator_z_stride lines (by
+ * default, all of them), and all the first lines: the spline
+ * estimates its derivative at the first point, and a coarse sampling
+ * there would spoil the accuracy close to reionization.
+ *
+ * @param ppr           Input: pointer to precision structure
+ * @param pth           Input: pointer to thermodynamics structure (with tt_size and z_table already set)
+ * @param index_tau_min Output: index of the line at the beginning of reionization
+ * @param line          Output: array of indices of the stored lines, allocated here, to be freed by the caller
+ * @param z_size        Output: number of stored lines
+ * @return the error status
+ */
+
+int thermodynamics_emulator_sampling(
+                                     struct precision * ppr,
+                                     struct thermodynamics * pth,
+                                     int * index_tau_min,
+                                     int ** line,
+                                     int * z_size
+                                     ) {
+
+  int stride,index_tau;
+
+  /* same number of reionization lines as in thermodynamics_workspace_init() */
+  *index_tau_min = ppr->reionization_z_start_max / ppr->reionization_sampling;
+  stride = ppr->recombination_emulator_z_stride;
+
+  class_test((stride < 1) || (*index_tau_min+stride >= pth->tt_size-1),
+             pth->error_message,
+             "inconsistent sampling of the emulator table (stride=%d, first line %d out of %d)",
+             stride,*index_tau_min,pth->tt_size);
+
+  class_alloc(*line,(pth->tt_size-*index_tau_min)*sizeof(int),pth->error_message);
+
+  *z_size = 0;
+  for (index_tau=*index_tau_min; index_tau<pth->tt_size; index_tau++) {
+    if ((index_tau-*index_tau_min < stride) || ((index_tau-*index_tau_min)%stride == 0) || (index_tau == pth->tt_size-1)) {
+      (*line)[*z_size] = index_tau;
+      (*z_size)++;
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Get the content of the emulator file, shared read-only by all the
+ * runs of the process: the file is only read by the first call (or
+ * again if it was modified in the meantime), and kept in memory for
+ * the next runs. Each call must be followed by a call to
+ * thermodynamics_emulator_table_release().
+ *
+ * If the table of another file is still in use, the caller gets its
+ * own copy of the file, which is freed when released.
+ *
+ * @param file          Input: name of the emulator file
+ * @param ptable        Output: pointer to the content of the file
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_emulator_table_get(
+                                      char * file,
+                                      struct recombination_emulator_table ** ptable,
+                                      ErrorMsg error_message
+                                      ) {
+  int status;
+
+#pragma omp critical (emulator_shared)
+  {
+    status = thermodynamics_emulator_table_get_serial(file,ptable,error_message);
+  }
+
+  if ((status == _SUCCESS_) && (*ptable == NULL)) {
+    class_alloc(*ptable,sizeof(struct recombination_emulator_table),error_message);
+    class_call_except(thermodynamics_emulator_table_read(file,*ptable,error_message),
+                      error_message,
+                      error_message,
+                      free(*ptable));
+  }
+
+  return status;
+}
+
+/**
+ * Body of thermodynamics_emulator_table_get(), to be called by one
+ * thread at a time. Returns a NULL pointer if the shared table
+ * describes another file which is still in use.
+ *
+ * @param file          Input: name of the emulator file
+ * @param ptable        Output: pointer to the shared content of the file, or NULL
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_emulator_table_get_serial(
+                                             char * file,
+                                             struct recombination_emulator_table ** ptable,
+                                             ErrorMsg error_message
+                                             ) {
+
+  struct stat file_status;
+
+  *ptable = NULL;
+
+  class_test(stat(file,&file_status) != 0,
+             error_message,
+             "could not open emulator file %s",file);
+
+  /** - table of another file, or of a file modified since it was read: replace it if it is not used anymore */
+  if ((emulator_shared_table != NULL) &&
+      ((strcmp(emulator_shared_table->file,file) != 0) ||
+       (emulator_shared_table->file_time != (long long)file_status.st_mtime) ||
+       (emulator_shared_table->file_size != (long long)file_status.st_size))) {
+    if (emulator_shared_refcount > 0)
+      return _SUCCESS_;
+    thermodynamics_emulator_table_free(emulator_shared_table);
+    free(emulator_shared_table);
+    emulator_shared_table = NULL;
+  }
+
+  /** - read the file the first time */
+  if (emulator_shared_table == NULL) {
+
+    class_alloc(emulator_shared_table,sizeof(struct recombination_emulator_table),error_message);
+
+    class_call_except(thermodynamics_emulator_table_read(file,emulator_shared_table,error_message),
+                      error_message,
+                      error_message,
+                      free(emulator_shared_table);emulator_shared_table=NULL);
+  }
+
+  emulator_shared_refcount++;
+  *ptable = emulator_shared_table;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Release the content of the emulator file obtained with
+ * thermodynamics_emulator_table_get(). The shared table is kept in
+ * memory for the next runs, while a private copy is freed.
+ *
+ * @param ptable        Input: pointer to the content of the file
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_emulator_table_release(
+                                          struct recombination_emulator_table * ptable,
+                                          ErrorMsg error_message
+                                          ) {
+
+  short shared;
+
+#pragma omp critical (emulator_shared)
+  {
+    shared = (ptable == emulator_shared_table) ? _TRUE_ : _FALSE_;
+    if (shared == _TRUE_)
+      emulator_shared_refcount--;
+  }
+
+  if (shared == _FALSE_) {
+    thermodynamics_emulator_table_free(ptable);
+    free(ptable);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Read an emulator file written by thermodynamics_emulator_train().
+ * A file which is not a complete emulator table is not an error:
+ * the field complete is then set to _FALSE_.
+ *
+ * @param file          Input: name of the emulator file
+ * @param ptable        Output: content of the file
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int thermodynamics_emulator_table_read(
+                                       char * file,
+                                       struct recombination_emulator_table * ptable,
+                                       ErrorMsg error_message
+                                       ) {
+
+  FILE * emulator_file;
+  struct stat file_status;
+  char magic[8];
+  int parameter_size,node_number,index_p;
+
+  class_test(stat(file,&file_status) != 0,
+             error_message,
+             "could not open emulator file %s",file);
+
+  strcpy(ptable->file,file);
+  ptable->file_time = (long long)file_status.st_mtime;
+  ptable->file_size = (long long)file_status.st_size;
+  ptable->complete = _FALSE_;
+  ptable->z = NULL;
+  ptable->node = NULL;
+
+  class_open(emulator_file,file,"rb",error_message);
+
+  if ((fread(magic,sizeof(char),8,emulator_file) == 8) &&
+      (strncmp(magic,"CLASSREC",8) == 0) &&
+      (fread(&(ptable->validation_error),sizeof(double),1,emulator_file) == 1) &&
+      (fread(&(ptable->recombination),sizeof(int),1,emulator_file) == 1) &&
+      (fread(&(ptable->T_cmb),sizeof(double),1,emulator_file) == 1) &&
+      (fread(&parameter_size,sizeof(int),1,emulator_file) == 1) &&
+      (parameter_size == rec_emulator_parameter_size) &&
+      (fread(&(ptable->points),sizeof(int),1,emulator_file) == 1) &&
+      (ptable->points > 1) &&
+      (fread(ptable->p_min,sizeof(double),rec_emulator_parameter_size,emulator_file) == rec_emulator_parameter_size) &&
+      (fread(ptable->p_max,sizeof(double),rec_emulator_parameter_size,emulator_file) == rec_emulator_parameter_size) &&
+      (fread(&(ptable->tt_size),sizeof(int),1,emulator_file) == 1) &&
+      (fread(&(ptable->index_tau_min),sizeof(int),1,emulator_file) == 1) &&
+      (fread(&(ptable->z_size),sizeof(int),1,emulator_file) == 1) &&
+      (ptable->z_size > 1)) {
+
+    ptable->node_size = 3*ptable->z_size+3;
+    node_number = 1;
+    for (index_p=0; index_p<rec_emulator_parameter_size; index_p++)
+      node_number *= ptable->points;
+
+    class_alloc(ptable->z,ptable->z_size*sizeof(double),error_message);
+    class_alloc(ptable->node,(long)node_number*ptable->node_size*sizeof(double),error_message);
+
+    if ((fread(ptable->z,sizeof(double),ptable->z_size,emulator_file) == ptable->z_size) &&
+        (fread(ptable->node,sizeof(double),(long)node_number*ptable->node_size,emulator_file) == (long)node_number*ptable->node_size)) {
+      ptable->complete = _TRUE_;
+    }
+    else {
+      thermodynamics_emulator_table_free(ptable);
+    }
+  }
+
+  fclose(emulator_file);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the arrays of an emulator table.
+ *
+ * @param ptable Input: pointer to the content of an emulator file
+ * @return the error status
+ */
+
+int thermodynamics_emulator_table_free(
+                                       struct recombination_emulator_table * ptable
+                                       ) {
+
+  if (ptable->z != NULL)
+    free(ptable->z);
+  if (ptable->node != NULL)
+    free(ptable->node);
+  ptable->z = NULL;
+  ptable->node = NULL;
+  ptable->complete = _FALSE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Interpolate the history before reionization in the emulator table
+ * written by a previous training run (see
+ * thermodynamics_emulator_train()).
+ *
+ * The table contains, for each node of a regular grid in the
+ * parameters of thermodynamics_emulator_parameters(), the logarithm
+ * of \f$ x_e \f$ and \f$ T_b \f$ and \f$ d \ln T_b / dz \f$ on a
+ * subset of the lines of the thermodynamics table (see
+ * thermodynamics_emulator_sampling()), as well as the state of the
+ * recombination network at the beginning of reionization. We
+ * interpolate with quadratic Lagrange polynomials along each
+ * parameter direction, and with splines in z.
+ *
+ * If the table cannot be used for the current model (parameters out
+ * of the training range, other recombination code, different
+ * sampling, insufficient accuracy of the table, or physical effects
+ * that the emulator does not capture), found is set to _FALSE_ and
+ * the recombination network should be integrated as usual.
+ *
+ * @param ppr           Input: pointer to precision structure
+ * @param pba           Input: pointer to background structure
+ * @param pth           Input: pointer to thermodynamics structure (with z_table already set)
+ * @param index_tau_min Input: index of the line at the beginning of reionization
+ * @param line          Input: indices of the lines stored in the emulator table, from thermodynamics_emulator_sampling()
+ * @param z_size        Input: number of stored lines
+ * @param emulated      Output: \f$ x_e, T_b, dT_b/dz \f$ for each line from index_tau_min to tt_size-1, followed by x_H, x_He, T_b-T_cmb at the beginning of reionization
+ * @param found         Output: _TRUE_ if the emulated history could be computed
+ * @return the error status
+ */
+
+int thermodynamics_emulator_evaluate(
+                                     struct precision * ppr,
+                                     struct background * pba,
+                                     struct thermodynamics * pth,
+                                     int index_tau_min,
+                                     int * line,
+                                     int z_size,
+                                     double * emulated,
+                                     short * found
+                                     ) {
+
+  struct recombination_emulator_table * ptable;
+  double parameter[rec_emulator_parameter_size];
+  int first[rec_emulator_parameter_size];
+  int size[rec_emulator_parameter_size];
+  double weight[rec_emulator_parameter_size][3];
+  int offset[rec_emulator_parameter_size];
+  double * node;
+  double * ln_history;
+  double * dd_ln_history;
+  int node_size,index_p,index_z,index_tau,i,index_node,last_index;
+  double w;
+  double result[3];
+  short consistent;
+  char reason[_LINE_LENGTH_MAX_];
+
+  *found = _FALSE_;
+
+  /** - the emulator only describes the standard recombination physics */
+  if ((pba->has_idm == _TRUE_) || (pba->has_idr == _TRUE_) || (pth->has_exotic_injection == _TRUE_) || (pth->has_varconst == _TRUE_)) {
+    if (pth->thermodynamics_verbose > 0)
+      printf(" -> recombination emulator not applicable to models with idm, idr, exotic injection or varying constants: integrating\n");
+    return _SUCCESS_;
+  }
+
+  /** - get the content of the file, and check that it is consistent with this run */
+  class_call(thermodynamics_emulator_table_get(pth->recombination_emulator_file,&ptable,pth->error_message),
+             pth->error_message,
+             pth->error_message);
+
+  consistent = _TRUE_;
+
+  if (ptable->complete == _FALSE_) {
+    sprintf(reason,"file %s is not a complete emulator table",pth->recombination_emulator_file);
+    consistent = _FALSE_;
+  }
+  else if ((ptable->recombination != (int)pth->recombination) || (fabs(ptable->T_cmb/pba->T_cmb-1.) > ppr->smallest_allowed_variation)) {
+    sprintf(reason,"emulator table computed with another recombination code or T_cmb");
+    consistent = _FALSE_;
+  }
+  else if ((ptable->tt_size != pth->tt_size) || (ptable->index_tau_min != index_tau_min) || (ptable->z_size != z_size)) {
+    sprintf(reason,"emulator table computed with a different sampling of the thermodynamics table");
+    consistent = _FALSE_;
+  }
+  else if ((pth->recombination_emulator_check == _FALSE_) &&
+           ((ptable->validation_error < 0.) || (ptable->validation_error > ppr->recombination_emulator_tolerance))) {
+    sprintf(reason,"accuracy of emulator table (%e) not validated or above tolerance (%e)",ptable->validation_error,ppr->recombination_emulator_tolerance);
+    consistent = _FALSE_;
+  }
+  else {
+    for (index_z=0; index_z<z_size; index_z++) {
+      index_tau = line[index_z];
+      if (fabs(ptable->z[index_z]-pth->z_table[index_tau]) > ppr->smallest_allowed_variation*MAX(1.,pth->z_table[index_tau])) {
+        sprintf(reason,"emulator table computed with a different sampling of the thermodynamics table");
+        consistent = _FALSE_;
+        break;
+      }
+    }
+  }
+
+  if (consistent == _FALSE_) {
+    class_call(thermodynamics_emulator_table_release(ptable,pth->error_message),
+               pth->error_message,
+               pth->error_message);
+    if (pth->thermodynamics_verbose > 0)
+      printf(" -> [WARNING:] %s: integrating\n",reason);
+    return _SUCCESS_;
+  }
+
+  /** - check that the model is within the training range, and get the interpolation weights */
+  class_call(thermodynamics_emulator_parameters(pba,pth,parameter),
+             pth->error_message,
+             pth->error_message);
+
+  for (index_p=0; index_p<rec_emulator_parameter_size; index_p++) {
+    if ((parameter[index_p] < ptable->p_min[index_p]) || (parameter[index_p] > ptable->p_max[index_p])) {
+      if (pth->thermodynamics_verbose > 0)
+        printf(" -> parameter %d of recombination emulator (%e) outside of training range [%e, %e]: integrating\n",
+               index_p,parameter[index_p],ptable->p_min[index_p],ptable->p_max[index_p]);
+      class_call(thermodynamics_emulator_table_release(ptable,pth->error_message),
+                 pth->error_message,
+                 pth->error_message);
+      return _SUCCESS_;
+    }
+
+    class_call(thermodynamics_emulator_weights(ptable->points,ptable->p_min[index_p],ptable->p_max[index_p],parameter[index_p],&(first[index_p]),&(size[index_p]),weight[index_p]),
+               pth->error_message,
+               pth->error_message);
+  }
+
+  /** - sum the contributions of the nodes in the interpolation stencil */
+  node_size = ptable->node_size;
+
+  class_calloc(ln_history,node_size,sizeof(double),pth->error_message);
+
+  for (index_p=0; index_p<rec_emulator_parameter_size; index_p++)
+    offset[index_p] = 0;
+
+  do {
+
+    index_node = 0;
+    w = 1.;
+    for (index_p=rec_emulator_parameter_size-1; index_p>=0; index_p--) {
+      index_node = index_node*ptable->points+first[index_p]+offset[index_p];
+      w *= weight[index_p][offset[index_p]];
+    }
+
+    node = ptable->node+(long)index_node*node_size;
+    for (i=0; i<node_size; i++)
+      ln_history[i] += w*node[i];
+
+    /* next node of the stencil */
+    for (index_p=0; index_p<rec_emulator_parameter_size; index_p++) {
+      offset[index_p]++;
+      if (offset[index_p] < size[index_p])
+        break;
+      offset[index_p] = 0;
+    }
+
+  } while (index_p < rec_emulator_parameter_size);
+
+  /** - copy the stored lines, or interpolate in z on all lines of the table */
+  if (z_size == pth->tt_size-index_tau_min) {
+    for (index_tau=index_tau_min; index_tau<pth->tt_size; index_tau++) {
+      index_z = index_tau-index_tau_min;
+      emulated[3*index_z] = exp(ln_history[3*index_z]);
+      emulated[3*index_z+1] = exp(ln_history[3*index_z+1]);
+      emulated[3*index_z+2] = emulated[3*index_z+1]*ln_history[3*index_z+2];
+    }
+  }
+  else {
+    class_alloc(dd_ln_history,3*ptable->z_size*sizeof(double),pth->error_message);
+
+    class_call(array_spline_table_lines(ptable->z,
+                                        ptable->z_size,
+                                        ln_history,
+                                        3,
+                                        dd_ln_history,
+                                        _SPLINE_EST_DERIV_,
+                                        pth->error_message),
+               pth->error_message,
+               pth->error_message);
+
+    last_index = 0;
+    for (index_tau=index_tau_min; index_tau<pth->tt_size; index_tau++) {
+
+      class_call(array_interpolate_spline_growing_closeby(ptable->z,
+                                                          ptable->z_size,
+                                                          ln_history,
+                                                          dd_ln_history,
+                                                          3,
+                                                          pth->z_table[index_tau],
+                                                          &last_index,
+                                                          result,
+                                                          3,
+                                                          pth->error_message),
+                 pth->error_message,
+                 pth->error_message);
+
+      emulated[3*(index_tau-index_tau_min)] = exp(result[0]);
+      emulated[3*(index_tau-index_tau_min)+1] = exp(result[1]);
+      emulated[3*(index_tau-index_tau_min)+2] = exp(result[1])*result[2];
+    }
+
+    free(dd_ln_history);
+  }
+
+  for (i=0; i<3; i++)
+    emulated[3*(pth->tt_size-index_tau_min)+i] = ln_history[3*ptable->z_size+i];
+
+  free(ln_history);
+
+  class_call(thermodynamics_emulator_table_release(ptable,pth->error_message),
+             pth->error_message,
+             pth->error_message);
+
+  *found = _TRUE_;
+
+  if (pth->thermodynamics_verbose > 0)
+    printf(" -> recombination history interpolated in emulator table %s\n",pth->recombination_emulator_file);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Weights for interpolating along one parameter direction of the
+ * emulator grid: quadratic Lagrange polynomial on the three nodes
+ * closest to the parameter (linear if there are only two nodes).
+ *
+ * @param n      Input: number of nodes along this direction
+ * @param p_min  Input: first node
+ * @param p_max  Input: last node
+ * @param p      Input: value of the parameter (within [p_min, p_max])
+ * @param first  Output: index of the first node of the stencil
+ * @param size   Output: number of nodes in the stencil
+ * @param weight Output: weights of the nodes of the stencil (array of size 3)
+ * @return the error status
+ */
+
+int thermodynamics_emulator_weights(
+                                    int n,
+                                    double p_min,
+                                    double p_max,
+                                    double p,
+                                    int * first,
+                                    int * size,
+                                    double * weight
+                                    ) {
+
+  double t;
+
+  /* position in units of the grid step */
+  t = (p-p_min)/(p_max-p_min)*(n-1);
+
+  if (n == 2) {
+    *first = 0;
+    *size = 2;
+    weight[0] = 1.-t;
+    weight[1] = t;
+  }
+  else {
+    *first = MAX(MIN((int)(t+0.5),n-2),1)-1;
+    *size = 3;
+    t -= *first;
+    weight[0] = 0.5*(t-1.)*(t-2.);
+    weight[1] = -t*(t-2.);
+    weight[2] = 0.5*t*(t-1.);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Store the emulated history in the thermodynamics table, and set the
+ * vector of integrated quantities at the beginning of reionization, as
+ * if the previous approximation intervals had been integrated.
+ *
+ * @param pth           Input/Output: pointer to thermodynamics structure
+ * @param ptw           Input/Output: pointer to thermodynamics workspace
+ * @param index_tau_min Input: index of the line at the beginning of reionization
+ * @param emulated      Input: output of thermodynamics_emulator_evaluate()
+ * @return the error status
+ */
+
+int thermodynamics_emulator_start(
+                                  struct thermodynamics * pth,
+                                  struct thermo_workspace * ptw,
+                                  int index_tau_min,
+                                  double * emulated
+                                  ) {
+
+  int index_tau,index_ti;
+  double * state;
+  struct thermo_vector * ptv;
+
+  /** - fill the table above the beginning of reionization */
+  for (index_tau=index_tau_min; index_tau<pth->tt_size; index_tau++) {
+    class_call(thermodynamics_table_store(pth,
+                                          ptw,
+                                          index_tau,
+                                          pth->z_table[index_tau],
+                                          emulated[3*(index_tau-index_tau_min)],
+                                          emulated[3*(index_tau-index_tau_min)+1],
+                                          emulated[3*(index_tau-index_tau_min)+2],
+                                          1.),
+               pth->error_message,
+               pth->error_message);
+  }
+
+  /** - define the vector of the last interval before reionization (as in thermodynamics_vector_init()) */
+  class_alloc(ptv,sizeof(struct thermo_vector),pth->error_message);
+
+  index_ti = 0;
+  class_define_index(ptv->index_ti_D_Tmat,_TRUE_,index_ti,1);
+  class_define_index(ptv->index_ti_x_He,_TRUE_,index_ti,1);
+  class_define_index(ptv->index_ti_x_H,_TRUE_,index_ti,1);
+  ptv->ti_size = index_ti;
+
+  class_calloc(ptv->y,ptv->ti_size,sizeof(double),pth->error_message);
+  class_calloc(ptv->dy,ptv->ti_size,sizeof(double),pth->error_message);
+  class_alloc(ptv->used_in_output,ptv->ti_size*sizeof(int),pth->error_message);
+  for (index_ti=0; index_ti<ptv->ti_size; index_ti++) {
+    ptv->used_in_output[index_ti] = _TRUE_;
+  }
+
+  state = emulated+3*(pth->tt_size-index_tau_min);
+  ptv->y[ptv->index_ti_x_H] = state[0];
+  ptv->y[ptv->index_ti_x_He] = state[1];
+  ptv->y[ptv->index_ti_D_Tmat] = state[2];
+
+  ptw->ptdw->ptv = ptv;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute the difference between the emulated history and the one
+ * of the thermodynamics table, above the beginning of reionization:
+ * maximum relative difference on \f$ x_e, T_b \f$, and maximum
+ * difference on \f$ dx_e/dz \f$ relative to the maximum of
+ * \f$ |dx_e/dz| \f$. The latter is sensitive to interpolation
+ * errors which hardly affect \f$ x_e \f$ itself, but are amplified
+ * in the derivatives of \f$ \kappa' \f$ and of the visibility
+ * function used by the perturbations.
+ *
+ * @param pth           Input: pointer to thermodynamics structure
+ * @param index_tau_min Input: index of the line at the beginning of reionization
+ * @param emulated      Input: output of thermodynamics_emulator_evaluate()
+ * @param error         Output: largest of the differences
+ * @return the error status
+ */
+
+int thermodynamics_emulator_compare(
+                                    struct thermodynamics * pth,
+                                    int index_tau_min,
+                                    double * emulated,
+                                    double * error
+                                    ) {
+
+  int index_tau;
+  double x,Tmat,dz,slope,slope_max,slope_error;
+
+  *error = 0.;
+  slope_max = 0.;
+  slope_error = 0.;
+
+  for (index_tau=index_tau_min; index_tau<pth->tt_size; index_tau++) {
+    x = pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_xe];
+    Tmat = pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_Tb];
+    *error = MAX(*error,fabs(emulated[3*(index_tau-index_tau_min)]/x-1.));
+    *error = MAX(*error,fabs(emulated[3*(index_tau-index_tau_min)+1]/Tmat-1.));
+
+    if (index_tau < pth->tt_size-1) {
+      dz = pth->z_table[index_tau+1]-pth->z_table[index_tau];
+      slope = (pth->thermodynamics_table[(index_tau+1)*pth->th_size+pth->index_th_xe]-x)/dz;
+      slope_max = MAX(slope_max,fabs(slope));
+      slope_error = MAX(slope_error,fabs((emulated[3*(index_tau+1-index_tau_min)]-emulated[3*(index_tau-index_tau_min)])/dz-slope));
+    }
+  }
+
+  if (slope_max > 0.)
+    *error = MAX(*error,slope_error/slope_max);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Write the header of an emulator table: recombination code, training
+ * range, and sampling in z. The accuracy of the table is not known
+ * yet: it is set to -1, and should be overwritten at the beginning of
+ * the file (after the 8 first characters) once the table has been
+ * validated.
+ *
+ * @param ppr           Input: pointer to precision structure
+ * @param pba           Input: pointer to background structure
+ * @param pth           Input: pointer to thermodynamics structure (already initialized)
+ * @param emulator_file Input: file open in binary write mode
+ * @param p_min         Input: first node along each parameter direction
+ * @param p_max         Input: last node along each parameter direction
+ * @return the error status
+ */
+
+int thermodynamics_emulator_write_header(
+                                         struct precision * ppr,
+                                         struct background * pba,
+                                         struct thermodynamics * pth,
+                                         FILE * emulator_file,
+                                         double * p_min,
+                                         double * p_max
+                                         ) {
+
+  double validation_error = -1.;
+  int recombination = (int)pth->recombination;
+  int parameter_size = rec_emulator_parameter_size;
+  int index_tau_min,z_size,index_z;
+  int * line;
+  double z;
+
+  class_call(thermodynamics_emulator_sampling(ppr,pth,&index_tau_min,&line,&z_size),
+             pth->error_message,
+             pth->error_message);
+
+  fwrite("CLASSREC",sizeof(char),8,emulator_file);
+  fwrite(&validation_error,sizeof(double),1,emulator_file);
+  fwrite(&recombination,sizeof(int),1,emulator_file);
+  fwrite(&(pba->T_cmb),sizeof(double),1,emulator_file);
+  fwrite(&parameter_size,sizeof(int),1,emulator_file);
+  fwrite(&(pth->recombination_emulator_points),sizeof(int),1,emulator_file);
+  fwrite(p_min,sizeof(double),rec_emulator_parameter_size,emulator_file);
+  fwrite(p_max,sizeof(double),rec_emulator_parameter_size,emulator_file);
+  fwrite(&(pth->tt_size),sizeof(int),1,emulator_file);
+  fwrite(&index_tau_min,sizeof(int),1,emulator_file);
+  fwrite(&z_size,sizeof(int),1,emulator_file);
+
+  for (index_z=0; index_z<z_size; index_z++) {
+    z = pth->z_table[line[index_z]];
+    fwrite(&z,sizeof(double),1,emulator_file);
+  }
+
+  free(line);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Write in an emulator table the recombination history of the current
+ * model (one node of the training grid).
+ *
+ * @param ppr           Input: pointer to precision structure
+ * @param pth           Input: pointer to thermodynamics structure (already initialized)
+ * @param emulator_file Input: file open in binary write mode, after the header and the previous nodes
+ * @return the error status
+ */
+
+int thermodynamics_emulator_write_node(
+                                       struct precision * ppr,
+                                       struct thermodynamics * pth,
+                                       FILE * emulator_file
+                                       ) {
+
+  int index_tau_min,z_size,index_z,index_tau;
+  int * line;
+  double value[3];
+
+  class_call(thermodynamics_emulator_sampling(ppr,pth,&index_tau_min,&line,&z_size),
+             pth->error_message,
+             pth->error_message);
+
+  for (index_z=0; index_z<z_size; index_z++) {
+    index_tau = line[index_z];
+    value[0] = log(pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_xe]);
+    value[1] = log(pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_Tb]);
+    value[2] = pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_dTb]
+      /pth->thermodynamics_table[index_tau*pth->th_size+pth->index_th_Tb];
+    class_test_except(fwrite(value,sizeof(double),3,emulator_file) != 3,
+                      pth->error_message,
+                      free(line),
+                      "could not write in emulator file");
+  }
+
+  free(line);
+
+  value[0] = pth->x_H_reio_start;
+  value[1] = pth->x_He_reio_start;
+  value[2] = pth->D_Tmat_reio_start;
+  class_test(fwrite(value,sizeof(double),3,emulator_file) != 3,
+             pth->error_message,
+             "could not write in emulator file");
+
+  return _SUCCESS_;
+}
+
+/**
+ * Train the recombination emulator: compute the recombination history
+ * on a regular grid of (omega_b, omega_cdm, Y_He, N_eff) values
+ * centered on the input model, and write it in the emulator file
+ * (see thermodynamics_emulator_evaluate()). All other parameters keep
+ * their input value. The budget equation is closed by adjusting the
+ * cosmological constant (or the fluid if there is no cosmological
+ * constant), which has no impact on the history before reionization.
+ *
+ * The accuracy of the table is then estimated by comparing emulated
+ * and integrated histories in the middle of the cells surrounding the
+ * input model, and written in the header of the file.
+ *
+ * This is not done by thermodynamics_init(), since it requires many
+ * runs of the background and thermodynamics modules: it should be
+ * called once, after reading the input parameters, by the program
+ * preparing the table (like the class executable).
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pba Input: pointer to background structure, with input parameters (not initialized)
+ * @param pth Input: pointer to thermodynamics structure, with input parameters (not initialized)
+ * @return the error status
+ */
+
+int thermodynamics_emulator_train(
+                                  struct precision * ppr,
+                                  struct background * pba,
+                                  struct thermodynamics * pth
+                                  ) {
+
+  /** Summary: */
+
+  /** Define local variables */
+  int true_background_verbose;
+  int true_thermodynamics_verbose;
+  int true_hyrec_verbose;
+  short true_check;
+  FileName true_file;
+  double true_Omega0_b;
+  double true_Omega0_cdm;
+  double true_Omega0_ur;
+  double true_Omega0_lambda;
+  double true_Omega0_fld;
+  double true_YHe;
+  double reference[rec_emulator_parameter_size];
+  double p_min[rec_emulator_parameter_size];
+  double p_max[rec_emulator_parameter_size];
+  double parameter[rec_emulator_parameter_size];
+  double Omega0_ur_per_Neff;
+  double delta_Omega;
+  double validation_error;
+  int points,node_size,index_node,index_p,divisor;
+  FileName tmpname;
+  FILE * emulator_file;
+
+  if (pth->thermodynamics_verbose > 0) {
+    printf("Training the recombination emulator around this model\n");
+    printf(" -> calling background and thermodynamics modules on a grid of %d^%d models\n",
+           pth->recombination_emulator_points,rec_emulator_parameter_size);
+  }
+
+  /** Store the true cosmological parameters somewhere before using temporarily some fake ones in this function */
+  true_background_verbose = pba->background_verbose;
+  true_thermodynamics_verbose = pth->thermodynamics_verbose;
+  true_hyrec_verbose = pth->hyrec_verbose;
+  true_check = pth->recombination_emulator_check;
+  strcpy(true_file,pth->recombination_emulator_file);
+  true_Omega0_b = pba->Omega0_b;
+  true_Omega0_cdm = pba->Omega0_cdm;
+  true_Omega0_ur = pba->Omega0_ur;
+  true_Omega0_lambda = pba->Omega0_lambda;
+  true_Omega0_fld = pba->Omega0_fld;
+  true_YHe = pth->YHe;
+
+  /** The fake calls of the background and thermodynamics module will be done in non-verbose mode, with the full recombination network */
+  pba->background_verbose = 0;
+  pth->thermodynamics_verbose = 0;
+  pth->hyrec_verbose = 0;
+  pth->recombination_emulator = rec_emulator_none;
+  pth->recombination_emulator_check = _FALSE_;
+
+  /** The table is written under a temporary name, and renamed once it is complete */
+  class_test(snprintf(tmpname,_FILENAMESIZE_,"%s.%ld.tmp",true_file,(long)getpid()) >= _FILENAMESIZE_,
+             pth->error_message,
+             "the name of the temporary emulator file %s.*.tmp is longer than %d characters",
+             true_file,_FILENAMESIZE_-1);
+  class_open(emulator_file,tmpname,"wb",pth->error_message);
+
+  /** Get the parameters of the input model (Y_He may be inferred from BBN, N_eff from all relativistic species), and write the header */
+  class_call_except(background_init(ppr,pba), pba->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+  class_call_except(thermodynamics_init(ppr,pba,pth), pth->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+  class_call(thermodynamics_emulator_parameters(pba,pth,reference), pth->error_message, pth->error_message);
+
+  points = pth->recombination_emulator_points;
+  for (index_p=0; index_p<rec_emulator_parameter_size; index_p++) {
+    p_min[index_p] = reference[index_p]-pth->recombination_emulator_delta[index_p];
+    p_max[index_p] = reference[index_p]+pth->recombination_emulator_delta[index_p];
+  }
+
+  class_call_except(thermodynamics_emulator_write_header(ppr,pba,pth,emulator_file,p_min,p_max),
+                    pth->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+
+  class_call(thermodynamics_free(pth), pth->error_message, pth->error_message);
+  class_call(background_free_noinput(pba), pba->error_message, pth->error_message);
+
+  /* N_eff is varied through the density of ultra-relativistic relics */
+  Omega0_ur_per_Neff = 7./8.*pow(4./11.,4./3.)*pba->Omega0_g;
+
+  /** Compute and write the recombination history at each node */
+  node_size = 1;
+  for (index_p=0; index_p<rec_emulator_parameter_size; index_p++)
+    node_size *= points;
+
+  for (index_node=0; index_node<node_size; index_node++) {
+
+    divisor = 1;
+    for (index_p=0; index_p<rec_emulator_parameter_size; index_p++) {
+      parameter[index_p] = p_min[index_p]+(p_max[index_p]-p_min[index_p])*((index_node/divisor)%points)/(points-1);
+      divisor *= points;
+    }
+
+    if (true_thermodynamics_verbose > 2)
+      printf("    * computing recombination history for node %d/%d\n",index_node+1,node_size);
+
+    pba->Omega0_b = parameter[rec_emulator_omega_b]/pba->h/pba->h;
+    pba->Omega0_cdm = parameter[rec_emulator_omega_cdm]/pba->h/pba->h;
+    pba->Omega0_ur = true_Omega0_ur+(parameter[rec_emulator_Neff]-reference[rec_emulator_Neff])*Omega0_ur_per_Neff;
+    pth->YHe = parameter[rec_emulator_YHe];
+    class_test_except(pba->Omega0_ur < 0.,
+                      pth->error_message,
+                      fclose(emulator_file);remove(tmpname),
+                      "the training range of the recombination emulator requires a negative density of ultra-relativistic relics: decrease recombination_emulator_delta_Neff");
+    delta_Omega = (pba->Omega0_b-true_Omega0_b)+(pba->Omega0_cdm-true_Omega0_cdm)+(pba->Omega0_ur-true_Omega0_ur);
+    if ((true_Omega0_lambda == 0.) && (true_Omega0_fld != 0.))
+      pba->Omega0_fld = true_Omega0_fld-delta_Omega;
+    else
+      pba->Omega0_lambda = true_Omega0_lambda-delta_Omega;
+
+    class_call_except(background_init(ppr,pba), pba->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+    class_call_except(thermodynamics_init(ppr,pba,pth), pth->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+
+    class_call_except(thermodynamics_emulator_write_node(ppr,pth,emulator_file),
+                      pth->error_message, pth->error_message, fclose(emulator_file);remove(tmpname));
+
+    class_call(thermodynamics_free(pth), pth->error_message, pth->error_message);
+    class_call(background_free_noinput(pba), pba->error_message, pth->error_message);
+  }
+
+  fclose(emulator_file);
+
+  /** Validate the table in the middle of the cells surrounding the input model (the points where interpolation is the least accurate) */
+  pth->recombination_emulator = rec_emulator_use;
+  pth->recombination_emulator_check = _TRUE_;
+  strcpy(pth->recombination_emulator_file,tmpname);
+  validation_error = 0.;
+
+  for (index_node=0; index_node<(1<<rec_emulator_parameter_size); index_node++) {
+
+    for (index_p=0; index_p<rec_emulator_parameter_size; index_p++) {
+      parameter[index_p] = reference[index_p]+(((index_node>>index_p)&1) ? 0.5 : -0.5)*(p_max[index_p]-p_min[index_p])/(points-1);
+    }
+
+    pba->Omega0_b = parameter[rec_emulator_omega_b]/pba->h/pba->h;
+    pba->Omega0_cdm = parameter[rec_emulator_omega_cdm]/pba->h/pba->h;
+    pba->Omega0_ur = true_Omega0_ur+(parameter[rec_emulator_Neff]-reference[rec_emulator_Neff])*Omega0_ur_per_Neff;
+    pth->YHe = parameter[rec_emulator_YHe];
+    delta_Omega = (pba->Omega0_b-true_Omega0_b)+(pba->Omega0_cdm-true_Omega0_cdm)+(pba->Omega0_ur-true_Omega0_ur);
+    if ((true_Omega0_lambda == 0.) && (true_Omega0_fld != 0.))
+      pba->Omega0_fld = true_Omega0_fld-delta_Omega;
+    else
+      pba->Omega0_lambda = true_Omega0_lambda-delta_Omega;
+
+    class_call_except(background_init(ppr,pba), pba->error_message, pth->error_message, remove(tmpname));
+    class_call_except(thermodynamics_init(ppr,pba,pth), pth->error_message, pth->error_message, remove(tmpname));
+
+    class_test_except(pth->recombination_emulator_error < 0.,
+                      pth->error_message,
+                      remove(tmpname),
+                      "the recombination emulator could not be evaluated at validation point %d",index_node);
+    validation_error = MAX(validation_error,pth->recombination_emulator_error);
+
+    class_call(thermodynamics_free(pth), pth->error_message, pth->error_message);
+    class_call(background_free_noinput(pba), pba->error_message, pth->error_message);
+  }
+
+  /** Write the accuracy in the header, and give its final name to the file */
+  class_open(emulator_file,tmpname,"r+b",pth->error_message);
+  class_test_except((fseek(emulator_file,8,SEEK_SET) != 0) || (fwrite(&validation_error,sizeof(double),1,emulator_file) != 1),
+                    pth->error_message,
+                    fclose(emulator_file);remove(tmpname),
+                    "could not write accuracy of the recombination emulator in %s",tmpname);
+  fclose(emulator_file);
+
+  class_test_except(rename(tmpname,true_file) != 0,
+                    pth->error_message,
+                    remove(tmpname),
+                    "could not rename emulator file %s into %s",tmpname,true_file);
+
+  /** Restore cosmological parameters to their true values before main call to CLASS modules */
+  pba->background_verbose = true_background_verbose;
+  pth->thermodynamics_verbose = true_thermodynamics_verbose;
+  pth->hyrec_verbose = true_hyrec_verbose;
+  pth->recombination_emulator = rec_emulator_train;
+  pth->recombination_emulator_check = true_check;
+  strcpy(pth->recombination_emulator_file,true_file);
+
+  pba->Omega0_b = true_Omega0_b;
+  pba->Omega0_cdm = true_Omega0_cdm;
+  pba->Omega0_ur = true_Omega0_ur;
+  pba->Omega0_lambda = true_Omega0_lambda;
+  pba->Omega0_fld = true_Omega0_fld;
+  pth->YHe = true_YHe;
+
+  if (true_thermodynamics_verbose > 0) {
+    printf(" -> wrote recombination emulator in %s, with maximum error %e on x_e, T_b and dx_e/dz",true_file,validation_error);
+    if (validation_error > ppr->recombination_emulator_tolerance)
+      printf(" [WARNING: above tolerance %e, the emulator will not be used; decrease the training range or increase recombination_emulator_points]",
+             ppr->recombination_emulator_tolerance);
+    printf("\n");
+  }
+
+  return _SUCCESS_;
+}
@@ -162,7 +162,7 @@ int transfer_init(
 
   /* structure containing the flat spherical bessel functions */
 
-  HyperInterpStruct BIS;
+  HyperInterpStruct * pBIS;
   double xmax;
 
   /* This code can be optionally compiled with the openmp option for parallel computation.
@@ -264,17 +264,24 @@ int transfer_init(
   if (pba->sgnK == -1)
     xmax *= (ptr->l[ptr->l_size_max-1]/ppr->hyper_flat_approximation_nu)/asinh(ptr->l[ptr->l_size_max-1]/ppr->hyper_flat_approximation_nu)*1.01;
 
-  class_call(hyperspherical_HIS_create(0,
-                                       1.,
-                                       ptr->l_size_max,
-                                       ptr->l,
-                                       ppr->hyper_x_min,
-                                       xmax,
-                                       ppr->hyper_sampling_flat,
-                                       ptr->l[ptr->l_size_max-1]+1,
-                                       ppr->hyper_phi_min_abs,
-                                       &BIS,
-                                       ptr->error_message),
+  /* they do not depend on the cosmology, but only on the list of
+     l's, on the precision parameters and on xmax: hence they are
+     shared with previous and simultaneous runs of this process (and
+     eventually with other processes through a file) whenever
+     possible */
+
+  class_call(hyperspherical_HIS_flat_shared_get(ptr->l_size_max,
+                                                ptr->l,
+                                                ppr->hyper_x_min,
+                                                xmax,
+                                                ppr->hyper_sampling_flat,
+                                                ptr->l[ptr->l_size_max-1]+1,
+                                                ppr->hyper_phi_min_abs,
+                                                ptr->has_hyperspherical_cache,
+                                                ptr->hyperspherical_cache_directory,
+                                                ptr->transfer_verbose,
+                                                &pBIS,
+                                                ptr->error_message),
              ptr->error_message,
              ptr->error_message);
 
@@ -314,7 +321,7 @@ int transfer_init(
 
   /* beginning of parallel region */
 #pragma omp parallel                                                    \
-  shared(tau_size_max,ptr,ppr,pba,ppt,tp_of_tt,tau_rec,sources_spline,abort,BIS,tau0) \
+  shared(tau_size_max,ptr,ppr,pba,ppt,tp_of_tt,tau_rec,sources_spline,abort,pBIS,tau0) \
   private(ptw,index_q,tstart,tstop,tspent)
   {
 
@@ -334,7 +341,7 @@ int transfer_init(
                                                 pba->K,
                                                 pba->sgnK,
                                                 tau0-pth->tau_cut,
-                                                &BIS),
+                                                pBIS),
                         ptr->error_message,
                         ptr->error_message);
 
@@ -416,7 +423,7 @@ int transfer_init(
              ptr->error_message,
              ptr->error_message);
 
-  class_call(hyperspherical_HIS_free(&BIS,ptr->error_message),
+  class_call(hyperspherical_HIS_flat_shared_release(pBIS,ptr->error_message),
              ptr->error_message,
              ptr->error_message);
   return _SUCCESS_;
@@ -678,19 +685,19 @@ int transfer_perturbation_copy_sources_and_nl_corrections(
                   ((ppt->has_source_theta_cb == _TRUE_) && (index_tp == ppt->index_tp_theta_cb))){
                 sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
-                  [index_tau * ppt->k_size[index_md] + index_k] =
+                  [_source_index_(index_md,index_tau,index_k)] =
                   ppt->sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
-                  [index_tau * ppt->k_size[index_md] + index_k]
+                  [_source_index_(index_md,index_tau,index_k)]
                   * pfo->nl_corr_density[pfo->index_pk_cb][index_tau * ppt->k_size[index_md] + index_k];
               }
               else{
                 sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
-                  [index_tau * ppt->k_size[index_md] + index_k] =
+                  [_source_index_(index_md,index_tau,index_k)] =
                   ppt->sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
-                  [index_tau * ppt->k_size[index_md] + index_k]
+                  [_source_index_(index_md,index_tau,index_k)]
                   * pfo->nl_corr_density[pfo->index_pk_m][index_tau * ppt->k_size[index_md] + index_k];
               }
             }
@@ -2046,10 +2053,10 @@ int transfer_interpolate_sources(
   for (index_tau = 0; index_tau < ppt->tau_size; index_tau++) {
 
     interpolated_sources[index_tau] =
-      a * pert_source[index_tau*ppt->k_size[index_md]+index_k]
-      + b * pert_source[index_tau*ppt->k_size[index_md]+index_k+1]
-      + ((a*a*a-a) * pert_source_spline[index_tau*ppt->k_size[index_md]+index_k]
-         +(b*b*b-b) * pert_source_spline[index_tau*ppt->k_size[index_md]+index_k+1])*h*h/6.0;
+      a * pert_source[_source_index_(index_md,index_tau,index_k)]
+      + b * pert_source[_source_index_(index_md,index_tau,index_k+1)]
+      + ((a*a*a-a) * pert_source_spline[_source_index_(index_md,index_tau,index_k)]
+         +(b*b*b-b) * pert_source_spline[_source_index_(index_md,index_tau,index_k+1)])*h*h/6.0;
 
   }
 
@@ -2745,13 +2752,8 @@ int transfer_source_resample(
   /* running index on time */
   int index_tau;
 
-  /* array of values of source */
-  double * source_at_tau;
-
-  /* array of source values for a given time and for all k's */
-  class_alloc(source_at_tau,
-              sizeof(double),
-              ptr->error_message);
+  /* value of source at a given time */
+  double source_at_tau;
 
   /* interpolate the sources linearly at the new time values */
   for (index_tau=0; index_tau<tau_size; index_tau++) {
@@ -2763,19 +2765,16 @@ int transfer_source_resample(
                                      1,
                                      ppt->tau_size,
                                      tau0-tau0_minus_tau[index_tau],
-                                     source_at_tau,
+                                     &source_at_tau,
                                      1,
                                      ptr->error_message),
                ptr->error_message,
                ptr->error_message);
 
     /* copy the new values in the output sources array */
-    sources[index_tau] = source_at_tau[0];
+    sources[index_tau] = source_at_tau;
   }
 
-  /* deallocate the temporary array */
-  free(source_at_tau);
-
   return _SUCCESS_;
 
 }
@@ -3210,7 +3209,14 @@ int transfer_integrate(
   /* index in the source's tau list corresponding to the last point in the overlapping region between sources and bessels. Also the index of possible Bessel truncation. */
   int index_tau_max, index_tau_max_Bessel;
 
-  double bessel, *radial_function;
+  double bessel;
+  double * radial_function = ptw->radial_function;
+
+  /* for radial functions computed together with the convolution integral: flag, constant factor, power of cscK, and value at the last point */
+  short fused;
+  double factor;
+  int cscK_power;
+  double radial_last;
 
   double x_turning_point;
 
@@ -3300,32 +3306,71 @@ int transfer_integrate(
     }
   }
 
-  /** - Compute the radial function: */
-  class_alloc(radial_function,sizeof(double)*(index_tau_max+1),ptr->error_message);
-
-  class_call(transfer_radial_function(
-                                      ptw,
-                                      ppt,
-                                      ptr,
-                                      k,
-                                      index_q,
-                                      index_l,
-                                      index_tau_max+1,
-                                      radial_function,
-                                      radial_type
-                                      ),
+  class_call(transfer_radial_function_is_fused(ptw,
+                                               ptr,
+                                               index_l,
+                                               radial_type,
+                                               &fused,
+                                               &factor,
+                                               &cscK_power),
              ptr->error_message,
              ptr->error_message);
 
-  /** - Now we do most of the convolution integral: */
-  class_call(array_trapezoidal_convolution(sources,
-                                           radial_function,
-                                           index_tau_max+1,
-                                           w_trapz,
-                                           trsf,
-                                           ptr->error_message),
-             ptr->error_message,
-             ptr->error_message);
+  if (fused == _TRUE_) {
+
+    /** - In the simplest cases (flat space, radial function
+        proportional to \f$ \Phi_l \f$), interpolate the radial
+        function and do most of the convolution integral in a single
+        vectorised pass: */
+    class_test(ptw->pBIS->x[ptw->pBIS->x_size-1] < ptw->chi[0],
+               ptr->error_message,
+               "Bessels need to be interpolated at %e, outside the range in which they have been computed (<%e). Increase their x_max.",
+               ptw->chi[0],
+               ptw->pBIS->x[ptw->pBIS->x_size-1]);
+
+    class_call(hyperspherical_Hermite4_convolution_Phi(ptw->pBIS,
+                                                       index_tau_max+1,
+                                                       index_l,
+                                                       ptw->chi,
+                                                       sources,
+                                                       w_trapz,
+                                                       ptw->cscKgen,
+                                                       cscK_power,
+                                                       factor,
+                                                       trsf,
+                                                       &radial_last),
+               ptr->error_message,
+               ptr->error_message);
+  }
+  else {
+
+    /** - Otherwise, compute the radial function (in the scratch arena of the workspace, of size tau_size_max >= index_tau_max+1): */
+    class_call(transfer_radial_function(
+                                        ptw,
+                                        ppt,
+                                        ptr,
+                                        k,
+                                        index_q,
+                                        index_l,
+                                        index_tau_max+1,
+                                        radial_function,
+                                        radial_type
+                                        ),
+               ptr->error_message,
+               ptr->error_message);
+
+    /** - and do most of the convolution integral: */
+    class_call(array_trapezoidal_convolution(sources,
+                                             radial_function,
+                                             index_tau_max+1,
+                                             w_trapz,
+                                             trsf,
+                                             ptr->error_message),
+               ptr->error_message,
+               ptr->error_message);
+
+    radial_last = radial_function[index_tau_max];
+  }
 
   /** - This integral is correct for the case where no truncation has
       occurred. If it has been truncated at some index_tau_max because
@@ -3336,11 +3381,9 @@ int transfer_integrate(
   if ((index_tau_max!=(ptw->tau_size-1))&&(index_tau_max==index_tau_max_Bessel)){
     //Bessel truncation
     *trsf -= 0.5*(tau0_minus_tau[index_tau_max+1]-tau0_minus_tau_min_bessel)*
-      radial_function[index_tau_max]*sources[index_tau_max];
+      radial_last*sources[index_tau_max];
   }
 
-
-  free(radial_function);
   return _SUCCESS_;
 }
 
@@ -3793,7 +3836,10 @@ int transfer_radial_function(
   double *cscKgen = ptw->cscKgen;
   double *cotKgen = ptw->cotKgen;
   int j;
-  double *Phi, *dPhi, *d2Phi, *chireverse;
+  double *Phi = ptw->Phi;
+  double *dPhi = ptw->dPhi;
+  double *d2Phi = ptw->d2Phi;
+  double *chireverse = ptw->chireverse;
   double K=0.,k2=1.0;
   double sqrt_absK_over_k;
   double absK_over_k2;
@@ -3802,7 +3848,7 @@ int transfer_radial_function(
   double l = (double)ptr->l[index_l];
   double rescale_argument;
   double rescale_amplitude;
-  double * rescale_function;
+  double * rescale_function = ptw->rescale_function;
   int (*interpolate_Phi)();
   int (*interpolate_dPhi)();
   int (*interpolate_Phid2Phi)();
@@ -3823,11 +3869,9 @@ int transfer_radial_function(
   }
   absK_over_k2 =sqrt_absK_over_k*sqrt_absK_over_k;
 
-  class_alloc(Phi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(dPhi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(d2Phi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(chireverse,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(rescale_function,sizeof(double)*x_size,ptr->error_message);
+  class_test(x_size > ptw->tau_size_max,
+             ptr->error_message,
+             "x_size=%d larger than size of scratch arrays tau_size_max=%d",x_size,ptw->tau_size_max);
 
   if (ptw->sgnK == 0) {
     pHIS = ptw->pBIS;
@@ -4043,11 +4087,68 @@ int transfer_radial_function(
     break;
   }
 
-  free(Phi);
-  free(dPhi);
-  free(d2Phi);
-  free(chireverse);
-  free(rescale_function);
+  return _SUCCESS_;
+}
+
+/**
+ * Check whether the radial function of a given type can be computed
+ * together with the convolution integral by
+ * hyperspherical_Hermite4_convolution_Phi(). This is the case in flat
+ * space for all radial functions of the form factor *
+ * cscK^cscK_power * Phi_l (see transfer_radial_function() for the
+ * general expressions, which reduce to the ones below for K=0).
+ *
+ * @param ptw         Input: pointer to transfer workspace
+ * @param ptr         Input: pointer to transfer structure
+ * @param index_l     Input: index of multipole
+ * @param radial_type Input: type of radial function
+ * @param fused       Output: _TRUE_ if the fused kernel can be used
+ * @param factor      Output: constant factor
+ * @param cscK_power  Output: power of cscK
+ * @return the error status
+ */
+
+int transfer_radial_function_is_fused(
+                                      struct transfer_workspace * ptw,
+                                      struct transfer * ptr,
+                                      int index_l,
+                                      radial_function_type radial_type,
+                                      short * fused,
+                                      double * factor,
+                                      int * cscK_power
+                                      ) {
+
+  double l = (double)ptr->l[index_l];
+
+  *fused = _FALSE_;
+
+  if (ptw->sgnK != 0)
+    return _SUCCESS_;
+
+  *fused = _TRUE_;
+
+  switch (radial_type){
+  case SCALAR_TEMPERATURE_0:
+    *factor = 1.;
+    *cscK_power = 0;
+    break;
+  case SCALAR_POLARISATION_E:
+  case TENSOR_TEMPERATURE_2:
+    *factor = sqrt(3.0/8.0*(l+2.0)*(l+1.0)*l*(l-1.0));
+    *cscK_power = 2;
+    break;
+  case VECTOR_TEMPERATURE_1:
+    *factor = sqrt(0.5*l*(l+1));
+    *cscK_power = 1;
+    break;
+  case VECTOR_POLARISATION_B:
+    *factor = 0.5*sqrt((l-1.0)*(l+2.0));
+    *cscK_power = 1;
+    break;
+  default:
+    *fused = _FALSE_;
+    break;
+  }
 
   return _SUCCESS_;
 }
@@ -4292,6 +4393,14 @@ int transfer_workspace_init(
   class_alloc((*ptw)->cscKgen,tau_size_max*sizeof(double),ptr->error_message);
   class_alloc((*ptw)->cotKgen,tau_size_max*sizeof(double),ptr->error_message);
 
+  class_alloc((*ptw)->scratch,_TRANSFER_SCRATCH_SIZE_*tau_size_max*sizeof(double),ptr->error_message);
+  (*ptw)->radial_function  = (*ptw)->scratch;
+  (*ptw)->Phi              = (*ptw)->scratch + tau_size_max;
+  (*ptw)->dPhi             = (*ptw)->scratch + 2*tau_size_max;
+  (*ptw)->d2Phi            = (*ptw)->scratch + 3*tau_size_max;
+  (*ptw)->chireverse       = (*ptw)->scratch + 4*tau_size_max;
+  (*ptw)->rescale_function = (*ptw)->scratch + 5*tau_size_max;
+
   return _SUCCESS_;
 }
 
@@ -4313,6 +4422,7 @@ int transfer_workspace_free(
   free(ptw->chi);
   free(ptw->cscKgen);
   free(ptw->cotKgen);
+  free(ptw->scratch);
 
   free(ptw);
   return _SUCCESS_;
@@ -0,0 +1,195 @@
+/** @file test_lensing_kernel.c
+ *
+ * Accuracy and speed of the fused quadrature kernel
+ * lensing_lensed_cl_all() compared to the three passes of
+ * lensing_lensed_cl_tt(), lensing_lensed_cl_te() and
+ * lensing_lensed_cl_ee_bb(), on the Wigner d-functions of a
+ * Gauss-Legendre quadrature, for a dense and a sparse sampling in l.
+ */
+
+#include "class.h"
+#include <time.h>
+
+/* maximum difference accepted between the two kernels, relative to the largest sum */
+#define _LENSING_KERNEL_TOLERANCE_ 1.e-12
+
+/* largest multipole of the d-functions, and number of quadrature points */
+#define _LENSING_KERNEL_LMAX_ 6000
+#define _LENSING_KERNEL_NUM_MU_ (_LENSING_KERNEL_LMAX_+70)
+
+/* number of values of mu for which the d-functions are stored at the same time */
+#define _LENSING_KERNEL_BLOCK_ 256
+
+/* wall-clock time in seconds: with OpenMP, clock() would add up the
+   CPU time of all threads */
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+int compare_kernels(
+                    struct lensing * ple,
+                    double * mu,
+                    double * w8,
+                    double ** ksi,
+                    double * buf_d,
+                    double *** d,
+                    double * max_error,
+                    double * time_passes,
+                    double * time_fused,
+                    ErrorMsg errmsg) {
+
+  int mu_start,mu_size,index_mu,index_d,index_l,index_lt;
+  double * cl_passes;
+  double * cl_fused;
+  double max_cl;
+  double start;
+
+  class_calloc(cl_passes,ple->l_size*ple->lt_size,sizeof(double),errmsg);
+  class_calloc(cl_fused,ple->l_size*ple->lt_size,sizeof(double),errmsg);
+
+  *time_passes = 0.;
+  *time_fused = 0.;
+
+  for (mu_start=0; mu_start<_LENSING_KERNEL_NUM_MU_; mu_start+=_LENSING_KERNEL_BLOCK_) {
+
+    mu_size = MIN(_LENSING_KERNEL_BLOCK_,_LENSING_KERNEL_NUM_MU_-mu_start);
+
+    /* d-functions of the current block, in the same layout as in lensing_lensed_cl_quadrature() */
+    for (index_d=0; index_d<4; index_d++) {
+      for (index_mu=mu_start; index_mu<mu_start+mu_size; index_mu++)
+        d[index_d][index_mu] = buf_d+((index_d*_LENSING_KERNEL_BLOCK_)+index_mu-mu_start)*(_LENSING_KERNEL_LMAX_+1);
+    }
+    class_call(lensing_d00(mu+mu_start,mu_size,_LENSING_KERNEL_LMAX_,d[0]+mu_start),errmsg,errmsg);
+    class_call(lensing_d20(mu+mu_start,mu_size,_LENSING_KERNEL_LMAX_,d[1]+mu_start),errmsg,errmsg);
+    class_call(lensing_d22(mu+mu_start,mu_size,_LENSING_KERNEL_LMAX_,d[2]+mu_start),errmsg,errmsg);
+    class_call(lensing_d2m2(mu+mu_start,mu_size,_LENSING_KERNEL_LMAX_,d[3]+mu_start),errmsg,errmsg);
+
+    /* three passes */
+    ple->cl_lens = cl_passes;
+    start = wall_time();
+    class_call(lensing_lensed_cl_tt(ksi[0]+mu_start,d[0]+mu_start,w8+mu_start,mu_size,ple),
+               ple->error_message,
+               errmsg);
+    class_call(lensing_lensed_cl_te(ksi[1]+mu_start,d[1]+mu_start,w8+mu_start,mu_size,ple),
+               ple->error_message,
+               errmsg);
+    class_call(lensing_lensed_cl_ee_bb(ksi[2]+mu_start,ksi[3]+mu_start,d[2]+mu_start,d[3]+mu_start,w8+mu_start,mu_size,ple),
+               ple->error_message,
+               errmsg);
+    *time_passes += wall_time()-start;
+
+    /* fused kernel */
+    ple->cl_lens = cl_fused;
+    start = wall_time();
+    class_call(lensing_lensed_cl_all(ksi[0],ksi[1],ksi[2],ksi[3],d[0],d[1],d[2],d[3],w8,mu_start,mu_size,ple),
+               ple->error_message,
+               errmsg);
+    *time_fused += wall_time()-start;
+  }
+
+  *max_error = 0.;
+  for (index_lt=0; index_lt<ple->lt_size; index_lt++) {
+    max_cl = 0.;
+    for (index_l=0; index_l<ple->l_size; index_l++)
+      max_cl = MAX(max_cl,fabs(cl_passes[index_l*ple->lt_size+index_lt]));
+    for (index_l=0; index_l<ple->l_size; index_l++)
+      *max_error = MAX(*max_error,fabs(cl_fused[index_l*ple->lt_size+index_lt]-cl_passes[index_l*ple->lt_size+index_lt])/max_cl);
+  }
+
+  ple->cl_lens = NULL;
+  free(cl_passes);
+  free(cl_fused);
+
+  return _SUCCESS_;
+}
+
+int main() {
+
+  struct lensing le;          /* for lensed spectra */
+  ErrorMsg errmsg;            /* for error messages */
+
+  double * mu;
+  double * w8;
+  double * ksi[4];
+  double * buf_d;
+  double ** d[4];
+  double theta;
+  int index_mu,index_d,index_l,l_step;
+  double max_error,time_passes,time_fused;
+  int status = _SUCCESS_;
+
+  /* Gauss-Legendre quadrature, and smooth correlation functions peaked at small angles */
+  class_alloc(mu,_LENSING_KERNEL_NUM_MU_*sizeof(double),errmsg);
+  class_alloc(w8,_LENSING_KERNEL_NUM_MU_*sizeof(double),errmsg);
+  if (quadrature_gauss_legendre(mu,w8,_LENSING_KERNEL_NUM_MU_,_PI_*1.e-14,errmsg) == _FAILURE_) {
+    printf("\n\nError in quadrature_gauss_legendre \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+
+  for (index_d=0; index_d<4; index_d++) {
+    class_alloc(ksi[index_d],_LENSING_KERNEL_NUM_MU_*sizeof(double),errmsg);
+    class_alloc(d[index_d],_LENSING_KERNEL_NUM_MU_*sizeof(double*),errmsg);
+  }
+  for (index_mu=0; index_mu<_LENSING_KERNEL_NUM_MU_; index_mu++) {
+    theta = acos(mu[index_mu]);
+    ksi[0][index_mu] = exp(-theta*theta/1.e-4)*cos(150.*theta);
+    ksi[1][index_mu] = -0.1*exp(-theta*theta/1.e-4)*sin(150.*theta);
+    ksi[2][index_mu] = 0.01*exp(-theta*theta/2.e-4);
+    ksi[3][index_mu] = 0.01*theta*theta*exp(-theta*theta/2.e-4);
+  }
+  class_alloc(buf_d,4*_LENSING_KERNEL_BLOCK_*(_LENSING_KERNEL_LMAX_+1)*sizeof(double),errmsg);
+
+  le.has_tt = _TRUE_;
+  le.has_te = _TRUE_;
+  le.has_ee = _TRUE_;
+  le.has_bb = _TRUE_;
+  le.index_lt_tt = 0;
+  le.index_lt_te = 1;
+  le.index_lt_ee = 2;
+  le.index_lt_bb = 3;
+  le.lt_size = 4;
+
+#ifdef _OPENMP
+  fprintf(stdout,"wall-clock timings with %d OpenMP thread(s)\n",omp_get_max_threads());
+#endif
+
+  /* every multipole, then a sampling similar to that of the harmonic module */
+  for (l_step=1; l_step<=40; l_step*=40) {
+
+    le.l_size = (_LENSING_KERNEL_LMAX_-2)/l_step+1;
+    class_alloc(le.l,le.l_size*sizeof(double),errmsg);
+    for (index_l=0; index_l<le.l_size; index_l++)
+      le.l[index_l] = 2+index_l*l_step;
+
+    if (compare_kernels(&le,mu,w8,ksi,buf_d,d,&max_error,&time_passes,&time_fused,errmsg) == _FAILURE_) {
+      printf("\n\nError in compare_kernels \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+
+    fprintf(stdout,"%d multipoles (step %d), %d quadrature points:\n",le.l_size,l_step,_LENSING_KERNEL_NUM_MU_);
+    fprintf(stdout," -> max difference relative to the largest sum: %e\n",max_error);
+    fprintf(stdout," -> %e s (three passes), %e s (fused kernel)\n",time_passes,time_fused);
+
+    if (max_error > _LENSING_KERNEL_TOLERANCE_) {
+      fprintf(stdout," -> FAILED: difference above %e\n",_LENSING_KERNEL_TOLERANCE_);
+      status = _FAILURE_;
+    }
+
+    free(le.l);
+  }
+
+  for (index_d=0; index_d<4; index_d++) {
+    free(ksi[index_d]);
+    free(d[index_d]);
+  }
+  free(buf_d);
+  free(mu);
+  free(w8);
+
+  return status;
+
+}
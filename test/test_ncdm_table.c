@@ -0,0 +1,205 @@
+/** @file test_ncdm_table.c
+ *
+ * Accuracy and speed of the tabulated ncdm background integrals
+ * (precision parameter background_ncdm_table) compared to the sum over
+ * momenta, for one, two and three massive neutrino species.
+ */
+
+#include "class.h"
+#include <time.h>
+
+/* maximum relative difference accepted between the two methods */
+#define _NCDM_TABLE_TOLERANCE_ 1.e-6
+
+/* number of scale factor values at which both methods are compared */
+#define _NCDM_TABLE_NA_ 100000
+
+/* wall-clock time in seconds: with OpenMP, clock() would add up the
+   CPU time of all threads */
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+int run_background(
+                   struct file_content *pfc,
+                   short tabulated,
+                   struct precision * ppr,
+                   struct background * pba,
+                   double * time_init,
+                   ErrorMsg errmsg) {
+
+  struct thermodynamics th;
+  struct perturbations pt;
+  struct transfer tr;
+  struct primordial pm;
+  struct harmonic hr;
+  struct fourier fo;
+  struct lensing le;
+  struct distortions sd;
+  struct output op;
+  double start;
+
+  sprintf(pfc->value[pfc->size-1],"%d",tabulated);
+
+  class_call(input_read_from_file(pfc,ppr,pba,&th,&pt,&tr,&pm,&hr,&fo,&le,&sd,&op,errmsg),
+             errmsg,
+             errmsg);
+
+  /* only the background is needed here */
+  thermodynamics_free_input(&th);
+  perturbations_free_input(&pt);
+
+  start = wall_time();
+  class_call(background_init(ppr,pba),
+             pba->error_message,
+             errmsg);
+  *time_init = wall_time()-start;
+
+  return _SUCCESS_;
+}
+
+int compare_integrals(
+                      struct background * pba,
+                      double * max_error,
+                      double * time_sum,
+                      double * time_table,
+                      ErrorMsg errmsg) {
+
+  int n_ncdm,index_a;
+  double loga_ini,z;
+  double rho,p,pseudo_p,rho_t,p_t,pseudo_p_t;
+  double sum=0.;
+  double start;
+
+  *max_error = 0.;
+  *time_sum = 0.;
+  *time_table = 0.;
+  loga_ini = pba->loga_table[0];
+
+  for (n_ncdm=0; n_ncdm<pba->N_ncdm; n_ncdm++) {
+
+    /* accuracy */
+    for (index_a=0; index_a<_NCDM_TABLE_NA_; index_a++) {
+      z = exp(-loga_ini*(1.-(double)index_a/(_NCDM_TABLE_NA_-1)))-1.;
+      class_call(background_ncdm_momenta(pba->q_ncdm_bg[n_ncdm],pba->w_ncdm_bg[n_ncdm],pba->q_size_ncdm_bg[n_ncdm],
+                                         pba->M_ncdm[n_ncdm],pba->factor_ncdm[n_ncdm],z,NULL,&rho,&p,NULL,&pseudo_p),
+                 pba->error_message,
+                 errmsg);
+      class_call(background_ncdm_momenta_tabulated(pba,n_ncdm,z,&rho_t,&p_t,&pseudo_p_t),
+                 pba->error_message,
+                 errmsg);
+      *max_error = MAX(*max_error,fabs(rho_t/rho-1.));
+      *max_error = MAX(*max_error,fabs(p_t/p-1.));
+      *max_error = MAX(*max_error,fabs(pseudo_p_t/pseudo_p-1.));
+    }
+
+    /* speed of each method alone (sum is only there to keep the calls alive) */
+    start = wall_time();
+    for (index_a=0; index_a<_NCDM_TABLE_NA_; index_a++) {
+      z = exp(-loga_ini*(1.-(double)index_a/(_NCDM_TABLE_NA_-1)))-1.;
+      background_ncdm_momenta(pba->q_ncdm_bg[n_ncdm],pba->w_ncdm_bg[n_ncdm],pba->q_size_ncdm_bg[n_ncdm],
+                              pba->M_ncdm[n_ncdm],pba->factor_ncdm[n_ncdm],z,NULL,&rho,&p,NULL,&pseudo_p);
+      sum += rho+p+pseudo_p;
+    }
+    *time_sum += wall_time()-start;
+
+    start = wall_time();
+    for (index_a=0; index_a<_NCDM_TABLE_NA_; index_a++) {
+      z = exp(-loga_ini*(1.-(double)index_a/(_NCDM_TABLE_NA_-1)))-1.;
+      background_ncdm_momenta_tabulated(pba,n_ncdm,z,&rho,&p,&pseudo_p);
+      sum += rho+p+pseudo_p;
+    }
+    *time_table += wall_time()-start;
+  }
+
+  class_test(!(sum > 0.),
+             errmsg,
+             "unexpected sum of ncdm integrals %e",sum);
+
+  return _SUCCESS_;
+}
+
+int main() {
+
+  struct precision pr;        /* for precision parameters */
+  struct background ba;       /* for cosmological background */
+  ErrorMsg errmsg;            /* for error messages */
+
+  struct file_content fc;
+  char * N_ncdm[3] = {"1","2","3"};
+  char * m_ncdm[3] = {"0.06","0.01,0.05","0.02,0.03,0.05"};
+  int index_config;
+  double max_error,time_sum,time_table,time_init_sum,time_init_table;
+  double H0_sum,age_sum,Omega0_ncdm_sum;
+  int status = _SUCCESS_;
+
+  parser_init(&fc,5,"",errmsg);
+
+  strcpy(fc.name[0],"N_ncdm");
+  strcpy(fc.name[1],"m_ncdm");
+  strcpy(fc.name[2],"N_ur");
+  /* parameters of the phase-space distribution in background_ncdm_distribution(): pure Fermi-Dirac */
+  strcpy(fc.name[3],"ncdm_psd_parameters");
+  strcpy(fc.value[3],"0.,1.,3.");
+  /* must be last, see run_background() */
+  strcpy(fc.name[4],"background_ncdm_table");
+
+#ifdef _OPENMP
+  fprintf(stdout,"wall-clock timings with %d OpenMP thread(s)\n",omp_get_max_threads());
+#endif
+
+  for (index_config=0; index_config<3; index_config++) {
+
+    strcpy(fc.value[0],N_ncdm[index_config]);
+    strcpy(fc.value[1],m_ncdm[index_config]);
+    sprintf(fc.value[2],"%e",3.044-(index_config+1)*1.0132);
+
+    /* reference: sum over momenta */
+    if (run_background(&fc,_FALSE_,&pr,&ba,&time_init_sum,errmsg) == _FAILURE_) {
+      printf("\n\nError in run_background \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+    H0_sum = ba.background_table[(ba.bt_size-1)*ba.bg_size+ba.index_bg_H];
+    age_sum = ba.age;
+    Omega0_ncdm_sum = ba.Omega0_ncdm_tot;
+    background_free(&ba);
+
+    /* tabulated integrals */
+    if (run_background(&fc,_TRUE_,&pr,&ba,&time_init_table,errmsg) == _FAILURE_) {
+      printf("\n\nError in run_background \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+
+    if (compare_integrals(&ba,&max_error,&time_sum,&time_table,errmsg) == _FAILURE_) {
+      printf("\n\nError in compare_integrals \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+
+    fprintf(stdout,"N_ncdm=%s m_ncdm=%s:\n",fc.value[0],fc.value[1]);
+    fprintf(stdout," -> max relative error on rho, p, pseudo_p: %e\n",max_error);
+    fprintf(stdout," -> relative error on H0: %e, on age: %e, on Omega0_ncdm: %e\n",
+            ba.background_table[(ba.bt_size-1)*ba.bg_size+ba.index_bg_H]/H0_sum-1.,
+            ba.age/age_sum-1.,
+            ba.Omega0_ncdm_tot/Omega0_ncdm_sum-1.);
+    fprintf(stdout," -> %d evaluations: %e s (sum over momenta), %e s (table)\n",
+            ba.N_ncdm*_NCDM_TABLE_NA_,time_sum,time_table);
+    fprintf(stdout," -> background_init: %e s (sum over momenta), %e s (table)\n",
+            time_init_sum,time_init_table);
+
+    if (max_error > _NCDM_TABLE_TOLERANCE_) {
+      fprintf(stdout," -> FAILED: relative error above %e\n",_NCDM_TABLE_TOLERANCE_);
+      status = _FAILURE_;
+    }
+
+    background_free(&ba);
+  }
+
+  parser_free(&fc);
+
+  return status;
+
+}
@@ -1871,6 +1871,161 @@ int array_interpolate_spline(
   return _SUCCESS_;
 }
 
+ /**
+  * interpolate to get y_i(x), when x and y_i are in different arrays,
+  * starting the search from the interval *last_index (typically
+  * provided by an index guide, see array_index_guide_init()) and
+  * walking to the correct interval. The interval found (and thus the
+  * result) is the same as in array_interpolate_spline(), but the cost
+  * is proportional to the distance between the guess and the answer
+  * instead of log2(n_lines). Works for growing and decreasing x_array.
+  *
+  * Called by background_at_z(); background_tau_of_z(); background_z_of_tau(); thermodynamics_at_z().
+  */
+int array_interpolate_spline_guided(
+                                    double * __restrict__ x_array,
+                                    int n_lines,
+                                    double * __restrict__ array,
+                                    double * __restrict__ array_splined,
+                                    int n_columns,
+                                    double x,
+                                    int * __restrict__ last_index,
+                                    double * __restrict__ result,
+                                    int result_size, /** from 1 to n_columns */
+                                    ErrorMsg errmsg) {
+
+  int inf,sup,i;
+  double h,a,b;
+
+  inf = *last_index;
+  if (inf < 0) inf = 0;
+  if (inf > n_lines-2) inf = n_lines-2;
+
+  if (x_array[0] < x_array[n_lines-1]){
+
+    if (x < x_array[0]) {
+      sprintf(errmsg,"%s(L:%d) : x=%e < x_min=%e",__func__,__LINE__,x,x_array[0]);
+      return _FAILURE_;
+    }
+
+    if (x > x_array[n_lines-1]) {
+      sprintf(errmsg,"%s(L:%d) : x=%e > x_max=%e",__func__,__LINE__,x,x_array[n_lines-1]);
+      return _FAILURE_;
+    }
+
+    /* same convention as the bisection: largest inf <= n_lines-2 with x_array[inf] <= x */
+    while ((inf > 0) && (x < x_array[inf])) inf--;
+    while ((inf < n_lines-2) && (x >= x_array[inf+1])) inf++;
+
+  }
+
+  else {
+
+    if (x < x_array[n_lines-1]) {
+      sprintf(errmsg,"%s(L:%d) : x=%e < x_min=%e",__func__,__LINE__,x,x_array[n_lines-1]);
+      return _FAILURE_;
+    }
+
+    if (x > x_array[0]) {
+      sprintf(errmsg,"%s(L:%d) : x=%e > x_max=%e",__func__,__LINE__,x,x_array[0]);
+      return _FAILURE_;
+    }
+
+    /* same convention as the bisection: largest inf <= n_lines-2 with x_array[inf] >= x */
+    while ((inf > 0) && (x > x_array[inf])) inf--;
+    while ((inf < n_lines-2) && (x <= x_array[inf+1])) inf++;
+
+  }
+
+  *last_index = inf;
+  sup = inf+1;
+
+  h = x_array[sup] - x_array[inf];
+  b = (x-x_array[inf])/h;
+  a = 1-b;
+
+  for (i=0; i<result_size; i++)
+    *(result+i) =
+      a * *(array+inf*n_columns+i) +
+      b * *(array+sup*n_columns+i) +
+      ((a*a*a-a)* *(array_splined+inf*n_columns+i) +
+       (b*b*b-b)* *(array_splined+sup*n_columns+i))*h*h/6.;
+
+  return _SUCCESS_;
+}
+
+ /**
+  * Build an index guide for a monotonic array x_array: the guide
+  * samples u = u_of_x(x) uniformly between u_of_x(x_array[0]) and
+  * u_of_x(x_array[n_lines-1]) with n_guide nodes, and stores for each
+  * node the index of the interval of x_array containing it. The
+  * transformation u_of_x (e.g. log) should be chosen such that x_array
+  * is roughly uniform in u; then array_index_guide_find() returns a
+  * starting point a few lines away from the correct interval at most.
+  *
+  * Called by background_solve(); thermodynamics_init().
+  */
+int array_index_guide_init(
+                           double * x_array,
+                           int n_lines,
+                           double (*u_of_x)(double),
+                           int n_guide,
+                           int * guide,
+                           double * u_min,
+                           double * du,
+                           ErrorMsg errmsg) {
+
+  int index_guide,index_x=0;
+  double u,u_max,sign;
+
+  class_test(n_lines < 2 || n_guide < 2,
+             errmsg,
+             "cannot build an index guide with n_lines=%d, n_guide=%d",n_lines,n_guide);
+
+  *u_min = u_of_x(x_array[0]);
+  u_max = u_of_x(x_array[n_lines-1]);
+  *du = (u_max-*u_min)/(n_guide-1);
+
+  class_test(!(*du != 0.),
+             errmsg,
+             "cannot build an index guide on a range of zero or undefined width [%e,%e]",*u_min,u_max);
+
+  /* the walk below assumes u growing along the guide; flip the comparison otherwise */
+  sign = (*du > 0.) ? 1. : -1.;
+
+  for (index_guide=0; index_guide<n_guide; index_guide++) {
+    u = *u_min + index_guide*(*du);
+    while ((index_x < n_lines-2) && (sign*u_of_x(x_array[index_x+1]) <= sign*u))
+      index_x++;
+    guide[index_guide] = index_x;
+  }
+
+  return _SUCCESS_;
+}
+
+ /**
+  * Starting index in a table given an index guide built by
+  * array_index_guide_init(), for the transformed abscissa u = u_of_x(x).
+  */
+int array_index_guide_find(
+                           int * guide,
+                           int n_guide,
+                           double u_min,
+                           double du,
+                           double u) {
+
+  double index_guide;
+
+  index_guide = (u-u_min)/du;
+
+  if (!(index_guide > 0.))
+    return guide[0];
+  if (index_guide >= n_guide-1)
+    return guide[n_guide-1];
+
+  return guide[(int)index_guide];
+}
+
  /**
   * Get the y[i] for which y[i]>c
   *
@@ -49,6 +49,30 @@ int file_exists(const char *fname){
 
 }
 
+/**
+ * Update a 64-bit FNV-1a hash with the content of an arbitrary block
+ * of memory. Start from _HASH_INIT_ and chain the calls to hash
+ * several blocks.
+ *
+ * @param hash  Input: current value of the hash
+ * @param data  Input: pointer to the block of memory
+ * @param size  Input: size of the block in bytes
+ * @return the updated hash
+ */
+
+unsigned long long class_hash(unsigned long long hash,
+                              const void * data,
+                              size_t size){
+  const unsigned char * byte = (const unsigned char *) data;
+  size_t i;
+
+  for (i=0; i<size; i++) {
+    hash ^= byte[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
 /**
  * Finds whether two doubles are equal or which one is bigger
  *
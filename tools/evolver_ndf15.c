@@ -53,6 +53,29 @@
     structure of the equations are nearly optimal for the LU decomposition, so we don't
     want to mess it up by too many row permutations if we can avoid it. This is also why
     do not use any column permutation to pre-order the matrix.
+
+    Analytic Jacobian:
+    Modules able to compute their Jacobian exactly can pass a function (*jacobian)
+    returning the list of its non-zero entries. It is then called by analytic_jac
+    instead of numjac, which saves the neq+1 (or max_group+1) calls to (*derivs)
+    needed for each new Jacobian. The entries are sorted and stored in the same
+    sparse (or dense) format as in numjac, so that the rest of the method is
+    unchanged. If (*jacobian) is NULL, numjac is used.
+
+    Jacobian cache:
+    The sparsity pattern is trusted after a few repetitions, and each time it changes
+    the AMD ordering and the pivot sequence are computed again by a full sparse LU
+    decomposition. As long as the pattern is unchanged, new Jacobians are only
+    refactorised numerically with sp_refactor, unless one of the old pivots has become
+    too small. A caller integrating many systems with the same structure (like the
+    perturbations for successive wavenumbers) can also pass a jacobian_cache, in
+    which the jacobian structures are kept from one call to the next. The pattern,
+    column grouping, ordering and pivot sequence found for one system are then reused
+    from the first step of the next one, until the caller calls jacobian_cache_reset.
+    With jacobian_cache_copy, the caller can also start each system from the structures
+    found for a reference system, so that the result does not depend on which systems
+    were integrated before with the same cache.
+    If jacobian_cache is NULL, a new jacobian is allocated in each call.
 */
 #include "common.h"
 #include "evolver_ndf15.h"
@@ -81,6 +104,9 @@ int evolver_ndf15(
                 ErrorMsg error_message),
           int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
                      ErrorMsg error_message),
+          int (*jacobian)(double x, double * y, struct jacobian_entries * jac_entries,
+                          void * parameters_and_workspace, ErrorMsg error_message),
+          struct jacobian_cache * jacobian_cache,
           ErrorMsg error_message){
 
   /* Constants: */
@@ -97,7 +123,7 @@ int evolver_ndf15(
   double *f0,*y,*wt,*ddfddt,*pred,*ynew,*invwt,*rhs,*psi,*difkp1,*del,*yinterp;
   double *tempvec1,*tempvec2,*ypinterp,*yppinterp;
   double **dif;
-  struct jacobian jac;
+  struct jacobian jac_local, *jac;
   struct numjac_workspace nj_ws;
 
   /* Method variables: */
@@ -183,8 +209,18 @@ int evolver_ndf15(
   /*Set pointers:*/
   ynew = y_inout-1; /* This way y_inout is always up to date. */
 
-  /*Initialize the jacobian:*/
-  class_call(initialize_jacobian(&jac,neq,error_message),error_message,error_message);
+  /*Initialize the jacobian, or get it from the cache of the caller:*/
+  if (jacobian_cache == NULL){
+    jac = &jac_local;
+    class_call(initialize_jacobian(jac,neq,error_message),error_message,error_message);
+    if (jacobian != NULL){
+      class_call(initialize_jacobian_entries(jac,neq,error_message),error_message,error_message);
+    }
+  }
+  else{
+    class_call(jacobian_cache_get(jacobian_cache,neq,(jacobian != NULL),&jac,error_message),
+               error_message,error_message);
+  }
 
   /* Initialize workspace for numjac: */
   class_call(initialize_numjac_workspace(&nj_ws,neq,error_message),error_message,error_message);
@@ -237,9 +273,16 @@ int evolver_ndf15(
 
 
   nfenj=0;
-  class_call(numjac((*derivs),t,y,f0,&jac,&nj_ws,abstol,neq,
-             &nfenj,parameters_and_workspace_for_derivs,error_message),
-             error_message,error_message);
+  if (jacobian == NULL){
+    class_call(numjac((*derivs),t,y,f0,jac,&nj_ws,abstol,neq,
+                      &nfenj,parameters_and_workspace_for_derivs,error_message),
+               error_message,error_message);
+  }
+  else{
+    class_call(analytic_jac((*jacobian),t,y,jac,neq,
+                            parameters_and_workspace_for_derivs,error_message),
+               error_message,error_message);
+  }
   stepstat[3] += 1;
   stepstat[2] += nfenj;
   Jcurrent = _TRUE_; /* True */
@@ -266,10 +309,23 @@ int evolver_ndf15(
   stepstat[2] += 1;
 
   /*I assume that a full jacobi matrix is always calculated in the beginning...*/
-  for(ii=1;ii<=neq;ii++){
-    ddfddt[ii]=0.0;
-    for(jj=1;jj<=neq;jj++){
-      ddfddt[ii]+=(jac.dfdy[ii][jj])*f0[jj];
+  /*...except with an analytic jacobian, or with a sparsity pattern already trusted
+    in a previous call (see jacobian_cache_get), in which case it may only be stored
+    in sparse form:*/
+  if ((jac->use_sparse)&&((jacobian != NULL)||(jac->repeated_pattern >= jac->trust_sparse))){
+    for(ii=1;ii<=neq;ii++) ddfddt[ii]=0.0;
+    for(jj=0;jj<neq;jj++){
+      for(ii=jac->spJ->Ap[jj];ii<jac->spJ->Ap[jj+1];ii++){
+        ddfddt[jac->spJ->Ai[ii]+1]+=jac->xjac[ii]*f0[jj+1];
+      }
+    }
+  }
+  else{
+    for(ii=1;ii<=neq;ii++){
+      ddfddt[ii]=0.0;
+      for(jj=1;jj<=neq;jj++){
+        ddfddt[ii]+=(jac->dfdy[ii][jj])*f0[jj];
+      }
     }
   }
 
@@ -293,7 +349,7 @@ int evolver_ndf15(
 
   hinvGak = h*invGa[k-1];
   nconhk = 0;     /*steps taken with current h and k*/
-  class_call(new_linearisation(&jac,hinvGak,neq,error_message),
+  class_call(new_linearisation(jac,hinvGak,neq,error_message),
              error_message,error_message);
   stepstat[4] += 1;
   havrate = _FALSE_; /*false*/
@@ -328,7 +384,7 @@ int evolver_ndf15(
       adjust_stepsize(dif,(absh/abshlast),neq,k);
       hinvGak = h * invGa[k-1];
       nconhk = 0;
-      class_call(new_linearisation(&jac,hinvGak,neq,error_message),
+      class_call(new_linearisation(jac,hinvGak,neq,error_message),
                  error_message,error_message);
       stepstat[4] += 1;
       havrate = _FALSE_;
@@ -387,14 +443,14 @@ int evolver_ndf15(
           }
 
           /*Solve the linear system A*x=del by using the LU decomposition stored in jac.*/
-          if (jac.use_sparse){
-            funcreturn = sp_lusolve(jac.Numerical, rhs+1, del+1);
+          if (jac->use_sparse){
+            funcreturn = sp_lusolve(jac->Numerical, rhs+1, del+1);
             class_test(funcreturn == _FAILURE_,error_message,
             "Failure in sp_lusolve. Possibly singular matrix!");
           }
           else{
             eqvec(rhs,del,neq);
-            funcreturn = lubksb(jac.LU,neq,jac.luidx,del);
+            funcreturn = lubksb(jac->LU,neq,jac->luidx,del);
             class_test(funcreturn == _FAILURE_,error_message,
             "Failure in lubksb. Possibly singular matrix!");
           }
@@ -455,9 +511,16 @@ int evolver_ndf15(
             class_call((*derivs)(t,y+1,f0+1,parameters_and_workspace_for_derivs,error_message),
                        error_message,error_message);
             nfenj=0;
-            class_call(numjac((*derivs),t,y,f0,&jac,&nj_ws,abstol,neq,
-                       &nfenj,parameters_and_workspace_for_derivs,error_message),
-                       error_message,error_message);
+            if (jacobian == NULL){
+              class_call(numjac((*derivs),t,y,f0,jac,&nj_ws,abstol,neq,
+                                &nfenj,parameters_and_workspace_for_derivs,error_message),
+                         error_message,error_message);
+            }
+            else{
+              class_call(analytic_jac((*jacobian),t,y,jac,neq,
+                                      parameters_and_workspace_for_derivs,error_message),
+                         error_message,error_message);
+            }
             stepstat[3] += 1;
             stepstat[2] += (nfenj + 1);
             Jcurrent = _TRUE_;
@@ -477,7 +540,7 @@ int evolver_ndf15(
             nconhk = 0;
           }
           /* A new linearisation is needed in both cases */
-          class_call(new_linearisation(&jac,hinvGak,neq,error_message),
+          class_call(new_linearisation(jac,hinvGak,neq,error_message),
                      error_message,error_message);
           stepstat[4] += 1;
           havrate = _FALSE_;
@@ -526,7 +589,7 @@ int evolver_ndf15(
         adjust_stepsize(dif,(absh/abshlast),neq,k);
         hinvGak = h * invGa[k-1];
         nconhk = 0;
-        class_call(new_linearisation(&jac,hinvGak,neq,error_message),
+        class_call(new_linearisation(jac,hinvGak,neq,error_message),
                    error_message,error_message);
         stepstat[4] += 1;
         havrate = _FALSE_;
@@ -702,7 +765,10 @@ int evolver_ndf15(
   /*     free(dif[1]); */
   /*     free(dif); */
 
-  uninitialize_jacobian(&jac);
+  if (jacobian_cache == NULL){
+    uninitialize_jacobian(jac);
+    uninitialize_jacobian_entries(jac);
+  }
   uninitialize_numjac_workspace(&nj_ws);
   return _SUCCESS_;
 
@@ -964,9 +1030,17 @@ int new_linearisation(struct jacobian *jac,double hinvGak,int neq,ErrorMsg error
       }
     }
     /* Matrix constructed... */
-    if(jac->new_jacobian==_TRUE_){
-      /*I have a new pattern, and I have not done a LU decomposition
-        since the last jacobian calculation, so    I need to do a full
+    if (jac->has_symbolic==_TRUE_){
+      /* The pattern has not changed since the last full LU-decomposition
+         (possibly done in a previous call to evolver_ndf15, see
+         jacobian_cache_get), so I can just refactor, unless one of the
+         old pivots has become too small: */
+      if (sp_refactor(jac->Numerical, jac->spJ, 1e-6) == _FAILURE_){
+        jac->has_symbolic = _FALSE_;
+      }
+    }
+    if (jac->has_symbolic==_FALSE_){
+      /*I have a new pattern (or a bad pivot), so I need to do a full
         sparse LU-decomposition: */
       /* Find the sparsity pattern C = J + J':*/
       calc_C(jac);
@@ -978,12 +1052,9 @@ int new_linearisation(struct jacobian *jac,double hinvGak,int neq,ErrorMsg error
       funcreturn = sp_ludcmp(jac->Numerical, jac->spJ, 1e-3);
       class_test(funcreturn == _FAILURE_,error_message,
          "Failure in sp_ludcmp. Possibly singular matrix!");
-      jac->new_jacobian = _FALSE_;
-    }
-    else{
-      /* I have a repeated pattern, so I can just refactor:*/
-      sp_refactor(jac->Numerical, jac->spJ);
+      jac->has_symbolic = _TRUE_;
     }
+    jac->new_jacobian = _FALSE_;
   }
   else{
     /* Normal calculation: */
@@ -1191,7 +1262,11 @@ int fzero_Newton(int (*func)(double *x,
 /**********************************************************************/
 /* Here are some routines related to the calculation of the jacobian: */
 /* "numjac", "initialize_jacobian", "uninitialize_jacobian",                    */
-/* "initialize_numjac_workspace", "uninitialize_numjac_workspace".        */
+/* "initialize_numjac_workspace", "uninitialize_numjac_workspace",        */
+/* "analytic_jac", "initialize_jacobian_entries",                          */
+/* "uninitialize_jacobian_entries", "jacobian_cache_init",                */
+/* "jacobian_cache_get", "jacobian_cache_reset", "jacobian_cache_copy",  */
+/* "jacobian_cache_free".                                                 */
 /**********************************************************************/
 int numjac(
        int (*derivs)(double x, double * y,double * dy,
@@ -1514,6 +1589,9 @@ int numjac(
       else{
         /*Something has changed (or first run), better still do the full calculation..*/
         jac->repeated_pattern = 0;
+        /* ...and forget the grouping and the LU ordering of the old pattern: */
+        jac->has_grouping = 0;
+        jac->has_symbolic = _FALSE_;
       }
       jac->has_pattern = 1;
     }
@@ -1521,6 +1599,263 @@ int numjac(
   return _SUCCESS_;
 } /* End of numjac */
 
+int analytic_jac(
+       int (*jacobian)(double x, double * y, struct jacobian_entries * jac_entries,
+                       void * parameters_and_workspace, ErrorMsg error_message),
+       double t, double *y, struct jacobian *jac, int neq,
+       void * parameters_and_workspace_for_derivs, ErrorMsg error_message){
+  /*    Routine that gets the jacobian from the function (*jacobian) supplied
+    by the caller, as a list of non-zero entries in arbitrary order, and
+    stores it like numjac: in the sparse matrix (jac->spJ, jac->xjac) if
+    jac->use_sparse is true, otherwise in the dense matrix jac->dfdy.
+    The entries are sorted by row within each column with two counting
+    sorts, and duplicate entries are summed.
+  */
+  struct jacobian_entries *in, *out;
+  int i,j,n,nz,*count,*Ap,*Ai,pattern_broken;
+
+  in = &(jac->entries);
+  out = &(jac->sorted);
+  count = jac->entries_count;
+
+  /* Set new_jacobian flag: */
+  jac->new_jacobian = _TRUE_;
+
+  in->size = 0;
+  class_call((*jacobian)(t,y+1,in,parameters_and_workspace_for_derivs,error_message),
+             error_message,error_message);
+
+  if (jac->use_sparse){
+    /* The diagonal is always in the sparsity pattern, as in numjac: */
+    class_test(in->size+neq > in->size_max,error_message,
+               "too many jacobian entries: %d, maximum is %d",in->size+neq,in->size_max);
+    for(i=0;i<neq;i++){
+      in->row[in->size] = i;
+      in->col[in->size] = i;
+      in->value[in->size] = 0.0;
+      in->size++;
+    }
+
+    /* Sort by row (from in to out), then by column (from out to in).
+       The second sort is stable, so rows remain sorted in each column. */
+    for(i=0;i<=neq;i++) count[i] = 0;
+    for(n=0;n<in->size;n++) count[in->row[n]+1]++;
+    for(i=0;i<neq;i++) count[i+1] += count[i];
+    for(n=0;n<in->size;n++){
+      j = count[in->row[n]]++;
+      out->row[j] = in->row[n];
+      out->col[j] = in->col[n];
+      out->value[j] = in->value[n];
+    }
+    for(i=0;i<=neq;i++) count[i] = 0;
+    for(n=0;n<in->size;n++) count[out->col[n]+1]++;
+    for(i=0;i<neq;i++) count[i+1] += count[i];
+    for(n=0;n<in->size;n++){
+      j = count[out->col[n]]++;
+      in->row[j] = out->row[n];
+      in->col[j] = out->col[n];
+      in->value[j] = out->value[n];
+    }
+
+    /* Write the compressed column format, summing duplicates, and check
+       whether the pattern is the same as for the previous jacobian: */
+    Ap = jac->spJ->Ap;
+    Ai = jac->spJ->Ai;
+    pattern_broken = !(jac->has_pattern);
+    Ap[0] = 0;
+    nz = 0;
+    n = 0;
+    for(j=0;j<neq;j++){
+      for( ;(n<in->size)&&(in->col[n]==j);n++){
+        if ((nz>Ap[j])&&(Ai[nz-1]==in->row[n])){
+          jac->xjac[nz-1] += in->value[n];
+        }
+        else{
+          if (nz>=jac->max_nonzero){
+            /* Too many non-zero points to take advantage of sparsity.*/
+            jac->use_sparse = 0;
+            break;
+          }
+          if ((pattern_broken == _FALSE_) && (Ai[nz] != in->row[n])) pattern_broken = _TRUE_;
+          Ai[nz] = in->row[n];
+          jac->xjac[nz] = in->value[n];
+          nz++;
+        }
+      }
+      if (jac->use_sparse==_FALSE_) break;
+      if ((pattern_broken == _FALSE_) && (Ap[j+1] != nz)) pattern_broken = _TRUE_;
+      Ap[j+1] = nz;
+    }
+    if (pattern_broken == _TRUE_){
+      jac->has_symbolic = _FALSE_;
+    }
+    jac->has_pattern = _TRUE_;
+  }
+
+  if (jac->use_sparse==_FALSE_){
+    /* Dense case: */
+    for(i=1;i<=neq;i++){
+      for(j=1;j<=neq;j++){
+        jac->dfdy[i][j] = 0.0;
+      }
+    }
+    for(n=0;n<in->size;n++){
+      jac->dfdy[in->row[n]+1][in->col[n]+1] += in->value[n];
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+int jacobian_cache_init(struct jacobian_cache *pjc){
+  pjc->key = 0;
+  pjc->size = 0;
+  pjc->neq = NULL;
+  pjc->keys = NULL;
+  pjc->analytic = NULL;
+  pjc->jac = NULL;
+  return _SUCCESS_;
+}
+
+int jacobian_cache_get(struct jacobian_cache *pjc, int neq, int analytic, struct jacobian **pjac,
+                       ErrorMsg error_message){
+  /* Return the jacobian stored for a system of neq equations with the key pjc->key,
+     or a new one if there is none yet. The pattern, grouping, ordering and pivot
+     sequence are kept, but the increments of numjac are reset. */
+  int n,i;
+
+  for (n=0;n<pjc->size;n++){
+    if ((pjc->neq[n] == neq) && (pjc->keys[n] == pjc->key) && (pjc->analytic[n] == analytic)){
+      *pjac = pjc->jac[n];
+      for (i=1;i<=neq;i++) (*pjac)->jacvec[i]=1.490116119384765597872e-8;
+      return _SUCCESS_;
+    }
+  }
+
+  n = pjc->size;
+  class_realloc(pjc->neq,pjc->neq,(n+1)*sizeof(int),error_message);
+  class_realloc(pjc->keys,pjc->keys,(n+1)*sizeof(int),error_message);
+  class_realloc(pjc->analytic,pjc->analytic,(n+1)*sizeof(int),error_message);
+  class_realloc(pjc->jac,pjc->jac,(n+1)*sizeof(struct jacobian *),error_message);
+  class_alloc(pjc->jac[n],sizeof(struct jacobian),error_message);
+  pjc->neq[n] = neq;
+  pjc->keys[n] = pjc->key;
+  pjc->analytic[n] = analytic;
+
+  class_call(initialize_jacobian(pjc->jac[n],neq,error_message),error_message,error_message);
+  if (analytic){
+    class_call(initialize_jacobian_entries(pjc->jac[n],neq,error_message),error_message,error_message);
+  }
+  pjc->size++;
+
+  *pjac = pjc->jac[n];
+  return _SUCCESS_;
+}
+
+int jacobian_cache_reset(struct jacobian_cache *pjc){
+  /* Keep the stored jacobians allocated, but forget their pattern, grouping,
+     ordering and pivot sequence, so that the next call behaves as with a new
+     jacobian. */
+  int n;
+  for (n=0;n<pjc->size;n++){
+    pjc->jac[n]->use_sparse = pjc->jac[n]->sparse_stuff_initialized;
+    pjc->jac[n]->repeated_pattern = 0;
+    pjc->jac[n]->has_grouping = 0;
+    pjc->jac[n]->has_pattern = 0;
+    pjc->jac[n]->has_symbolic = _FALSE_;
+  }
+  return _SUCCESS_;
+}
+
+int jacobian_cache_copy(struct jacobian_cache *out, struct jacobian_cache *in,
+                        ErrorMsg error_message){
+  /* Give to the jacobians of out the pattern, grouping, ordering and pivot
+     sequence of the jacobians of in, creating them if needed, and reset the
+     other ones: the next call with out then behaves exactly as the next call
+     with in (if out and in are the same cache, nothing changes). The values
+     of the jacobians are not copied, since they are computed again at the
+     first step of each call. */
+  struct jacobian *jac, *ref;
+  int n,key;
+
+  if (out == in)
+    return _SUCCESS_;
+
+  class_call(jacobian_cache_reset(out),error_message,error_message);
+
+  key = out->key;
+  for (n=0;n<in->size;n++){
+    out->key = in->keys[n];
+    class_call(jacobian_cache_get(out,in->neq[n],in->analytic[n],&jac,error_message),
+               error_message,error_message);
+    ref = in->jac[n];
+    jac->use_sparse = ref->use_sparse;
+    jac->repeated_pattern = ref->repeated_pattern;
+    jac->has_grouping = ref->has_grouping;
+    jac->has_pattern = ref->has_pattern;
+    jac->has_symbolic = ref->has_symbolic;
+    jac->max_group = ref->max_group;
+    if (ref->sparse_stuff_initialized){
+      if (ref->has_grouping)
+        memcpy(jac->col_group,ref->col_group,in->neq[n]*sizeof(int));
+      if (ref->has_pattern)
+        sp_mat_copy(jac->spJ,ref->spJ);
+      if (ref->has_symbolic)
+        sp_num_copy(jac->Numerical,ref->Numerical);
+    }
+  }
+  out->key = key;
+
+  return _SUCCESS_;
+}
+
+int jacobian_cache_free(struct jacobian_cache *pjc){
+  int n;
+  for (n=0;n<pjc->size;n++){
+    uninitialize_jacobian(pjc->jac[n]);
+    uninitialize_jacobian_entries(pjc->jac[n]);
+    free(pjc->jac[n]);
+  }
+  free(pjc->neq);
+  free(pjc->keys);
+  free(pjc->analytic);
+  free(pjc->jac);
+  jacobian_cache_init(pjc);
+  return _SUCCESS_;
+}
+
+int initialize_jacobian_entries(struct jacobian *jac, int neq, ErrorMsg error_message){
+
+  /* Room for the entries written by (*jacobian), plus the diagonal: */
+  jac->entries.size_max = MIN(neq*neq,2*jac->max_nonzero)+neq;
+  jac->sorted.size_max = jac->entries.size_max;
+
+  class_alloc(jac->entries.row,sizeof(int)*jac->entries.size_max,error_message);
+  class_alloc(jac->entries.col,sizeof(int)*jac->entries.size_max,error_message);
+  class_alloc(jac->entries.value,sizeof(double)*jac->entries.size_max,error_message);
+  class_alloc(jac->sorted.row,sizeof(int)*jac->sorted.size_max,error_message);
+  class_alloc(jac->sorted.col,sizeof(int)*jac->sorted.size_max,error_message);
+  class_alloc(jac->sorted.value,sizeof(double)*jac->sorted.size_max,error_message);
+  class_alloc(jac->entries_count,sizeof(int)*(neq+1),error_message);
+
+  jac->analytic_stuff_initialized = 1;
+  return _SUCCESS_;
+}
+
+int uninitialize_jacobian_entries(struct jacobian *jac){
+  if (jac->analytic_stuff_initialized){
+    free(jac->entries.row);
+    free(jac->entries.col);
+    free(jac->entries.value);
+    free(jac->sorted.row);
+    free(jac->sorted.col);
+    free(jac->sorted.value);
+    free(jac->entries_count);
+    jac->analytic_stuff_initialized = 0;
+  }
+  return _SUCCESS_;
+}
+
 int initialize_jacobian(struct jacobian *jac, int neq, ErrorMsg error_message){
   int i;
 
@@ -1539,7 +1874,9 @@ int initialize_jacobian(struct jacobian *jac, int neq, ErrorMsg error_message){
   /* Number of times a pattern is repeated before we trust it. */
   jac->has_grouping = 0;
   jac->has_pattern = 0;
+  jac->has_symbolic = _FALSE_;
   jac->sparse_stuff_initialized=0;
+  jac->analytic_stuff_initialized=0;
 
   /*Setup memory for the pointers of the dense method:*/
 
@@ -31,6 +31,12 @@ int evolver_rk(int (*derivs)(double x,
 					   double dy[],
 					   void * parameters_and_workspace,
 					   ErrorMsg error_message),
+		    int (*jacobian)(double x,
+				    double * y,
+				    struct jacobian_entries * jac_entries,
+				    void * parameters_and_workspace,
+				    ErrorMsg error_message), /* not used by this evolver, only by ndf15 (can be NULL) */
+		    struct jacobian_cache * jacobian_cache, /* idem */
 		    ErrorMsg error_message) {
 
   int next_index_x;
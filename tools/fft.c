@@ -0,0 +1,158 @@
+/**
+ * Module with tools for fast Fourier transforms
+ *
+ * Radix-2 complex transforms on interleaved arrays (data[2*i] is the
+ * real part and data[2*i+1] the imaginary part of the i-th element),
+ * with twiddle factors computed once for a given size.
+ */
+
+#include "fft.h"
+
+/**
+ * Smallest power of two larger or equal to n_min
+ *
+ * @param n_min Input: minimum size
+ * @return the size
+ */
+
+int fft_size(
+             int n_min
+             ) {
+
+  int n=1;
+
+  while (n < n_min)
+    n <<= 1;
+
+  return n;
+}
+
+/**
+ * Fill the table of twiddle factors for transforms of size n:
+ * twiddle[2*k] = \f$ \cos(2 \pi k/n) \f$ and twiddle[2*k+1] = \f$ \sin(2 \pi k/n) \f$
+ * for 0 <= k < n/2
+ *
+ * @param twiddle       Output: table of size n (already allocated)
+ * @param n             Input: size of the transforms, must be a power of two
+ * @param error_message Output: error message
+ * @return the error status
+ */
+
+int fft_twiddle_init(
+                     double * twiddle,
+                     int n,
+                     ErrorMsg error_message
+                     ) {
+
+  int k;
+
+  class_test((n < 2) || (n & (n-1)),
+             error_message,
+             "size of fast Fourier transform n=%d should be a power of two",n);
+
+  for (k=0; k<n/2; k++) {
+    twiddle[2*k] = cos(2.*_PI_*k/n);
+    twiddle[2*k+1] = sin(2.*_PI_*k/n);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * In-place complex transform
+ * \f$ data_k \leftarrow \sum_j data_j e^{sign \, 2 \pi i j k/n} \f$
+ * (not normalised: a forward and a backward transform multiply data by n)
+ *
+ * @param data    Input/output: interleaved array of n complex numbers
+ * @param twiddle Input: table filled by fft_twiddle_init() for the same n
+ * @param n       Input: size, must be a power of two
+ * @param sign    Input: -1 for forward, +1 for backward transform
+ * @return the error status
+ */
+
+int fft_complex(
+                double * data,
+                double * twiddle,
+                int n,
+                int sign
+                ) {
+
+  int i,j,k,m,half,stride;
+  double tmp,wr,wi,tr,ti;
+
+  /** - reorder the elements by bit reversal of their index */
+  for (i=1, j=0; i<n; i++) {
+    m = n >> 1;
+    while (j & m) {
+      j ^= m;
+      m >>= 1;
+    }
+    j |= m;
+    if (i < j) {
+      tmp = data[2*i]; data[2*i] = data[2*j]; data[2*j] = tmp;
+      tmp = data[2*i+1]; data[2*i+1] = data[2*j+1]; data[2*j+1] = tmp;
+    }
+  }
+
+  /** - Danielson-Lanczos butterflies of increasing size */
+  for (half=1; half<n; half<<=1) {
+    stride = n/(2*half);
+    for (k=0; k<half; k++) {
+      wr = twiddle[2*k*stride];
+      wi = sign*twiddle[2*k*stride+1];
+      for (i=k; i<n; i+=2*half) {
+        j = i+half;
+        tr = wr*data[2*j]-wi*data[2*j+1];
+        ti = wr*data[2*j+1]+wi*data[2*j];
+        data[2*j] = data[2*i]-tr;
+        data[2*j+1] = data[2*i+1]-ti;
+        data[2*i] += tr;
+        data[2*i+1] += ti;
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Forward transforms of two real arrays a and b with a single complex
+ * transform of a+ib
+ *
+ * @param data       Input: interleaved array with data[2*j]=a_j, data[2*j+1]=b_j (overwritten)
+ * @param twiddle    Input: table filled by fft_twiddle_init() for the same n
+ * @param n          Input: size, must be a power of two
+ * @param spectrum_a Output: interleaved transform of a (n complex numbers, already allocated)
+ * @param spectrum_b Output: interleaved transform of b (n complex numbers, already allocated; not computed if NULL)
+ * @return the error status
+ */
+
+int fft_real_pair(
+                  double * data,
+                  double * twiddle,
+                  int n,
+                  double * spectrum_a,
+                  double * spectrum_b
+                  ) {
+
+  int k,kc;
+  double zr,zi,cr,ci;
+
+  fft_complex(data,twiddle,n,-1);
+
+  for (k=0; k<n; k++) {
+    kc = (n-k) & (n-1);
+    zr = data[2*k];
+    zi = data[2*k+1];
+    cr = data[2*kc];
+    ci = -data[2*kc+1];
+    spectrum_a[2*k] = 0.5*(zr+cr);
+    spectrum_a[2*k+1] = 0.5*(zi+ci);
+    if (spectrum_b != NULL) {
+      spectrum_b[2*k] = 0.5*(zi-ci);
+      spectrum_b[2*k+1] = -0.5*(zr-cr);
+    }
+  }
+
+  return _SUCCESS_;
+}
@@ -6,6 +6,10 @@
  */
 
 #include "hyperspherical.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 int hyperspherical_HIS_create(int K,
                               double beta,
@@ -25,20 +29,45 @@ int hyperspherical_HIS_create(int K,
       single call, and return the pointer as ppHIS. All pointers inside are
       then relative to ppHIS.
   */
-  double deltax, beta2, lambda, x, xfwd;
-  double *sqrtK, *one_over_sqrtK,*PhiL;
-  int j, k, l, nx, lmax, l_recurrence_max;
-  int abort;
-  int current_chunk, index_x;
+  double deltax, lambda;
+  int nx;
 
-  beta2 = beta*beta;
-  lmax = lvec[nl-1];
   lambda = 2*_PI_/beta;
   nx = (int) ((xmax-xmin)*sampling/lambda);
   nx = MAX(nx,2);
   deltax = (xmax-xmin)/(nx-1.0);
   //fprintf(stderr,"dx=%e\n",deltax);
   //fprintf(stderr,"%e %e\n",beta,sampling);
+
+  class_call(hyperspherical_HIS_create_on_grid(K,beta,nl,lvec,xmin,deltax,nx,l_WKB,phiminabs,pHIS,error_message),
+             error_message,
+             error_message);
+
+  return _SUCCESS_;
+}
+
+int hyperspherical_HIS_create_on_grid(int K,
+                                      double beta,
+                                      int nl,
+                                      int *lvec,
+                                      double xmin,
+                                      double deltax,
+                                      int nx,
+                                      int l_WKB,
+                                      double phiminabs,
+                                      HyperInterpStruct *pHIS,
+                                      ErrorMsg error_message){
+  /** Same as hyperspherical_HIS_create(), but for a given x-sampling:
+      nx values of x, starting from xmin, with a step deltax.
+  */
+  double beta2, x, xfwd;
+  double *sqrtK, *one_over_sqrtK,*PhiL;
+  int j, k, l, lmax, l_recurrence_max;
+  int abort;
+  int current_chunk, index_x;
+
+  beta2 = beta*beta;
+  lmax = lvec[nl-1];
   //Set scalar values:
   pHIS->beta = beta;
   pHIS->delta_x = deltax;
@@ -247,7 +276,13 @@ int hyperspherical_HIS_create(int K,
 }
 
 size_t hyperspherical_HIS_size(int nl, int nx){
-  return(sizeof(int)*nl+sizeof(double)*nl+3*sizeof(double)*nx+2*sizeof(double)*nx*nl);
+  return(hyperspherical_HIS_int_size(nl)+sizeof(double)*nl+3*sizeof(double)*nx+2*sizeof(double)*nx*nl);
+}
+
+size_t hyperspherical_HIS_int_size(int nl){
+  /** Size of the vector of l values in a contiguous storage, rounded up
+      such that the following double arrays remain aligned. */
+  return(((sizeof(int)*nl+_HIS_BYTE_ALIGNMENT_-1)/_HIS_BYTE_ALIGNMENT_)*_HIS_BYTE_ALIGNMENT_);
 }
 
 int hyperspherical_update_pointers(HyperInterpStruct *pHIS_local,
@@ -258,7 +293,7 @@ int hyperspherical_update_pointers(HyperInterpStruct *pHIS_local,
   int nx=pHIS_local->x_size;
   int nl=pHIS_local->l_size;
   pHIS_local->l = (int *) (HIS_storage_shared);
-  pHIS_local->chi_at_phimin = (double *) (pHIS_local->l+nl);
+  pHIS_local->chi_at_phimin = (double *) ((char *) HIS_storage_shared + hyperspherical_HIS_int_size(nl));
   pHIS_local->x = pHIS_local->chi_at_phimin+nl;
   pHIS_local->sinK = pHIS_local->x + nx;
   pHIS_local->cotK = pHIS_local->sinK + nx;
@@ -282,6 +317,339 @@ int hyperspherical_HIS_free(HyperInterpStruct *pHIS,
   return _SUCCESS_;
 }
 
+/**
+ * List of flat-space interpolation structures shared by all the runs
+ * performed by this process (see hyperspherical_HIS_flat_shared_get()).
+ */
+static HyperSharedTable * hyperspherical_shared_tables = NULL;
+
+int hyperspherical_HIS_flat_shared_get(int nl,
+                                       int *lvec,
+                                       double xmin,
+                                       double xmax,
+                                       double sampling,
+                                       int l_WKB,
+                                       double phiminabs,
+                                       short use_file,
+                                       char *directory,
+                                       int verbose,
+                                       HyperInterpStruct **ppHIS,
+                                       ErrorMsg error_message){
+  /** Return a pointer to a flat-space (K=0, beta=1) interpolation
+      structure on [xmin,xmax], shared read-only with the other runs of
+      the process. The x-sampling is exactly the one of
+      hyperspherical_HIS_create(), so the results do not depend on
+      whether the table is shared: a table is only reused by runs
+      asking for the same sampling, the same l's and the same
+      precision parameters. If use_file is true, the table is also
+      looked for in (or written to) a binary file in the given
+      directory, and memory-mapped, so that successive processes skip
+      its computation and processes running on the same node share one
+      physical copy. Each call must be followed by a call to
+      hyperspherical_HIS_flat_shared_release(). */
+  int status;
+
+#pragma omp critical (hyperspherical_shared)
+  {
+    status = hyperspherical_HIS_flat_shared_get_serial(nl,lvec,xmin,xmax,sampling,l_WKB,phiminabs,
+                                                       use_file,directory,verbose,ppHIS,error_message);
+  }
+
+  return status;
+}
+
+int hyperspherical_HIS_flat_shared_release(HyperInterpStruct *pHIS,
+                                           ErrorMsg error_message){
+  /** Release a structure obtained with hyperspherical_HIS_flat_shared_get().
+      It is kept in memory for the next runs, until a run needs a
+      different table. */
+  int status;
+
+#pragma omp critical (hyperspherical_shared)
+  {
+    status = hyperspherical_HIS_flat_shared_release_serial(pHIS,error_message);
+  }
+
+  return status;
+}
+
+int hyperspherical_HIS_flat_shared_get_serial(int nl,
+                                              int *lvec,
+                                              double xmin,
+                                              double xmax,
+                                              double sampling,
+                                              int l_WKB,
+                                              double phiminabs,
+                                              short use_file,
+                                              char *directory,
+                                              int verbose,
+                                              HyperInterpStruct **ppHIS,
+                                              ErrorMsg error_message){
+  /** Body of hyperspherical_HIS_flat_shared_get(), to be called by one
+      thread at a time. */
+  HyperSharedTable *pHST, **ppHST;
+  FileName filename;
+  unsigned long long key;
+  double deltax, lambda, beta=1.;
+  int K=0, nx;
+  short found;
+
+  /* same sampling as in hyperspherical_HIS_create() */
+  lambda = 2*_PI_/beta;
+  nx = (int) ((xmax-xmin)*sampling/lambda);
+  nx = MAX(nx,2);
+  deltax = (xmax-xmin)/(nx-1.0);
+
+  key = _HASH_INIT_;
+  key = class_hash(key,&K,sizeof(int));
+  key = class_hash(key,&beta,sizeof(double));
+  key = class_hash(key,&nl,sizeof(int));
+  key = class_hash(key,lvec,nl*sizeof(int));
+  key = class_hash(key,&xmin,sizeof(double));
+  key = class_hash(key,&deltax,sizeof(double));
+  key = class_hash(key,&nx,sizeof(int));
+  key = class_hash(key,&l_WKB,sizeof(int));
+  key = class_hash(key,&phiminabs,sizeof(double));
+
+  /** Look for the same table in memory */
+  for (pHST=hyperspherical_shared_tables; pHST!=NULL; pHST=pHST->next){
+    if ((pHST->key == key) && (pHST->HIS.x_size == nx) && (pHST->HIS.delta_x == deltax)){
+      pHST->refcount++;
+      *ppHIS = &(pHST->HIS);
+      return _SUCCESS_;
+    }
+  }
+
+  /** Otherwise, free the tables not used anymore, and get a new one */
+  ppHST = &hyperspherical_shared_tables;
+  while (*ppHST != NULL){
+    pHST = *ppHST;
+    if (pHST->refcount == 0){
+      *ppHST = pHST->next;
+      class_call(hyperspherical_HIS_flat_shared_free(pHST,error_message),
+                 error_message,
+                 error_message);
+    }
+    else{
+      ppHST = &(pHST->next);
+    }
+  }
+
+  class_calloc(pHST,1,sizeof(HyperSharedTable),error_message);
+  pHST->key = key;
+
+  found = _FALSE_;
+  if (use_file == _TRUE_){
+    class_test_except(snprintf(filename,_FILENAMESIZE_,"%s/bessel_%016llx.bin",directory,key) >= _FILENAMESIZE_,
+                      error_message,
+                      free(pHST),
+                      "the name of the Bessel function file in directory %s is longer than %d characters",
+                      directory,_FILENAMESIZE_-1);
+    class_call(hyperspherical_HIS_map_file(filename,key,nl,nx,deltax,pHST,&found,error_message),
+               error_message,
+               error_message);
+    if ((found == _TRUE_) && (verbose > 0))
+      printf(" -> mapped Bessel functions from file %s\n",filename);
+  }
+
+  if (found == _FALSE_){
+
+    class_call(hyperspherical_HIS_create_on_grid(K,beta,nl,lvec,xmin,deltax,nx,l_WKB,phiminabs,&(pHST->HIS),error_message),
+               error_message,
+               error_message);
+
+    if (use_file == _TRUE_){
+      class_call(hyperspherical_HIS_write_file(filename,key,&(pHST->HIS),error_message),
+                 error_message,
+                 error_message);
+      class_call(hyperspherical_HIS_free(&(pHST->HIS),error_message),
+                 error_message,
+                 error_message);
+      class_call(hyperspherical_HIS_map_file(filename,key,nl,nx,deltax,pHST,&found,error_message),
+                 error_message,
+                 error_message);
+      class_test(found == _FALSE_,
+                 error_message,
+                 "could not map file %s just written",filename);
+      if (verbose > 0)
+        printf(" -> wrote Bessel functions in file %s\n",filename);
+    }
+  }
+
+  pHST->refcount = 1;
+  pHST->next = hyperspherical_shared_tables;
+  hyperspherical_shared_tables = pHST;
+
+  *ppHIS = &(pHST->HIS);
+
+  return _SUCCESS_;
+}
+
+int hyperspherical_HIS_flat_shared_release_serial(HyperInterpStruct *pHIS,
+                                                  ErrorMsg error_message){
+  /** Body of hyperspherical_HIS_flat_shared_release(), to be called by
+      one thread at a time. */
+  HyperSharedTable **ppHST;
+
+  for (ppHST=&hyperspherical_shared_tables; *ppHST!=NULL; ppHST=&((*ppHST)->next)){
+    if (&((*ppHST)->HIS) == pHIS)
+      break;
+  }
+
+  class_test(*ppHST == NULL,
+             error_message,
+             "this interpolation structure was not obtained with hyperspherical_HIS_flat_shared_get()");
+
+  (*ppHST)->refcount--;
+
+  return _SUCCESS_;
+}
+
+int hyperspherical_HIS_flat_shared_free(HyperSharedTable *pHST,
+                                        ErrorMsg error_message){
+  /** Free a shared table, either allocated or memory-mapped. */
+  if (pHST->map != NULL){
+    class_test(munmap(pHST->map,pHST->map_size) != 0,
+               error_message,
+               "could not unmap Bessel function file");
+  }
+  else{
+    class_call(hyperspherical_HIS_free(&(pHST->HIS),error_message),
+               error_message,
+               error_message);
+  }
+  free(pHST);
+
+  return _SUCCESS_;
+}
+
+int hyperspherical_HIS_write_file(char *filename,
+                                  unsigned long long key,
+                                  HyperInterpStruct *pHIS,
+                                  ErrorMsg error_message){
+  /** Write an interpolation structure in a binary file: a header,
+      followed by all arrays in the contiguous layout of
+      hyperspherical_update_pointers(). The file is first written under
+      a temporary name and then renamed, such that processes reading it
+      at the same time never see an incomplete file. */
+  HyperSharedFileHeader header;
+  HyperInterpStruct HIS_file;
+  FileName tmpname;
+  FILE *pfile;
+  void *storage;
+  size_t storage_size, written;
+  int nl = pHIS->l_size;
+  int nx = pHIS->x_size;
+
+  storage_size = hyperspherical_HIS_size(nl,nx);
+  class_calloc(storage,storage_size,1,error_message);
+
+  HIS_file.l_size = nl;
+  HIS_file.x_size = nx;
+  hyperspherical_update_pointers(&HIS_file,storage);
+  memcpy(HIS_file.l,pHIS->l,nl*sizeof(int));
+  memcpy(HIS_file.chi_at_phimin,pHIS->chi_at_phimin,nl*sizeof(double));
+  memcpy(HIS_file.x,pHIS->x,nx*sizeof(double));
+  memcpy(HIS_file.sinK,pHIS->sinK,nx*sizeof(double));
+  memcpy(HIS_file.cotK,pHIS->cotK,nx*sizeof(double));
+  memcpy(HIS_file.phi,pHIS->phi,nx*nl*sizeof(double));
+  memcpy(HIS_file.dphi,pHIS->dphi,nx*nl*sizeof(double));
+
+  memset(&header,0,sizeof(HyperSharedFileHeader));
+  memcpy(header.magic,"CLASSHIS",8);
+  header.key = key;
+  header.K = pHIS->K;
+  header.l_size = nl;
+  header.x_size = nx;
+  header.trig_order = pHIS->trig_order;
+  header.beta = pHIS->beta;
+  header.delta_x = pHIS->delta_x;
+
+  class_test_except(snprintf(tmpname,_FILENAMESIZE_,"%s.%ld.tmp",filename,(long)getpid()) >= _FILENAMESIZE_,
+                    error_message,
+                    free(storage),
+                    "the name of the temporary Bessel function file %s.*.tmp is longer than %d characters",
+                    filename,_FILENAMESIZE_-1);
+  class_open(pfile,tmpname,"wb",error_message);
+  written = fwrite(&header,sizeof(HyperSharedFileHeader),1,pfile);
+  written += fwrite(storage,storage_size,1,pfile);
+  fclose(pfile);
+  free(storage);
+
+  class_test_except(written != 2,
+                    error_message,
+                    remove(tmpname),
+                    "could not write Bessel functions in file %s",tmpname);
+
+  class_test_except(rename(tmpname,filename) != 0,
+                    error_message,
+                    remove(tmpname),
+                    "could not rename file %s into %s",tmpname,filename);
+
+  return _SUCCESS_;
+}
+
+int hyperspherical_HIS_map_file(char *filename,
+                                unsigned long long key,
+                                int nl,
+                                int nx,
+                                double deltax,
+                                HyperSharedTable *pHST,
+                                short *found,
+                                ErrorMsg error_message){
+  /** Map read-only a file written by hyperspherical_HIS_write_file(), if
+      it exists, has the right key, and has exactly nx values of x
+      separated by deltax. Otherwise, return found = _FALSE_. */
+  HyperSharedFileHeader *pheader;
+  struct stat file_status;
+  void *map;
+  int fd;
+
+  *found = _FALSE_;
+
+  fd = open(filename,O_RDONLY);
+  if (fd < 0)
+    return _SUCCESS_;
+
+  if ((fstat(fd,&file_status) != 0) || (file_status.st_size < (off_t)sizeof(HyperSharedFileHeader))){
+    close(fd);
+    return _SUCCESS_;
+  }
+
+  map = mmap(NULL,file_status.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return _SUCCESS_;
+
+  pheader = (HyperSharedFileHeader *) map;
+
+  if ((memcmp(pheader->magic,"CLASSHIS",8) != 0) ||
+      (pheader->key != key) ||
+      (pheader->l_size != nl) ||
+      (pheader->x_size != nx) ||
+      (pheader->delta_x != deltax) ||
+      ((size_t)file_status.st_size != sizeof(HyperSharedFileHeader)+hyperspherical_HIS_size(pheader->l_size,pheader->x_size))){
+    class_test(munmap(map,file_status.st_size) != 0,
+               error_message,
+               "could not unmap file %s",filename);
+    return _SUCCESS_;
+  }
+
+  pHST->map = map;
+  pHST->map_size = file_status.st_size;
+  pHST->HIS.K = pheader->K;
+  pHST->HIS.beta = pheader->beta;
+  pHST->HIS.delta_x = pheader->delta_x;
+  pHST->HIS.trig_order = pheader->trig_order;
+  pHST->HIS.l_size = pheader->l_size;
+  pHST->HIS.x_size = pheader->x_size;
+  hyperspherical_update_pointers(&(pHST->HIS),(char *) map + sizeof(HyperSharedFileHeader));
+
+  *found = _TRUE_;
+
+  return _SUCCESS_;
+}
+
 int hyperspherical_Hermite_interpolation_vector(HyperInterpStruct *pHIS,
                                                 int nxi,
                                                 int lnum,
@@ -1561,6 +1929,104 @@ int hyperspherical_Hermite3_interpolation_vector_PhidPhid2Phi(HyperInterpStruct
 #include "hermite3_interpolation_csource.h"
   return _SUCCESS_;
 }
+/** Hermite interpolation of order 4 of Phi_l at x=xinterp[j], for the
+    kernel below: find the interval containing x and the coefficients of
+    the polynomial independently for each point (zero outside the
+    interpolation range). Same formulas as in hermite4_interpolation_csource.h */
+#define _HYPER_HERMITE4_PHI_                                            \
+  x = xinterp[j];                                                       \
+  idx = ((int) ((x-xmin)/deltax))+1;                                    \
+  idx = MAX(1,idx);                                                     \
+  idx = MIN(nx-1,idx);                                                  \
+  ym = Phi_l[idx-1];                                                    \
+  yp = Phi_l[idx];                                                      \
+  dym = dPhi_l[idx-1];                                                  \
+  dyp = dPhi_l[idx];                                                    \
+  a0 = dym*deltax;                                                      \
+  a1 = -2*dym*deltax-dyp*deltax-3*ym+3*yp;                              \
+  a2 = dym*deltax+dyp*deltax+2*ym-2*yp;                                 \
+  z = (x-xvec[idx-1])/deltax;                                           \
+  z2 = z*z;                                                             \
+  z3 = z2*z;                                                            \
+  Phi = ((x<xmin)||(x>xmax)) ? 0. : (ym+a0*z+a1*z2+a2*z3);
+
+_HYPER_TARGET_CLONES_
+int hyperspherical_Hermite4_convolution_Phi(HyperInterpStruct *pHIS,
+                                            int nxi,
+                                            int lnum,
+                                            double * __restrict__ xinterp,
+                                            double * __restrict__ integrand,
+                                            double * __restrict__ w_trapz,
+                                            double * __restrict__ cscK,
+                                            int cscK_power,
+                                            double factor,
+                                            double *result,
+                                            double *radial_last){
+  /** Fused version of hyperspherical_Hermite4_interpolation_vector_Phi()
+      followed by array_trapezoidal_convolution(), for a flat or open
+      structure (no periodicity): compute in a single pass
+
+      result = sum_j integrand[j] * radial(x_j) * w_trapz[j],
+      radial(x_j) = factor * cscK[j]^cscK_power * Phi_l(x_j),
+
+      with cscK_power = 0, 1 or 2, as well as radial(x_{nxi-1}).
+      Instead of reusing the coefficients of the Hermite polynomial
+      between neighbouring points, which requires the values of x to
+      be sorted and a sequential loop, the interval and the
+      coefficients are found independently for each point. The loop
+      can then be vectorised by the compiler (using the widest
+      instruction set available at runtime when the compiler supports
+      function multiversioning, see _HYPER_TARGET_CLONES_).
+  */
+  double *xvec = pHIS->x;
+  double deltax = pHIS->delta_x;
+  int nx = pHIS->x_size;
+  double *Phi_l = pHIS->phi+lnum*nx;
+  double *dPhi_l = pHIS->dphi+lnum*nx;
+  double xmin = xvec[0];
+  double xmax = xvec[nx-1];
+  double res = 0.;
+  double x, z, z2, z3, ym, yp, dym, dyp, a0, a1, a2, Phi;
+  int j, idx;
+
+  /** Radial function at the last point (needed by the caller for
+      correcting the trapezoidal rule when the integral is truncated) */
+  j = nxi-1;
+  _HYPER_HERMITE4_PHI_
+  *radial_last = factor*Phi;
+  for (idx=0; idx<cscK_power; idx++)
+    *radial_last *= cscK[j];
+
+  /** Convolution, with one loop for each power of cscK */
+  switch (cscK_power){
+  case 0:
+#pragma omp simd private(x,idx,ym,yp,dym,dyp,a0,a1,a2,z,z2,z3,Phi) reduction(+:res)
+    for (j=0; j<nxi; j++){
+      _HYPER_HERMITE4_PHI_
+      res += integrand[j]*(factor*Phi)*w_trapz[j];
+    }
+    break;
+  case 1:
+#pragma omp simd private(x,idx,ym,yp,dym,dyp,a0,a1,a2,z,z2,z3,Phi) reduction(+:res)
+    for (j=0; j<nxi; j++){
+      _HYPER_HERMITE4_PHI_
+      res += integrand[j]*(factor*cscK[j]*Phi)*w_trapz[j];
+    }
+    break;
+  default:
+#pragma omp simd private(x,idx,ym,yp,dym,dyp,a0,a1,a2,z,z2,z3,Phi) reduction(+:res)
+    for (j=0; j<nxi; j++){
+      _HYPER_HERMITE4_PHI_
+      res += integrand[j]*(factor*cscK[j]*cscK[j]*Phi)*w_trapz[j];
+    }
+    break;
+  }
+
+  *result = res;
+
+  return _SUCCESS_;
+}
+
 int hyperspherical_Hermite4_interpolation_vector_Phi(HyperInterpStruct *pHIS,
                                                      int nxi,
                                                      int lnum,
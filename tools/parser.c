@@ -51,6 +51,8 @@ int parser_init(struct file_content * pfc,
                 char * filename,
                 ErrorMsg errmsg) {
 
+  pfc->read_by = NULL;
+
   if (size > 0) {
     pfc->size=size;
     class_alloc(pfc->filename,(strlen(filename)+1)*sizeof(char),errmsg);
@@ -70,6 +72,10 @@ int parser_free(struct file_content * pfc) {
     free(pfc->value);
     free(pfc->read);
     free(pfc->filename);
+    if (pfc->read_by != NULL) {
+      free(pfc->read_by);
+      pfc->read_by = NULL;
+    }
   }
 
   return _SUCCESS_;
@@ -644,6 +650,7 @@ int parser_cat(struct file_content * pfc1,
   }
 
   pfc3->size = pfc1->size + pfc2->size;
+  pfc3->read_by = NULL;
   class_alloc(pfc3->value,pfc3->size*sizeof(FileArg),errmsg);
   class_alloc(pfc3->name,pfc3->size*sizeof(FileArg),errmsg);
   class_alloc(pfc3->read,pfc3->size*sizeof(short),errmsg);
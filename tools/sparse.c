@@ -59,6 +59,30 @@ int sp_num_alloc(sp_num** N, int n, ErrorMsg error_message){
 	return _SUCCESS_;
 }
 
+int sp_mat_copy(sp_mat *B, sp_mat *A){
+	/* Copy the column pointers and the A->Ap[ncols] entries of A into B,
+	allocated with the same dimensions. */
+	int nz = A->Ap[A->ncols];
+	memcpy(B->Ap,A->Ap,(A->ncols+1)*sizeof(int));
+	memcpy(B->Ai,A->Ai,nz*sizeof(int));
+	memcpy(B->Ax,A->Ax,nz*sizeof(double));
+	return _SUCCESS_;
+}
+
+int sp_num_copy(sp_num *M, sp_num *N){
+	/* Copy the LU decomposition N, with its ordering, pivot sequence and
+	reach sets, into M, allocated with the same n. */
+	int n = N->n;
+	sp_mat_copy(M->L,N->L);
+	sp_mat_copy(M->U,N->U);
+	memcpy(M->xi[0],N->xi[0],n*n*sizeof(int));
+	memcpy(M->topvec,N->topvec,n*sizeof(int));
+	memcpy(M->pinv,N->pinv,n*sizeof(int));
+	memcpy(M->p,N->p,n*sizeof(int));
+	memcpy(M->q,N->q,(n+1)*sizeof(int));
+	return _SUCCESS_;
+}
+
 int sp_num_free(sp_num *N){
 	sp_mat_free(N->L);
 	sp_mat_free(N->U);
@@ -227,8 +251,12 @@ int sp_lusolve(sp_num *N, double *b, double *x){
 	return _SUCCESS_;
 }
 
-int sp_refactor(sp_num *N, sp_mat *A){
-	double pivot, *Lx, *Ux, *x;
+int sp_refactor(sp_num *N, sp_mat *A, double pivtol){
+	/* Numerical LU decomposition of A, reusing the ordering, the pivot sequence
+	and the reach sets found by sp_ludcmp for a matrix with the same pattern.
+	Returns _FAILURE_ if a pivot is smaller than pivtol times the largest entry
+	it could have been chosen among; a full sp_ludcmp is then needed. */
+	double pivot, a, *Lx, *Ux, *x;
 	int *Lp, *Li, *Up, *Ui, *pinv, *pvec, *q;
 	int n, ipiv, k, top, p, i, col, lnz, unz;
 	n = A->ncols;
@@ -250,6 +278,13 @@ int sp_refactor(sp_num *N, sp_mat *A){
 		/* Assign values to U and L: */
 		ipiv = pvec[k];
 		pivot = x[ipiv];
+		/* Check that the old pivot is still acceptable: */
+		a = 0;
+		for (p=top; p<n; p++){
+			i = N->xi[k][p];
+			if ((pinv[i]>k) && (fabs(x[i])>a)) a = fabs(x[i]);
+		}
+		if ((pivot == 0) || (fabs(pivot)<a*pivtol)) return _FAILURE_;
 		Li[lnz] = ipiv;
 		Lx[lnz] = 1;
 		lnz++;